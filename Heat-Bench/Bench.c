@@ -0,0 +1,1918 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/// @file Bench.c
+/// @brief Benchmarks of the pattern matcher, the scan engine and the shift path.
+///
+///  Builds synthetic address spaces of heap-like noise with a given region
+///  fragmentation and decoy density, plants one real struct per target gear
+///  and keeps their live memory changing. Every layout is benchmarked with
+///  every search strategy the CPU supports:
+///
+///   - match: FindPattern() over the layout in AOBSCAN_BLOCK_SIZE blocks on
+///            one thread, the matcher alone.
+///   - scan:  AobScanTarget() through a memory source that counts its reads,
+///            up to the verified lock of every target gear.
+///
+///  The shift suite (--suite shift) injects synthetic key presses into the
+///  shift path of the keyboard hook, HandleShifterKey() to the gear writer
+///  thread, against a stand-in game of two gear fields:
+///
+///   - sequential: one press per shift, each once the previous one was written.
+///   - autorepeat: a storm of BENCH_AUTOREPEAT_EVENTS presses per shift.
+///   - rescan:     sequential shifts while the compact layout is scanned over
+///                 and over in the background.
+///   - focus:      sequential shifts, each gear key pressed once more while
+///                 another window of the fake window system has the focus.
+///                 Those presses must be left alone.
+///
+///  It reports shifts per second, the shift latency percentiles, and the
+///  memory reads and writes, foreground window queries and gear display
+///  redraws per shift, each of which costs system calls. A run fails if a
+///  shift is missed, a key is dispatched while the game isn't focused, or a
+///  key asks the window system for the foreground window.
+///
+///  Results are appended to a CSV file, one row per benchmark run, so runs
+///  on different commits can be compared.
+///
+///  Usage: Heat-Bench.exe [--out <file>] [--label <text>] [--runs <n>] [--heap-mib <n>]
+///                        [--seed <n>] [--layout <name>] [--variant <name>]
+///                        [--suite <scan|shift>] [--scenario <name>] [--shifts <n>]
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+///
+
+#include "Search.h"
+#include "MemorySource.h"
+#include "GearCommit.h"
+#include "WindowSystem.h"
+#include "SyntheticHeap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_DEFAULT_RESULTS_FILE              "bench-results.csv"
+#define BENCH_DEFAULT_HEAP_MIB                  256
+#define BENCH_DEFAULT_RUNS                      3
+#define BENCH_DEFAULT_SEED                      0x1337
+#define BENCH_MIN_HEAP_SIZE                     0x1000000           // One region of the least fragmented layout
+
+#define BENCH_SLOT_SIZE                         0x200               // Address space slot of one planted struct
+#define BENCH_SLOT_ARTIFACT_OFFSET              0x80                // Artifact offset in its slot, before alignment
+#define BENCH_MAX_PLANT_ATTEMPTS                64
+#define BENCH_TICK_MS                           16                  // Live memory update interval, about one game frame
+
+#define BENCH_DEFAULT_SHIFT_RESULTS_FILE        "bench-shift-results.csv"
+#define BENCH_DEFAULT_SHIFTS                    5000
+// Key bindings and commit settings of the shift benchmarks, the defaults if it's missing
+#define BENCH_SHIFT_CONFIG_FILE                 L".\\bench-shift.ini"
+#define BENCH_SHIFT_TIMEOUT_MS                  1000                // A shift not written by then is missed
+#define BENCH_SHIFT_GAME_PROCESS_ID             0x4EA7              // Stand-in game process, in the foreground between focus changes
+#define BENCH_SHIFT_OTHER_PROCESS_ID            0x0BAD              // Takes the foreground in the focus scenario
+#define BENCH_AUTOREPEAT_EVENTS                 32                  // Presses per shift in an autorepeat storm
+
+GLOBAL SHIFTER_CONFIG g_ShifterConfig = { 0 };
+GLOBAL SHIFTER_STATE g_ShifterState = { 0 };
+
+/// Synthetic address space.
+typedef struct _BENCH_LAYOUT {
+    LPCSTR szName;
+    SIZE_T cbRegion;                    // Size of every region, the smaller the more fragmented
+    DWORD dwDecoysPerMiB;               // Pattern matches that are not the real structs
+} BENCH_LAYOUT, *LPBENCH_LAYOUT;
+
+typedef CONST BENCH_LAYOUT *LPCBENCH_LAYOUT;
+
+/// Search kernel and strategy a variant runs with.
+/// Signatures the strategy can't search keep the one they were compiled with.
+typedef struct _BENCH_VARIANT {
+    LPCSTR szName;
+    SEARCH_KERNEL eKernel;              // SEARCH_KERNEL_INVALID for the detected one
+    SEARCH_STRATEGY eStrategy;
+    BOOLEAN bForceStrategy;
+} BENCH_VARIANT, *LPBENCH_VARIANT;
+
+typedef CONST BENCH_VARIANT *LPCBENCH_VARIANT;
+
+/// Synthetic key input of a shift benchmark.
+typedef struct _BENCH_SHIFT_SCENARIO {
+    LPCSTR szName;
+    DWORD dwRepeats;                    // Presses per shift, all but the first are autorepeat
+    BOOLEAN bRescan;                    // Scans run in the background
+    BOOLEAN bFocusChanges;              // Every gear key is pressed once more while another window is focused
+} BENCH_SHIFT_SCENARIO, *LPBENCH_SHIFT_SCENARIO;
+
+typedef CONST BENCH_SHIFT_SCENARIO *LPCBENCH_SHIFT_SCENARIO;
+
+STATIC CONST BENCH_LAYOUT g_aLayouts[] = {
+    { "compact",        0x1000000,  1 },
+    { "fragmented",     0x10000,    1 },
+    { "decoy-heavy",    0x1000000,  32 }
+};
+
+STATIC CONST BENCH_VARIANT g_aVariants[] = {
+    { "auto",           SEARCH_KERNEL_INVALID,  SEARCH_STRATEGY_ANCHOR,     FALSE },
+    { "anchor-avx2",    SEARCH_KERNEL_AVX2,     SEARCH_STRATEGY_ANCHOR,     TRUE },
+    { "anchor-sse2",    SEARCH_KERNEL_SSE2,     SEARCH_STRATEGY_ANCHOR,     TRUE },
+    { "aligned",        SEARCH_KERNEL_SCALAR,   SEARCH_STRATEGY_ALIGNED,    TRUE },
+    { "horspool",       SEARCH_KERNEL_SCALAR,   SEARCH_STRATEGY_HORSPOOL,   TRUE }
+};
+
+STATIC CONST BENCH_SHIFT_SCENARIO g_aShiftScenarios[] = {
+    { "sequential",     1,                          FALSE,  FALSE },
+    { "autorepeat",     BENCH_AUTOREPEAT_EVENTS,    FALSE,  FALSE },
+    { "rescan",         1,                          TRUE,   FALSE },
+    { "focus",          1,                          FALSE,  TRUE }
+};
+
+// Up and down the gearbox, every shift changes the gear
+STATIC CONST SHIFT_GEAR g_aeShiftSequence[] = {
+    GEAR_1, GEAR_2, GEAR_3, GEAR_4, GEAR_5, GEAR_6, GEAR_5, GEAR_4, GEAR_3, GEAR_2
+};
+
+typedef struct _BENCH_REGION {
+    LPBYTE lpBaseAddress;
+    SIZE_T cbSize;
+} BENCH_REGION, *LPBENCH_REGION;
+
+typedef CONST BENCH_REGION *LPCBENCH_REGION;
+
+/// Planted pattern match and the DWORD the tick thread changes, if any.
+typedef struct _BENCH_ARTIFACT {
+    LPBYTE lpArtifact;
+    LPDWORD lpTicked;
+} BENCH_ARTIFACT, *LPBENCH_ARTIFACT;
+
+typedef struct _BENCH_HEAP {
+    LPBENCH_REGION aRegions;            // Sorted by address
+    DWORD dwRegionCount;
+    SIZE_T cbHeap;
+
+    PBYTE abySlotUsed;                  // One byte per BENCH_SLOT_SIZE slot of the heap
+    SIZE_T qwSlotCount;
+
+    LPCVOID alpReal[TARGET_GEAR_LAST + 1];
+    LPBENCH_ARTIFACT aTicked;           // Real structs and unstable decoys
+    DWORD dwTickedCount;
+    DWORD dwDecoyCount;
+
+    DWORD64 qwRandomState;
+    VOLATILE LONG lStop;
+} BENCH_HEAP, *LPBENCH_HEAP;
+
+/// Counters of the benchmark memory source.
+typedef struct _BENCH_SOURCE_CONTEXT {
+    LPBENCH_HEAP lpHeap;
+    VOLATILE LONG64 llReadCalls;        // One ReadProcessMemory() per request on Windows
+    VOLATILE LONG64 llReadBatches;      // One process_vm_readv() per batch on Linux
+} BENCH_SOURCE_CONTEXT, *LPBENCH_SOURCE_CONTEXT;
+
+typedef struct _BENCH_CONFIG {
+    LPCSTR szResultsPath;
+    LPCSTR szLabel;
+    LPCSTR szLayout;                    // NULL for all
+    LPCSTR szVariant;                   // NULL for all
+    LPCSTR szSuite;                     // "scan" or "shift"
+    LPCSTR szScenario;                  // NULL for all
+    DWORD dwShifts;                     // Per shift benchmark run
+    DWORD dwRuns;
+    SIZE_T cbHeap;
+    DWORD64 qwSeed;
+} BENCH_CONFIG, *LPBENCH_CONFIG;
+
+typedef CONST BENCH_CONFIG *LPCBENCH_CONFIG;
+
+typedef struct _BENCH_RESULT {
+    DWORD64 qwBytes;
+    DOUBLE fSeconds;
+    DWORD64 qwReadCalls;
+    DWORD64 qwReadBatches;
+    DWORD dwCandidates;
+    DWORD dwHits;
+    DOUBLE fLockSeconds;
+    BOOLEAN bLocked;
+    BOOLEAN bScan;                      // Scan benchmark, the read and lock metrics are set
+} BENCH_RESULT, *LPBENCH_RESULT;
+
+STATIC DOUBLE GetSecondsSince(
+    CONST LARGE_INTEGER *lpliStart
+) {
+    LARGE_INTEGER liFrequency, liNow;
+
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liNow);
+
+    return (DOUBLE) (liNow.QuadPart - lpliStart->QuadPart) / (DOUBLE) liFrequency.QuadPart;
+}
+
+STATIC INT CompareBenchRegions(
+    CONST VOID *lpFirst,
+    CONST VOID *lpSecond
+) {
+    LPCBYTE lpFirstBase = ((LPCBENCH_REGION) lpFirst)->lpBaseAddress;
+    LPCBYTE lpSecondBase = ((LPCBENCH_REGION) lpSecond)->lpBaseAddress;
+
+    return (lpFirstBase > lpSecondBase) - (lpFirstBase < lpSecondBase);
+}
+
+/// Index of the region holding lpAddress, dwRegionCount if there is none.
+STATIC DWORD FindBenchRegion(
+    LPBENCH_HEAP lpHeap,
+    LPCBYTE lpAddress
+) {
+    DWORD dwLow = 0;
+    DWORD dwHigh = lpHeap->dwRegionCount;
+
+    // First region starting past lpAddress
+    while (dwLow < dwHigh) {
+        CONST DWORD dwMiddle = dwLow + (dwHigh - dwLow) / 2;
+
+        if (lpHeap->aRegions[dwMiddle].lpBaseAddress <= lpAddress) {
+            dwLow = dwMiddle + 1;
+        } else {
+            dwHigh = dwMiddle;
+        }
+    }
+
+    if (0 == dwLow) {
+        return lpHeap->dwRegionCount;
+    }
+
+    LPCBENCH_REGION lpRegion = &lpHeap->aRegions[dwLow - 1];
+    if (lpAddress >= lpRegion->lpBaseAddress + lpRegion->cbSize) {
+        return lpHeap->dwRegionCount;
+    }
+
+    return dwLow - 1;
+}
+
+/// Picks a free slot of the heap and returns the artifact address in it,
+/// with the alignment of the signature and the gear address nibble of the game.
+/// NULL if the heap is too crowded.
+STATIC LPBYTE ClaimArtifactSlot(
+    LPBENCH_HEAP lpHeap,
+    LPCSIGNATURE lpSignature
+) {
+    for (DWORD i = 0; i < BENCH_MAX_PLANT_ATTEMPTS; ++i) {
+        CONST SIZE_T qwSlot = (SIZE_T) NextRandomBelow(
+            &lpHeap->qwRandomState,
+            lpHeap->qwSlotCount
+        );
+
+        if (lpHeap->abySlotUsed[qwSlot]) {
+            continue;
+        }
+
+        // Regions are whole numbers of slots, slot numbers run through them in address order
+        SIZE_T qwFirstSlot = 0;
+        DWORD dwIndex = 0;
+
+        while (qwSlot >= qwFirstSlot + lpHeap->aRegions[dwIndex].cbSize / BENCH_SLOT_SIZE) {
+            qwFirstSlot += lpHeap->aRegions[dwIndex++].cbSize / BENCH_SLOT_SIZE;
+        }
+
+        LPBYTE lpAddress = AlignArtifactAddress(
+            lpSignature,
+            lpHeap->aRegions[dwIndex].lpBaseAddress
+                + (qwSlot - qwFirstSlot) * BENCH_SLOT_SIZE
+                + BENCH_SLOT_ARTIFACT_OFFSET
+        );
+
+        // Coarse alignments may push the struct out of its slot
+        if (lpAddress + BENCH_SLOT_ARTIFACT_OFFSET > lpHeap->aRegions[dwIndex].lpBaseAddress
+            + (qwSlot - qwFirstSlot + 1) * BENCH_SLOT_SIZE) {
+            continue;
+        }
+
+        lpHeap->abySlotUsed[qwSlot] = TRUE;
+        return lpAddress;
+    }
+
+    return NULL;
+}
+
+/// Plants the real structs and the decoys. Half of the decoys never change,
+/// so verification rejects them as static memory after all samples, the
+/// other half has a changing static field and is rejected on the second sample.
+STATIC BOOLEAN PlantArtifacts(
+    LPBENCH_HEAP lpHeap,
+    LPCSIGNATURE_PACK lpSignaturePack,
+    CONST DWORD dwDecoyCount
+) {
+    lpHeap->aTicked = VirtualAlloc(
+        NULL,
+        ((SIZE_T) lpSignaturePack->dwSignatureCount + dwDecoyCount) * sizeof(BENCH_ARTIFACT),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpHeap->aTicked) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    for (DWORD i = 0; i < lpSignaturePack->dwSignatureCount; ++i) {
+        LPCSIGNATURE lpSignature = &lpSignaturePack->aSignatures[i];
+
+        if (NULL != lpHeap->alpReal[lpSignature->eTargetGear]) {
+            continue;
+        }
+
+        LPBYTE lpArtifact = ClaimArtifactSlot(
+            lpHeap,
+            lpSignature
+        );
+
+        if (NULL == lpArtifact) {
+            fprintf(
+                stderr,
+                "[-] No room for the real '%s' struct.\n",
+                lpSignature->szName
+            );
+            return FALSE;
+        }
+
+        PlantArtifact(
+            &lpHeap->qwRandomState,
+            lpSignature,
+            lpArtifact,
+            GEAR_3
+        );
+
+        lpHeap->alpReal[lpSignature->eTargetGear] = lpArtifact;
+        lpHeap->aTicked[lpHeap->dwTickedCount++] = (BENCH_ARTIFACT) {
+            .lpArtifact = lpArtifact,
+            .lpTicked = (LPDWORD) (lpArtifact + GetLiveFieldOffset(lpSignature))
+        };
+    }
+
+    for (DWORD i = 0; i < dwDecoyCount; ++i) {
+        LPCSIGNATURE lpSignature = &lpSignaturePack->aSignatures[i % lpSignaturePack->dwSignatureCount];
+
+        LPBYTE lpArtifact = ClaimArtifactSlot(
+            lpHeap,
+            lpSignature
+        );
+
+        if (NULL == lpArtifact) {
+            break;
+        }
+
+        PlantArtifact(
+            &lpHeap->qwRandomState,
+            lpSignature,
+            lpArtifact,
+            GEAR_NEUTRAL + (DWORD) NextRandomBelow(&lpHeap->qwRandomState, GEAR_8)
+        );
+
+        lpHeap->dwDecoyCount++;
+
+        if (i & 1) {
+            lpHeap->aTicked[lpHeap->dwTickedCount++] = (BENCH_ARTIFACT) {
+                .lpArtifact = lpArtifact,
+                .lpTicked = (LPDWORD) (lpArtifact + lpSignature->lStaticOffset)
+            };
+        }
+    }
+
+    return TRUE;
+}
+
+STATIC VOID FreeBenchHeap(
+    LPBENCH_HEAP lpHeap
+) {
+    if (NULL != lpHeap->aRegions) {
+        for (DWORD i = 0; i < lpHeap->dwRegionCount; ++i) {
+            VirtualFree(
+                lpHeap->aRegions[i].lpBaseAddress,
+                0,
+                MEM_RELEASE
+            );
+        }
+
+        VirtualFree(
+            lpHeap->aRegions,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    if (NULL != lpHeap->abySlotUsed) {
+        VirtualFree(
+            lpHeap->abySlotUsed,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    if (NULL != lpHeap->aTicked) {
+        VirtualFree(
+            lpHeap->aTicked,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    ZeroMemory(
+        lpHeap,
+        sizeof(BENCH_HEAP)
+    );
+}
+
+STATIC BOOLEAN BuildBenchHeap(
+    LPBENCH_HEAP lpHeap,
+    LPCBENCH_LAYOUT lpLayout,
+    LPCBENCH_CONFIG lpConfig,
+    LPCSIGNATURE_PACK lpSignaturePack
+) {
+    CONST DWORD dwRegionCount = (DWORD) max(lpConfig->cbHeap / lpLayout->cbRegion, 1);
+
+    ZeroMemory(
+        lpHeap,
+        sizeof(BENCH_HEAP)
+    );
+
+    lpHeap->qwRandomState = lpConfig->qwSeed | 1;
+
+    lpHeap->aRegions = VirtualAlloc(
+        NULL,
+        dwRegionCount * sizeof(BENCH_REGION),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpHeap->aRegions) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    // Separate allocations, so regions are not adjacent in the address space
+    for (DWORD i = 0; i < dwRegionCount; ++i) {
+        LPBYTE lpRegion = VirtualAlloc(
+            NULL,
+            lpLayout->cbRegion,
+            MEM_COMMIT | MEM_RESERVE,
+            PAGE_READWRITE
+        );
+
+        if (NULL == lpRegion) {
+            fprintf(
+                stderr,
+                "[-] VirtualAlloc(): E%lu\n",
+                GetLastError()
+            );
+            goto _ERROR;
+        }
+
+        for (SIZE_T cbOffset = 0; cbOffset < lpLayout->cbRegion; cbOffset += PAGE_SIZE) {
+            FillHeapPage(
+                &lpHeap->qwRandomState,
+                (LPDWORD) (lpRegion + cbOffset)
+            );
+        }
+
+        lpHeap->aRegions[lpHeap->dwRegionCount++] = (BENCH_REGION) {
+            .lpBaseAddress = lpRegion,
+            .cbSize = lpLayout->cbRegion
+        };
+        lpHeap->cbHeap += lpLayout->cbRegion;
+    }
+
+    qsort(
+        lpHeap->aRegions,
+        lpHeap->dwRegionCount,
+        sizeof(BENCH_REGION),
+        CompareBenchRegions
+    );
+
+    lpHeap->qwSlotCount = lpHeap->cbHeap / BENCH_SLOT_SIZE;
+    lpHeap->abySlotUsed = VirtualAlloc(
+        NULL,
+        lpHeap->qwSlotCount,
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpHeap->abySlotUsed) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        goto _ERROR;
+    }
+
+    if (!PlantArtifacts(
+        lpHeap,
+        lpSignaturePack,
+        (DWORD) ((lpHeap->cbHeap >> 20) * lpLayout->dwDecoysPerMiB)
+    )) {
+        goto _ERROR;
+    }
+
+    return TRUE;
+
+_ERROR:
+    FreeBenchHeap(lpHeap);
+    return FALSE;
+}
+
+/// Keeps the live memory of the real structs and the static fields of the
+/// unstable decoys changing while a scan verifies them.
+STATIC DWORD WINAPI BenchTickThread(
+    LPVOID lpParameter
+) {
+    LPBENCH_HEAP lpHeap = (LPBENCH_HEAP) lpParameter;
+    DWORD dwValue = 0;
+
+    while (!lpHeap->lStop) {
+        dwValue++;
+
+        for (DWORD i = 0; i < lpHeap->dwTickedCount; ++i) {
+            *(VOLATILE DWORD *) lpHeap->aTicked[i].lpTicked = dwValue;
+        }
+
+        Sleep(BENCH_TICK_MS);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+STATIC BOOLEAN BenchEnumRegions(
+    LPMEMORY_SOURCE lpSource,
+    LPCVOID lpMinimumAddress,
+    LPCVOID lpMaximumAddress,
+    LPMEMORY_REGION_CALLBACK lpCallback,
+    LPVOID lpCallbackContext
+) {
+    LPBENCH_HEAP lpHeap = ((LPBENCH_SOURCE_CONTEXT) lpSource->lpContext)->lpHeap;
+
+    for (DWORD i = 0; i < lpHeap->dwRegionCount; ++i) {
+        LPCBENCH_REGION lpRegion = &lpHeap->aRegions[i];
+
+        // Clip to the requested range
+        LPCBYTE lpStart = max(lpRegion->lpBaseAddress, (LPCBYTE) lpMinimumAddress);
+        LPCBYTE lpEnd = min(lpRegion->lpBaseAddress + lpRegion->cbSize, (LPCBYTE) lpMaximumAddress);
+
+        if (lpStart >= lpEnd) {
+            continue;
+        }
+
+        MEMORY_BASIC_INFORMATION memInfo = {
+            .BaseAddress = (PVOID) lpStart,
+            .AllocationBase = (PVOID) lpRegion->lpBaseAddress,
+            .RegionSize = (SIZE_T) (lpEnd - lpStart),
+            .State = MEM_COMMIT,
+            .Protect = PAGE_READWRITE,
+            .Type = MEM_PRIVATE
+        };
+
+        if (!lpCallback(
+            lpCallbackContext,
+            &memInfo
+        )) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+STATIC DWORD BenchReadBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    LPBENCH_SOURCE_CONTEXT lpContext = (LPBENCH_SOURCE_CONTEXT) lpSource->lpContext;
+    LPBENCH_HEAP lpHeap = lpContext->lpHeap;
+    DWORD dwCompleted = 0;
+
+    InterlockedIncrement64(&lpContext->llReadBatches);
+    InterlockedAdd64(
+        &lpContext->llReadCalls,
+        dwRequestCount
+    );
+
+    for (DWORD i = 0; i < dwRequestCount; ++i) {
+        LPMEMORY_IO lpRequest = &aRequests[i];
+        LPCBYTE lpAddress = (LPCBYTE) lpRequest->lpAddress;
+
+        CONST DWORD dwIndex = FindBenchRegion(
+            lpHeap,
+            lpAddress
+        );
+
+        lpRequest->cbTransferred = 0;
+
+        // Regions are separate allocations, a read never spans two
+        if (dwIndex == lpHeap->dwRegionCount) {
+            SetLastError(ERROR_PARTIAL_COPY);
+            continue;
+        }
+
+        LPCBENCH_REGION lpRegion = &lpHeap->aRegions[dwIndex];
+
+        lpRequest->cbTransferred = min(
+            lpRequest->cbSize,
+            (SIZE_T) (lpRegion->lpBaseAddress + lpRegion->cbSize - lpAddress)
+        );
+
+        memcpy(
+            lpRequest->lpBuffer,
+            lpAddress,
+            lpRequest->cbTransferred
+        );
+
+        if (lpRequest->cbSize == lpRequest->cbTransferred) {
+            dwCompleted++;
+        } else {
+            SetLastError(ERROR_PARTIAL_COPY);
+        }
+    }
+
+    return dwCompleted;
+}
+
+STATIC DWORD BenchWriteBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    UNREFERENCED_PARAMETER(lpSource);
+
+    for (DWORD i = 0; i < dwRequestCount; ++i) {
+        aRequests[i].cbTransferred = 0;
+    }
+
+    SetLastError(ERROR_ACCESS_DENIED);
+    return 0;
+}
+
+/// Compiles the pack for the kernel of the variant and forces its strategy
+/// on the signatures it can search.
+/// Returns FALSE if the CPU doesn't support the kernel.
+STATIC BOOLEAN ApplyBenchVariant(
+    LPCBENCH_VARIANT lpVariant,
+    CONST SEARCH_KERNEL eDetectedKernel,
+    LPSIGNATURE_PACK lpSignaturePack
+) {
+    CONST SEARCH_KERNEL eKernel = (SEARCH_KERNEL_INVALID == lpVariant->eKernel)
+        ? eDetectedKernel
+        : lpVariant->eKernel;
+
+    if (!SetSearchKernel(eKernel)) {
+        return FALSE;
+    }
+
+    InitDefaultSignaturePack(lpSignaturePack);
+
+    if (!lpVariant->bForceStrategy) {
+        return TRUE;
+    }
+
+    for (DWORD i = 0; i < lpSignaturePack->dwSignatureCount; ++i) {
+        LPSEARCH_PATTERN lpSearchPattern = &lpSignaturePack->aSignatures[i].SearchPattern;
+        BOOLEAN bSearchable = TRUE;
+
+        switch (lpVariant->eStrategy) {
+            case SEARCH_STRATEGY_ANCHOR:
+                bSearchable = (lpSearchPattern->dwAlignment <= SEARCH_LANE_MASK_MAX_ALIGNMENT);
+                break;
+
+            // The skip table ignores the alignment
+            case SEARCH_STRATEGY_HORSPOOL:
+                bSearchable = (1 == lpSearchPattern->dwAlignment);
+                break;
+
+            default:
+                break;
+        }
+
+        if (bSearchable) {
+            lpSearchPattern->eStrategy = lpVariant->eStrategy;
+        }
+    }
+
+    return TRUE;
+}
+
+/// FindPattern() over every region, all signatures per AOBSCAN_BLOCK_SIZE block like a scan worker.
+STATIC VOID RunMatchBenchmark(
+    LPBENCH_HEAP lpHeap,
+    LPCSIGNATURE_PACK lpSignaturePack,
+    LPBENCH_RESULT lpResult
+) {
+    LARGE_INTEGER liStart;
+
+    QueryPerformanceCounter(&liStart);
+
+    for (DWORD i = 0; i < lpHeap->dwRegionCount; ++i) {
+        LPCBENCH_REGION lpRegion = &lpHeap->aRegions[i];
+
+        for (SIZE_T qwBlock = 0; qwBlock < lpRegion->cbSize; qwBlock += AOBSCAN_BLOCK_SIZE) {
+            CONST SIZE_T qwBlockEnd = min(qwBlock + AOBSCAN_BLOCK_SIZE, lpRegion->cbSize);
+
+            for (DWORD j = 0; j < lpSignaturePack->dwSignatureCount; ++j) {
+                LPCSEARCH_PATTERN lpSearchPattern = &lpSignaturePack->aSignatures[j].SearchPattern;
+
+                // Matches must start inside the block, but may end past it
+                CONST SIZE_T cbSearch = min(
+                    qwBlockEnd + lpSearchPattern->cbPatternSize - 1,
+                    lpRegion->cbSize
+                );
+
+                for (
+                    SIZE_T qwIndex = FindPattern(
+                        lpSearchPattern,
+                        lpRegion->lpBaseAddress,
+                        cbSearch,
+                        qwBlock,
+                        (DWORD64) lpRegion->lpBaseAddress
+                    );
+                    SEARCH_NOT_FOUND != qwIndex;
+                    qwIndex = FindPattern(
+                        lpSearchPattern,
+                        lpRegion->lpBaseAddress,
+                        cbSearch,
+                        qwIndex + 1,
+                        (DWORD64) lpRegion->lpBaseAddress
+                    )
+                ) {
+                    lpResult->dwHits++;
+                }
+            }
+        }
+    }
+
+    lpResult->fSeconds = GetSecondsSince(&liStart);
+    lpResult->qwBytes = lpHeap->cbHeap;
+}
+
+/// AobScanTarget() with a fresh region map, as the first scan of a session.
+STATIC VOID RunScanBenchmark(
+    LPBENCH_HEAP lpHeap,
+    LPCSIGNATURE_PACK lpSignaturePack,
+    CONST VOLATILE LONG *lplAbort,
+    LPBENCH_RESULT lpResult
+) {
+    BENCH_SOURCE_CONTEXT benchContext = {
+        .lpHeap = lpHeap
+    };
+
+    MEMORY_SOURCE memSource = {
+        .szName = "Benchmark",
+        .EnumRegions = BenchEnumRegions,
+        .ReadBatch = BenchReadBatch,
+        .WriteBatch = BenchWriteBatch,
+        .lpContext = &benchContext
+    };
+
+    REGION_MAP regionMap = { 0 };
+    AOBSCAN_RESULT aobResult = { 0 };
+    LARGE_INTEGER liStart;
+
+    CONST AOBSCAN_TARGET aobTarget = {
+        .lpSource = &memSource,
+        .lpRegionMap = &regionMap,
+        .lplAbort = lplAbort
+    };
+
+    QueryPerformanceCounter(&liStart);
+
+    CONST BOOLEAN bFound = AobScanTarget(
+        &aobTarget,
+        lpSignaturePack,
+        &aobResult
+    );
+
+    lpResult->bScan = TRUE;
+    lpResult->fLockSeconds = GetSecondsSince(&liStart);
+    lpResult->bLocked = bFound;
+
+    // A lock on a decoy is no lock
+    for (DWORD i = 0; i <= TARGET_GEAR_LAST; ++i) {
+        if (NULL != lpHeap->alpReal[i] && aobResult.alpArtifact[i] != lpHeap->alpReal[i]) {
+            lpResult->bLocked = FALSE;
+        }
+    }
+
+    for (DWORD i = 0; i < lpSignaturePack->dwSignatureCount; ++i) {
+        lpResult->dwHits += aobResult.adwHitCount[i];
+    }
+
+    lpResult->qwBytes = aobResult.qwBytesScanned;
+    lpResult->fSeconds = aobResult.fScanSeconds;
+    lpResult->qwReadCalls = (DWORD64) benchContext.llReadCalls;
+    lpResult->qwReadBatches = (DWORD64) benchContext.llReadBatches;
+    lpResult->dwCandidates = aobResult.dwCandidateCount;
+
+    FreeRegionMap(&regionMap);
+}
+
+STATIC DOUBLE GetGigabytesPerSecond(
+    LPBENCH_RESULT lpResult
+) {
+    return (lpResult->fSeconds > 0.0)
+        ? ((DOUBLE) lpResult->qwBytes / lpResult->fSeconds / 1e9)
+        : 0.0;
+}
+
+/// Opens the results file for appending and writes the CSV header if it's new.
+STATIC FILE *OpenBenchResults(
+    LPCSTR szResultsPath,
+    LPCSTR szHeader
+) {
+    FILE *lpFile = NULL;
+
+    if (EXIT_SUCCESS != fopen_s(
+        &lpFile,
+        szResultsPath,
+        "a"
+    )) {
+        fprintf(
+            stderr,
+            "[-] Unable to open '%s'.\n",
+            szResultsPath
+        );
+        return NULL;
+    }
+
+    fseek(
+        lpFile,
+        0,
+        SEEK_END
+    );
+
+    if (0 == ftell(lpFile)) {
+        fprintf(
+            lpFile,
+            "%s\n",
+            szHeader
+        );
+    }
+
+    return lpFile;
+}
+
+STATIC VOID WriteBenchResult(
+    FILE *lpFile,
+    LPCBENCH_CONFIG lpConfig,
+    LPCSTR szBenchmark,
+    LPCBENCH_LAYOUT lpLayout,
+    LPCBENCH_VARIANT lpVariant,
+    CONST DWORD dwRun,
+    LPBENCH_HEAP lpHeap,
+    LPBENCH_RESULT lpResult
+) {
+    CONST DOUBLE fGigabytes = (DOUBLE) lpResult->qwBytes / 1e9;
+
+    printf(
+        "%-6s %-12s %-12s %3lu %10.3f %8.2f %10llu %10lu %8lu  ",
+        szBenchmark,
+        lpLayout->szName,
+        lpVariant->szName,
+        dwRun,
+        lpResult->fSeconds,
+        GetGigabytesPerSecond(lpResult),
+        lpResult->qwReadCalls,
+        lpResult->dwCandidates,
+        lpResult->dwHits
+    );
+
+    if (lpResult->bScan) {
+        printf(
+            "%6.2f s %s\n",
+            lpResult->fLockSeconds,
+            lpResult->bLocked ? "OK" : "MISSING"
+        );
+    } else {
+        printf("%8s\n", "-");
+    }
+
+    // Metrics a benchmark doesn't measure are left empty
+    fprintf(
+        lpFile,
+        "%s,%s,%s,%s,%s,%lu,%llu,%lu,%lu,%llu,%.6f,%.3f,",
+        (NULL != lpConfig->szLabel) ? lpConfig->szLabel : "",
+        szBenchmark,
+        lpLayout->szName,
+        lpVariant->szName,
+        GetSearchKernelName(GetSearchKernel()),
+        dwRun,
+        (DWORD64) lpHeap->cbHeap,
+        lpHeap->dwRegionCount,
+        lpHeap->dwDecoyCount,
+        lpResult->qwBytes,
+        lpResult->fSeconds,
+        GetGigabytesPerSecond(lpResult)
+    );
+
+    if (lpResult->bScan) {
+        fprintf(
+            lpFile,
+            "%llu,%llu,%.1f,%lu,%lu,%.6f,%d\n",
+            lpResult->qwReadCalls,
+            lpResult->qwReadBatches,
+            (fGigabytes > 0.0) ? ((DOUBLE) lpResult->qwReadCalls / fGigabytes) : 0.0,
+            lpResult->dwCandidates,
+            lpResult->dwHits,
+            lpResult->fLockSeconds,
+            lpResult->bLocked
+        );
+    } else {
+        fprintf(
+            lpFile,
+            ",,,,%lu,,\n",
+            lpResult->dwHits
+        );
+    }
+}
+
+/// Benchmarks one layout with every selected variant.
+/// Returns FALSE if the layout couldn't be built or a scan missed the real structs.
+STATIC BOOLEAN BenchmarkLayout(
+    LPCBENCH_LAYOUT lpLayout,
+    LPCBENCH_CONFIG lpConfig,
+    CONST SEARCH_KERNEL eDetectedKernel,
+    FILE *lpResultsFile
+) {
+    SIGNATURE_PACK signaturePack = { 0 };
+    BENCH_HEAP benchHeap = { 0 };
+    BOOLEAN bRet = TRUE;
+
+    InitDefaultSignaturePack(&signaturePack);
+
+    printf(
+        "\n[*] Building layout '%s'..\n",
+        lpLayout->szName
+    );
+
+    if (!BuildBenchHeap(
+        &benchHeap,
+        lpLayout,
+        lpConfig,
+        &signaturePack
+    )) {
+        return FALSE;
+    }
+
+    printf(
+        "[*] %llu MiB in %lu regions, %lu decoys\n",
+        (DWORD64) benchHeap.cbHeap >> 20,
+        benchHeap.dwRegionCount,
+        benchHeap.dwDecoyCount
+    );
+
+    HANDLE hTickThread = CreateThread(
+        NULL,
+        0,
+        BenchTickThread,
+        &benchHeap,
+        0,
+        NULL
+    );
+
+    if (NULL == hTickThread) {
+        fprintf(
+            stderr,
+            "[-] CreateThread(): E%lu\n",
+            GetLastError()
+        );
+        FreeBenchHeap(&benchHeap);
+        return FALSE;
+    }
+
+    printf(
+        "%-6s %-12s %-12s %3s %10s %8s %10s %10s %8s  %s\n",
+        "Bench",
+        "Layout",
+        "Variant",
+        "Run",
+        "Seconds",
+        "GB/s",
+        "Reads",
+        "Candidates",
+        "Hits",
+        "Lock"
+    );
+
+    for (DWORD i = 0; i < ARRAYSIZE(g_aVariants); ++i) {
+        LPCBENCH_VARIANT lpVariant = &g_aVariants[i];
+
+        if (NULL != lpConfig->szVariant && EXIT_SUCCESS != strcmp(
+            lpConfig->szVariant,
+            lpVariant->szName
+        )) {
+            continue;
+        }
+
+        if (!ApplyBenchVariant(
+            lpVariant,
+            eDetectedKernel,
+            &signaturePack
+        )) {
+            printf(
+                "[*] Skipping '%s', the CPU doesn't support it.\n",
+                lpVariant->szName
+            );
+            continue;
+        }
+
+        for (DWORD dwRun = 0; dwRun < lpConfig->dwRuns; ++dwRun) {
+            BENCH_RESULT matchResult = { 0 };
+            BENCH_RESULT scanResult = { 0 };
+
+            RunMatchBenchmark(
+                &benchHeap,
+                &signaturePack,
+                &matchResult
+            );
+
+            WriteBenchResult(
+                lpResultsFile,
+                lpConfig,
+                "match",
+                lpLayout,
+                lpVariant,
+                dwRun,
+                &benchHeap,
+                &matchResult
+            );
+
+            RunScanBenchmark(
+                &benchHeap,
+                &signaturePack,
+                NULL,
+                &scanResult
+            );
+
+            WriteBenchResult(
+                lpResultsFile,
+                lpConfig,
+                "scan",
+                lpLayout,
+                lpVariant,
+                dwRun,
+                &benchHeap,
+                &scanResult
+            );
+
+            if (!scanResult.bLocked) {
+                bRet = FALSE;
+            }
+        }
+    }
+
+    InterlockedExchange(&benchHeap.lStop, TRUE);
+    WaitForSingleObject(
+        hTickThread,
+        INFINITE
+    );
+
+    CloseHandle(hTickThread);
+    FreeBenchHeap(&benchHeap);
+
+    fflush(lpResultsFile);
+    return bRet;
+}
+
+/// Gear fields of the stand-in game, and the calls the shift path made to the system.
+typedef struct DECLSPEC_CACHEALIGN _BENCH_SHIFT_TARGET {
+    VOLATILE DWORD adwGear[TARGET_GEAR_LAST + 1];
+    VOLATILE LONG64 llReadCalls;        // One ReadProcessMemory() per request on Windows
+    VOLATILE LONG64 llWriteCalls;       // One WriteProcessMemory() per request on Windows
+    VOLATILE LONG64 llForegroundQueries;// GetForegroundWindow() and GetWindowThreadProcessId()
+    DWORD (*GetForegroundProcessId)(    // Of the fake window system, counted
+        LPWINDOW_SYSTEM lpWindowSystem
+    );
+} BENCH_SHIFT_TARGET, *LPBENCH_SHIFT_TARGET;
+
+/// Background scans of the rescan scenario.
+typedef struct _BENCH_RESCAN_LOAD {
+    LPBENCH_HEAP lpHeap;
+    LPCSIGNATURE_PACK lpSignaturePack;
+    VOLATILE LONG lStop;
+    VOLATILE LONG lScans;
+} BENCH_RESCAN_LOAD, *LPBENCH_RESCAN_LOAD;
+
+typedef struct _BENCH_SHIFT_RESULT {
+    DWORD dwKeys;                       // Key events injected
+    DWORD dwShifts;                     // Gears written
+    DWORD dwMissed;                     // Shifts not written within BENCH_SHIFT_TIMEOUT_MS
+    DWORD dwUnfocusedKeys;              // Key events injected while another window was focused
+    DWORD dwLeaked;                     // Of those, dispatched anyway
+    DOUBLE fSeconds;
+    LATENCY_SUMMARY aLatency[SHIFT_LATENCY_STAGE_COUNT];
+    DWORD64 qwReadCalls;
+    DWORD64 qwWriteCalls;
+    DWORD64 qwForegroundQueries;
+    DWORD64 qwRedraws;
+    DWORD dwRescans;
+} BENCH_SHIFT_RESULT, *LPBENCH_SHIFT_RESULT;
+
+STATIC BENCH_SHIFT_TARGET g_ShiftTarget = { 0 };
+
+/// Gear field of the stand-in game at lpAddress, NULL if there is none.
+STATIC VOLATILE DWORD *GetShiftTargetField(
+    LPCVOID lpAddress,
+    CONST SIZE_T cbSize
+) {
+    for (DWORD i = 0; i <= TARGET_GEAR_LAST; ++i) {
+        if (lpAddress == (LPCVOID) &g_ShiftTarget.adwGear[i] && sizeof(DWORD) == cbSize) {
+            return &g_ShiftTarget.adwGear[i];
+        }
+    }
+
+    return NULL;
+}
+
+STATIC DWORD ShiftTargetReadBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    UNREFERENCED_PARAMETER(lpSource);
+
+    DWORD dwCompleted = 0;
+
+    InterlockedAdd64(
+        &g_ShiftTarget.llReadCalls,
+        dwRequestCount
+    );
+
+    for (DWORD i = 0; i < dwRequestCount; ++i) {
+        VOLATILE DWORD *lpField = GetShiftTargetField(
+            aRequests[i].lpAddress,
+            aRequests[i].cbSize
+        );
+
+        aRequests[i].cbTransferred = 0;
+
+        if (NULL == lpField) {
+            SetLastError(ERROR_PARTIAL_COPY);
+            continue;
+        }
+
+        *(LPDWORD) aRequests[i].lpBuffer = *lpField;
+        aRequests[i].cbTransferred = sizeof(DWORD);
+        dwCompleted++;
+    }
+
+    return dwCompleted;
+}
+
+STATIC DWORD ShiftTargetWriteBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    UNREFERENCED_PARAMETER(lpSource);
+
+    DWORD dwCompleted = 0;
+
+    InterlockedAdd64(
+        &g_ShiftTarget.llWriteCalls,
+        dwRequestCount
+    );
+
+    for (DWORD i = 0; i < dwRequestCount; ++i) {
+        VOLATILE DWORD *lpField = GetShiftTargetField(
+            aRequests[i].lpAddress,
+            aRequests[i].cbSize
+        );
+
+        aRequests[i].cbTransferred = 0;
+
+        if (NULL == lpField) {
+            SetLastError(ERROR_ACCESS_DENIED);
+            continue;
+        }
+
+        *lpField = *(LPDWORD) aRequests[i].lpBuffer;
+        aRequests[i].cbTransferred = sizeof(DWORD);
+        dwCompleted++;
+    }
+
+    return dwCompleted;
+}
+
+STATIC DWORD ShiftTargetGetForegroundProcessId(
+    LPWINDOW_SYSTEM lpWindowSystem
+) {
+    InterlockedIncrement64(&g_ShiftTarget.llForegroundQueries);
+
+    return g_ShiftTarget.GetForegroundProcessId(
+        lpWindowSystem
+    );
+}
+
+/// Virtual key bound to a gear without modifiers, 0 if there is none.
+STATIC BYTE FindGearKey(
+    CONST SHIFT_GEAR eGear
+) {
+    CONST LPKEYBOARD_MAP lpKeyboardMap = &g_ShifterConfig.KeyboardMap;
+
+    for (DWORD dwKey = 1; dwKey < ARRAYSIZE(lpKeyboardMap->abyFirstBinding); ++dwKey) {
+        for (
+            BYTE byIndex = lpKeyboardMap->abyFirstBinding[dwKey];
+            0 != byIndex;
+            byIndex = lpKeyboardMap->aBindings[byIndex].byNext
+        ) {
+            if (0 == lpKeyboardMap->aBindings[byIndex].byModifiers && eGear == lpKeyboardMap->aBindings[byIndex].wTarget) {
+                return (BYTE) dwKey;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/// Waits until the writer thread wrote a gear to both fields of the stand-in game.
+STATIC BOOLEAN WaitForShiftTarget(
+    CONST SHIFT_GEAR eGear
+) {
+    LARGE_INTEGER liStart;
+
+    QueryPerformanceCounter(&liStart);
+
+    // The last gear is written second
+    while (eGear != g_ShiftTarget.adwGear[TARGET_GEAR_LAST]) {
+        if (GetSecondsSince(&liStart) * 1000.0 > BENCH_SHIFT_TIMEOUT_MS) {
+            return FALSE;
+        }
+
+        SwitchToThread();
+    }
+
+    return TRUE;
+}
+
+/// Scans the layout over and over, swapping the gear addresses after every
+/// scan the way a rescan does, until the scenario ends.
+STATIC DWORD WINAPI BenchRescanThread(
+    LPVOID lpParameter
+) {
+    LPBENCH_RESCAN_LOAD lpLoad = (LPBENCH_RESCAN_LOAD) lpParameter;
+
+    while (!lpLoad->lStop) {
+        BENCH_RESULT scanResult = { 0 };
+
+        RunScanBenchmark(
+            lpLoad->lpHeap,
+            lpLoad->lpSignaturePack,
+            &lpLoad->lStop,
+            &scanResult
+        );
+
+        AcquireSRWLockExclusive(&g_ShifterState.Lock);
+        g_ShifterState.lpCurrentGearAddress = g_ShifterState.aalpGearAddress[TARGET_GEAR_CURRENT][0];
+        g_ShifterState.lpLastGearAddress = g_ShifterState.aalpGearAddress[TARGET_GEAR_LAST][0];
+        ReleaseSRWLockExclusive(&g_ShifterState.Lock);
+
+        InterlockedIncrement(&lpLoad->lScans);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/// Injects the key events of a scenario into the shift path of the keyboard hook,
+/// one shift at a time, each once the previous one was written.
+STATIC VOID RunShiftScenario(
+    LPCBENCH_SHIFT_SCENARIO lpScenario,
+    LPCBENCH_CONFIG lpConfig,
+    LPFOCUS_TRACKER lpFocusTracker,
+    CONST BYTE abyGearKeys[GEAR_8 + 1],
+    LPDWORD lpdwSequence,
+    LPBENCH_SHIFT_RESULT lpResult
+) {
+    SHIFT_COMMIT_COUNTERS countersBefore, countersAfter;
+    LARGE_INTEGER liStart;
+
+    ResetShiftLatency();
+    GetShiftCommitCounters(&countersBefore);
+
+    g_ShiftTarget.llReadCalls = 0;
+    g_ShiftTarget.llWriteCalls = 0;
+    g_ShiftTarget.llForegroundQueries = 0;
+
+    QueryPerformanceCounter(&liStart);
+
+    for (DWORD i = 0; i < lpConfig->dwShifts; ++i) {
+        CONST SHIFT_GEAR eGear = g_aeShiftSequence[(*lpdwSequence)++ % ARRAYSIZE(g_aeShiftSequence)];
+
+        // The key press must not reach the writer, the focused one below shifts
+        if (lpScenario->bFocusChanges) {
+            SetFakeForegroundProcess(
+                lpFocusTracker->lpWindowSystem,
+                BENCH_SHIFT_OTHER_PROCESS_ID
+            );
+
+            if (KEY_ACTION_INVALID != HandleShifterKey(
+                abyGearKeys[eGear],
+                lpFocusTracker
+            )) {
+                lpResult->dwLeaked++;
+            }
+
+            lpResult->dwUnfocusedKeys++;
+            lpResult->dwKeys++;
+
+            SetFakeForegroundProcess(
+                lpFocusTracker->lpWindowSystem,
+                BENCH_SHIFT_GAME_PROCESS_ID
+            );
+        }
+
+        // Autorepeat sends the held key again, without a release in between
+        for (DWORD j = 0; j < lpScenario->dwRepeats; ++j) {
+            HandleShifterKey(
+                abyGearKeys[eGear],
+                lpFocusTracker
+            );
+
+            lpResult->dwKeys++;
+        }
+
+        if (!WaitForShiftTarget(eGear)) {
+            lpResult->dwMissed++;
+        }
+    }
+
+    lpResult->fSeconds = GetSecondsSince(&liStart);
+
+    // Let the last shift be verified, so it shows up as confirmed
+    Sleep(g_ShifterConfig.dwCommitWindowMs + 2 * SHIFT_COMMIT_POLL_INTERVAL_US / 1000);
+
+    for (DWORD i = 0; i < SHIFT_LATENCY_STAGE_COUNT; ++i) {
+        GetShiftLatency(
+            (SHIFT_LATENCY_STAGE) i,
+            &lpResult->aLatency[i]
+        );
+    }
+
+    GetShiftCommitCounters(&countersAfter);
+
+    lpResult->dwShifts = (DWORD) lpResult->aLatency[SHIFT_LATENCY_WRITE].qwCount;
+    lpResult->qwReadCalls = (DWORD64) g_ShiftTarget.llReadCalls;
+    lpResult->qwWriteCalls = (DWORD64) g_ShiftTarget.llWriteCalls;
+    lpResult->qwForegroundQueries = (DWORD64) g_ShiftTarget.llForegroundQueries;
+    lpResult->qwRedraws = (DWORD64) (countersAfter.lRedraws - countersBefore.lRedraws);
+}
+
+STATIC DOUBLE GetPerShift(
+    LPBENCH_SHIFT_RESULT lpResult,
+    CONST DWORD64 qwCalls
+) {
+    return (0 != lpResult->dwShifts)
+        ? ((DOUBLE) qwCalls / lpResult->dwShifts)
+        : 0.0;
+}
+
+STATIC VOID WriteShiftResult(
+    FILE *lpFile,
+    LPCBENCH_CONFIG lpConfig,
+    LPCBENCH_SHIFT_SCENARIO lpScenario,
+    CONST DWORD dwRun,
+    LPBENCH_SHIFT_RESULT lpResult
+) {
+    LPCLATENCY_SUMMARY lpDispatch = &lpResult->aLatency[SHIFT_LATENCY_DISPATCH];
+    LPCLATENCY_SUMMARY lpWritten = &lpResult->aLatency[SHIFT_LATENCY_WRITE];
+    LPCLATENCY_SUMMARY lpConfirmed = &lpResult->aLatency[SHIFT_LATENCY_CONFIRM];
+    CONST DOUBLE fShiftsPerSecond = (lpResult->fSeconds > 0.0)
+        ? (lpResult->dwShifts / lpResult->fSeconds)
+        : 0.0;
+
+    printf(
+        "%-12s %3lu %10.0f %8lu %8lu %8lu %8lu %7.2f %7.2f %7.2f %7.2f %6lu\n",
+        lpScenario->szName,
+        dwRun,
+        fShiftsPerSecond,
+        lpWritten->dwP50Us,
+        lpWritten->dwP99Us,
+        lpWritten->dwP999Us,
+        lpWritten->dwMaxUs,
+        GetPerShift(lpResult, lpResult->qwReadCalls),
+        GetPerShift(lpResult, lpResult->qwWriteCalls),
+        GetPerShift(lpResult, lpResult->qwForegroundQueries),
+        GetPerShift(lpResult, lpResult->qwRedraws),
+        lpResult->dwMissed
+    );
+
+    fprintf(
+        lpFile,
+        "%s,shift,%s,%lu,%lu,%lu,%lu,%.6f,%.1f,%.1f,"
+        "%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,"
+        "%.3f,%.3f,%.3f,%.3f,%lu\n",
+        (NULL != lpConfig->szLabel) ? lpConfig->szLabel : "",
+        lpScenario->szName,
+        dwRun,
+        lpResult->dwKeys,
+        lpResult->dwShifts,
+        lpResult->dwMissed,
+        lpResult->fSeconds,
+        fShiftsPerSecond,
+        (lpResult->fSeconds > 0.0) ? (lpResult->dwKeys / lpResult->fSeconds) : 0.0,
+        lpDispatch->dwP50Us,
+        lpDispatch->dwP99Us,
+        lpDispatch->dwMaxUs,
+        lpWritten->dwP50Us,
+        lpWritten->dwP99Us,
+        lpWritten->dwP999Us,
+        lpWritten->dwMaxUs,
+        lpConfirmed->dwP50Us,
+        lpConfirmed->dwP99Us,
+        lpConfirmed->dwMaxUs,
+        GetPerShift(lpResult, lpResult->qwReadCalls),
+        GetPerShift(lpResult, lpResult->qwWriteCalls),
+        GetPerShift(lpResult, lpResult->qwForegroundQueries),
+        GetPerShift(lpResult, lpResult->qwRedraws),
+        lpResult->dwRescans
+    );
+}
+
+/// Points the shifter at the stand-in game, with the key bindings and commit
+/// settings of bench-shift.ini, or the defaults if there is none.
+STATIC BOOLEAN InitShiftBenchmark(
+    LPWINDOW_SYSTEM lpWindowSystem,
+    BYTE abyGearKeys[GEAR_8 + 1]
+) {
+    wcscpy_s(
+        g_ShifterConfig.wszConfigFilePath,
+        ARRAYSIZE(g_ShifterConfig.wszConfigFilePath),
+        BENCH_SHIFT_CONFIG_FILE
+    );
+
+    LoadConfig();
+
+    for (DWORD i = 0; i < ARRAYSIZE(g_aeShiftSequence); ++i) {
+        CONST SHIFT_GEAR eGear = g_aeShiftSequence[i];
+
+        abyGearKeys[eGear] = FindGearKey(eGear);
+
+        if (0 == abyGearKeys[eGear]) {
+            fprintf(
+                stderr,
+                "[-] No key is bound to gear %lu without modifiers.\n",
+                eGear
+            );
+            return FALSE;
+        }
+    }
+
+    // The shift path never enumerates regions
+    g_GameMemory = (MEMORY_SOURCE) {
+        .szName = "Stand-in",
+        .ReadBatch = ShiftTargetReadBatch,
+        .WriteBatch = ShiftTargetWriteBatch
+    };
+
+    g_ShiftTarget.adwGear[TARGET_GEAR_CURRENT] = GEAR_NEUTRAL;
+    g_ShiftTarget.adwGear[TARGET_GEAR_LAST] = GEAR_NEUTRAL;
+
+    for (DWORD i = 0; i <= TARGET_GEAR_LAST; ++i) {
+        g_ShifterState.aalpGearAddress[i][0] = (LPVOID) &g_ShiftTarget.adwGear[i];
+        g_ShifterState.adwGearAddressCount[i] = 1;
+        g_ShifterState.adwGearAddressIndex[i] = 0;
+    }
+
+    g_ShifterState.lpCurrentGearAddress = g_ShifterState.aalpGearAddress[TARGET_GEAR_CURRENT][0];
+    g_ShifterState.lpLastGearAddress = g_ShifterState.aalpGearAddress[TARGET_GEAR_LAST][0];
+    g_ShifterState.dwCurrentGear = GEAR_NEUTRAL;
+    g_ShifterState.dwLastGear = GEAR_NEUTRAL;
+
+    // The game has the foreground unless the scenario takes it, foreground queries are counted
+    InitFakeWindowSystem(
+        lpWindowSystem,
+        BENCH_SHIFT_GAME_PROCESS_ID
+    );
+
+    g_ShiftTarget.GetForegroundProcessId = lpWindowSystem->GetForegroundProcessId;
+    lpWindowSystem->GetForegroundProcessId = ShiftTargetGetForegroundProcessId;
+
+    // Redrawn off screen, so the redraws cost what they cost in the shifter
+    g_ShifterConfig.hGearDisplayConsole = CreateConsoleScreenBuffer(
+        GENERIC_READ | GENERIC_WRITE,
+        0,
+        NULL,
+        CONSOLE_TEXTMODE_BUFFER,
+        NULL
+    );
+
+    g_ShifterConfig.bGearWindowEnabled = (INVALID_HANDLE_VALUE != g_ShifterConfig.hGearDisplayConsole);
+
+    if (!g_ShifterConfig.bGearWindowEnabled) {
+        fprintf(
+            stderr,
+            "[-] CreateConsoleScreenBuffer(): E%lu, benchmarking without the gear display\n",
+            GetLastError()
+        );
+    }
+
+    return StartGearWriter();
+}
+
+/// Benchmarks every selected shift scenario against the stand-in game.
+/// Returns FALSE if the shifter couldn't be set up or a shift was missed.
+STATIC BOOLEAN BenchmarkShifts(
+    LPCBENCH_CONFIG lpConfig,
+    FILE *lpResultsFile
+) {
+    WINDOW_SYSTEM windowSystem = { 0 };
+    FOCUS_TRACKER focusTracker = { 0 };
+    SIGNATURE_PACK signaturePack = { 0 };
+    BENCH_HEAP benchHeap = { 0 };
+    BYTE abyGearKeys[GEAR_8 + 1] = { 0 };
+    DWORD dwSequence = 0;
+    BOOLEAN bRet = FALSE;
+
+    if (!InitShiftBenchmark(
+        &windowSystem,
+        abyGearKeys
+    )) {
+        goto _FINAL;
+    }
+
+    StartFocusTracker(
+        &focusTracker,
+        &windowSystem,
+        BENCH_SHIFT_GAME_PROCESS_ID,
+        GetCurrentProcessId()
+    );
+
+    printf(
+        "[*] %lu shifts per run, commit window %lu ms, gear display %s\n",
+        lpConfig->dwShifts,
+        g_ShifterConfig.dwCommitWindowMs,
+        g_ShifterConfig.bGearWindowEnabled ? "on" : "off"
+    );
+
+    printf(
+        "%-12s %3s %10s %8s %8s %8s %8s %7s %7s %7s %7s %6s\n",
+        "Scenario",
+        "Run",
+        "Shifts/s",
+        "p50 us",
+        "p99 us",
+        "p99.9 us",
+        "max us",
+        "Reads",
+        "Writes",
+        "FgWin",
+        "Redraw",
+        "Missed"
+    );
+
+    bRet = TRUE;
+
+    for (DWORD i = 0; i < ARRAYSIZE(g_aShiftScenarios); ++i) {
+        LPCBENCH_SHIFT_SCENARIO lpScenario = &g_aShiftScenarios[i];
+        BENCH_RESCAN_LOAD rescanLoad = { 0 };
+        HANDLE hRescanThread = NULL;
+        HANDLE hTickThread = NULL;
+
+        if (NULL != lpConfig->szScenario && EXIT_SUCCESS != strcmp(
+            lpConfig->szScenario,
+            lpScenario->szName
+        )) {
+            continue;
+        }
+
+        // The layout is built once, before any timing
+        if (lpScenario->bRescan && NULL == benchHeap.aRegions) {
+            InitDefaultSignaturePack(&signaturePack);
+
+            if (!BuildBenchHeap(
+                &benchHeap,
+                &g_aLayouts[0],
+                lpConfig,
+                &signaturePack
+            )) {
+                bRet = FALSE;
+                continue;
+            }
+        }
+
+        for (DWORD dwRun = 0; dwRun < lpConfig->dwRuns; ++dwRun) {
+            BENCH_SHIFT_RESULT shiftResult = { 0 };
+
+            if (lpScenario->bRescan) {
+                rescanLoad = (BENCH_RESCAN_LOAD) {
+                    .lpHeap = &benchHeap,
+                    .lpSignaturePack = &signaturePack
+                };
+                benchHeap.lStop = FALSE;
+
+                hTickThread = CreateThread(
+                    NULL,
+                    0,
+                    BenchTickThread,
+                    &benchHeap,
+                    0,
+                    NULL
+                );
+
+                hRescanThread = CreateThread(
+                    NULL,
+                    0,
+                    BenchRescanThread,
+                    &rescanLoad,
+                    0,
+                    NULL
+                );
+
+                if (NULL == hTickThread || NULL == hRescanThread) {
+                    fprintf(
+                        stderr,
+                        "[-] CreateThread(): E%lu\n",
+                        GetLastError()
+                    );
+                }
+            }
+
+            RunShiftScenario(
+                lpScenario,
+                lpConfig,
+                &focusTracker,
+                abyGearKeys,
+                &dwSequence,
+                &shiftResult
+            );
+
+            if (NULL != hRescanThread) {
+                InterlockedExchange(&rescanLoad.lStop, TRUE);
+                WaitForSingleObject(
+                    hRescanThread,
+                    INFINITE
+                );
+
+                CloseHandle(hRescanThread);
+                hRescanThread = NULL;
+            }
+
+            if (NULL != hTickThread) {
+                InterlockedExchange(&benchHeap.lStop, TRUE);
+                WaitForSingleObject(
+                    hTickThread,
+                    INFINITE
+                );
+
+                CloseHandle(hTickThread);
+                hTickThread = NULL;
+            }
+
+            shiftResult.dwRescans = (DWORD) rescanLoad.lScans;
+
+            WriteShiftResult(
+                lpResultsFile,
+                lpConfig,
+                lpScenario,
+                dwRun,
+                &shiftResult
+            );
+
+            if (0 != shiftResult.dwMissed) {
+                bRet = FALSE;
+            }
+
+            if (0 != shiftResult.dwLeaked) {
+                fprintf(
+                    stderr,
+                    "[-] %s: %lu of %lu keys pressed while the game wasn't focused were dispatched.\n",
+                    lpScenario->szName,
+                    shiftResult.dwLeaked,
+                    shiftResult.dwUnfocusedKeys
+                );
+                bRet = FALSE;
+            }
+
+            // Focus changes are notified, keys never ask for the foreground window
+            if (0 != shiftResult.qwForegroundQueries) {
+                fprintf(
+                    stderr,
+                    "[-] %s: %llu foreground window queries for %lu keys.\n",
+                    lpScenario->szName,
+                    shiftResult.qwForegroundQueries,
+                    shiftResult.dwKeys
+                );
+                bRet = FALSE;
+            }
+        }
+    }
+
+_FINAL:
+    StopFocusTracker(&focusTracker);
+    StopGearWriter();
+    FreeBenchHeap(&benchHeap);
+
+    if (g_ShifterConfig.bGearWindowEnabled) {
+        CloseHandle(g_ShifterConfig.hGearDisplayConsole);
+        g_ShifterConfig.bGearWindowEnabled = FALSE;
+    }
+
+    fflush(lpResultsFile);
+    return bRet;
+}
+
+STATIC VOID ParseBenchArguments(
+    LPBENCH_CONFIG lpConfig,
+    int argc,
+    const char *argv[]
+) {
+    for (INT i = 1; i + 1 < argc; i++) {
+        if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--out",
+            strlen("--out")
+        )) {
+            lpConfig->szResultsPath = argv[++i];
+        } else if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--label",
+            strlen("--label")
+        )) {
+            lpConfig->szLabel = argv[++i];
+        } else if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--runs",
+            strlen("--runs")
+        )) {
+            lpConfig->dwRuns = strtoul(argv[++i], NULL, 0);
+        } else if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--heap-mib",
+            strlen("--heap-mib")
+        )) {
+            lpConfig->cbHeap = (SIZE_T) strtoull(argv[++i], NULL, 0) << 20;
+        } else if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--seed",
+            strlen("--seed")
+        )) {
+            lpConfig->qwSeed = strtoull(argv[++i], NULL, 0);
+        } else if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--layout",
+            strlen("--layout")
+        )) {
+            lpConfig->szLayout = argv[++i];
+        } else if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--variant",
+            strlen("--variant")
+        )) {
+            lpConfig->szVariant = argv[++i];
+        } else if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--suite",
+            strlen("--suite")
+        )) {
+            lpConfig->szSuite = argv[++i];
+        } else if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--scenario",
+            strlen("--scenario")
+        )) {
+            lpConfig->szScenario = argv[++i];
+        } else if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--shifts",
+            strlen("--shifts")
+        )) {
+            lpConfig->dwShifts = strtoul(argv[++i], NULL, 0);
+        }
+    }
+
+    lpConfig->dwRuns = max(lpConfig->dwRuns, 1);
+    lpConfig->dwShifts = max(lpConfig->dwShifts, 1);
+    lpConfig->cbHeap = max(lpConfig->cbHeap, BENCH_MIN_HEAP_SIZE);
+}
+
+int main(int argc, const char *argv[]) {
+    BENCH_CONFIG benchConfig = {
+        .szSuite = "scan",
+        .dwShifts = BENCH_DEFAULT_SHIFTS,
+        .dwRuns = BENCH_DEFAULT_RUNS,
+        .cbHeap = (SIZE_T) BENCH_DEFAULT_HEAP_MIB << 20,
+        .qwSeed = BENCH_DEFAULT_SEED
+    };
+
+    INT iRet = EXIT_SUCCESS;
+
+    ParseBenchArguments(
+        &benchConfig,
+        argc,
+        argv
+    );
+
+    // Before any variant overrides it
+    CONST SEARCH_KERNEL eDetectedKernel = GetSearchKernel();
+
+    if (EXIT_SUCCESS == strcmp(
+        benchConfig.szSuite,
+        "shift"
+    )) {
+        if (NULL == benchConfig.szResultsPath) {
+            benchConfig.szResultsPath = BENCH_DEFAULT_SHIFT_RESULTS_FILE;
+        }
+
+        printf(
+            "[*] Heat shift path benchmark: %lu runs, %llu MiB rescan layout\n",
+            benchConfig.dwRuns,
+            (DWORD64) benchConfig.cbHeap >> 20
+        );
+
+        FILE *lpResultsFile = OpenBenchResults(
+            benchConfig.szResultsPath,
+            "label,benchmark,scenario,run,keys,shifts,missed,seconds,shifts_per_second,keys_per_second,"
+            "dispatch_p50_us,dispatch_p99_us,dispatch_max_us,written_p50_us,written_p99_us,written_p999_us,written_max_us,"
+            "confirmed_p50_us,confirmed_p99_us,confirmed_max_us,"
+            "reads_per_shift,writes_per_shift,foreground_queries_per_shift,redraws_per_shift,rescans"
+        );
+
+        if (NULL == lpResultsFile) {
+            return EXIT_FAILURE;
+        }
+
+        if (!BenchmarkShifts(
+            &benchConfig,
+            lpResultsFile
+        )) {
+            iRet = EXIT_FAILURE;
+        }
+
+        fclose(lpResultsFile);
+        goto _FINAL;
+    }
+
+    if (NULL == benchConfig.szResultsPath) {
+        benchConfig.szResultsPath = BENCH_DEFAULT_RESULTS_FILE;
+    }
+
+    printf(
+        "[*] Heat scanner benchmark: %s kernel, %llu MiB layouts, %lu runs, seed 0x%llX\n",
+        GetSearchKernelName(eDetectedKernel),
+        (DWORD64) benchConfig.cbHeap >> 20,
+        benchConfig.dwRuns,
+        benchConfig.qwSeed
+    );
+
+    FILE *lpResultsFile = OpenBenchResults(
+        benchConfig.szResultsPath,
+        "label,benchmark,layout,variant,kernel,run,heap_bytes,regions,decoys,"
+        "bytes,seconds,gbps,read_calls,read_batches,read_calls_per_gb,candidates,hits,lock_seconds,locked"
+    );
+
+    if (NULL == lpResultsFile) {
+        return EXIT_FAILURE;
+    }
+
+    for (DWORD i = 0; i < ARRAYSIZE(g_aLayouts); ++i) {
+        if (NULL != benchConfig.szLayout && EXIT_SUCCESS != strcmp(
+            benchConfig.szLayout,
+            g_aLayouts[i].szName
+        )) {
+            continue;
+        }
+
+        if (!BenchmarkLayout(
+            &g_aLayouts[i],
+            &benchConfig,
+            eDetectedKernel,
+            lpResultsFile
+        )) {
+            iRet = EXIT_FAILURE;
+        }
+    }
+
+    fclose(lpResultsFile);
+
+_FINAL:
+    printf(
+        "\n[%c] Results appended to '%s'.\n",
+        (EXIT_SUCCESS == iRet) ? '+' : '-',
+        benchConfig.szResultsPath
+    );
+
+    return iRet;
+}
@@ -0,0 +1,374 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/// @file Corpus.c
+/// @brief Validates a signature pack against a directory of memory dumps.
+///
+///  Up to CORPUS_MAX_CONCURRENT_DUMPS corpus threads pull dumps off a shared
+///  index, each scanning its dump with its share of the processors. Dumps are
+///  independent memory sources with their own region maps, so the scans
+///  don't share any state.
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+///
+
+#include "Corpus.h"
+
+#include <Shlwapi.h>
+#include <stdio.h>
+
+typedef struct _CORPUS_DUMP {
+    CHAR szFileName[MAX_PATH];
+    BOOLEAN bOpened;
+    BOOLEAN bFound;
+    AOBSCAN_RESULT aobResult;
+} CORPUS_DUMP, *LPCORPUS_DUMP;
+
+typedef struct _CORPUS_JOB {
+    LPCSIGNATURE_PACK lpSignaturePack;
+    LPCSTR szDirectory;
+
+    LPCORPUS_DUMP aDumps;
+    DWORD dwDumpCount;
+    DWORD dwScanWorkerCount;    // Scan workers per dump
+
+    VOLATILE LONG lNextDump;
+    VOLATILE LONG lCompletedDumps;
+} CORPUS_JOB, *LPCORPUS_JOB;
+
+STATIC VOID ScanCorpusDump(
+    LPCORPUS_JOB lpJob,
+    LPCORPUS_DUMP lpDump
+) {
+    CHAR szDumpPath[MAX_PATH] = { 0 };
+    MEMORY_SOURCE memSource = { 0 };
+    REGION_MAP regionMap = { 0 };
+
+    if (NULL == PathCombineA(
+        szDumpPath,
+        lpJob->szDirectory,
+        lpDump->szFileName
+    )) {
+        return;
+    }
+
+    if (!InitDumpMemorySource(
+        &memSource,
+        szDumpPath
+    )) {
+        return;
+    }
+
+    lpDump->bOpened = TRUE;
+
+    CONST AOBSCAN_TARGET aobTarget = {
+        .lpSource = &memSource,
+        .lpRegionMap = &regionMap,
+        .dwWorkerCount = lpJob->dwScanWorkerCount,
+        .bShowProgress = FALSE
+    };
+
+    lpDump->bFound = AobScanTarget(
+        &aobTarget,
+        lpJob->lpSignaturePack,
+        &lpDump->aobResult
+    );
+
+    FreeRegionMap(&regionMap);
+    CloseDumpMemorySource(&memSource);
+}
+
+STATIC DWORD WINAPI CorpusWorker(
+    LPVOID lpParameter
+) {
+    LPCORPUS_JOB lpJob = (LPCORPUS_JOB) lpParameter;
+
+    for (;;) {
+        CONST LONG lDumpIndex = InterlockedIncrement(&lpJob->lNextDump) - 1;
+
+        if ((DWORD) lDumpIndex >= lpJob->dwDumpCount) {
+            break;
+        }
+
+        LPCORPUS_DUMP lpDump = &lpJob->aDumps[lDumpIndex];
+
+        ScanCorpusDump(
+            lpJob,
+            lpDump
+        );
+
+        printf(
+            "[*] Scanned dump %ld / %lu: '%s'\n",
+            InterlockedIncrement(&lpJob->lCompletedDumps),
+            lpJob->dwDumpCount,
+            lpDump->szFileName
+        );
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/// Collects the names of all files in the directory.
+STATIC BOOLEAN CollectCorpusDumps(
+    LPCORPUS_JOB lpJob
+) {
+    CHAR szSearchPath[MAX_PATH] = { 0 };
+    WIN32_FIND_DATAA findData = { 0 };
+
+    if (NULL == PathCombineA(
+        szSearchPath,
+        lpJob->szDirectory,
+        "*"
+    )) {
+        fprintf(
+            stderr,
+            "[-] PathCombineA(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    HANDLE hFind = FindFirstFileA(
+        szSearchPath,
+        &findData
+    );
+
+    if (INVALID_HANDLE_VALUE == hFind) {
+        fprintf(
+            stderr,
+            "[-] FindFirstFileA(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    do {
+        if (FILE_ATTRIBUTE_DIRECTORY & findData.dwFileAttributes) {
+            continue;
+        }
+
+        if (CORPUS_MAX_DUMPS == lpJob->dwDumpCount) {
+            printf(
+                "[*] Corpus holds more than %u dumps, scanning the first %u.\n",
+                CORPUS_MAX_DUMPS,
+                CORPUS_MAX_DUMPS
+            );
+            break;
+        }
+
+        strncpy_s(
+            lpJob->aDumps[lpJob->dwDumpCount++].szFileName,
+            MAX_PATH,
+            findData.cFileName,
+            _TRUNCATE
+        );
+    } while (FindNextFileA(
+        hFind,
+        &findData
+    ));
+
+    FindClose(hFind);
+    return TRUE;
+}
+
+STATIC VOID PrintCorpusTable(
+    LPCORPUS_JOB lpJob
+) {
+    LPCSIGNATURE_PACK lpSignaturePack = lpJob->lpSignaturePack;
+
+    printf(
+        "\n%-32s %-16s %-18s %-18s %10s %8s %7s  %s\n",
+        "Dump",
+        "Hits",
+        "Current gear",
+        "Previous gear",
+        "MiB",
+        "Seconds",
+        "GB/s",
+        "Result"
+    );
+
+    for (DWORD i = 0; i < lpJob->dwDumpCount; ++i) {
+        LPCORPUS_DUMP lpDump = &lpJob->aDumps[i];
+        LPCAOBSCAN_RESULT lpcResult = &lpDump->aobResult;
+        CHAR szHits[64] = { 0 };
+        SIZE_T cchHits = 0;
+
+        if (!lpDump->bOpened) {
+            printf(
+                "%-32.32s %-16s %-18s %-18s %10s %8s %7s  %s\n",
+                lpDump->szFileName,
+                "-",
+                "-",
+                "-",
+                "-",
+                "-",
+                "-",
+                "ERROR"
+            );
+            continue;
+        }
+
+        // Hits per signature, in pack order
+        for (DWORD j = 0; j < lpSignaturePack->dwSignatureCount && cchHits < sizeof(szHits); ++j) {
+            cchHits += (SIZE_T) snprintf(
+                szHits + cchHits,
+                sizeof(szHits) - cchHits,
+                (0 == j) ? "%lu" : "/%lu",
+                lpcResult->adwHitCount[j]
+            );
+        }
+
+        printf(
+            "%-32.32s %-16.16s 0x%016llX 0x%016llX %10llu %8.2f %7.2f  %s\n",
+            lpDump->szFileName,
+            szHits,
+            (DWORD64) lpcResult->alpArtifact[TARGET_GEAR_CURRENT],
+            (DWORD64) lpcResult->alpArtifact[TARGET_GEAR_LAST],
+            lpcResult->qwBytesScanned >> 20,
+            lpcResult->fScanSeconds,
+            (lpcResult->fScanSeconds > 0.0)
+                ? ((DOUBLE) lpcResult->qwBytesScanned / lpcResult->fScanSeconds / 1e9)
+                : 0.0,
+            lpDump->bFound ? "OK" : "MISSING"
+        );
+    }
+}
+
+BOOLEAN ScanDumpCorpus(
+    LPCSIGNATURE_PACK lpSignaturePack,
+    LPCSTR szDirectory
+) {
+    LARGE_INTEGER liFrequency, liCorpusStart, liCorpusEnd;
+    HANDLE ahThreads[CORPUS_MAX_CONCURRENT_DUMPS] = { 0 };
+    DWORD dwThreadCount = 0;
+    DWORD dwMatchedCount = 0;
+
+    CORPUS_JOB corpusJob = {
+        .lpSignaturePack = lpSignaturePack,
+        .szDirectory = szDirectory
+    };
+
+    corpusJob.aDumps = VirtualAlloc(
+        NULL,
+        CORPUS_MAX_DUMPS * sizeof(CORPUS_DUMP),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == corpusJob.aDumps) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    if (!CollectCorpusDumps(&corpusJob)) {
+        goto _FINAL;
+    }
+
+    if (0 == corpusJob.dwDumpCount) {
+        fprintf(
+            stderr,
+            "[-] No dumps found in '%s'.\n",
+            szDirectory
+        );
+        goto _FINAL;
+    }
+
+    CONST DWORD dwProcessorCount = max(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), 1);
+    CONST DWORD dwConcurrentDumps = min(corpusJob.dwDumpCount, CORPUS_MAX_CONCURRENT_DUMPS);
+
+    // Split the processors between the dumps scanned at once
+    corpusJob.dwScanWorkerCount = max(dwProcessorCount / dwConcurrentDumps, 1);
+
+    printf(
+        "[*] Scanning %lu dumps, %lu at a time with %lu scan threads each..\n",
+        corpusJob.dwDumpCount,
+        dwConcurrentDumps,
+        corpusJob.dwScanWorkerCount
+    );
+
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liCorpusStart);
+
+    for (DWORD i = 0; i < dwConcurrentDumps; ++i) {
+        HANDLE hThread = CreateThread(
+            NULL,
+            0,
+            CorpusWorker,
+            &corpusJob,
+            0,
+            NULL
+        );
+
+        if (NULL == hThread) {
+            fprintf(
+                stderr,
+                "[-] CreateThread(): E%lu\n",
+                GetLastError()
+            );
+            continue;
+        }
+
+        ahThreads[dwThreadCount++] = hThread;
+    }
+
+    // No threads, scan the dumps one by one on this one
+    if (0 == dwThreadCount) {
+        CorpusWorker(&corpusJob);
+    }
+
+    WaitForMultipleObjects(
+        dwThreadCount,
+        ahThreads,
+        TRUE,
+        INFINITE
+    );
+
+    QueryPerformanceCounter(&liCorpusEnd);
+
+    for (DWORD i = 0; i < dwThreadCount; ++i) {
+        CloseHandle(ahThreads[i]);
+    }
+
+    PrintCorpusTable(&corpusJob);
+
+    for (DWORD i = 0; i < corpusJob.dwDumpCount; ++i) {
+        if (corpusJob.aDumps[i].bFound) {
+            dwMatchedCount++;
+        }
+    }
+
+    printf(
+        "\n[%c] %lu / %lu dumps matched all target gears in %.2f s.\n",
+        (dwMatchedCount == corpusJob.dwDumpCount) ? '+' : '-',
+        dwMatchedCount,
+        corpusJob.dwDumpCount,
+        (DOUBLE) (liCorpusEnd.QuadPart - liCorpusStart.QuadPart) / (DOUBLE) liFrequency.QuadPart
+    );
+
+_FINAL:
+    VirtualFree(
+        corpusJob.aDumps,
+        0,
+        MEM_RELEASE
+    );
+
+    return (0 != corpusJob.dwDumpCount && dwMatchedCount == corpusJob.dwDumpCount);
+}
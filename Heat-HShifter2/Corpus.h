@@ -0,0 +1,43 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+///
+
+/// @file Corpus.h
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#ifndef _HEAT_HSHIFTER2_CORPUS_H
+#define _HEAT_HSHIFTER2_CORPUS_H
+
+#include "Search.h"
+
+#define CORPUS_MAX_DUMPS                        256
+#define CORPUS_MAX_CONCURRENT_DUMPS             4                   // Dumps mapped and scanned at once
+
+/// <summary>
+///  Scans every memory dump in a directory for a signature pack, several dumps
+///  at once, and prints a table of hits, artifact addresses and scan throughput per dump.
+/// </summary>
+/// <param name="lpSignaturePack"></param>
+/// <param name="szDirectory"></param>
+/// <returns>
+///  TRUE if every dump has a verified artifact for every target gear of the pack, FALSE otherwise.
+/// </returns>
+BOOLEAN ScanDumpCorpus(
+    LPCSIGNATURE_PACK lpSignaturePack,
+    LPCSTR szDirectory
+);
+
+#endif // _HEAT_HSHIFTER2_CORPUS_H
@@ -0,0 +1,962 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/// @file DumpWriter.c
+/// @brief Writes sparse, compressed region dumps of the game for bug reports.
+///
+///  The dump is captured in two passes over DUMP_WRITER_CHUNK_SIZE work items.
+///  The first one stores every scannable region and searches the remaining
+///  readable regions for the signatures, the second one stores the windows
+///  around the hits of the first. Workers compress blocks of non-zero pages
+///  and append them to the file in whatever order they finish, the block
+///  table written at the end keeps the dump seekable by address.
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+///
+
+#include "DumpWriter.h"
+
+#include <compressapi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#pragma comment (lib, "Cabinet.lib")
+
+typedef struct _DUMP_ITEM {
+    LPCBYTE lpAddress;
+    SIZE_T cbSize;
+    SIZE_T cbOverlap;                   // Bytes read past cbSize, for matches straddling the next item
+    BOOLEAN bCapture;                   // Stored in the dump, only searched for hits otherwise
+} DUMP_ITEM, *LPDUMP_ITEM;
+
+typedef CONST DUMP_ITEM *LPCDUMP_ITEM;
+
+typedef struct _DUMP_WRITER_JOB {
+    LPMEMORY_SOURCE lpSource;
+    LPCSIGNATURE_PACK lpSignaturePack;
+    SIZE_T cbHitRadius;
+    DWORD dwWorkerCount;
+
+    LPDUMP_ITEM aItems;
+    DWORD64 qwItemCount;
+    VOLATILE LONG64 qwNextItem;
+
+    // Captured ranges, the region table of the dump
+    LPREGION_DUMP_ENTRY aEntries;
+    DWORD dwEntryCount;
+
+    SRWLOCK OutputLock;                 // Guards everything below
+    HANDLE hFile;
+    DWORD64 qwFileOffset;
+    LPREGION_DUMP_BLOCK aBlocks;
+    DWORD64 qwBlockCount;
+    DWORD64 qwBlockCapacity;
+    LPCBYTE alpHits[DUMP_WRITER_MAX_HITS];
+    DWORD dwHitCount;
+    VOLATILE BOOLEAN bWriteFailed;
+
+    VOLATILE LONG64 qwBytesCaptured;
+    VOLATILE LONG64 qwBytesUnreadable;
+    VOLATILE LONG64 qwZeroPages;
+} DUMP_WRITER_JOB, *LPDUMP_WRITER_JOB;
+
+STATIC BOOLEAN IsZeroPage(
+    LPCBYTE lpPage,
+    CONST SIZE_T cbPage
+) {
+    CONST DWORD64 *lpQwords = (CONST DWORD64 *) lpPage;
+    DWORD64 qwBits = 0;
+
+    for (SIZE_T i = 0; i < cbPage / sizeof(DWORD64); ++i) {
+        qwBits |= lpQwords[i];
+    }
+
+    return (0 == qwBits);
+}
+
+/// Compresses a block and appends it to the dump, stored raw if it doesn't shrink.
+STATIC VOID WriteDumpBlock(
+    LPDUMP_WRITER_JOB lpJob,
+    COMPRESSOR_HANDLE hCompressor,
+    LPCBYTE lpAddress,
+    LPCBYTE lpData,
+    CONST SIZE_T cbSize,
+    LPBYTE lpCompressed
+) {
+    SIZE_T cbCompressed = 0;
+    LPCBYTE lpStored = lpData;
+    SIZE_T cbStored = cbSize;
+    DWORD dwWritten = 0;
+
+    if (NULL != hCompressor && Compress(
+        hCompressor,
+        lpData,
+        cbSize,
+        lpCompressed,
+        cbSize,
+        &cbCompressed
+    ) && cbCompressed < cbSize) {
+        lpStored = lpCompressed;
+        cbStored = cbCompressed;
+    }
+
+    AcquireSRWLockExclusive(&lpJob->OutputLock);
+
+    if (lpJob->bWriteFailed) {
+        goto _FINAL;
+    }
+
+    if (!WriteFile(
+        lpJob->hFile,
+        lpStored,
+        (DWORD) cbStored,
+        &dwWritten,
+        NULL
+    ) || dwWritten != cbStored || lpJob->qwBlockCount == lpJob->qwBlockCapacity) {
+        fprintf(
+            stderr,
+            "[-] WriteFile(): E%lu\n",
+            GetLastError()
+        );
+        lpJob->bWriteFailed = TRUE;
+        goto _FINAL;
+    }
+
+    lpJob->aBlocks[lpJob->qwBlockCount++] = (REGION_DUMP_BLOCK) {
+        .qwAddress = (DWORD64) lpAddress,
+        .qwFileOffset = lpJob->qwFileOffset,
+        .cbSize = (DWORD) cbSize,
+        .cbStored = (DWORD) cbStored
+    };
+
+    lpJob->qwFileOffset += cbStored;
+
+_FINAL:
+    ReleaseSRWLockExclusive(&lpJob->OutputLock);
+}
+
+/// Reads a range of the game, a failed read is split in halves until the
+/// readable pages are recovered. Pages that stay unreadable are zeroed, so
+/// they are left out of the dump like zero pages.
+/// Returns the number of unreadable bytes.
+STATIC SIZE_T ReadDumpPages(
+    LPMEMORY_SOURCE lpSource,
+    LPCBYTE lpAddress,
+    LPBYTE lpBuffer,
+    CONST SIZE_T cbSize
+) {
+    if (0 == cbSize || ReadMemory(
+        lpSource,
+        lpAddress,
+        lpBuffer,
+        cbSize
+    )) {
+        return 0;
+    }
+
+    if (cbSize <= PAGE_SIZE) {
+        ZeroMemory(
+            lpBuffer,
+            cbSize
+        );
+        return cbSize;
+    }
+
+    CONST SIZE_T cbHalf = ((cbSize / 2) + PAGE_SIZE - 1) & ~((SIZE_T) PAGE_SIZE - 1);
+
+    return ReadDumpPages(
+        lpSource,
+        lpAddress,
+        lpBuffer,
+        cbHalf
+    ) + ReadDumpPages(
+        lpSource,
+        lpAddress + cbHalf,
+        lpBuffer + cbHalf,
+        cbSize - cbHalf
+    );
+}
+
+/// Splits a chunk into blocks of consecutive non-zero pages.
+/// cbUnreadable bytes of it were zeroed by ReadDumpPages() and are missing, not zero.
+STATIC VOID CaptureDumpChunk(
+    LPDUMP_WRITER_JOB lpJob,
+    COMPRESSOR_HANDLE hCompressor,
+    LPCDUMP_ITEM lpItem,
+    LPCBYTE lpData,
+    CONST SIZE_T cbUnreadable,
+    LPBYTE lpCompressed
+) {
+    SIZE_T cbOffset = 0;
+    DWORD64 qwZeroPages = 0;
+
+    while (cbOffset < lpItem->cbSize) {
+        if (IsZeroPage(
+            lpData + cbOffset,
+            min(PAGE_SIZE, lpItem->cbSize - cbOffset)
+        )) {
+            qwZeroPages++;
+            cbOffset += PAGE_SIZE;
+            continue;
+        }
+
+        CONST SIZE_T cbLimit = min(lpItem->cbSize, cbOffset + REGION_DUMP_BLOCK_SIZE);
+        SIZE_T cbEnd = min(cbLimit, cbOffset + PAGE_SIZE);
+
+        while (cbEnd < cbLimit && !IsZeroPage(
+            lpData + cbEnd,
+            min(PAGE_SIZE, cbLimit - cbEnd)
+        )) {
+            cbEnd = min(cbLimit, cbEnd + PAGE_SIZE);
+        }
+
+        WriteDumpBlock(
+            lpJob,
+            hCompressor,
+            lpItem->lpAddress + cbOffset,
+            lpData + cbOffset,
+            cbEnd - cbOffset,
+            lpCompressed
+        );
+
+        cbOffset = cbEnd;
+    }
+
+    InterlockedAdd64(
+        &lpJob->qwZeroPages,
+        (LONG64) (qwZeroPages - cbUnreadable / PAGE_SIZE)
+    );
+
+    InterlockedAdd64(
+        &lpJob->qwBytesCaptured,
+        (LONG64) (lpItem->cbSize - cbUnreadable)
+    );
+}
+
+/// Records the signature hits that start within the chunk.
+STATIC VOID SearchDumpChunk(
+    LPDUMP_WRITER_JOB lpJob,
+    LPCDUMP_ITEM lpItem,
+    LPCBYTE lpData
+) {
+    CONST SIZE_T cbSearch = lpItem->cbSize + lpItem->cbOverlap;
+
+    for (DWORD i = 0; i < lpJob->lpSignaturePack->dwSignatureCount; ++i) {
+        LPCSIGNATURE lpSignature = &lpJob->lpSignaturePack->aSignatures[i];
+
+        for (
+            SIZE_T qwIndex = FindPattern(
+                &lpSignature->SearchPattern,
+                lpData,
+                cbSearch,
+                0,
+                (DWORD64) lpItem->lpAddress
+            );
+            SEARCH_NOT_FOUND != qwIndex && qwIndex < lpItem->cbSize;
+            qwIndex = FindPattern(
+                &lpSignature->SearchPattern,
+                lpData,
+                cbSearch,
+                qwIndex + 1,
+                (DWORD64) lpItem->lpAddress
+            )
+        ) {
+            AcquireSRWLockExclusive(&lpJob->OutputLock);
+
+            if (lpJob->dwHitCount < DUMP_WRITER_MAX_HITS) {
+                lpJob->alpHits[lpJob->dwHitCount++] = lpItem->lpAddress + qwIndex;
+            }
+
+            ReleaseSRWLockExclusive(&lpJob->OutputLock);
+        }
+    }
+}
+
+STATIC DWORD WINAPI DumpWriterWorker(
+    LPVOID lpParameter
+) {
+    LPDUMP_WRITER_JOB lpJob = (LPDUMP_WRITER_JOB) lpParameter;
+    COMPRESSOR_HANDLE hCompressor = NULL;
+
+    // Leave the game its share of the processors
+    SetThreadPriority(
+        GetCurrentThread(),
+        THREAD_PRIORITY_BELOW_NORMAL
+    );
+
+    LPBYTE lpChunk = VirtualAlloc(
+        NULL,
+        DUMP_WRITER_CHUNK_SIZE + SIGNATURE_MAX_SIZE + REGION_DUMP_BLOCK_SIZE,
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpChunk) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return EXIT_FAILURE;
+    }
+
+    LPBYTE lpCompressed = lpChunk + DUMP_WRITER_CHUNK_SIZE + SIGNATURE_MAX_SIZE;
+
+    // Blocks are stored raw without a compressor
+    if (!CreateCompressor(
+        COMPRESS_ALGORITHM_XPRESS_HUFF | COMPRESS_RAW,
+        NULL,
+        &hCompressor
+    )) {
+        WriteLog(
+            "[-] CreateCompressor(): E%lu\n",
+            GetLastError()
+        );
+        hCompressor = NULL;
+    }
+
+    for (;;) {
+        CONST LONG64 qwItem = InterlockedIncrement64(&lpJob->qwNextItem) - 1;
+
+        if ((DWORD64) qwItem >= lpJob->qwItemCount || lpJob->bWriteFailed) {
+            break;
+        }
+
+        LPCDUMP_ITEM lpItem = &lpJob->aItems[qwItem];
+        SIZE_T cbUnreadable = 0;
+
+        // Some pages were freed or protected since the region map was taken,
+        // the overlap past the chunk is only searched and isn't counted
+        if (!ReadMemory(
+            lpJob->lpSource,
+            lpItem->lpAddress,
+            lpChunk,
+            lpItem->cbSize + lpItem->cbOverlap
+        )) {
+            cbUnreadable = ReadDumpPages(
+                lpJob->lpSource,
+                lpItem->lpAddress,
+                lpChunk,
+                lpItem->cbSize
+            );
+
+            ReadDumpPages(
+                lpJob->lpSource,
+                lpItem->lpAddress + lpItem->cbSize,
+                lpChunk + lpItem->cbSize,
+                lpItem->cbOverlap
+            );
+
+            InterlockedAdd64(
+                &lpJob->qwBytesUnreadable,
+                (LONG64) cbUnreadable
+            );
+
+            if (cbUnreadable == lpItem->cbSize) {
+                continue;
+            }
+        }
+
+        if (lpItem->bCapture) {
+            CaptureDumpChunk(
+                lpJob,
+                hCompressor,
+                lpItem,
+                lpChunk,
+                cbUnreadable,
+                lpCompressed
+            );
+        } else {
+            SearchDumpChunk(
+                lpJob,
+                lpItem,
+                lpChunk
+            );
+        }
+    }
+
+    if (NULL != hCompressor) {
+        CloseCompressor(hCompressor);
+    }
+
+    VirtualFree(
+        lpChunk,
+        0,
+        MEM_RELEASE
+    );
+
+    return EXIT_SUCCESS;
+}
+
+STATIC VOID RunDumpWorkers(
+    LPDUMP_WRITER_JOB lpJob
+) {
+    HANDLE ahThreads[AOBSCAN_MAX_WORKERS] = { 0 };
+    DWORD dwThreadCount = 0;
+
+    lpJob->qwNextItem = 0;
+
+    for (DWORD i = 0; i < lpJob->dwWorkerCount; ++i) {
+        HANDLE hThread = CreateThread(
+            NULL,
+            0,
+            DumpWriterWorker,
+            lpJob,
+            0,
+            NULL
+        );
+
+        if (NULL == hThread) {
+            fprintf(
+                stderr,
+                "[-] CreateThread(): E%lu\n",
+                GetLastError()
+            );
+            continue;
+        }
+
+        ahThreads[dwThreadCount++] = hThread;
+    }
+
+    // No threads, capture on this one
+    if (0 == dwThreadCount) {
+        DumpWriterWorker(lpJob);
+    }
+
+    WaitForMultipleObjects(
+        dwThreadCount,
+        ahThreads,
+        TRUE,
+        INFINITE
+    );
+
+    for (DWORD i = 0; i < dwThreadCount; ++i) {
+        CloseHandle(ahThreads[i]);
+    }
+}
+
+/// Replaces the work items with room for qwItemCount new ones.
+STATIC BOOLEAN AllocateDumpItems(
+    LPDUMP_WRITER_JOB lpJob,
+    CONST DWORD64 qwItemCount
+) {
+    if (NULL != lpJob->aItems) {
+        VirtualFree(
+            lpJob->aItems,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    lpJob->qwItemCount = 0;
+    lpJob->aItems = VirtualAlloc(
+        NULL,
+        (SIZE_T) max(qwItemCount, 1) * sizeof(DUMP_ITEM),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpJob->aItems) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/// Splits [lpStart, lpEnd) into work items. Search items overlap the next
+/// one by up to SIGNATURE_MAX_SIZE - 1 bytes, as long as lpLimit allows.
+STATIC VOID AddDumpItems(
+    LPDUMP_WRITER_JOB lpJob,
+    LPCBYTE lpStart,
+    LPCBYTE lpEnd,
+    LPCBYTE lpLimit,
+    CONST BOOLEAN bCapture
+) {
+    for (LPCBYTE lpAddress = lpStart; lpAddress < lpEnd; lpAddress += DUMP_WRITER_CHUNK_SIZE) {
+        CONST SIZE_T cbSize = min((SIZE_T) (lpEnd - lpAddress), DUMP_WRITER_CHUNK_SIZE);
+
+        lpJob->aItems[lpJob->qwItemCount++] = (DUMP_ITEM) {
+            .lpAddress = lpAddress,
+            .cbSize = cbSize,
+            .cbOverlap = bCapture
+                ? 0
+                : min((SIZE_T) (lpLimit - (lpAddress + cbSize)), SIGNATURE_MAX_SIZE - 1),
+            .bCapture = bCapture
+        };
+    }
+}
+
+STATIC BOOLEAN IsMemoryRegionReadable(
+    LPCMEMORY_REGION lpRegion
+) {
+    return !((PAGE_NOACCESS | PAGE_GUARD) & lpRegion->dwProtect);
+}
+
+/// First pass, scannable regions are captured, other readable ones searched if there is a hit radius.
+STATIC BOOLEAN PlanRegionCapture(
+    LPDUMP_WRITER_JOB lpJob,
+    LPCREGION_MAP lpRegionMap
+) {
+    DWORD64 qwItemCount = 0;
+
+    for (SIZE_T i = 0; i < lpRegionMap->qwRegionCount; ++i) {
+        qwItemCount += (lpRegionMap->aRegions[i].cbSize + DUMP_WRITER_CHUNK_SIZE - 1) / DUMP_WRITER_CHUNK_SIZE;
+    }
+
+    if (!AllocateDumpItems(
+        lpJob,
+        qwItemCount
+    )) {
+        return FALSE;
+    }
+
+    for (SIZE_T i = 0; i < lpRegionMap->qwRegionCount; ++i) {
+        LPCMEMORY_REGION lpRegion = &lpRegionMap->aRegions[i];
+        LPCBYTE lpEnd = lpRegion->lpBaseAddress + lpRegion->cbSize;
+
+        if (IsMemoryRegionScannable(lpRegion)) {
+            lpJob->aEntries[lpJob->dwEntryCount++] = (REGION_DUMP_ENTRY) {
+                .qwBaseAddress = (DWORD64) lpRegion->lpBaseAddress,
+                .qwSize = lpRegion->cbSize,
+                .dwProtect = lpRegion->dwProtect,
+                .dwType = lpRegion->dwType
+            };
+        } else if (0 == lpJob->cbHitRadius || !IsMemoryRegionReadable(lpRegion)) {
+            continue;
+        }
+
+        AddDumpItems(
+            lpJob,
+            lpRegion->lpBaseAddress,
+            lpEnd,
+            lpEnd,
+            IsMemoryRegionScannable(lpRegion)
+        );
+    }
+
+    return TRUE;
+}
+
+STATIC INT CompareDumpHits(
+    CONST VOID *lpFirst,
+    CONST VOID *lpSecond
+) {
+    LPCBYTE lpFirstHit = *(CONST LPCBYTE *) lpFirst;
+    LPCBYTE lpSecondHit = *(CONST LPCBYTE *) lpSecond;
+
+    return (lpFirstHit > lpSecondHit) - (lpFirstHit < lpSecondHit);
+}
+
+/// Second pass, captures the page aligned window around each hit, clipped to
+/// its region. Windows that overlap within a region are merged.
+STATIC BOOLEAN PlanHitCapture(
+    LPDUMP_WRITER_JOB lpJob,
+    LPCREGION_MAP lpRegionMap
+) {
+    CONST DWORD dwFirstWindow = lpJob->dwEntryCount;
+    DWORD64 qwItemCount = 0;
+    LPCMEMORY_REGION lpLastRegion = NULL;
+
+    qsort(
+        (LPVOID) lpJob->alpHits,
+        lpJob->dwHitCount,
+        sizeof(LPCBYTE),
+        CompareDumpHits
+    );
+
+    for (DWORD i = 0; i < lpJob->dwHitCount; ++i) {
+        LPCMEMORY_REGION lpRegion = FindMemoryRegion(
+            lpRegionMap,
+            lpJob->alpHits[i]
+        );
+
+        if (NULL == lpRegion) {
+            continue;
+        }
+
+        CONST DWORD64 qwRegionStart = (DWORD64) lpRegion->lpBaseAddress;
+        CONST DWORD64 qwRegionEnd = qwRegionStart + lpRegion->cbSize;
+        CONST DWORD64 qwHit = (DWORD64) lpJob->alpHits[i];
+
+        CONST DWORD64 qwStart = max(
+            qwRegionStart,
+            (qwHit - qwRegionStart > lpJob->cbHitRadius)
+                ? ((qwHit - lpJob->cbHitRadius) & ~((DWORD64) PAGE_SIZE - 1))
+                : qwRegionStart
+        );
+
+        CONST DWORD64 qwEnd = min(
+            qwRegionEnd,
+            (qwRegionEnd - qwHit > lpJob->cbHitRadius + SIGNATURE_MAX_SIZE)
+                ? ((qwHit + lpJob->cbHitRadius + SIGNATURE_MAX_SIZE + PAGE_SIZE - 1) & ~((DWORD64) PAGE_SIZE - 1))
+                : qwRegionEnd
+        );
+
+        if (lpRegion == lpLastRegion) {
+            LPREGION_DUMP_ENTRY lpLastWindow = &lpJob->aEntries[lpJob->dwEntryCount - 1];
+            CONST DWORD64 qwLastEnd = lpLastWindow->qwBaseAddress + lpLastWindow->qwSize;
+
+            if (qwStart <= qwLastEnd) {
+                lpLastWindow->qwSize = max(qwEnd, qwLastEnd) - lpLastWindow->qwBaseAddress;
+                continue;
+            }
+        }
+
+        lpJob->aEntries[lpJob->dwEntryCount++] = (REGION_DUMP_ENTRY) {
+            .qwBaseAddress = qwStart,
+            .qwSize = qwEnd - qwStart,
+            .dwProtect = lpRegion->dwProtect,
+            .dwType = lpRegion->dwType
+        };
+
+        lpLastRegion = lpRegion;
+    }
+
+    for (DWORD i = dwFirstWindow; i < lpJob->dwEntryCount; ++i) {
+        qwItemCount += (lpJob->aEntries[i].qwSize + DUMP_WRITER_CHUNK_SIZE - 1) / DUMP_WRITER_CHUNK_SIZE;
+    }
+
+    if (!AllocateDumpItems(
+        lpJob,
+        qwItemCount
+    )) {
+        return FALSE;
+    }
+
+    for (DWORD i = dwFirstWindow; i < lpJob->dwEntryCount; ++i) {
+        LPCBYTE lpStart = (LPCBYTE) lpJob->aEntries[i].qwBaseAddress;
+        LPCBYTE lpEnd = lpStart + lpJob->aEntries[i].qwSize;
+
+        AddDumpItems(
+            lpJob,
+            lpStart,
+            lpEnd,
+            lpEnd,
+            TRUE
+        );
+    }
+
+    printf(
+        "[*] %lu pattern hits outside scannable regions, capturing %lu windows around them..\n",
+        lpJob->dwHitCount,
+        lpJob->dwEntryCount - dwFirstWindow
+    );
+
+    return TRUE;
+}
+
+STATIC INT CompareDumpEntries(
+    CONST VOID *lpFirst,
+    CONST VOID *lpSecond
+) {
+    CONST DWORD64 qwFirstBase = ((LPCREGION_DUMP_ENTRY) lpFirst)->qwBaseAddress;
+    CONST DWORD64 qwSecondBase = ((LPCREGION_DUMP_ENTRY) lpSecond)->qwBaseAddress;
+
+    return (qwFirstBase > qwSecondBase) - (qwFirstBase < qwSecondBase);
+}
+
+STATIC INT CompareDumpBlocks(
+    CONST VOID *lpFirst,
+    CONST VOID *lpSecond
+) {
+    CONST DWORD64 qwFirstAddress = ((LPCREGION_DUMP_BLOCK) lpFirst)->qwAddress;
+    CONST DWORD64 qwSecondAddress = ((LPCREGION_DUMP_BLOCK) lpSecond)->qwAddress;
+
+    return (qwFirstAddress > qwSecondAddress) - (qwFirstAddress < qwSecondAddress);
+}
+
+STATIC BOOLEAN WriteDumpData(
+    HANDLE hFile,
+    LPCVOID lpData,
+    CONST SIZE_T cbSize
+) {
+    DWORD dwWritten = 0;
+
+    if (!WriteFile(
+        hFile,
+        lpData,
+        (DWORD) cbSize,
+        &dwWritten,
+        NULL
+    ) || dwWritten != cbSize) {
+        fprintf(
+            stderr,
+            "[-] WriteFile(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/// Appends the region and block tables and fills in the header.
+STATIC BOOLEAN WriteDumpTables(
+    LPDUMP_WRITER_JOB lpJob
+) {
+    LARGE_INTEGER liOffset = { 0 };
+
+    qsort(
+        lpJob->aEntries,
+        lpJob->dwEntryCount,
+        sizeof(REGION_DUMP_ENTRY),
+        CompareDumpEntries
+    );
+
+    qsort(
+        lpJob->aBlocks,
+        (SIZE_T) lpJob->qwBlockCount,
+        sizeof(REGION_DUMP_BLOCK),
+        CompareDumpBlocks
+    );
+
+    CONST REGION_DUMP_HEADER dumpHeader = {
+        .dwMagic = REGION_DUMP_MAGIC,
+        .dwVersion = REGION_DUMP_VERSION_BLOCKS,
+        .dwRegionCount = lpJob->dwEntryCount,
+        .qwRegionTableOffset = lpJob->qwFileOffset,
+        .qwBlockTableOffset = lpJob->qwFileOffset + (DWORD64) lpJob->dwEntryCount * sizeof(REGION_DUMP_ENTRY),
+        .qwBlockCount = lpJob->qwBlockCount,
+        .dwCompression = REGION_DUMP_COMPRESSION_XPRESS_HUFF
+    };
+
+    if (!WriteDumpData(
+        lpJob->hFile,
+        lpJob->aEntries,
+        (SIZE_T) lpJob->dwEntryCount * sizeof(REGION_DUMP_ENTRY)
+    )) {
+        return FALSE;
+    }
+
+    // Written in pieces, the block table of a large dump may exceed a DWORD
+    CONST DWORD64 qwBlocksPerWrite = DUMP_WRITER_CHUNK_SIZE / sizeof(REGION_DUMP_BLOCK);
+
+    for (DWORD64 i = 0; i < lpJob->qwBlockCount; i += qwBlocksPerWrite) {
+        if (!WriteDumpData(
+            lpJob->hFile,
+            &lpJob->aBlocks[i],
+            (SIZE_T) min(lpJob->qwBlockCount - i, qwBlocksPerWrite) * sizeof(REGION_DUMP_BLOCK)
+        )) {
+            return FALSE;
+        }
+    }
+
+    if (!SetFilePointerEx(
+        lpJob->hFile,
+        liOffset,
+        NULL,
+        FILE_BEGIN
+    )) {
+        fprintf(
+            stderr,
+            "[-] SetFilePointerEx(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    return WriteDumpData(
+        lpJob->hFile,
+        &dumpHeader,
+        sizeof(dumpHeader)
+    );
+}
+
+BOOLEAN WriteRegionDump(
+    LPMEMORY_SOURCE lpSource,
+    LPCSIGNATURE_PACK lpSignaturePack,
+    LPCSTR szDumpPath,
+    CONST SIZE_T cbHitRadius
+) {
+    CONST REGION_DUMP_HEADER dumpHeader = { 0 };
+    LARGE_INTEGER liFrequency, liDumpStart, liDumpEnd;
+    REGION_MAP regionMap = { 0 };
+    BOOLEAN bRet = FALSE;
+
+    DUMP_WRITER_JOB dumpJob = {
+        .lpSource = lpSource,
+        .lpSignaturePack = lpSignaturePack,
+        .cbHitRadius = cbHitRadius,
+        .hFile = INVALID_HANDLE_VALUE,
+        .OutputLock = SRWLOCK_INIT
+    };
+
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liDumpStart);
+
+    if (!RefreshRegionMap(
+        &regionMap,
+        lpSource
+    )) {
+        fprintf(
+            stderr,
+            "[-] Unable to enumerate the memory regions of the game.\n"
+        );
+        return FALSE;
+    }
+
+    CONST DWORD dwProcessorCount = max(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), 1);
+    dumpJob.dwWorkerCount = min(max(dwProcessorCount / 2, 1), AOBSCAN_MAX_WORKERS);
+
+    // Every captured range lies in committed memory and holds at least a page per block
+    dumpJob.qwBlockCapacity = max(regionMap.cbCommitted / PAGE_SIZE, 1);
+
+    dumpJob.aBlocks = VirtualAlloc(
+        NULL,
+        (SIZE_T) dumpJob.qwBlockCapacity * sizeof(REGION_DUMP_BLOCK),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    dumpJob.aEntries = VirtualAlloc(
+        NULL,
+        (regionMap.qwRegionCount + DUMP_WRITER_MAX_HITS) * sizeof(REGION_DUMP_ENTRY),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == dumpJob.aBlocks || NULL == dumpJob.aEntries) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    dumpJob.hFile = CreateFileA(
+        szDumpPath,
+        GENERIC_WRITE,
+        0,
+        NULL,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL
+    );
+
+    if (INVALID_HANDLE_VALUE == dumpJob.hFile) {
+        fprintf(
+            stderr,
+            "[-] CreateFileA(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    // Placeholder, the header is written once the tables are
+    if (!WriteDumpData(
+        dumpJob.hFile,
+        &dumpHeader,
+        sizeof(dumpHeader)
+    )) {
+        goto _FINAL;
+    }
+
+    dumpJob.qwFileOffset = sizeof(dumpHeader);
+
+    if (!PlanRegionCapture(
+        &dumpJob,
+        &regionMap
+    )) {
+        goto _FINAL;
+    }
+
+    printf(
+        "[*] Capturing %lu scannable regions with %lu threads..\n",
+        dumpJob.dwEntryCount,
+        dumpJob.dwWorkerCount
+    );
+
+    RunDumpWorkers(&dumpJob);
+
+    if (0 != dumpJob.dwHitCount) {
+        if (!PlanHitCapture(
+            &dumpJob,
+            &regionMap
+        )) {
+            goto _FINAL;
+        }
+
+        RunDumpWorkers(&dumpJob);
+    }
+
+    if (dumpJob.bWriteFailed || !WriteDumpTables(&dumpJob)) {
+        goto _FINAL;
+    }
+
+    QueryPerformanceCounter(&liDumpEnd);
+
+    printf(
+        "[+] Wrote '%s': %llu MiB captured, %llu MiB stored, %lld zero pages skipped, %.2f s\n",
+        szDumpPath,
+        (DWORD64) dumpJob.qwBytesCaptured >> 20,
+        dumpJob.qwFileOffset >> 20,
+        dumpJob.qwZeroPages,
+        (DOUBLE) (liDumpEnd.QuadPart - liDumpStart.QuadPart) / (DOUBLE) liFrequency.QuadPart
+    );
+
+    if (0 != dumpJob.qwBytesUnreadable) {
+        printf(
+            "[*] %llu pages were freed or protected while capturing and are missing.\n",
+            (DWORD64) dumpJob.qwBytesUnreadable / PAGE_SIZE
+        );
+    }
+
+    bRet = TRUE;
+
+_FINAL:
+    if (INVALID_HANDLE_VALUE != dumpJob.hFile) {
+        CloseHandle(dumpJob.hFile);
+
+        // Don't leave a dump without tables behind
+        if (!bRet) {
+            DeleteFileA(szDumpPath);
+        }
+    }
+
+    if (NULL != dumpJob.aItems) {
+        VirtualFree(
+            dumpJob.aItems,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    if (NULL != dumpJob.aEntries) {
+        VirtualFree(
+            dumpJob.aEntries,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    if (NULL != dumpJob.aBlocks) {
+        VirtualFree(
+            dumpJob.aBlocks,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    FreeRegionMap(&regionMap);
+
+    return bRet;
+}
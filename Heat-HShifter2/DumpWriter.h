@@ -0,0 +1,52 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+///
+
+/// @file DumpWriter.h
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#ifndef _HEAT_HSHIFTER2_DUMPWRITER_H
+#define _HEAT_HSHIFTER2_DUMPWRITER_H
+
+#include "Search.h"
+#include "RegionDump.h"
+
+#define DUMP_WRITER_CHUNK_SIZE                  0x100000            // Bytes read per work item, multiple of REGION_DUMP_BLOCK_SIZE
+#define DUMP_WRITER_DEFAULT_HIT_RADIUS          0x10000             // Bytes kept around pattern hits outside scannable regions
+#define DUMP_WRITER_MAX_HITS                    4096                // Pattern hits outside scannable regions that are kept
+
+/// <summary>
+///  Writes a compressed region dump (RegionDump.h, version 2) of all scannable
+///  regions of a memory source, plus hit windows of cbHitRadius bytes around
+///  pattern hits in the other readable regions. All-zero pages are left out.
+///  Runs on below normal priority threads on half of the processors, so the
+///  game keeps running smoothly while it is captured.
+/// </summary>
+/// <param name="lpSource"></param>
+/// <param name="lpSignaturePack"></param>
+/// <param name="szDumpPath"></param>
+/// <param name="cbHitRadius">0 to capture the scannable regions only.</param>
+/// <returns>
+///  TRUE if the dump was written, FALSE otherwise.
+/// </returns>
+BOOLEAN WriteRegionDump(
+    LPMEMORY_SOURCE lpSource,
+    LPCSIGNATURE_PACK lpSignaturePack,
+    LPCSTR szDumpPath,
+    CONST SIZE_T cbHitRadius
+);
+
+#endif // _HEAT_HSHIFTER2_DUMPWRITER_H
@@ -0,0 +1,415 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+///
+
+/// @file EvdevInput.c
+/// @brief Shifter input read straight from Linux event devices, for Winelib builds.
+///
+///  The shifter's buttons are read from /dev/input on a dedicated thread,
+///  so shifts skip the vendor software's keyboard emulation and the keyboard
+///  hook. Button codes are compiled into a direct lookup table, like the key
+///  bindings. A recording of a device is a plain copy of its event stream,
+///  which is replayed in recorded time to reproduce an input sequence.
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+///
+
+#ifdef __linux__
+
+#include "EvdevInput.h"
+#include "GearCommit.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define EVDEV_READ_EVENT_COUNT                  64
+
+typedef struct _EVDEV_INPUT {
+    INT iFd;
+    BOOLEAN bRecording;                 // Regular file, replayed in recorded time
+    BOOLEAN bNeutralOnRelease;          // Releasing the held gear button shifts to neutral
+    VOLATILE BOOLEAN bStop;
+    HANDLE hReaderThread;
+    WORD wHeldGearCode;                 // Button of the last gear shifted to, 0 if released
+    WORD awTarget[EVDEV_KEY_CODE_COUNT]; // SHIFT_GEAR or KEY_ACTION per button code
+    DWORD dwBindingCount;
+    LPFOCUS_TRACKER lpFocusTracker;     // NULL to dispatch regardless of focus
+} EVDEV_INPUT, *LPEVDEV_INPUT;
+
+STATIC EVDEV_INPUT g_EvdevInput = { .iFd = -1 };
+
+/// Loads the [EVDEV] button bindings, comma separated button codes per gear or action.
+STATIC VOID LoadEvdevBindings(
+    LPEVDEV_INPUT lpInput
+) {
+    for (DWORD i = 0; i < ARRAYSIZE(lpInput->awTarget); i++) {
+        lpInput->awTarget[i] = KEY_ACTION_INVALID;
+    }
+
+    lpInput->dwBindingCount = 0;
+
+    for (WORD wTarget = 0; wTarget < KEY_TARGET_COUNT; wTarget++) {
+        WCHAR wszBindings[KEY_BINDING_TEXT_SIZE] = { 0 };
+        LPCWSTR wszName = GetKeyTargetName(wTarget);
+
+        GetPrivateProfileStringW(
+            EVDEV_CONFIG_SECTION,
+            wszName,
+            L"",
+            wszBindings,
+            ARRAYSIZE(wszBindings),
+            g_ShifterConfig.wszConfigFilePath
+        );
+
+        LPWSTR wszCursor = wszBindings;
+
+        while (L'\0' != *wszCursor) {
+            LPWSTR wszEnd = NULL;
+            CONST ULONG ulCode = wcstoul(
+                wszCursor,
+                &wszEnd,
+                0
+            );
+
+            if (wszEnd == wszCursor || ulCode >= EVDEV_KEY_CODE_COUNT) {
+                fwprintf(
+                    stderr,
+                    L"[-] Invalid button binding of %s: '%s'\n",
+                    wszName,
+                    wszCursor
+                );
+                break;
+            }
+
+            if (KEY_ACTION_INVALID != lpInput->awTarget[ulCode]) {
+                fprintf(
+                    stderr,
+                    "[-] Button 0x%lX is bound twice, keeping the first binding.\n",
+                    ulCode
+                );
+            } else {
+                lpInput->awTarget[ulCode] = wTarget;
+                lpInput->dwBindingCount++;
+            }
+
+            wszCursor = wszEnd;
+            while (L' ' == *wszCursor || L'\t' == *wszCursor || L',' == *wszCursor) {
+                wszCursor++;
+            }
+        }
+    }
+
+    lpInput->bNeutralOnRelease = (0 != GetPrivateProfileIntW(
+        EVDEV_CONFIG_SECTION,
+        L"NEUTRAL_ON_RELEASE",
+        0,
+        g_ShifterConfig.wszConfigFilePath
+    ));
+}
+
+STATIC VOID HandleEvdevEvent(
+    LPEVDEV_INPUT lpInput,
+    CONST EVDEV_EVENT *lpEvent
+) {
+    if (EVDEV_EV_KEY != lpEvent->wType || lpEvent->wCode >= EVDEV_KEY_CODE_COUNT) {
+        return;
+    }
+
+    CONST WORD wTarget = lpInput->awTarget[lpEvent->wCode];
+
+    if (KEY_ACTION_INVALID == wTarget) {
+        return;
+    }
+
+    switch (lpEvent->iValue) {
+        case 1: {
+            // Timed from here, event times are wall clock and off in recordings
+            if (KEY_ACTION_INVALID != DispatchShifterTarget(
+                wTarget,
+                GetShiftClockUs(),
+                lpInput->lpFocusTracker
+            ) && wTarget <= GEAR_8) {
+                lpInput->wHeldGearCode = lpEvent->wCode;
+            }
+            break;
+        }
+
+        case 0: {
+            // The lever went back to neutral from the gear it was in
+            if (lpInput->bNeutralOnRelease && lpEvent->wCode == lpInput->wHeldGearCode) {
+                lpInput->wHeldGearCode = 0;
+                DispatchShifterTarget(
+                    GEAR_NEUTRAL,
+                    GetShiftClockUs(),
+                    lpInput->lpFocusTracker
+                );
+            }
+            break;
+        }
+
+        default: {
+            // Autorepeat
+            break;
+        }
+    }
+}
+
+/// Sleeps until a recorded event is due, FALSE if stopped in the meantime.
+STATIC BOOLEAN WaitForRecordedEvent(
+    LPEVDEV_INPUT lpInput,
+    CONST LARGE_INTEGER *lpliFrequency,
+    CONST LARGE_INTEGER *lpliStart,
+    CONST INT64 llDueUs
+) {
+    for (;;) {
+        LARGE_INTEGER liNow;
+        QueryPerformanceCounter(&liNow);
+
+        CONST INT64 llElapsedUs = (liNow.QuadPart - lpliStart->QuadPart)
+            * 1000000 / lpliFrequency->QuadPart;
+
+        if (lpInput->bStop) {
+            return FALSE;
+        }
+
+        if (llElapsedUs >= llDueUs) {
+            return TRUE;
+        }
+
+        CONST INT64 llWaitMs = (llDueUs - llElapsedUs + 999) / 1000;
+
+        Sleep(
+            (DWORD) min(llWaitMs, EVDEV_STOP_POLL_INTERVAL_MS)
+        );
+    }
+}
+
+STATIC DWORD WINAPI EvdevReaderThread(
+    LPVOID lpParameter
+) {
+    LPEVDEV_INPUT lpInput = (LPEVDEV_INPUT) lpParameter;
+    EVDEV_EVENT aEvents[EVDEV_READ_EVENT_COUNT];
+    LARGE_INTEGER liFrequency = { 0 };
+    LARGE_INTEGER liStart = { 0 };
+    INT64 llFirstEventUs = -1;
+
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liStart);
+
+    while (!lpInput->bStop) {
+        // A blocked read() can't be stopped, wait for events in short slices
+        if (!lpInput->bRecording) {
+            struct pollfd pollFd = {
+                .fd = lpInput->iFd,
+                .events = POLLIN
+            };
+
+            CONST INT iReady = poll(
+                &pollFd,
+                1,
+                EVDEV_STOP_POLL_INTERVAL_MS
+            );
+
+            if (0 == iReady || (iReady < 0 && EINTR == errno)) {
+                continue;
+            }
+
+            if (iReady < 0 || 0 != (pollFd.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+                fprintf(
+                    stderr,
+                    "[-] Shifter input device lost, gear keys keep working.\n"
+                );
+                break;
+            }
+        }
+
+        CONST ssize_t cbRead = read(
+            lpInput->iFd,
+            aEvents,
+            sizeof(aEvents)
+        );
+
+        if (cbRead < 0) {
+            if (EINTR == errno || EAGAIN == errno) {
+                continue;
+            }
+
+            fprintf(
+                stderr,
+                "[-] read(): %s\n",
+                strerror(errno)
+            );
+            break;
+        }
+
+        if (0 == cbRead) {
+            printf("[*] Shifter input recording replayed.\n");
+            break;
+        }
+
+        for (SIZE_T i = 0; i < (SIZE_T) cbRead / sizeof(EVDEV_EVENT); i++) {
+            if (lpInput->bRecording) {
+                CONST INT64 llEventUs = aEvents[i].llSeconds * 1000000 + aEvents[i].llMicroseconds;
+
+                if (llFirstEventUs < 0) {
+                    llFirstEventUs = llEventUs;
+                }
+
+                if (!WaitForRecordedEvent(
+                    lpInput,
+                    &liFrequency,
+                    &liStart,
+                    llEventUs - llFirstEventUs
+                )) {
+                    break;
+                }
+            }
+
+            HandleEvdevEvent(
+                lpInput,
+                &aEvents[i]
+            );
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+BOOLEAN StartEvdevInput(
+    LPCSTR szPath,
+    LPFOCUS_TRACKER lpFocusTracker
+) {
+    LPEVDEV_INPUT lpInput = &g_EvdevInput;
+    BOOLEAN bResult = FALSE;
+    struct stat fileStat;
+
+    lpInput->lpFocusTracker = lpFocusTracker;
+    LoadEvdevBindings(lpInput);
+
+    if (0 == lpInput->dwBindingCount) {
+        fprintf(
+            stderr,
+            "[-] No shifter buttons bound in the [EVDEV] section of the config file.\n"
+        );
+        return FALSE;
+    }
+
+    lpInput->iFd = open(
+        szPath,
+        O_RDONLY | O_CLOEXEC
+    );
+
+    if (lpInput->iFd < 0) {
+        fprintf(
+            stderr,
+            "[-] open('%s'): %s\n",
+            szPath,
+            strerror(errno)
+        );
+        return FALSE;
+    }
+
+    if (0 != fstat(lpInput->iFd, &fileStat)) {
+        fprintf(
+            stderr,
+            "[-] fstat('%s'): %s\n",
+            szPath,
+            strerror(errno)
+        );
+        goto _FINAL;
+    }
+
+    lpInput->bRecording = S_ISREG(fileStat.st_mode);
+    lpInput->bStop = FALSE;
+    lpInput->wHeldGearCode = 0;
+
+    lpInput->hReaderThread = CreateThread(
+        NULL,
+        0,
+        EvdevReaderThread,
+        lpInput,
+        0,
+        NULL
+    );
+
+    if (NULL == lpInput->hReaderThread) {
+        fprintf(
+            stderr,
+            "[-] CreateThread(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    // Button presses are handed over ahead of the game's own threads
+    if (!SetThreadPriority(
+        lpInput->hReaderThread,
+        THREAD_PRIORITY_HIGHEST
+    )) {
+        WriteLog(
+            "[-] SetThreadPriority(): E%lu\n",
+            GetLastError()
+        );
+    }
+
+    printf(
+        "[+] Reading shifter input from %s '%s' (%lu buttons bound).\n",
+        lpInput->bRecording ? "recording" : "device",
+        szPath,
+        lpInput->dwBindingCount
+    );
+
+    bResult = TRUE;
+
+_FINAL:
+    if (!bResult) {
+        close(lpInput->iFd);
+        lpInput->iFd = -1;
+    }
+
+    return bResult;
+}
+
+VOID StopEvdevInput(
+    VOID
+) {
+    LPEVDEV_INPUT lpInput = &g_EvdevInput;
+
+    if (NULL != lpInput->hReaderThread) {
+        lpInput->bStop = TRUE;
+
+        WaitForSingleObject(
+            lpInput->hReaderThread,
+            INFINITE
+        );
+
+        CloseHandle(lpInput->hReaderThread);
+        lpInput->hReaderThread = NULL;
+    }
+
+    if (lpInput->iFd >= 0) {
+        close(lpInput->iFd);
+        lpInput->iFd = -1;
+    }
+}
+
+#endif // __linux__
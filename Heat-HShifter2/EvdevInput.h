@@ -0,0 +1,76 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+///
+
+/// @file EvdevInput.h
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#ifndef _HEAT_HSHIFTER2_EVDEVINPUT_H
+#define _HEAT_HSHIFTER2_EVDEVINPUT_H
+
+#include "Utils.h"
+#include "WindowSystem.h"
+
+#ifdef __linux__
+
+#define EVDEV_CONFIG_SECTION                    L"EVDEV"            // Button bindings in config.ini
+#define EVDEV_KEY_CODE_COUNT                    0x300               // KEY_MAX + 1
+#define EVDEV_STOP_POLL_INTERVAL_MS             100                 // How often a blocked reader checks for StopEvdevInput()
+
+/// struct input_event of 64-bit Linux, as read from /dev/input/event* and stored in recordings.
+#pragma pack(push, 8)
+typedef struct _EVDEV_EVENT {
+    INT64 llSeconds;
+    INT64 llMicroseconds;
+    WORD wType;                         // EVDEV_EV_*
+    WORD wCode;                         // Button code for EVDEV_EV_KEY
+    INT iValue;                         // EVDEV_EV_KEY: 1 pressed, 0 released, 2 autorepeat
+} EVDEV_EVENT, *LPEVDEV_EVENT;
+#pragma pack(pop)
+
+#define EVDEV_EV_KEY                            0x01
+
+/// <summary>
+///  Starts reading shifter button events on a dedicated thread, bypassing the
+///  keyboard emulation of the vendor software and the keyboard hook.
+///  Pressed buttons are dispatched like bound keys, by DispatchShifterTarget().
+///  Buttons are bound in the [EVDEV] section of config.ini, with the key names
+///  of the [CONFIG] section and evdev button codes (e.g. GEAR_1=0x12C).
+/// </summary>
+/// <param name="szPath">
+///  Event device (e.g. /dev/input/by-id/...-event-joystick), or a recording of
+///  one (cat /dev/input/eventN > shifter.evdev) that is replayed in recorded time.
+/// </param>
+/// <param name="lpFocusTracker">NULL to skip the focus check.</param>
+/// <returns>
+///  TRUE if the reader thread is running, FALSE otherwise.
+/// </returns>
+BOOLEAN StartEvdevInput(
+    LPCSTR szPath,
+    LPFOCUS_TRACKER lpFocusTracker
+);
+
+/// <summary>
+///  Stops the reader thread started by StartEvdevInput() and closes the device.
+/// </summary>
+VOID StopEvdevInput(
+    VOID
+);
+
+#endif // __linux__
+
+#endif // _HEAT_HSHIFTER2_EVDEVINPUT_H
@@ -0,0 +1,652 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+///
+
+/// @file GearCommit.c
+/// @brief Commits shifts to the game memory and verifies that the game keeps them.
+///
+///  The keyboard hook posts gears to a single slot mailbox and returns.
+///  The writer thread writes the latest one to both gear addresses, then reads
+///  them back on a high resolution timer. A shift that survives the commit
+///  window is accepted, one the game reverts is written again, until it has
+///  been re-committed too often and the game's gear is taken over instead.
+///  Every stage of a shift is timed from its input into a latency histogram.
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+///
+
+#include "GearCommit.h"
+#include "MemorySource.h"
+
+#include <stdio.h>
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION   0x00000002          // Windows 10 1803+
+#endif
+
+// A post is the input time and the gear in one exchange, input time << 8 | SHIFT_GEAR
+#define GEAR_POST_EMPTY                         ((LONG64) -1)
+#define GEAR_POST_GEAR_BITS                     8
+
+typedef enum _SHIFT_OUTCOME {
+    SHIFT_OUTCOME_ACCEPTED = 0,
+    SHIFT_OUTCOME_RECOMMITTED,
+    SHIFT_OUTCOME_REJECTED,
+    SHIFT_OUTCOME_SUPERSEDED
+} SHIFT_OUTCOME, *LPSHIFT_OUTCOME;
+
+/// Single slot mailbox from the keyboard hook to the gear writer thread.
+/// The hook only replaces the slot, so gears posted between two wake-ups of the
+/// writer are merged and the latest one wins. A shift picked up while the
+/// previous one is still verified supersedes it.
+typedef struct DECLSPEC_CACHEALIGN _GEAR_MAILBOX {
+    VOLATILE LONG64 llTargetGear;       // GEAR_POST_EMPTY if empty
+    VOLATILE BOOLEAN bStop;
+    HANDLE hWakeEvent;                  // Auto-reset, signaled after each post
+    HANDLE hPollTimer;                  // Paces the read-back of the pending shift
+    HANDLE hWriterThread;
+} GEAR_MAILBOX, *LPGEAR_MAILBOX;
+
+/// Shift written by the writer thread and not verified yet.
+typedef struct _GEAR_COMMIT {
+    SHIFT_GEAR eGear;                   // GEAR_INVALID if none
+    DWORD dwRetries;                    // Times written again after the game reverted it
+    ULONGLONG qwInputUs;                // Input of the shift, GetShiftClockUs()
+    ULONGLONG qwWrittenUs;              // Last write
+    ULONGLONG qwConfirmedUs;            // First read-back of the last write, 0 if none yet
+    BOOLEAN bRedraw;                    // Gear changed, the display is redrawn once the state lock is released
+} GEAR_COMMIT, *LPGEAR_COMMIT;
+
+STATIC GEAR_MAILBOX g_GearMailbox = { .llTargetGear = GEAR_POST_EMPTY };
+
+// Written by the writer thread only, read with GetShiftCommitCounters()
+STATIC SHIFT_COMMIT_COUNTERS g_CommitCounters = { 0 };
+
+// Recorded by the hook, the input threads and the writer thread
+STATIC LATENCY_HISTOGRAM g_aShiftLatency[SHIFT_LATENCY_STAGE_COUNT] = { 0 };
+
+STATIC LARGE_INTEGER g_liShiftClockFrequency = { 0 };
+
+ULONGLONG GetShiftClockUs(
+    VOID
+) {
+    LARGE_INTEGER liNow;
+    QueryPerformanceCounter(&liNow);
+
+    return (ULONGLONG) (
+        liNow.QuadPart / g_liShiftClockFrequency.QuadPart * 1000000
+        + liNow.QuadPart % g_liShiftClockFrequency.QuadPart * 1000000 / g_liShiftClockFrequency.QuadPart
+    );
+}
+
+STATIC VOID ArmPollTimer(
+    VOID
+) {
+    // Relative due time, in 100 ns units
+    LARGE_INTEGER liDueTime = {
+        .QuadPart = -(LONGLONG) SHIFT_COMMIT_POLL_INTERVAL_US * 10
+    };
+
+    if (!SetWaitableTimer(
+        g_GearMailbox.hPollTimer,
+        &liDueTime,
+        0,
+        NULL,
+        NULL,
+        FALSE
+    )) {
+        WriteLog(
+            "[-] SetWaitableTimer(): E%lu\n",
+            GetLastError()
+        );
+    }
+}
+
+/// Writes a gear to both gear addresses, failing over stale ones.
+STATIC BOOLEAN WriteGear(
+    SHIFT_GEAR eTargetGear
+) {
+    while (!WriteMemory(
+        &g_GameMemory,
+        g_ShifterState.lpCurrentGearAddress,
+        &eTargetGear,
+        sizeof(DWORD)
+    )) {
+        fprintf(
+            stderr,
+            "[-] WriteMemory(): E%lu\n",
+            GetLastError()
+        );
+
+        if (!FailoverGearAddress(TARGET_GEAR_CURRENT)) {
+            return FALSE;
+        }
+    }
+
+    while (!WriteMemory(
+        &g_GameMemory,
+        g_ShifterState.lpLastGearAddress,
+        &eTargetGear,
+        sizeof(DWORD)
+    )) {
+        fprintf(
+            stderr,
+            "[-] WriteMemory(): E%lu\n",
+            GetLastError()
+        );
+
+        if (!FailoverGearAddress(TARGET_GEAR_LAST)) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+STATIC VOID FinishCommit(
+    LPGEAR_COMMIT lpCommit,
+    CONST SHIFT_OUTCOME eOutcome
+) {
+    CONST LPCSTR aszOutcomeNames[] = {
+        "accepted",
+        "re-committed",
+        "rejected",
+        "superseded"
+    };
+
+    switch (eOutcome) {
+        case SHIFT_OUTCOME_ACCEPTED:
+            InterlockedIncrement(&g_CommitCounters.lAccepted);
+            RecordShiftLatency(
+                SHIFT_LATENCY_CONFIRM,
+                lpCommit->qwConfirmedUs - lpCommit->qwInputUs
+            );
+            break;
+
+        case SHIFT_OUTCOME_RECOMMITTED:
+            InterlockedIncrement(&g_CommitCounters.lRecommitted);
+            RecordShiftLatency(
+                SHIFT_LATENCY_CONFIRM,
+                lpCommit->qwConfirmedUs - lpCommit->qwInputUs
+            );
+            break;
+
+        case SHIFT_OUTCOME_REJECTED:
+            InterlockedIncrement(&g_CommitCounters.lRejected);
+            break;
+
+        default:
+            InterlockedIncrement(&g_CommitCounters.lSuperseded);
+            break;
+    }
+
+    WriteLog(
+        "[*] Shift to gear %lu %s (%lu re-commits)\n",
+        lpCommit->eGear,
+        aszOutcomeNames[eOutcome],
+        lpCommit->dwRetries
+    );
+
+    lpCommit->eGear = GEAR_INVALID;
+}
+
+/// Writes a new shift and starts verifying it.
+STATIC VOID BeginCommit(
+    LPGEAR_COMMIT lpCommit,
+    CONST SHIFT_GEAR eTargetGear,
+    CONST ULONGLONG qwInputUs
+) {
+    if (GEAR_INVALID != lpCommit->eGear) {
+        FinishCommit(
+            lpCommit,
+            SHIFT_OUTCOME_SUPERSEDED
+        );
+    }
+
+    if (eTargetGear == g_ShifterState.dwLastGear) {
+        return;
+    }
+
+    lpCommit->eGear = eTargetGear;
+    lpCommit->dwRetries = 0;
+    lpCommit->qwInputUs = qwInputUs;
+
+    // Fail over stale gear addresses before writing to them
+    if (GEAR_INVALID == ReadCurrentGear() || GEAR_INVALID == ReadLastGear()) {
+        fprintf(
+            stderr,
+            "[-] No sane gear address left, press DELETE to rescan.\n"
+        );
+        FinishCommit(
+            lpCommit,
+            SHIFT_OUTCOME_REJECTED
+        );
+        return;
+    }
+
+    // Writes go ASAP
+    if (!WriteGear(eTargetGear)) {
+        FinishCommit(
+            lpCommit,
+            SHIFT_OUTCOME_REJECTED
+        );
+        return;
+    }
+
+    lpCommit->qwWrittenUs = GetShiftClockUs();
+    lpCommit->qwConfirmedUs = 0;
+
+    RecordShiftLatency(
+        SHIFT_LATENCY_WRITE,
+        lpCommit->qwWrittenUs - qwInputUs
+    );
+
+    g_ShifterState.dwCurrentGear = eTargetGear;
+    g_ShifterState.dwLastGear = eTargetGear;
+    lpCommit->bRedraw = TRUE;
+
+    ArmPollTimer();
+}
+
+/// Reads the pending shift back, accepting, re-committing or rejecting it.
+STATIC VOID PollCommit(
+    LPGEAR_COMMIT lpCommit
+) {
+    CONST SHIFT_GEAR eCurrentGear = ReadCurrentGear();
+    CONST SHIFT_GEAR eLastGear = ReadLastGear();
+
+    if (eCurrentGear == lpCommit->eGear && eLastGear == lpCommit->eGear) {
+        CONST ULONGLONG qwNowUs = GetShiftClockUs();
+
+        if (0 == lpCommit->qwConfirmedUs) {
+            lpCommit->qwConfirmedUs = qwNowUs;
+        }
+
+        if (
+            qwNowUs - lpCommit->qwWrittenUs
+            >= (ULONGLONG) g_ShifterConfig.dwCommitWindowMs * 1000
+        ) {
+            FinishCommit(
+                lpCommit,
+                (0 == lpCommit->dwRetries)
+                    ? SHIFT_OUTCOME_ACCEPTED
+                    : SHIFT_OUTCOME_RECOMMITTED
+            );
+            return;
+        }
+
+        ArmPollTimer();
+        return;
+    }
+
+    if (GEAR_INVALID == eCurrentGear || GEAR_INVALID == eLastGear) {
+        fprintf(
+            stderr,
+            "[-] No sane gear address left, press DELETE to rescan.\n"
+        );
+        FinishCommit(
+            lpCommit,
+            SHIFT_OUTCOME_REJECTED
+        );
+        return;
+    }
+
+    if (lpCommit->dwRetries >= g_ShifterConfig.dwCommitRetries) {
+        // The game won't take the shift, follow the gear it settled on
+        if (eLastGear != eCurrentGear) {
+            SHIFT_GEAR eSettledGear = eCurrentGear;
+
+            if (!WriteMemory(
+                &g_GameMemory,
+                g_ShifterState.lpLastGearAddress,
+                &eSettledGear,
+                sizeof(DWORD)
+            )) {
+                fprintf(
+                    stderr,
+                    "[-] WriteMemory(): E%lu\n",
+                    GetLastError()
+                );
+            }
+        }
+
+        g_ShifterState.dwCurrentGear = eCurrentGear;
+        g_ShifterState.dwLastGear = eCurrentGear;
+        lpCommit->bRedraw = TRUE;
+
+        FinishCommit(
+            lpCommit,
+            SHIFT_OUTCOME_REJECTED
+        );
+        return;
+    }
+
+    lpCommit->dwRetries++;
+    InterlockedIncrement(&g_CommitCounters.lRecommits);
+
+    WriteLog(
+        "[*] Gear %lu reverted to %lu/%lu, re-committing (%lu/%lu)\n",
+        lpCommit->eGear,
+        eCurrentGear,
+        eLastGear,
+        lpCommit->dwRetries,
+        g_ShifterConfig.dwCommitRetries
+    );
+
+    if (!WriteGear(lpCommit->eGear)) {
+        FinishCommit(
+            lpCommit,
+            SHIFT_OUTCOME_REJECTED
+        );
+        return;
+    }
+
+    lpCommit->qwWrittenUs = GetShiftClockUs();
+    lpCommit->qwConfirmedUs = 0;
+
+    ArmPollTimer();
+}
+
+/// Commits the gears posted by the keyboard hook, until StopGearWriter().
+STATIC DWORD WINAPI GearWriterThread(
+    LPVOID lpParameter
+) {
+    UNREFERENCED_PARAMETER(lpParameter);
+
+    GEAR_COMMIT Commit = { .eGear = GEAR_INVALID };
+    CONST HANDLE ahWaitHandles[] = {
+        g_GearMailbox.hWakeEvent,
+        g_GearMailbox.hPollTimer
+    };
+
+    for (;;) {
+        // Sleep until the next post, or the next read-back of a pending shift
+        WaitForMultipleObjects(
+            (GEAR_INVALID == Commit.eGear) ? 1 : ARRAYSIZE(ahWaitHandles),
+            ahWaitHandles,
+            FALSE,
+            INFINITE
+        );
+
+        if (g_GearMailbox.bStop) {
+            break;
+        }
+
+        CONST LONG64 llPost = InterlockedExchange64(
+            &g_GearMailbox.llTargetGear,
+            GEAR_POST_EMPTY
+        );
+        CONST SHIFT_GEAR eTargetGear = (GEAR_POST_EMPTY == llPost)
+            ? GEAR_INVALID
+            : (SHIFT_GEAR) (llPost & ((1 << GEAR_POST_GEAR_BITS) - 1));
+
+        AcquireSRWLockExclusive(&g_ShifterState.Lock);
+
+        if (GEAR_INVALID != eTargetGear && eTargetGear != Commit.eGear) {
+            BeginCommit(
+                &Commit,
+                eTargetGear,
+                (ULONGLONG) llPost >> GEAR_POST_GEAR_BITS
+            );
+        } else if (GEAR_INVALID != Commit.eGear) {
+            PollCommit(
+                &Commit
+            );
+        }
+
+        ReleaseSRWLockExclusive(&g_ShifterState.Lock);
+
+        // Console output is slow, it never holds up the read-backs or the state lock
+        if (Commit.bRedraw) {
+            Commit.bRedraw = FALSE;
+
+            if (g_ShifterConfig.bGearWindowEnabled) {
+                InterlockedIncrement(&g_CommitCounters.lRedraws);
+                DrawAsciiGearDisplay();
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+BOOLEAN StartGearWriter(
+    VOID
+) {
+    QueryPerformanceFrequency(&g_liShiftClockFrequency);
+
+    g_GearMailbox.hWakeEvent = CreateEventA(
+        NULL,
+        FALSE,
+        FALSE,
+        NULL
+    );
+
+    if (NULL == g_GearMailbox.hWakeEvent) {
+        fprintf(
+            stderr,
+            "[-] CreateEventA(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    g_GearMailbox.hPollTimer = CreateWaitableTimerExW(
+        NULL,
+        NULL,
+        CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+        TIMER_ALL_ACCESS
+    );
+
+    if (NULL == g_GearMailbox.hPollTimer) {
+        // Older Windows, read-backs are paced by the system timer resolution
+        WriteLog(
+            "[-] CreateWaitableTimerExW(HIGH_RESOLUTION): E%lu\n",
+            GetLastError()
+        );
+
+        g_GearMailbox.hPollTimer = CreateWaitableTimerExW(
+            NULL,
+            NULL,
+            0,
+            TIMER_ALL_ACCESS
+        );
+    }
+
+    if (NULL == g_GearMailbox.hPollTimer) {
+        fprintf(
+            stderr,
+            "[-] CreateWaitableTimerExW(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    g_GearMailbox.hWriterThread = CreateThread(
+        NULL,
+        0,
+        GearWriterThread,
+        NULL,
+        0,
+        NULL
+    );
+
+    if (NULL == g_GearMailbox.hWriterThread) {
+        fprintf(
+            stderr,
+            "[-] CreateThread(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    // Shifts are committed ahead of the game's own threads
+    if (!SetThreadPriority(
+        g_GearMailbox.hWriterThread,
+        THREAD_PRIORITY_HIGHEST
+    )) {
+        WriteLog(
+            "[-] SetThreadPriority(): E%lu\n",
+            GetLastError()
+        );
+    }
+
+    return TRUE;
+}
+
+VOID StopGearWriter(
+    VOID
+) {
+    if (NULL != g_GearMailbox.hWriterThread) {
+        g_GearMailbox.bStop = TRUE;
+        SetEvent(g_GearMailbox.hWakeEvent);
+
+        WaitForSingleObject(
+            g_GearMailbox.hWriterThread,
+            INFINITE
+        );
+
+        CloseHandle(g_GearMailbox.hWriterThread);
+        g_GearMailbox.hWriterThread = NULL;
+    }
+
+    if (NULL != g_GearMailbox.hPollTimer) {
+        CloseHandle(g_GearMailbox.hPollTimer);
+        g_GearMailbox.hPollTimer = NULL;
+    }
+
+    if (NULL != g_GearMailbox.hWakeEvent) {
+        CloseHandle(g_GearMailbox.hWakeEvent);
+        g_GearMailbox.hWakeEvent = NULL;
+    }
+}
+
+VOID PostTargetGear(
+    SHIFT_GEAR eTargetGear,
+    CONST ULONGLONG qwInputUs
+) {
+    InterlockedExchange64(
+        &g_GearMailbox.llTargetGear,
+        (LONG64) (qwInputUs << GEAR_POST_GEAR_BITS | (ULONGLONG) eTargetGear)
+    );
+
+    SetEvent(g_GearMailbox.hWakeEvent);
+
+    RecordShiftLatency(
+        SHIFT_LATENCY_DISPATCH,
+        GetShiftClockUs() - qwInputUs
+    );
+}
+
+WORD DispatchShifterTarget(
+    CONST WORD wTarget,
+    CONST ULONGLONG qwInputUs,
+    LPFOCUS_TRACKER lpFocusTracker
+) {
+    if (KEY_ACTION_INVALID == wTarget) {
+        return KEY_ACTION_INVALID;
+    }
+
+    // Kept up to date on foreground changes, no window lookups per key
+    if (NULL != lpFocusTracker && !IsTargetFocused(lpFocusTracker)) {
+        return KEY_ACTION_INVALID;
+    }
+
+    // Committed by the writer thread, the input thread returns right away
+    if (wTarget <= GEAR_8) {
+        PostTargetGear(
+            (SHIFT_GEAR) wTarget,
+            qwInputUs
+        );
+        return wTarget;
+    }
+
+    // Actions touch the consoles and log files, they run on the main thread
+    if (!PostThreadMessageA(
+        g_ShifterConfig.dwShifterThreadId,
+        WM_SHIFTER_ACTION,
+        (WPARAM) wTarget,
+        0
+    )) {
+        fprintf(
+            stderr,
+            "[-] PostThreadMessageA(): E%lu\n",
+            GetLastError()
+        );
+    }
+
+    return wTarget;
+}
+
+WORD HandleShifterKey(
+    CONST BYTE byVirtualKey,
+    LPFOCUS_TRACKER lpFocusTracker
+) {
+    // The hook sees every key pressed on the machine, most of them aren't bound.
+    // Virtual key codes are 1 - 254.
+    if (0 == g_ShifterConfig.KeyboardMap.abyFirstBinding[byVirtualKey]) {
+        return KEY_ACTION_INVALID;
+    }
+
+    // Shift latencies are timed from here
+    CONST ULONGLONG qwInputUs = GetShiftClockUs();
+
+    return DispatchShifterTarget(
+        ResolveKeyBinding(byVirtualKey),
+        qwInputUs,
+        lpFocusTracker
+    );
+}
+
+VOID GetShiftCommitCounters(
+    LPSHIFT_COMMIT_COUNTERS lpCounters
+) {
+    lpCounters->lAccepted = InterlockedCompareExchange(&g_CommitCounters.lAccepted, 0, 0);
+    lpCounters->lRecommitted = InterlockedCompareExchange(&g_CommitCounters.lRecommitted, 0, 0);
+    lpCounters->lRejected = InterlockedCompareExchange(&g_CommitCounters.lRejected, 0, 0);
+    lpCounters->lSuperseded = InterlockedCompareExchange(&g_CommitCounters.lSuperseded, 0, 0);
+    lpCounters->lRecommits = InterlockedCompareExchange(&g_CommitCounters.lRecommits, 0, 0);
+    lpCounters->lRedraws = InterlockedCompareExchange(&g_CommitCounters.lRedraws, 0, 0);
+}
+
+VOID RecordShiftLatency(
+    CONST SHIFT_LATENCY_STAGE eStage,
+    CONST ULONGLONG qwLatencyUs
+) {
+    RecordLatency(
+        &g_aShiftLatency[eStage],
+        qwLatencyUs
+    );
+}
+
+VOID GetShiftLatency(
+    CONST SHIFT_LATENCY_STAGE eStage,
+    LPLATENCY_SUMMARY lpSummary
+) {
+    SummarizeLatency(
+        &g_aShiftLatency[eStage],
+        lpSummary
+    );
+}
+
+VOID ResetShiftLatency(
+    VOID
+) {
+    ZeroMemory(
+        g_aShiftLatency,
+        sizeof(g_aShiftLatency)
+    );
+}
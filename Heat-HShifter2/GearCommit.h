@@ -0,0 +1,165 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+///
+
+/// @file GearCommit.h
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#ifndef _HEAT_HSHIFTER2_GEARCOMMIT_H
+#define _HEAT_HSHIFTER2_GEARCOMMIT_H
+
+#include "Utils.h"
+#include "LatencyHistogram.h"
+#include "WindowSystem.h"
+
+#define SHIFT_COMMIT_WINDOW_MS                  150                 // Shifts the game keeps this long are accepted
+#define SHIFT_COMMIT_MAX_RETRIES                3                   // Re-commits of a reverted shift before it is rejected
+#define SHIFT_COMMIT_POLL_INTERVAL_US           1000                // Read-back interval while a shift is verified
+
+/// Outcomes of the shifts committed so far.
+typedef struct _SHIFT_COMMIT_COUNTERS {
+    LONG lAccepted;                     // Kept by the game after the first write
+    LONG lRecommitted;                  // Kept by the game after being written again
+    LONG lRejected;                     // Reverted after every re-commit, or not writable
+    LONG lSuperseded;                   // Replaced by the next shift before the window ran out
+    LONG lRecommits;                    // Writes repeated because the game reverted the gear
+    LONG lRedraws;                      // Gear display redraws of the writer thread
+} SHIFT_COMMIT_COUNTERS, *LPSHIFT_COMMIT_COUNTERS;
+
+/// Stages of a shift, each timed from the moment its input arrived (hook entry).
+typedef enum _SHIFT_LATENCY_STAGE {
+    SHIFT_LATENCY_INPUT = 0,            // Key event to hook entry, KBDLLHOOKSTRUCT.time has millisecond resolution
+    SHIFT_LATENCY_DISPATCH,             // Gear posted to the writer thread
+    SHIFT_LATENCY_WRITE,                // Gear written to both gear addresses
+    SHIFT_LATENCY_CONFIRM,              // First read-back of the write the game kept
+    SHIFT_LATENCY_STAGE_COUNT
+} SHIFT_LATENCY_STAGE, *LPSHIFT_LATENCY_STAGE;
+
+/// <summary>
+///  Starts the gear writer thread, which commits the gears posted by PostTargetGear().
+///  Each shift is written to both gear addresses and read back every
+///  SHIFT_COMMIT_POLL_INTERVAL_US until the game has kept it for the commit window
+///  (COMMIT_WINDOW_MS in config.ini). A reverted shift is written again, up to
+///  COMMIT_RETRIES times.
+/// </summary>
+/// <returns>
+///  TRUE if the writer thread is running, FALSE otherwise.
+/// </returns>
+BOOLEAN StartGearWriter(
+    VOID
+);
+
+/// <summary>
+///  Stops the gear writer thread. A shift that is still being verified is dropped.
+/// </summary>
+VOID StopGearWriter(
+    VOID
+);
+
+/// <summary>
+///  Hands a gear to the writer thread, replacing one it hasn't picked up yet.
+///  Never blocks, safe to call from the keyboard hook.
+/// </summary>
+/// <param name="eTargetGear"></param>
+/// <param name="qwInputUs">GetShiftClockUs() when the input arrived, the shift's latencies are timed from it.</param>
+VOID PostTargetGear(
+    SHIFT_GEAR eTargetGear,
+    CONST ULONGLONG qwInputUs
+);
+
+/// <summary>
+///  Dispatches a bound gear or action of any input source. Nothing is dispatched
+///  while neither the game nor the shifter is focused, gears are posted to the
+///  writer thread and actions to the main thread as WM_SHIFTER_ACTION.
+///  Never blocks, safe to call from the keyboard hook.
+/// </summary>
+/// <param name="wTarget">SHIFT_GEAR or KEY_ACTION.</param>
+/// <param name="qwInputUs">GetShiftClockUs() when the input arrived.</param>
+/// <param name="lpFocusTracker">NULL to skip the focus check.</param>
+/// <returns>
+///  wTarget if it was dispatched, KEY_ACTION_INVALID otherwise.
+/// </returns>
+WORD DispatchShifterTarget(
+    CONST WORD wTarget,
+    CONST ULONGLONG qwInputUs,
+    LPFOCUS_TRACKER lpFocusTracker
+);
+
+/// <summary>
+///  Runs a key press down the shift path of the keyboard hook, through
+///  DispatchShifterTarget(). Shifts are timed from here.
+///  Never blocks, safe to call from the keyboard hook.
+/// </summary>
+/// <param name="byVirtualKey"></param>
+/// <param name="lpFocusTracker">NULL to skip the focus check.</param>
+/// <returns>
+///  SHIFT_GEAR or KEY_ACTION that was dispatched,
+///  KEY_ACTION_INVALID if the key isn't the shifter's or wasn't dispatched.
+/// </returns>
+WORD HandleShifterKey(
+    CONST BYTE byVirtualKey,
+    LPFOCUS_TRACKER lpFocusTracker
+);
+
+/// <summary>
+///  Retrieves a snapshot of the shift outcome counters.
+/// </summary>
+/// <param name="lpCounters"></param>
+VOID GetShiftCommitCounters(
+    LPSHIFT_COMMIT_COUNTERS lpCounters
+);
+
+/// <summary>
+///  Reads the clock shift latencies are measured with.
+///  Valid once StartGearWriter() was called.
+/// </summary>
+/// <returns>
+///  Microseconds since an arbitrary point in time.
+/// </returns>
+ULONGLONG GetShiftClockUs(
+    VOID
+);
+
+/// <summary>
+///  Records the latency of a shift stage that is timed outside of the writer thread.
+///  Lock-free, safe to call from the keyboard hook.
+/// </summary>
+/// <param name="eStage"></param>
+/// <param name="qwLatencyUs"></param>
+VOID RecordShiftLatency(
+    CONST SHIFT_LATENCY_STAGE eStage,
+    CONST ULONGLONG qwLatencyUs
+);
+
+/// <summary>
+///  Reads the latency percentiles of a shift stage.
+/// </summary>
+/// <param name="eStage"></param>
+/// <param name="lpSummary"></param>
+VOID GetShiftLatency(
+    CONST SHIFT_LATENCY_STAGE eStage,
+    LPLATENCY_SUMMARY lpSummary
+);
+
+/// <summary>
+///  Clears the latencies of every shift stage.
+///  Latencies recorded while it runs may be lost.
+/// </summary>
+VOID ResetShiftLatency(
+    VOID
+);
+
+#endif // _HEAT_HSHIFTER2_GEARCOMMIT_H
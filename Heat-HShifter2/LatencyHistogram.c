@@ -0,0 +1,140 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/// @file LatencyHistogram.c
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#include "LatencyHistogram.h"
+
+STATIC DWORD GetLatencyBucket(
+    CONST DWORD dwLatencyUs
+) {
+    ULONG ulHighestBit;
+
+    if (dwLatencyUs < LATENCY_EXACT_LIMIT_US) {
+        return dwLatencyUs;
+    }
+
+    BitScanReverse(
+        &ulHighestBit,
+        dwLatencyUs
+    );
+
+    // 6 - 31, the top LATENCY_SUB_BUCKET_BITS + 1 bits pick the bucket
+    CONST DWORD dwShift = ulHighestBit - LATENCY_SUB_BUCKET_BITS;
+
+    return LATENCY_EXACT_LIMIT_US
+        + (ulHighestBit - 6) * LATENCY_SUB_BUCKET_COUNT
+        + ((dwLatencyUs >> dwShift) - LATENCY_SUB_BUCKET_COUNT);
+}
+
+/// Largest value counted in a bucket.
+STATIC DWORD GetLatencyBucketLimit(
+    CONST DWORD dwBucket
+) {
+    if (dwBucket < LATENCY_EXACT_LIMIT_US) {
+        return dwBucket;
+    }
+
+    CONST DWORD dwLinear = dwBucket - LATENCY_EXACT_LIMIT_US;
+    CONST DWORD dwShift = 6 + dwLinear / LATENCY_SUB_BUCKET_COUNT - LATENCY_SUB_BUCKET_BITS;
+    CONST ULONGLONG qwLowest = (ULONGLONG) (LATENCY_SUB_BUCKET_COUNT + dwLinear % LATENCY_SUB_BUCKET_COUNT) << dwShift;
+
+    return (DWORD) (qwLowest + (1ULL << dwShift) - 1);
+}
+
+VOID RecordLatency(
+    LPLATENCY_HISTOGRAM lpHistogram,
+    CONST ULONGLONG qwLatencyUs
+) {
+    CONST DWORD dwLatencyUs = (qwLatencyUs > MAXDWORD) ? MAXDWORD : (DWORD) qwLatencyUs;
+    LONG64 llMaxUs = lpHistogram->llMaxUs;
+
+    while ((LONG64) dwLatencyUs > llMaxUs) {
+        CONST LONG64 llSeenUs = InterlockedCompareExchange64(
+            &lpHistogram->llMaxUs,
+            (LONG64) dwLatencyUs,
+            llMaxUs
+        );
+
+        if (llSeenUs == llMaxUs) {
+            break;
+        }
+
+        llMaxUs = llSeenUs;
+    }
+
+    // After the maximum, a counted value is never above the maximum read with it
+    InterlockedIncrement64(
+        &lpHistogram->allBuckets[GetLatencyBucket(dwLatencyUs)]
+    );
+}
+
+VOID SummarizeLatency(
+    LPLATENCY_HISTOGRAM lpHistogram,
+    LPLATENCY_SUMMARY lpSummary
+) {
+    // Per ten thousand, p50, p99, p99.9
+    CONST DWORD adwPercentiles[] = { 5000, 9900, 9990 };
+    LPDWORD alpdwResults[] = {
+        &lpSummary->dwP50Us,
+        &lpSummary->dwP99Us,
+        &lpSummary->dwP999Us
+    };
+    LONG64 allBuckets[LATENCY_BUCKET_COUNT];
+    ULONGLONG qwCount = 0;
+
+    ZeroMemory(
+        lpSummary,
+        sizeof(LATENCY_SUMMARY)
+    );
+
+    // Snapshot first, so the percentiles agree with the count while others record
+    for (DWORD i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+        allBuckets[i] = InterlockedCompareExchange64(&lpHistogram->allBuckets[i], 0, 0);
+        qwCount += (ULONGLONG) allBuckets[i];
+    }
+
+    if (0 == qwCount) {
+        return;
+    }
+
+    lpSummary->qwCount = qwCount;
+    lpSummary->dwMaxUs = (DWORD) InterlockedCompareExchange64(&lpHistogram->llMaxUs, 0, 0);
+
+
+    for (DWORD p = 0; p < ARRAYSIZE(adwPercentiles); p++) {
+        CONST ULONGLONG qwRank = (qwCount * adwPercentiles[p] + 9999) / 10000;
+        ULONGLONG qwSeen = 0;
+        DWORD i;
+
+        for (i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+            qwSeen += (ULONGLONG) allBuckets[i];
+
+            if (qwSeen >= qwRank) {
+                break;
+            }
+        }
+
+        *alpdwResults[p] = GetLatencyBucketLimit(i);
+
+        // The highest bucket may reach past the largest value in it
+        if (*alpdwResults[p] > lpSummary->dwMaxUs) {
+            *alpdwResults[p] = lpSummary->dwMaxUs;
+        }
+    }
+}
@@ -0,0 +1,72 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/// @file LatencyHistogram.h
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#ifndef _HEAT_HSHIFTER2_LATENCYHISTOGRAM_H
+#define _HEAT_HSHIFTER2_LATENCYHISTOGRAM_H
+
+#include "Utils.h"
+
+#define LATENCY_EXACT_LIMIT_US                  64                  // Below this, every microsecond has its own bucket
+#define LATENCY_SUB_BUCKET_BITS                 5                   // 32 buckets per power of two above it, ~3% precision
+#define LATENCY_SUB_BUCKET_COUNT                (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_BUCKET_COUNT                    (LATENCY_EXACT_LIMIT_US + (32 - 6) * LATENCY_SUB_BUCKET_COUNT)
+
+/// HDR-style latency histogram, 1 us to ~71 minutes.
+/// Buckets are exact up to LATENCY_EXACT_LIMIT_US and log-linear above it,
+/// so a recorded value is off by at most 1/LATENCY_SUB_BUCKET_COUNT.
+/// Recording is lock-free and never blocks, any thread may record while another reads.
+typedef struct DECLSPEC_CACHEALIGN _LATENCY_HISTOGRAM {
+    VOLATILE LONG64 llMaxUs;
+    VOLATILE LONG64 allBuckets[LATENCY_BUCKET_COUNT];
+} LATENCY_HISTOGRAM, *LPLATENCY_HISTOGRAM;
+
+/// Percentiles of a histogram, in microseconds.
+typedef struct _LATENCY_SUMMARY {
+    ULONGLONG qwCount;
+    DWORD dwP50Us;
+    DWORD dwP99Us;
+    DWORD dwP999Us;
+    DWORD dwMaxUs;
+} LATENCY_SUMMARY, *LPLATENCY_SUMMARY;
+
+typedef CONST LATENCY_SUMMARY *LPCLATENCY_SUMMARY;
+
+/// <summary>
+///  Records a latency. Values past the last bucket are counted in it.
+/// </summary>
+/// <param name="lpHistogram"></param>
+/// <param name="qwLatencyUs"></param>
+VOID RecordLatency(
+    LPLATENCY_HISTOGRAM lpHistogram,
+    CONST ULONGLONG qwLatencyUs
+);
+
+/// <summary>
+///  Reads the percentiles of a histogram. Percentiles are reported as the
+///  upper edge of their bucket, the maximum is exact.
+/// </summary>
+/// <param name="lpHistogram"></param>
+/// <param name="lpSummary">Zeroed if nothing was recorded.</param>
+VOID SummarizeLatency(
+    LPLATENCY_HISTOGRAM lpHistogram,
+    LPLATENCY_SUMMARY lpSummary
+);
+
+#endif // _HEAT_HSHIFTER2_LATENCYHISTOGRAM_H
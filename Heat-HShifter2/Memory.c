@@ -20,7 +20,9 @@
 ///   - github.con/x0reaxeax/nfsheat-hshifter
 /// 
 
-#include "Utils.h"
+#include "Search.h"
+#include "RegionMap.h"
+#include "MemorySource.h"
 
 #include <TlHelp32.h>
 
@@ -92,32 +94,8 @@ STATIC LPMODULEENTRY32 GetModuleInfo(
     return lpModuleEntry32;
 }
 
-STATIC INLINE BOOLEAN IsAddressStateValid(
-    DWORD dwState,
-    DWORD dwProtect
-) {
-    if (MEM_COMMIT != dwState) {
-        return FALSE;
-    }
-
-    if (PAGE_GUARD & dwProtect) {
-        return FALSE;
-    }
-
-    if (PAGE_NOACCESS & dwProtect) {
-        return FALSE;
-    }
-
-    if (PAGE_EXECUTE_READ & dwProtect) {
-        return FALSE;
-    }
-
-    if (!(PAGE_READWRITE & dwProtect)) {
-        return FALSE;
-    }
-
-    return TRUE;
-}
+// Committed regions of the game process, reused by every scan of the session
+STATIC REGION_MAP g_RegionMap = { 0 };
 
 STATIC BOOLEAN AreDwordsUnique(
     CONST LPDWORD adwArray,
@@ -133,414 +111,1704 @@ STATIC BOOLEAN AreDwordsUnique(
     return TRUE;
 }
 
-STATIC BOOLEAN IsValueLiveMemory(
-    LPCVOID lpcTargetLiveMemory,
-    SIZE_T cbLiveMemorySize
+/// Live memory is only live if the game is not minimized.
+STATIC BOOLEAN RestoreGameWindow(
+    VOID
 ) {
-    BOOLEAN bRet = FALSE;
-    if (IsIconic(
+    if (!IsIconic(
         g_ShifterConfig.hGameWindow
     )) {
-        // Live memory is only live if the game is not minimized
-        if (!MaximizeWindow(
-            g_ShifterConfig.hGameWindow
-        )) {
-            fprintf(
-                stderr,
-                "[-] Failed to maximize game window.\n"
-            );
-            return FALSE;
-        }
-
-        g_ShifterConfig.bGameWasMinimized = TRUE;
-
-        // Wait for and verify window state change
-        while (IsIconic(
-            g_ShifterConfig.hGameWindow
-        )) {
-            Sleep(250);
-        }
+        return TRUE;
     }
 
-    LPBYTE alpReads[AOBSCAN_LIVE_MEMORY_ITERATIONS] = { 0 };
-    SIZE_T cbBytesRead = 0;
-
-    for (DWORD i = 0; i < AOBSCAN_LIVE_MEMORY_ITERATIONS; ++i) {
-        alpReads[i] = VirtualAlloc(
-            NULL,
-            cbLiveMemorySize,
-            MEM_COMMIT | MEM_RESERVE,
-            PAGE_READWRITE
+    if (!MaximizeWindow(
+        g_ShifterConfig.hGameWindow
+    )) {
+        fprintf(
+            stderr,
+            "[-] Failed to maximize game window.\n"
         );
+        return FALSE;
+    }
 
-        if (NULL == alpReads[i]) {
-            fprintf(
-                stderr,
-                "[-] VirtualAlloc(): E%lu\n",
-                GetLastError()
-            );
-            return FALSE;
-        }
-        
-        if (!ReadProcessMemory(
-            g_ShifterConfig.hGameProcess,
-            lpcTargetLiveMemory,
-            alpReads[i],
-            cbLiveMemorySize,
-            &cbBytesRead
-        )) {
-            fprintf(
-                stderr,
-                "[-] ReadProcessMemory(): E%lu\n",
-                GetLastError()
-            );
-            return FALSE;
-        }
+    g_ShifterConfig.bGameWasMinimized = TRUE;
 
-        Sleep(AOBSCAN_LIVE_MEMORY_DELAY_MS);
+    // Wait for and verify window state change
+    while (IsIconic(
+        g_ShifterConfig.hGameWindow
+    )) {
+        Sleep(250);
     }
 
-    // Check if all reads are the same
-    for (DWORD i = 0; i < AOBSCAN_LIVE_MEMORY_ITERATIONS; ++i) {
-        for (DWORD j = i + 1; j < AOBSCAN_LIVE_MEMORY_ITERATIONS; ++j) {
-            if (EXIT_SUCCESS != memcmp(
-                alpReads[i],
-                alpReads[j],
-                cbLiveMemorySize
-            )) {
-                // Reads are not the same - live memory detected
-                bRet = TRUE;
-                goto _FINAL;
-            }
-        }
-    }
+    return TRUE;
+}
 
-_FINAL:
-    for (DWORD i = 0; i < AOBSCAN_LIVE_MEMORY_ITERATIONS; ++i) {
-        if (NULL != alpReads[i]) {
-            VirtualFree(
-                alpReads[i],
-                0,
-                MEM_RELEASE
-            );
-        }
+STATIC BOOLEAN IsGearValuePlausible(
+    CONST DWORD dwGearValue
+) {
+    if (g_ShifterConfig.bSecondGearScan) {
+        return (GEAR_2 == dwGearValue);
     }
 
-    return bRet;
+    // Omit GEAR_REVERSE from this check, so the car can't be in reverse gear!!
+    return (dwGearValue >= GEAR_NEUTRAL && dwGearValue <= GEAR_8);
 }
 
-STATIC BOOLEAN VerifyPlayerGear(
-    LPCVOID lpcCurrentArtifactAddress,
-    TARGET_GEAR eTargetGear
+STATIC BOOLEAN IsGearPlausible(
+    LPMEMORY_SOURCE lpSource,
+    LPCVOID lpcArtifactAddress,
+    LPCSIGNATURE lpSignature
 ) {
     DWORD dwReadValue = 0;
-    SIZE_T cbBytesRead = 0;
-    SIZE_T cbLiveMemorySize = 0;
-
-    LPCVOID lpcTargetAddressGear;
-    LPCVOID lpcTargetLiveMemory;
-    LPCVOID lpcTargetStaticMemory;
-
-    switch (eTargetGear) {
-        case TARGET_GEAR_CURRENT:
-            lpcTargetAddressGear = (LPCVOID) (
-                (DWORD64) lpcCurrentArtifactAddress 
-                    + HEAT_CURRENT_GEAR_ARTIFACT_OFFSET
-            );
-
-            lpcTargetLiveMemory = (LPCVOID) (
-                (DWORD64) lpcCurrentArtifactAddress 
-                    + AOBSCAN_CURRENT_GEAR_LIVE_MEMORY_OFFSET
-            );
-
-            lpcTargetStaticMemory = (LPCVOID) (
-                (DWORD64) lpcTargetLiveMemory - sizeof(DWORD64)
-            );
-
-            cbLiveMemorySize = HEAT_CURRENT_GEAR_ARTIFACT_SIZE;
-
-            break;
-
-        case TARGET_GEAR_LAST:
-            lpcTargetAddressGear = (LPCVOID) (
-                (DWORD64) lpcCurrentArtifactAddress 
-                    + HEAT_LAST_GEAR_ARTIFACT_OFFSET
-            );
 
-            lpcTargetLiveMemory = (LPCVOID) (
-                (DWORD64) lpcCurrentArtifactAddress 
-                    - AOBSCAN_LAST_GEAR_LIVE_MEMORY_OFFSET
-            );
-
-            lpcTargetStaticMemory = (LPCVOID) (
-                (DWORD64) lpcTargetLiveMemory + sizeof(DWORD64)
-            );
-
-            cbLiveMemorySize = HEAT_LAST_GEAR_ARTIFACT_SIZE;
-
-            break;
-
-        default:
-            fprintf(
-                stderr,
-                "[-] Invalid target gear: %d\n",
-                eTargetGear
-            );
-            return FALSE;
-    }
+    LPCVOID lpcTargetAddressGear = (LPCVOID) (
+        (DWORD64) lpcArtifactAddress + lpSignature->lGearOffset
+    );
 
-    // Validate gear sanity check first, since it is faster
-    if (!ReadProcessMemory(
-        g_ShifterConfig.hGameProcess,
+    if (!ReadMemory(
+        lpSource,
         lpcTargetAddressGear,
         &dwReadValue,
-        sizeof(DWORD),
-        &cbBytesRead
+        sizeof(DWORD)
     )) {
         fprintf(
             stderr,
-            "[-] ReadProcessMemory(): E%lu\n",
+            "[-] ReadMemory(): E%lu\n",
             GetLastError()
         );
         return FALSE;
     }
 
-    if (g_ShifterConfig.bSecondGearScan) {
-        if (GEAR_2 != dwReadValue) {
-            WriteLog(
-                "[-] => %s():%lu Invalid gear at address: 0x%016llX\n",
-                __FUNCTION__,
-                __LINE__,
-                (DWORD64) lpcTargetAddressGear
-            );
+    if (!IsGearValuePlausible(dwReadValue)) {
+        WriteLog(
+            "[-] => %s():%lu Invalid gear at address: 0x%016llX\n",
+            __FUNCTION__,
+            __LINE__,
+            (DWORD64) lpcTargetAddressGear
+        );
+        return FALSE;
+    }
 
-            return FALSE;
-        }
-    } else {
-        // Omit GEAR_REVERSE from this check, so the car can't be in reverse gear!!
-        if (dwReadValue < GEAR_NEUTRAL || dwReadValue > GEAR_8) {
-            WriteLog(
-                "[-] => %s():%lu Invalid gear at address: 0x%016llX\n",
-                __FUNCTION__,
-                __LINE__,
-                (DWORD64) lpcTargetAddressGear
-            );
+    return TRUE;
+}
+
+/// Pattern hit waiting for the shared liveness sampling rounds.
+typedef struct _AOBSCAN_CANDIDATE {
+    LPCBYTE lpArtifact;
+    DWORD dwSignatureId;
+    DWORD dwSamples;            // Samples taken so far, the first one is the baseline
+    ULONGLONG qwNextSample;     // Tick count the next sample is due at
+    BOOLEAN bSampleDue;         // Sampled in the current round
+    BOOLEAN bRejected;
+
+    // Ranking evidence
+    DWORD dwLiveChanges;        // Samples in which live memory differed from the previous one
+    DWORD dwPlausibleGears;     // Samples with a plausible gear value
+
+    // Artifact, gear, live and static memory are sampled with a single read,
+    // the reads of all due candidates share one scatter batch
+    LPCBYTE lpWindow;
+    SIZE_T cbWindow;
+    SIZE_T cbSampled;
+    BYTE abySample[AOBSCAN_CANDIDATE_WINDOW_SIZE];
+    BYTE abyLastSample[AOBSCAN_CANDIDATE_WINDOW_SIZE];
+} AOBSCAN_CANDIDATE, *LPAOBSCAN_CANDIDATE;
+
+typedef CONST AOBSCAN_CANDIDATE *LPCAOBSCAN_CANDIDATE;
+
+/// Pattern hit passed from the scan stage to the verification stage.
+typedef struct _AOBSCAN_HIT {
+    LPCBYTE lpArtifact;
+    DWORD dwSignatureId;
+} AOBSCAN_HIT, *LPAOBSCAN_HIT;
+
+typedef CONST AOBSCAN_HIT *LPCAOBSCAN_HIT;
+
+typedef struct _AOBSCAN_WORK_ITEM {
+    LPCBYTE lpAddress;
+    SIZE_T cbSize;
+    SIZE_T cbTail;              // Readable bytes past cbSize, for matches straddling the next item
+} AOBSCAN_WORK_ITEM, *LPAOBSCAN_WORK_ITEM;
+
+struct _AOBSCAN_JOB;
+
+typedef struct _AOBSCAN_STREAM {
+    struct _AOBSCAN_JOB *lpJob;
+
+    LPBYTE lpBuffer;            // AOBSCAN_READ_CHUNK_SIZE + cbOverlap bytes
+    SIZE_T cbCarry;             // Bytes currently carried at the start of lpBuffer
+    LPCBYTE lpCarryAddress;     // Remote address of lpBuffer[0]
+    LPCBYTE lpItemEnd;          // Matches starting here or later belong to the next work item
+} AOBSCAN_STREAM, *LPAOBSCAN_STREAM;
+
+typedef struct DECLSPEC_CACHEALIGN _AOBSCAN_WORKER {
+    SRWLOCK DequeLock;
+    SIZE_T qwHead;              // Owner pops work items from the head..
+    SIZE_T qwTail;              // ..thieves steal from the tail
+
+    DWORD dwWorkerIndex;
+    HANDLE hThread;
+    AOBSCAN_STREAM Stream;
+} AOBSCAN_WORKER, *LPAOBSCAN_WORKER;
+
+typedef struct _AOBSCAN_JOB {
+    LPMEMORY_SOURCE lpSource;
+    LPCSIGNATURE_PACK lpSignaturePack;
+    LPAOBSCAN_RESULT lpResult;
+    LPREGION_MAP lpRegionMap;
+    SIZE_T cbOverlap;           // Tail carried between windows, longest pattern - 1
+    LONG lRequiredTargets;      // Bit per target gear present in the pack
+    BOOLEAN bExhaustive;        // Snapshots are scanned to the end, every hit is verified and ranked
+
+    LPAOBSCAN_WORK_ITEM aWorkItems;
+    SIZE_T qwWorkItemCount;
+    DWORD64 qwTotalBytes;
+
+    AOBSCAN_WORKER aWorkers[AOBSCAN_MAX_WORKERS];
+    DWORD dwWorkerCount;
+
+    // Bounded queue of hits, pushed by the workers and popped by the verifier
+    SRWLOCK HitQueueLock;
+    CONDITION_VARIABLE HitQueueNotFull;
+    AOBSCAN_HIT aHitQueue[AOBSCAN_HIT_QUEUE_SIZE];
+    SIZE_T qwHitQueueHead;
+    SIZE_T qwHitQueueTail;
+    BOOLEAN bVerifierRunning;   // Workers wait on a full queue, otherwise the scanning thread drains it
+
+    // Owned by the verifier
+    LPAOBSCAN_CANDIDATE aCandidates;    // AOBSCAN_MAX_CANDIDATES entries
+    DWORD dwCandidateCount;
+
+    // Written by all workers
+    DECLSPEC_CACHEALIGN VOLATILE LONG lCancelled;
+    VOLATILE LONG lLockedTargets;
+    VOLATILE LONG64 qwBytesScanned;
+} AOBSCAN_JOB, *LPAOBSCAN_JOB;
+
+/// Checks with the region map that every field of the artifact layout is
+/// committed, so verification doesn't issue reads that are bound to fail.
+STATIC BOOLEAN IsArtifactLayoutCommitted(
+    LPCREGION_MAP lpRegionMap,
+    LPCSIGNATURE lpSignature,
+    LPCBYTE lpArtifact
+) {
+    CONST LONG alFieldOffsets[] = {
+        lpSignature->lGearOffset,
+        lpSignature->lLiveOffset,
+        lpSignature->lLiveOffset + (LONG) lpSignature->cbLiveSize - 1,
+        lpSignature->lStaticOffset
+    };
+
+    for (DWORD i = 0; i < ARRAYSIZE(alFieldOffsets); ++i) {
+        if (NULL == FindMemoryRegion(
+            lpRegionMap,
+            lpArtifact + alFieldOffsets[i]
+        )) {
             return FALSE;
         }
     }
 
-    // Verify known live memory
-    if (!IsValueLiveMemory(
-        lpcTargetLiveMemory,
-        cbLiveMemorySize
-    )) {
+    return TRUE;
+}
+
+/// Turns a queued hit into a candidate with its sampling window.
+STATIC BOOLEAN AdmitCandidate(
+    LPAOBSCAN_JOB lpJob,
+    LPCAOBSCAN_HIT lpcHit
+) {
+    LPCSIGNATURE lpSignature = &lpJob->lpSignaturePack->aSignatures[lpcHit->dwSignatureId];
+
+    CONST LONG lWindowStart = min(
+        min(0, lpSignature->lGearOffset),
+        min(lpSignature->lLiveOffset, lpSignature->lStaticOffset)
+    );
+
+    CONST LONG lWindowEnd = max(
+        max(
+            (LONG) lpSignature->SearchPattern.cbPatternSize,
+            lpSignature->lGearOffset + (LONG) sizeof(DWORD)
+        ),
+        max(
+            lpSignature->lLiveOffset + (LONG) lpSignature->cbLiveSize,
+            lpSignature->lStaticOffset + (LONG) sizeof(DWORD)
+        )
+    );
+
+    if (lWindowEnd - lWindowStart > AOBSCAN_CANDIDATE_WINDOW_SIZE) {
         WriteLog(
-            "[-] => %s():%lu Omitting static memory at address: 0x%016llX\n",
+            "[-] => %s():%lu Artifact layout of '%s' exceeds the sampling window\n",
             __FUNCTION__,
             __LINE__,
-            (DWORD64) lpcCurrentArtifactAddress
+            lpSignature->szName
         );
         return FALSE;
     }
 
+    lpJob->lpResult->dwCandidateCount++;
+    lpJob->aCandidates[lpJob->dwCandidateCount++] = (AOBSCAN_CANDIDATE) {
+        .lpArtifact = lpcHit->lpArtifact,
+        .dwSignatureId = lpcHit->dwSignatureId,
+        .lpWindow = lpcHit->lpArtifact + lWindowStart,
+        .cbWindow = (SIZE_T) (lWindowEnd - lWindowStart)
+    };
+
+    return TRUE;
+}
+
+/// Evaluates the sample just read for a candidate. The first sample is the
+/// baseline, later ones reject the candidate as soon as static memory or the
+/// artifact itself changes, and count the samples in which its live memory changed.
+STATIC VOID SampleCandidate(
+    LPAOBSCAN_JOB lpJob,
+    LPAOBSCAN_CANDIDATE lpCandidate
+) {
+    CONST DWORD dwRound = lpCandidate->dwSamples++;
+    LPCSIGNATURE lpSignature = &lpJob->lpSignaturePack->aSignatures[lpCandidate->dwSignatureId];
+    LPCBYTE abySample = lpCandidate->abySample;
+
+    if (lpCandidate->cbWindow != lpCandidate->cbSampled) {
+        WriteLog(
+            "[-] => %s():%lu Unable to sample address: 0x%016llX\n",
+            __FUNCTION__,
+            __LINE__,
+            (DWORD64) lpCandidate->lpArtifact
+        );
+        lpCandidate->bRejected = TRUE;
+        return;
+    }
+
+    CONST SIZE_T cbArtifactOffset = (SIZE_T) (lpCandidate->lpArtifact - lpCandidate->lpWindow);
+    CONST SIZE_T cbGearOffset = cbArtifactOffset + lpSignature->lGearOffset;
+    CONST SIZE_T cbLiveOffset = cbArtifactOffset + lpSignature->lLiveOffset;
+    CONST SIZE_T cbStaticOffset = cbArtifactOffset + lpSignature->lStaticOffset;
+
+    DWORD dwGearValue = 0;
+    memcpy(
+        &dwGearValue,
+        abySample + cbGearOffset,
+        sizeof(DWORD)
+    );
+
+    if (IsGearValuePlausible(dwGearValue)) {
+        lpCandidate->dwPlausibleGears++;
+    }
+
+    if (0 == dwRound) {
+        memcpy(
+            lpCandidate->abyLastSample,
+            abySample,
+            lpCandidate->cbWindow
+        );
+        return;
+    }
+
     // Verify known static memory
-    if (IsValueLiveMemory(
-        (LPCVOID) ((DWORD64) lpcTargetStaticMemory),
+    if (EXIT_SUCCESS != memcmp(
+        abySample + cbStaticOffset,
+        lpCandidate->abyLastSample + cbStaticOffset,
         sizeof(DWORD)
     )) {
         WriteLog(
             "[-] => %s():%lu Omitting live memory at address: 0x%016llX\n",
             __FUNCTION__,
             __LINE__,
-            (DWORD64) lpcTargetStaticMemory
+            (DWORD64) lpCandidate->lpWindow + cbStaticOffset
         );
-        return FALSE;
+        lpCandidate->bRejected = TRUE;
+        return;
     }
 
-    return TRUE;
+    // Check if artifact itself is live memory
+    if (!g_ShifterConfig.bSecondGearScan && EXIT_SUCCESS != memcmp(
+        abySample + cbArtifactOffset,
+        lpCandidate->abyLastSample + cbArtifactOffset,
+        lpSignature->SearchPattern.cbPatternSize
+    )) {
+        WriteLog(
+            "[-] => %s():%lu Omitting live memory at address: 0x%016llX\n",
+            __FUNCTION__,
+            __LINE__,
+            (DWORD64) lpCandidate->lpArtifact
+        );
+        lpCandidate->bRejected = TRUE;
+        return;
+    }
+
+    // Verify known live memory
+    if (EXIT_SUCCESS != memcmp(
+        abySample + cbLiveOffset,
+        lpCandidate->abyLastSample + cbLiveOffset,
+        lpSignature->cbLiveSize
+    )) {
+        lpCandidate->dwLiveChanges++;
+    }
+
+    memcpy(
+        lpCandidate->abyLastSample,
+        abySample,
+        lpCandidate->cbWindow
+    );
 }
 
-LPCVOID AobScan(
-    LPCBYTE abyPattern,
-    CONST SIZE_T cbPatternSize,
-    TARGET_GEAR eTargetGear
+/// Stops the workers, hits found so far are still verified.
+STATIC VOID CancelScanStage(
+    LPAOBSCAN_JOB lpJob
 ) {
-    SIZE_T cbBytesRead = 0;
+    InterlockedExchange(&lpJob->lCancelled, TRUE);
 
-    LPCBYTE lpAobMatch = NULL;
-    LPCBYTE lpCurrentAddress = (LPCBYTE) AOBSCAN_LOW_ADDRESS_LIMIT;
+    // Release workers waiting on a full queue
+    AcquireSRWLockExclusive(&lpJob->HitQueueLock);
+    WakeAllConditionVariable(&lpJob->HitQueueNotFull);
+    ReleaseSRWLockExclusive(&lpJob->HitQueueLock);
+}
 
-    LPBYTE lpReadBuffer = VirtualAlloc(
-        NULL,
-        PAGE_SIZE,
-        MEM_COMMIT | MEM_RESERVE,
-        PAGE_READWRITE
+/// Adds a verified candidate to the ranked artifacts of its target gear,
+/// replacing the lowest scored one if the list is full.
+/// Cancels the scan stage once every target gear has a verified artifact.
+STATIC VOID PublishCandidate(
+    LPAOBSCAN_JOB lpJob,
+    LPCAOBSCAN_CANDIDATE lpcCandidate
+) {
+    LPCSIGNATURE lpSignature = &lpJob->lpSignaturePack->aSignatures[lpcCandidate->dwSignatureId];
+    LPAOBSCAN_RESULT lpResult = lpJob->lpResult;
+
+    CONST TARGET_GEAR eTargetGear = lpSignature->eTargetGear;
+    LPAOBSCAN_ARTIFACT aRanked = lpResult->aaRankedArtifacts[eTargetGear];
+
+    CONST DWORD dwScore = lpcCandidate->dwLiveChanges * AOBSCAN_SCORE_LIVE_CHANGE
+        + lpcCandidate->dwPlausibleGears * AOBSCAN_SCORE_PLAUSIBLE_GEAR;
+
+    WriteLog(
+        "[+] Verified artifact '%s' at address: 0x%016llX (score %lu)\n",
+        lpSignature->szName,
+        (DWORD64) lpcCandidate->lpArtifact,
+        dwScore
     );
 
-    if (NULL == lpReadBuffer) {
-        fprintf(
-            stderr,
-            "[-] VirtualAlloc(): E%lu\n",
-            GetLastError()
+    DWORD dwSlot = lpResult->adwRankedCount[eTargetGear];
+    if (dwSlot < AOBSCAN_MAX_RANKED_ARTIFACTS) {
+        lpResult->adwRankedCount[eTargetGear]++;
+    } else {
+        dwSlot = 0;
+        for (DWORD i = 1; i < AOBSCAN_MAX_RANKED_ARTIFACTS; ++i) {
+            if (aRanked[i].dwScore < aRanked[dwSlot].dwScore) {
+                dwSlot = i;
+            }
+        }
+
+        if (aRanked[dwSlot].dwScore >= dwScore) {
+            return;
+        }
+    }
+
+    aRanked[dwSlot] = (AOBSCAN_ARTIFACT) {
+        .lpArtifact = lpcCandidate->lpArtifact,
+        .dwSignatureId = lpcCandidate->dwSignatureId,
+        .dwScore = dwScore
+    };
+
+    CONST LONG lLockedTargets = InterlockedOr(
+        &lpJob->lLockedTargets,
+        1 << eTargetGear
+    ) | (1 << eTargetGear);
+
+    if (!lpJob->bExhaustive && lLockedTargets == lpJob->lRequiredTargets) {
+        CancelScanStage(lpJob);
+    }
+}
+
+/// Runs one round of the verification stage.
+/// Admits queued hits and samples every candidate whose next sample is due.
+/// Samples of a candidate are AOBSCAN_LIVE_MEMORY_DELAY_MS apart and all due
+/// candidates share a round, so verification takes as long as the samples of
+/// one candidate, however many candidates there are. Candidates retire once
+/// rejected or after AOBSCAN_LIVE_MEMORY_ITERATIONS samples.
+/// Candidates already admitted are verified to the end even if their target
+/// gear is locked, they are the failover artifacts.
+/// Snapshots have nothing live to sample, their candidates are verified on
+/// the static checks of a single sample.
+/// Returns the number of hits still queued or being verified.
+STATIC DWORD VerifyCandidateRound(
+    LPAOBSCAN_JOB lpJob,
+    PULONGLONG lpqwNextSample
+) {
+    DWORD dwQueued = 0;
+    DWORD dwPending = 0;
+
+    AcquireSRWLockExclusive(&lpJob->HitQueueLock);
+
+    while (
+        lpJob->qwHitQueueHead != lpJob->qwHitQueueTail
+        && lpJob->dwCandidateCount < AOBSCAN_MAX_CANDIDATES
+    ) {
+        AdmitCandidate(
+            lpJob,
+            &lpJob->aHitQueue[lpJob->qwHitQueueHead++ % AOBSCAN_HIT_QUEUE_SIZE]
         );
-        return NULL;
     }
 
-    MEMORY_BASIC_INFORMATION memInfo = { 0 };
+    dwQueued = (DWORD) (lpJob->qwHitQueueTail - lpJob->qwHitQueueHead);
+    WakeAllConditionVariable(&lpJob->HitQueueNotFull);
+    ReleaseSRWLockExclusive(&lpJob->HitQueueLock);
 
-    // Save cursor position, but don't check for errors
-    // to avoid sacrificing scan speed even more
-    BOOLEAN bCursorPositionSaved = TRUE;
-    CONSOLE_SCREEN_BUFFER_INFO csbi = { 0 };
-    if (!GetConsoleScreenBufferInfo(
-        g_ShifterConfig.hShifterConsole,
-        &csbi
-    )) {
-        bCursorPositionSaved = FALSE;
+    *lpqwNextSample = (ULONGLONG) -1;
+
+    if (0 == lpJob->dwCandidateCount) {
+        return dwQueued;
     }
 
-    while ((DWORD64) lpCurrentAddress < AOBSCAN_HIGH_ADDRESS_LIMIT) {
-        if (
-            0 == ((DWORD64) lpCurrentAddress & AOBSCAN_UPDATE_CHECKPOINT) 
-            && bCursorPositionSaved
-        ) {
-            // Restore cursor position
-            SetConsoleCursorPosition(
-                g_ShifterConfig.hShifterConsole,
-                csbi.dwCursorPosition
-            );
+    CONST BOOLEAN bSnapshot = lpJob->lpSource->bSnapshot;
+    CONST DWORD dwRequiredSamples = bSnapshot ? 1 : AOBSCAN_LIVE_MEMORY_ITERATIONS;
+    CONST BOOLEAN bWindowRestored = bSnapshot || RestoreGameWindow();
+    CONST ULONGLONG qwRoundStart = GetTickCount64();
 
-            printf(
-                "[*] Scanning memory: 0x%012llX\n",
-                (DWORD64) lpCurrentAddress
-            );
-        }
+    MEMORY_IO aRequests[AOBSCAN_MAX_CANDIDATES];
+    DWORD dwRequestCount = 0;
 
-        if (sizeof(memInfo) != VirtualQueryEx(
-            g_ShifterConfig.hGameProcess,
-            lpCurrentAddress,
-            &memInfo,
-            sizeof(MEMORY_BASIC_INFORMATION)
-        )) {
-            lpCurrentAddress += PAGE_SIZE;
-            continue;
+    for (DWORD i = 0; i < lpJob->dwCandidateCount; ++i) {
+        LPAOBSCAN_CANDIDATE lpCandidate = &lpJob->aCandidates[i];
+
+        lpCandidate->bSampleDue = (qwRoundStart >= lpCandidate->qwNextSample);
+
+        if (lpCandidate->bSampleDue) {
+            aRequests[dwRequestCount++] = (MEMORY_IO) {
+                .lpAddress = lpCandidate->lpWindow,
+                .lpBuffer = lpCandidate->abySample,
+                .cbSize = lpCandidate->cbWindow
+            };
         }
+    }
 
-        if (!IsAddressStateValid(
-            memInfo.State,
-            memInfo.Protect
-        )) {
-            lpCurrentAddress = (LPCBYTE) memInfo.BaseAddress + memInfo.RegionSize;
+    ReadMemoryScatter(
+        lpJob->lpSource,
+        aRequests,
+        dwRequestCount
+    );
+
+    CONST ULONGLONG qwSampleTime = GetTickCount64();
+    dwRequestCount = 0;
+
+    for (DWORD i = 0; i < lpJob->dwCandidateCount; ++i) {
+        LPAOBSCAN_CANDIDATE lpCandidate = &lpJob->aCandidates[i];
+
+        if (!bWindowRestored) {
             continue;
         }
 
-        LPCBYTE lpRegionEnd = (LPCBYTE) memInfo.BaseAddress + memInfo.RegionSize;
-        for (
-            LPCBYTE lpPageAddr = (LPCBYTE) memInfo.BaseAddress;
-            lpPageAddr < lpRegionEnd;
-            lpPageAddr += PAGE_SIZE
-        ) {
-            if (!ReadProcessMemory(
-                g_ShifterConfig.hGameProcess,
-                lpPageAddr,
-                lpReadBuffer,
-                PAGE_SIZE,
-                &cbBytesRead
-            )) {
-                continue;
-            }
-
-            for (DWORD64 qwIndex = 0; qwIndex + cbPatternSize <= cbBytesRead; ++qwIndex) {
-                if (lpReadBuffer[qwIndex] != abyPattern[0]) { // next-level filter
-                    continue;
-                }
+        if (lpCandidate->bSampleDue) {
+            lpCandidate->cbSampled = aRequests[dwRequestCount++].cbTransferred;
 
-                LPCVOID lpTempMatch = lpPageAddr + qwIndex;
-                if (TARGET_GEAR_CURRENT == eTargetGear) {
-                    if (HEAT_CURRENT_GEAR_ARTIFACT_NIBBLE != GET_NIBBLE(lpTempMatch)) {
-                        continue;
-                    }
-                }
+            SampleCandidate(
+                lpJob,
+                lpCandidate
+            );
 
-                if (EXIT_SUCCESS != memcmp(
-                    lpReadBuffer + qwIndex,
-                    abyPattern,
-                    cbPatternSize
-                )) {
-                    continue;
-                }
-                
-                WriteLog(
-                    "[*] Testing pattern at address: 0x%016llX\n",
-                    (DWORD64) lpTempMatch
-                );
+            // Replayed samples were taken apart already
+            lpCandidate->qwNextSample = lpJob->lpSource->bFastReplay
+                ? qwSampleTime
+                : qwSampleTime + AOBSCAN_LIVE_MEMORY_DELAY_MS;
+        }
 
-                if (!VerifyPlayerGear(
-                    lpTempMatch,
-                    eTargetGear
-                )) {
-                    continue;
-                }
+        if (lpCandidate->bRejected) {
+            continue;
+        }
 
-                if (!g_ShifterConfig.bSecondGearScan) {
-                    // Check if artifact itself is live memory
-                    if (IsValueLiveMemory(
-                        lpTempMatch,
-                        cbPatternSize
-                    )) {
-                        WriteLog(
-                            "[-] => %s():%lu Omitting live memory at address: 0x%016llX\n",
-                            __FUNCTION__,
-                            __LINE__,
-                            (DWORD64) lpTempMatch
-                        );
-                        continue;
-                    }
-                }
+        if (lpCandidate->dwSamples < dwRequiredSamples) {
+            *lpqwNextSample = min(*lpqwNextSample, lpCandidate->qwNextSample);
 
-                lpAobMatch = lpTempMatch;
-                goto _FINAL;
+            // Still sampling, keep it
+            if (dwPending != i) {
+                lpJob->aCandidates[dwPending] = *lpCandidate;
             }
+
+            dwPending++;
+            continue;
+        }
+
+        if (!bSnapshot && 0 == lpCandidate->dwLiveChanges) {
+            WriteLog(
+                "[-] => %s():%lu Omitting static memory at address: 0x%016llX\n",
+                __FUNCTION__,
+                __LINE__,
+                (DWORD64) lpCandidate->lpArtifact
+            );
+            continue;
         }
-        lpCurrentAddress = (LPCBYTE) memInfo.BaseAddress + memInfo.RegionSize;
+
+        PublishCandidate(
+            lpJob,
+            lpCandidate
+        );
     }
 
-_FINAL:
-    VirtualFree(
-        lpReadBuffer,
-        0,
-        MEM_RELEASE
-    );
+    lpJob->dwCandidateCount = dwPending;
 
-    return lpAobMatch;
+    return dwQueued + dwPending;
 }
 
+/// Verifies queued hits on the scanning thread until the hit queue has room,
+/// for scans without worker threads, where no verifier drains it meanwhile.
+STATIC VOID DrainHitQueue(
+    LPAOBSCAN_JOB lpJob
+) {
+    ULONGLONG qwNextSample = 0;
 
-SHIFT_GEAR ReadGear(
-    CONST TARGET_GEAR eTargetGear
+    for (;;) {
+        AcquireSRWLockShared(&lpJob->HitQueueLock);
+        CONST BOOLEAN bFull = (AOBSCAN_HIT_QUEUE_SIZE == lpJob->qwHitQueueTail - lpJob->qwHitQueueHead);
+        ReleaseSRWLockShared(&lpJob->HitQueueLock);
+
+        if (!bFull || lpJob->lCancelled) {
+            return;
+        }
+
+        // Hits are admitted as soon as candidates retire, which takes their samples
+        CONST ULONGLONG qwNow = GetTickCount64();
+
+        if ((ULONGLONG) -1 != qwNextSample && qwNextSample > qwNow) {
+            Sleep((DWORD) (qwNextSample - qwNow));
+        }
+
+        VerifyCandidateRound(
+            lpJob,
+            &qwNextSample
+        );
+    }
+}
+
+/// Runs the cheap checks on one full pattern match and queues it for the
+/// verification stage. Blocks while the queue is full, or drains it when
+/// there is no verifier running next to the scan.
+STATIC VOID AddCandidate(
+    LPAOBSCAN_JOB lpJob,
+    DWORD dwSignatureId,
+    LPCVOID lpTempMatch
 ) {
-    SHIFT_GEAR eGearValue = 0;
-    SIZE_T cbBytesRead = 0;
+    LPCSIGNATURE lpSignature = &lpJob->lpSignaturePack->aSignatures[dwSignatureId];
+
+    InterlockedIncrement((VOLATILE LONG *) &lpJob->lpResult->adwHitCount[dwSignatureId]);
+
+    RecordRegionHit(
+        lpJob->lpRegionMap,
+        lpTempMatch
+    );
+
+    WriteLog(
+        "[*] Testing pattern '%s' (signature %lu) at address: 0x%016llX\n",
+        lpSignature->szName,
+        dwSignatureId,
+        (DWORD64) lpTempMatch
+    );
+
+    if (!IsArtifactLayoutCommitted(
+        lpJob->lpRegionMap,
+        lpSignature,
+        lpTempMatch
+    )) {
+        WriteLog(
+            "[-] => %s():%lu Artifact layout not committed at address: 0x%016llX\n",
+            __FUNCTION__,
+            __LINE__,
+            (DWORD64) lpTempMatch
+        );
+        return;
+    }
+
+    if (!IsGearPlausible(
+        lpJob->lpSource,
+        lpTempMatch,
+        lpSignature
+    )) {
+        return;
+    }
+
+    if (!lpJob->bVerifierRunning) {
+        DrainHitQueue(lpJob);
+    }
+
+    AcquireSRWLockExclusive(&lpJob->HitQueueLock);
+
+    while (
+        lpJob->bVerifierRunning
+        && !lpJob->lCancelled
+        && AOBSCAN_HIT_QUEUE_SIZE == lpJob->qwHitQueueTail - lpJob->qwHitQueueHead
+    ) {
+        SleepConditionVariableSRW(
+            &lpJob->HitQueueNotFull,
+            &lpJob->HitQueueLock,
+            INFINITE,
+            0
+        );
+    }
+
+    CONST BOOLEAN bQueued = (AOBSCAN_HIT_QUEUE_SIZE != lpJob->qwHitQueueTail - lpJob->qwHitQueueHead);
+    if (bQueued) {
+        lpJob->aHitQueue[lpJob->qwHitQueueTail++ % AOBSCAN_HIT_QUEUE_SIZE] = (AOBSCAN_HIT) {
+            .lpArtifact = (LPCBYTE) lpTempMatch,
+            .dwSignatureId = dwSignatureId
+        };
+    }
+
+    ReleaseSRWLockExclusive(&lpJob->HitQueueLock);
+
+    if (!bQueued) {
+        WriteLog(
+            "[-] => %s():%lu Scan stage cancelled, dropping address: 0x%016llX\n",
+            __FUNCTION__,
+            __LINE__,
+            (DWORD64) lpTempMatch
+        );
+    }
+}
+
+/// Searches the window for every signature of the pack in one pass.
+/// The window is walked in AOBSCAN_BLOCK_SIZE blocks, each block is
+/// searched for all signatures while it is still in cache.
+/// lpWindow holds the stream buffer, or the mapped range of a source that maps it.
+STATIC BOOLEAN ScanWindow(
+    LPAOBSCAN_STREAM lpStream,
+    LPCBYTE lpWindow,
+    CONST SIZE_T cbWindow
+) {
+    LPAOBSCAN_JOB lpJob = lpStream->lpJob;
+    LPCSIGNATURE_PACK lpSignaturePack = lpJob->lpSignaturePack;
+
+    // The item tail is only read to complete matches that start inside the item
+    CONST SIZE_T qwStartLimit = min(
+        (SIZE_T) (lpStream->lpItemEnd - lpStream->lpCarryAddress),
+        cbWindow
+    );
+
+    for (SIZE_T qwBlock = 0; qwBlock < qwStartLimit; qwBlock += AOBSCAN_BLOCK_SIZE) {
+        CONST SIZE_T qwBlockEnd = min(qwBlock + AOBSCAN_BLOCK_SIZE, qwStartLimit);
+
+        for (DWORD i = 0; i < lpSignaturePack->dwSignatureCount; ++i) {
+            LPCSIGNATURE lpSignature = &lpSignaturePack->aSignatures[i];
+
+            CONST SIZE_T cbPatternSize = lpSignature->SearchPattern.cbPatternSize;
+
+            // Matches must start inside the block, but may end past it
+            CONST SIZE_T cbSearch = min(
+                qwBlockEnd + cbPatternSize - 1,
+                cbWindow
+            );
+
+            // The carry is sized for the longest pattern, shorter ones that
+            // fit entirely in it were already tested in the previous window
+            CONST SIZE_T qwFirstIndex = (lpStream->cbCarry >= cbPatternSize)
+                ? lpStream->cbCarry - cbPatternSize + 1
+                : 0;
+
+            for (
+                SIZE_T qwIndex = FindPattern(
+                    &lpSignature->SearchPattern,
+                    lpWindow,
+                    cbSearch,
+                    max(qwBlock, qwFirstIndex),
+                    (DWORD64) lpStream->lpCarryAddress
+                );
+                SEARCH_NOT_FOUND != qwIndex;
+                qwIndex = FindPattern(
+                    &lpSignature->SearchPattern,
+                    lpWindow,
+                    cbSearch,
+                    qwIndex + 1,
+                    (DWORD64) lpStream->lpCarryAddress
+                )
+            ) {
+                // Another worker may have locked on while this one was verifying
+                if (lpJob->lCancelled) {
+                    return TRUE;
+                }
+
+                if (!lpJob->bExhaustive && (lpJob->lLockedTargets & (1 << lpSignature->eTargetGear))) {
+                    break;
+                }
 
-    LPCVOID lpTargetAddress = (TARGET_GEAR_CURRENT == eTargetGear) 
-        ? g_ShifterConfig.lpCurrentGearAddress 
-        : g_ShifterConfig.lpLastGearAddress;
+                AddCandidate(
+                    lpJob,
+                    i,
+                    lpStream->lpCarryAddress + qwIndex
+                );
+            }
+        }
+    }
 
+    return (BOOLEAN) lpJob->lCancelled;
+}
+
+/// Reads [lpAddress, lpAddress + cbSize) into the stream window and scans it.
+/// A failed read is split in halves until the readable parts are recovered,
+/// and the carried tail is dropped across every unreadable gap.
+/// Returns TRUE once the scan should stop.
+STATIC BOOLEAN StreamRead(
+    LPAOBSCAN_STREAM lpStream,
+    LPCBYTE lpAddress,
+    CONST SIZE_T cbSize
+) {
+    if (lpStream->lpJob->lCancelled) {
+        return TRUE;
+    }
 
-    if (!ReadProcessMemory(
-        g_ShifterConfig.hGameProcess,
-        lpTargetAddress,
-        &eGearValue,
-        sizeof(DWORD),
-        &cbBytesRead
+    // Carry is only valid if this read directly continues the previous one
+    if (lpStream->lpCarryAddress + lpStream->cbCarry != lpAddress) {
+        lpStream->cbCarry = 0;
+        lpStream->lpCarryAddress = lpAddress;
+    }
+
+    if (!ReadMemory(
+        lpStream->lpJob->lpSource,
+        lpAddress,
+        lpStream->lpBuffer + lpStream->cbCarry,
+        cbSize
     )) {
+        if (cbSize <= PAGE_SIZE) {
+            // Unreadable page, break the stream
+            lpStream->cbCarry = 0;
+            lpStream->lpCarryAddress = NULL;
+            return FALSE;
+        }
+
+        CONST SIZE_T cbHalf = ((cbSize / 2) + PAGE_SIZE - 1) & ~((SIZE_T) PAGE_SIZE - 1);
+        if (StreamRead(
+            lpStream,
+            lpAddress,
+            cbHalf
+        )) {
+            return TRUE;
+        }
+
+        return StreamRead(
+            lpStream,
+            lpAddress + cbHalf,
+            cbSize - cbHalf
+        );
+    }
+
+    CONST SIZE_T cbWindow = lpStream->cbCarry + cbSize;
+    if (ScanWindow(
+        lpStream,
+        lpStream->lpBuffer,
+        cbWindow
+    )) {
+        return TRUE;
+    }
+
+    // Keep the tail that may hold the start of a match straddling the next window
+    CONST SIZE_T cbKeep = min(lpStream->lpJob->cbOverlap, cbWindow);
+    memmove(
+        lpStream->lpBuffer,
+        lpStream->lpBuffer + cbWindow - cbKeep,
+        cbKeep
+    );
+
+    lpStream->lpCarryAddress += cbWindow - cbKeep;
+    lpStream->cbCarry = cbKeep;
+
+    return FALSE;
+}
+
+STATIC BOOLEAN PopWorkItem(
+    LPAOBSCAN_WORKER lpWorker,
+    PSIZE_T lpqwItemIndex
+) {
+    BOOLEAN bRet = FALSE;
+
+    AcquireSRWLockExclusive(&lpWorker->DequeLock);
+    if (lpWorker->qwHead < lpWorker->qwTail) {
+        *lpqwItemIndex = lpWorker->qwHead++;
+        bRet = TRUE;
+    }
+    ReleaseSRWLockExclusive(&lpWorker->DequeLock);
+
+    return bRet;
+}
+
+/// Moves the back half of the first non-empty victim deque
+/// into the (empty) deque of the thief and pops one item from it.
+STATIC BOOLEAN StealWorkItem(
+    LPAOBSCAN_JOB lpJob,
+    LPAOBSCAN_WORKER lpThief,
+    PSIZE_T lpqwItemIndex
+) {
+    for (DWORD i = 1; i < lpJob->dwWorkerCount; ++i) {
+        LPAOBSCAN_WORKER lpVictim = &lpJob->aWorkers[
+            (lpThief->dwWorkerIndex + i) % lpJob->dwWorkerCount
+        ];
+
+        SIZE_T qwStolenHead = 0;
+        SIZE_T qwStolenTail = 0;
+
+        AcquireSRWLockExclusive(&lpVictim->DequeLock);
+        if (lpVictim->qwHead < lpVictim->qwTail) {
+            CONST SIZE_T qwCount = lpVictim->qwTail - lpVictim->qwHead;
+            qwStolenTail = lpVictim->qwTail;
+            qwStolenHead = qwStolenTail - ((qwCount + 1) / 2);
+            lpVictim->qwTail = qwStolenHead;
+        }
+        ReleaseSRWLockExclusive(&lpVictim->DequeLock);
+
+        if (qwStolenHead == qwStolenTail) {
+            continue;
+        }
+
+        AcquireSRWLockExclusive(&lpThief->DequeLock);
+        lpThief->qwHead = qwStolenHead + 1;
+        lpThief->qwTail = qwStolenTail;
+        ReleaseSRWLockExclusive(&lpThief->DequeLock);
+
+        *lpqwItemIndex = qwStolenHead;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+STATIC DWORD WINAPI AobScanWorker(
+    LPVOID lpParameter
+) {
+    LPAOBSCAN_WORKER lpWorker = (LPAOBSCAN_WORKER) lpParameter;
+    LPAOBSCAN_JOB lpJob = lpWorker->Stream.lpJob;
+    SIZE_T qwItemIndex = 0;
+
+    while (!lpJob->lCancelled) {
+        if (
+            !PopWorkItem(lpWorker, &qwItemIndex) 
+            && !StealWorkItem(lpJob, lpWorker, &qwItemIndex)
+        ) {
+            break;
+        }
+
+        LPAOBSCAN_WORK_ITEM lpItem = &lpJob->aWorkItems[qwItemIndex];
+
+        // Work items are not contiguous with whatever this worker read last
+        lpWorker->Stream.cbCarry = 0;
+        lpWorker->Stream.lpCarryAddress = NULL;
+        lpWorker->Stream.lpItemEnd = lpItem->lpAddress + lpItem->cbSize;
+
+        LPCBYTE lpMapped = (NULL != lpJob->lpSource->MapRange)
+            ? lpJob->lpSource->MapRange(
+                lpJob->lpSource,
+                lpItem->lpAddress,
+                lpItem->cbSize + lpItem->cbTail
+            )
+            : NULL;
+
+        // Search mapped items in place, tail included
+        if (NULL != lpMapped) {
+            lpWorker->Stream.lpCarryAddress = lpItem->lpAddress;
+
+            if (ScanWindow(
+                &lpWorker->Stream,
+                lpMapped,
+                lpItem->cbSize + lpItem->cbTail
+            )) {
+                break;
+            }
+        } else if (StreamRead(
+            &lpWorker->Stream,
+            lpItem->lpAddress,
+            lpItem->cbSize
+        )) {
+            break;
+        }
+
+        if (NULL == lpMapped && 0 != lpItem->cbTail && StreamRead(
+            &lpWorker->Stream,
+            lpItem->lpAddress + lpItem->cbSize,
+            lpItem->cbTail
+        )) {
+            break;
+        }
+
+        InterlockedExchangeAdd64(
+            &lpJob->qwBytesScanned,
+            (LONG64) lpItem->cbSize
+        );
+
+        MarkRegionsScanned(
+            lpJob->lpRegionMap,
+            lpItem->lpAddress,
+            lpItem->cbSize
+        );
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/// Appends [lpAddress, lpAddress + cbSize) to the work item list in chunks,
+/// growing the list as needed.
+STATIC BOOLEAN AddWorkItems(
+    LPAOBSCAN_JOB lpJob,
+    PSIZE_T lpqwCapacity,
+    LPCBYTE lpAddress,
+    CONST SIZE_T cbSize,
+    CONST SIZE_T cbReadableTail
+) {
+    for (SIZE_T cbOffset = 0; cbOffset < cbSize; cbOffset += AOBSCAN_READ_CHUNK_SIZE) {
+        if (lpJob->qwWorkItemCount == *lpqwCapacity) {
+            CONST SIZE_T qwNewCapacity = (0 == *lpqwCapacity) ? 1024 : *lpqwCapacity * 2;
+            LPAOBSCAN_WORK_ITEM aNewItems = VirtualAlloc(
+                NULL,
+                qwNewCapacity * sizeof(AOBSCAN_WORK_ITEM),
+                MEM_COMMIT | MEM_RESERVE,
+                PAGE_READWRITE
+            );
+
+            if (NULL == aNewItems) {
+                fprintf(
+                    stderr,
+                    "[-] VirtualAlloc(): E%lu\n",
+                    GetLastError()
+                );
+                return FALSE;
+            }
+
+            if (NULL != lpJob->aWorkItems) {
+                memcpy(
+                    aNewItems,
+                    lpJob->aWorkItems,
+                    lpJob->qwWorkItemCount * sizeof(AOBSCAN_WORK_ITEM)
+                );
+
+                VirtualFree(
+                    lpJob->aWorkItems,
+                    0,
+                    MEM_RELEASE
+                );
+            }
+
+            lpJob->aWorkItems = aNewItems;
+            *lpqwCapacity = qwNewCapacity;
+        }
+
+        CONST SIZE_T cbItemSize = min(AOBSCAN_READ_CHUNK_SIZE, cbSize - cbOffset);
+        lpJob->aWorkItems[lpJob->qwWorkItemCount++] = (AOBSCAN_WORK_ITEM) {
+            .lpAddress = lpAddress + cbOffset,
+            .cbSize = cbItemSize,
+            .cbTail = min(lpJob->cbOverlap, cbSize - cbOffset - cbItemSize + cbReadableTail)
+        };
+    }
+
+    lpJob->qwTotalBytes += cbSize;
+    return TRUE;
+}
+
+/// Walks the target address space and splits every scannable span
+/// into work items of at most AOBSCAN_READ_CHUNK_SIZE bytes.
+/// Readable bytes directly after the span, if a scannable region follows it.
+STATIC SIZE_T GetSpanReadableTail(
+    LPCREGION_MAP lpRegionMap,
+    SIZE_T qwNextRegion,
+    LPCBYTE lpSpanEnd
+) {
+    if (qwNextRegion == lpRegionMap->qwRegionCount) {
+        return 0;
+    }
+
+    LPCMEMORY_REGION lpNext = &lpRegionMap->aRegions[qwNextRegion];
+    if (lpNext->lpBaseAddress != lpSpanEnd || REGION_STATE_NONE == lpNext->eState) {
+        return 0;
+    }
+
+    return lpNext->cbSize;
+}
+
+/// Collects work items tier by tier, each tier being a mask of region states.
+/// Adjacent regions of the same tier are merged into spans, and spans
+/// bordering a region of another tier read into it for straddling matches.
+STATIC BOOLEAN CollectWorkItems(
+    LPAOBSCAN_JOB lpJob,
+    CONST DWORD *adwTierStates,
+    CONST DWORD dwTierCount
+) {
+    SIZE_T qwCapacity = 0;
+    LPCREGION_MAP lpRegionMap = lpJob->lpRegionMap;
+
+    for (DWORD dwTier = 0; dwTier < dwTierCount; ++dwTier) {
+        LPCBYTE lpSpanStart = NULL;
+        LPCBYTE lpSpanEnd = NULL;
+
+        for (SIZE_T i = 0; i <= lpRegionMap->qwRegionCount; ++i) {
+            LPCMEMORY_REGION lpRegion = (i < lpRegionMap->qwRegionCount)
+                ? &lpRegionMap->aRegions[i]
+                : NULL;
+
+            if (NULL != lpRegion && !(adwTierStates[dwTier] & lpRegion->eState)) {
+                lpRegion = NULL;
+            }
+
+            // Adjacent valid regions are merged, so matches straddling
+            // a region boundary are still found
+            if (NULL != lpRegion && lpSpanEnd == lpRegion->lpBaseAddress) {
+                lpSpanEnd += lpRegion->cbSize;
+                continue;
+            }
+
+            if (NULL != lpSpanStart && !AddWorkItems(
+                lpJob,
+                &qwCapacity,
+                lpSpanStart,
+                (SIZE_T) (lpSpanEnd - lpSpanStart),
+                GetSpanReadableTail(lpRegionMap, i, lpSpanEnd)
+            )) {
+                return FALSE;
+            }
+
+            lpSpanStart = (NULL != lpRegion) ? lpRegion->lpBaseAddress : NULL;
+            lpSpanEnd = (NULL != lpRegion) ? lpRegion->lpBaseAddress + lpRegion->cbSize : NULL;
+        }
+    }
+
+    return TRUE;
+}
+
+/// Deals the work items round-robin into the worker deques, so that every
+/// worker starts on the highest tier and thieves take the lowest one.
+STATIC BOOLEAN DealWorkItems(
+    LPAOBSCAN_JOB lpJob
+) {
+    CONST DWORD dwWorkerCount = lpJob->dwWorkerCount;
+    CONST SIZE_T qwItemCount = lpJob->qwWorkItemCount;
+
+    if (0 == qwItemCount) {
+        return TRUE;
+    }
+
+    LPAOBSCAN_WORK_ITEM aDealtItems = VirtualAlloc(
+        NULL,
+        qwItemCount * sizeof(AOBSCAN_WORK_ITEM),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == aDealtItems) {
         fprintf(
             stderr,
-            "[-] ReadProcessMemory(): E%lu\n",
+            "[-] VirtualAlloc(): E%lu\n",
             GetLastError()
         );
-        return GEAR_INVALID;
+        return FALSE;
+    }
+
+    SIZE_T qwHead = 0;
+    for (DWORD i = 0; i < dwWorkerCount; ++i) {
+        LPAOBSCAN_WORKER lpWorker = &lpJob->aWorkers[i];
+
+        lpWorker->qwHead = qwHead;
+        for (SIZE_T j = i; j < qwItemCount; j += dwWorkerCount) {
+            aDealtItems[qwHead++] = lpJob->aWorkItems[j];
+        }
+        lpWorker->qwTail = qwHead;
+    }
+
+    VirtualFree(
+        lpJob->aWorkItems,
+        0,
+        MEM_RELEASE
+    );
+
+    lpJob->aWorkItems = aDealtItems;
+    return TRUE;
+}
+
+STATIC DWORD GetScanWorkerCount(
+    VOID
+) {
+    DWORD dwProcessorCount = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+
+    if (0 == dwProcessorCount) {
+        return 1;
+    }
+
+    return min(dwProcessorCount, AOBSCAN_MAX_WORKERS);
+}
+
+/// Checks whether the caller gave up on the scan or its time is up.
+STATIC BOOLEAN IsScanAbandoned(
+    LPCAOBSCAN_TARGET lpTarget,
+    CONST ULONGLONG qwDeadline
+) {
+    if (NULL != lpTarget->lplAbort && 0 != *lpTarget->lplAbort) {
+        return TRUE;
+    }
+
+    return GetTickCount64() >= qwDeadline;
+}
+
+/// Scans the regions of the given tiers for the targets not yet locked in lpResult.
+STATIC BOOLEAN ScanRegionMap(
+    LPCAOBSCAN_TARGET lpTarget,
+    LPCSIGNATURE_PACK lpSignaturePack,
+    LPAOBSCAN_RESULT lpResult,
+    CONST DWORD *adwTierStates,
+    CONST DWORD dwTierCount,
+    CONST ULONGLONG qwDeadline
+) {
+    LARGE_INTEGER liFrequency, liScanStart, liScanEnd;
+    HANDLE ahThreads[AOBSCAN_MAX_WORKERS] = { 0 };
+    DWORD dwThreadCount = 0;
+    BOOLEAN bScanComplete = FALSE;
+
+    BOOLEAN bCursorPositionSaved = TRUE;
+    CONSOLE_SCREEN_BUFFER_INFO csbi = { 0 };
+
+    AOBSCAN_JOB aobJob = {
+        .lpSource = lpTarget->lpSource,
+        .lpSignaturePack = lpSignaturePack,
+        .lpResult = lpResult,
+        .lpRegionMap = lpTarget->lpRegionMap,
+        .bExhaustive = lpTarget->lpSource->bSnapshot
+    };
+
+    for (DWORD i = 0; i < lpSignaturePack->dwSignatureCount; ++i) {
+        LPCSIGNATURE lpSignature = &lpSignaturePack->aSignatures[i];
+
+        aobJob.lRequiredTargets |= 1 << lpSignature->eTargetGear;
+        aobJob.cbOverlap = max(
+            aobJob.cbOverlap,
+            lpSignature->SearchPattern.cbPatternSize - 1
+        );
+    }
+
+    if (0 == aobJob.lRequiredTargets) {
+        return FALSE;
+    }
+
+    // Targets locked by an earlier pass stay locked
+    for (DWORD i = 0; i <= TARGET_GEAR_LAST; ++i) {
+        if (0 != lpResult->adwRankedCount[i]) {
+            aobJob.lLockedTargets |= 1 << i;
+        }
     }
 
-    return eGearValue;
+    if (aobJob.lLockedTargets == aobJob.lRequiredTargets) {
+        return TRUE;
+    }
+
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liScanStart);
+
+    aobJob.dwWorkerCount = (0 != lpTarget->dwWorkerCount)
+        ? min(lpTarget->dwWorkerCount, AOBSCAN_MAX_WORKERS)
+        : GetScanWorkerCount();
+
+    if (!CollectWorkItems(
+        &aobJob,
+        adwTierStates,
+        dwTierCount
+    )) {
+        goto _FINAL;
+    }
+
+    if (!DealWorkItems(&aobJob)) {
+        goto _FINAL;
+    }
+
+    aobJob.aCandidates = VirtualAlloc(
+        NULL,
+        AOBSCAN_MAX_CANDIDATES * sizeof(AOBSCAN_CANDIDATE),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == aobJob.aCandidates) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    InitializeSRWLock(&aobJob.HitQueueLock);
+    InitializeConditionVariable(&aobJob.HitQueueNotFull);
+    aobJob.bVerifierRunning = TRUE;
+
+    for (DWORD i = 0; i < aobJob.dwWorkerCount; ++i) {
+        LPAOBSCAN_WORKER lpWorker = &aobJob.aWorkers[i];
+
+        InitializeSRWLock(&lpWorker->DequeLock);
+        lpWorker->dwWorkerIndex = i;
+        lpWorker->Stream.lpJob = &aobJob;
+
+        lpWorker->Stream.lpBuffer = VirtualAlloc(
+            NULL,
+            AOBSCAN_READ_CHUNK_SIZE + aobJob.cbOverlap,
+            MEM_COMMIT | MEM_RESERVE,
+            PAGE_READWRITE
+        );
+
+        if (NULL == lpWorker->Stream.lpBuffer) {
+            fprintf(
+                stderr,
+                "[-] VirtualAlloc(): E%lu\n",
+                GetLastError()
+            );
+            continue;
+        }
+
+        // Items of a worker that failed to start are stolen by the others
+        lpWorker->hThread = CreateThread(
+            NULL,
+            0,
+            AobScanWorker,
+            lpWorker,
+            0,
+            NULL
+        );
+
+        if (NULL == lpWorker->hThread) {
+            fprintf(
+                stderr,
+                "[-] CreateThread(): E%lu\n",
+                GetLastError()
+            );
+            continue;
+        }
+
+        ahThreads[dwThreadCount++] = lpWorker->hThread;
+    }
+
+    if (0 == dwThreadCount) {
+        if (NULL == aobJob.aWorkers[0].Stream.lpBuffer) {
+            goto _FINAL;
+        }
+
+        // No threads, scan everything on this one, verifying whenever the queue fills
+        aobJob.bVerifierRunning = FALSE;
+        AobScanWorker(&aobJob.aWorkers[0]);
+        bScanComplete = TRUE;
+    }
+
+    // Save cursor position, but don't check for errors
+    if (!lpTarget->bShowProgress || !GetConsoleScreenBufferInfo(
+        g_ShifterConfig.hShifterConsole,
+        &csbi
+    )) {
+        bCursorPositionSaved = FALSE;
+    }
+
+    // This thread is the verification stage, it runs sampling rounds while
+    // the workers scan, until the scan is complete or cancelled because all
+    // targets are verified, and all hits found until then are verified
+    for (;;) {
+        // Hits of a complete scan are all queued by now
+        CONST BOOLEAN bLastHitsQueued = bScanComplete;
+        ULONGLONG qwNextSample = 0;
+
+        CONST DWORD dwPending = VerifyCandidateRound(
+            &aobJob,
+            &qwNextSample
+        );
+
+        if (bLastHitsQueued && 0 == dwPending) {
+            break;
+        }
+
+        // Candidates still sampling are dropped, what is verified stays unpublished
+        if (IsScanAbandoned(lpTarget, qwDeadline)) {
+            lpResult->bAbandoned = TRUE;
+            CancelScanStage(&aobJob);
+
+            if (!bScanComplete) {
+                WaitForMultipleObjects(
+                    dwThreadCount,
+                    ahThreads,
+                    TRUE,
+                    INFINITE
+                );
+            }
+            break;
+        }
+
+        CONST ULONGLONG qwNow = GetTickCount64();
+
+        // New hits are admitted at least every progress interval
+        CONST DWORD dwWaitMs = (DWORD) min(
+            (qwNextSample > qwNow) ? (qwNextSample - qwNow) : 0,
+            AOBSCAN_PROGRESS_INTERVAL_MS
+        );
+
+        if (bScanComplete) {
+            Sleep(dwWaitMs);
+            continue;
+        }
+
+        bScanComplete = (WAIT_TIMEOUT != WaitForMultipleObjects(
+            dwThreadCount,
+            ahThreads,
+            TRUE,
+            dwWaitMs
+        ));
+
+        if (!bCursorPositionSaved) {
+            continue;
+        }
+
+        QueryPerformanceCounter(&liScanEnd);
+
+        // Remaining bytes at the rate so far
+        CONST DWORD64 qwBytesScanned = (DWORD64) aobJob.qwBytesScanned;
+        CONST DOUBLE fElapsed = (DOUBLE) (liScanEnd.QuadPart - liScanStart.QuadPart)
+            / (DOUBLE) liFrequency.QuadPart;
+        CONST DWORD dwEtaSeconds = (0 != qwBytesScanned && aobJob.qwTotalBytes > qwBytesScanned)
+            ? (DWORD) (fElapsed * (DOUBLE) (aobJob.qwTotalBytes - qwBytesScanned) / (DOUBLE) qwBytesScanned)
+            : 0;
+
+        // Restore cursor position
+        SetConsoleCursorPosition(
+            g_ShifterConfig.hShifterConsole,
+            csbi.dwCursorPosition
+        );
+
+        printf(
+            "[*] Scanning memory: %llu / %llu MiB, ETA %3lu s (%lu threads, %lu candidates)\n",
+            qwBytesScanned >> 20,
+            aobJob.qwTotalBytes >> 20,
+            dwEtaSeconds,
+            dwThreadCount,
+            aobJob.dwCandidateCount
+        );
+    }
+
+    QueryPerformanceCounter(&liScanEnd);
+
+    CONST DOUBLE fSeconds = (DOUBLE) (liScanEnd.QuadPart - liScanStart.QuadPart) 
+        / (DOUBLE) liFrequency.QuadPart;
+
+    lpResult->qwBytesScanned += (DWORD64) aobJob.qwBytesScanned;
+    lpResult->fScanSeconds += fSeconds;
+
+    if (lpTarget->bShowProgress) {
+        printf(
+            "[*] Scanned %llu MiB in %.2f s (%.2f GB/s)\n",
+            (DWORD64) aobJob.qwBytesScanned >> 20,
+            fSeconds,
+            (fSeconds > 0.0) ? ((DOUBLE) aobJob.qwBytesScanned / fSeconds / 1e9) : 0.0
+        );
+    }
+
+_FINAL:
+    for (DWORD i = 0; i < aobJob.dwWorkerCount; ++i) {
+        if (NULL != aobJob.aWorkers[i].hThread) {
+            CloseHandle(aobJob.aWorkers[i].hThread);
+        }
+
+        if (NULL != aobJob.aWorkers[i].Stream.lpBuffer) {
+            VirtualFree(
+                aobJob.aWorkers[i].Stream.lpBuffer,
+                0,
+                MEM_RELEASE
+            );
+        }
+    }
+
+    if (NULL != aobJob.aWorkItems) {
+        VirtualFree(
+            aobJob.aWorkItems,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    if (NULL != aobJob.aCandidates) {
+        VirtualFree(
+            aobJob.aCandidates,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    for (DWORD i = 0; i < lpSignaturePack->dwSignatureCount; ++i) {
+        WriteLog(
+            "[*] Signature %lu '%s': %lu hits\n",
+            i,
+            lpSignaturePack->aSignatures[i].szName,
+            lpResult->adwHitCount[i]
+        );
+    }
+
+    return (aobJob.lLockedTargets == aobJob.lRequiredTargets);
+}
+
+/// Adds the gear agreement bonus to the verified artifacts and sorts them by
+/// score. An artifact agrees if its gear value matches the gear value of an
+/// artifact of another target gear, both hold the same gear after a scan.
+STATIC VOID RankArtifacts(
+    LPMEMORY_SOURCE lpSource,
+    LPCSIGNATURE_PACK lpSignaturePack,
+    LPAOBSCAN_RESULT lpResult
+) {
+    DWORD aadwGearValue[TARGET_GEAR_LAST + 1][AOBSCAN_MAX_RANKED_ARTIFACTS];
+    MEMORY_IO aRequests[(TARGET_GEAR_LAST + 1) * AOBSCAN_MAX_RANKED_ARTIFACTS];
+    DWORD dwRequestCount = 0;
+
+    for (DWORD i = 0; i <= TARGET_GEAR_LAST; ++i) {
+        for (DWORD j = 0; j < lpResult->adwRankedCount[i]; ++j) {
+            LPCAOBSCAN_ARTIFACT lpcArtifact = &lpResult->aaRankedArtifacts[i][j];
+
+            aRequests[dwRequestCount++] = (MEMORY_IO) {
+                .lpAddress = (LPCBYTE) lpcArtifact->lpArtifact 
+                    + lpSignaturePack->aSignatures[lpcArtifact->dwSignatureId].lGearOffset,
+                .lpBuffer = &aadwGearValue[i][j],
+                .cbSize = sizeof(DWORD)
+            };
+        }
+    }
+
+    // All gear values in one batch
+    ReadMemoryScatter(
+        lpSource,
+        aRequests,
+        dwRequestCount
+    );
+
+    for (DWORD i = 0; i < dwRequestCount; ++i) {
+        if (aRequests[i].cbSize != aRequests[i].cbTransferred) {
+            *(LPDWORD) aRequests[i].lpBuffer = GEAR_INVALID;
+        }
+    }
+
+    for (DWORD i = 0; i <= TARGET_GEAR_LAST; ++i) {
+        LPAOBSCAN_ARTIFACT aRanked = lpResult->aaRankedArtifacts[i];
+        CONST DWORD dwRankedCount = lpResult->adwRankedCount[i];
+
+        for (DWORD j = 0; j < dwRankedCount; ++j) {
+            BOOLEAN bAgrees = FALSE;
+
+            for (DWORD k = 0; k <= TARGET_GEAR_LAST && !bAgrees; ++k) {
+                if (k == i || GEAR_INVALID == aadwGearValue[i][j]) {
+                    continue;
+                }
+
+                for (DWORD l = 0; l < lpResult->adwRankedCount[k]; ++l) {
+                    if (aadwGearValue[i][j] == aadwGearValue[k][l]) {
+                        bAgrees = TRUE;
+                        break;
+                    }
+                }
+            }
+
+            if (bAgrees) {
+                aRanked[j].dwScore += AOBSCAN_SCORE_GEAR_AGREEMENT;
+            }
+        }
+
+        // Insertion sort, equal scores keep the verification order
+        for (DWORD j = 1; j < dwRankedCount; ++j) {
+            CONST AOBSCAN_ARTIFACT Artifact = aRanked[j];
+            DWORD k = j;
+
+            while (k > 0 && aRanked[k - 1].dwScore < Artifact.dwScore) {
+                aRanked[k] = aRanked[k - 1];
+                k--;
+            }
+
+            aRanked[k] = Artifact;
+        }
+
+        if (0 != dwRankedCount) {
+            lpResult->alpArtifact[i] = aRanked[0].lpArtifact;
+            lpResult->adwSignatureId[i] = aRanked[0].dwSignatureId;
+        }
+
+        for (DWORD j = 0; j < dwRankedCount; ++j) {
+            WriteLog(
+                "[*] Target gear %lu rank %lu: 0x%016llX (score %lu)\n",
+                i,
+                j,
+                (DWORD64) aRanked[j].lpArtifact,
+                aRanked[j].dwScore
+            );
+        }
+    }
+}
+
+BOOLEAN AobScanTarget(
+    LPCAOBSCAN_TARGET lpTarget,
+    LPCSIGNATURE_PACK lpSignaturePack,
+    LPAOBSCAN_RESULT lpResult
+) {
+    // Fresh allocations first, a car swap moves the artifacts there
+    STATIC CONST DWORD adwChangedTiers[] = {
+        REGION_STATE_NEW | REGION_STATE_MODIFIED,
+        REGION_STATE_HIT,
+        REGION_STATE_UNSCANNED
+    };
+
+    STATIC CONST DWORD adwUnchangedTiers[] = {
+        REGION_STATE_UNCHANGED
+    };
+
+    LPREGION_MAP lpRegionMap = lpTarget->lpRegionMap;
+
+    CONST ULONGLONG qwDeadline = (0 != lpTarget->dwTimeoutMs)
+        ? GetTickCount64() + lpTarget->dwTimeoutMs
+        : (ULONGLONG) -1;
+
+    ZeroMemory(
+        lpResult,
+        sizeof(AOBSCAN_RESULT)
+    );
+
+    // New regions can only be found by walking the address space again
+    if (!RefreshRegionMap(
+        lpRegionMap,
+        lpTarget->lpSource
+    )) {
+        fprintf(
+            stderr,
+            "[-] Unable to enumerate %s memory regions.\n",
+            lpTarget->lpSource->szName
+        );
+        return FALSE;
+    }
+
+    if (lpTarget->bShowProgress && 0 != lpRegionMap->cbUnchanged) {
+        printf(
+            "[*] Skipping %llu MiB of memory unchanged since the last scan.\n",
+            (DWORD64) lpRegionMap->cbUnchanged >> 20
+        );
+    }
+
+    BOOLEAN bFound = ScanRegionMap(
+        lpTarget,
+        lpSignaturePack,
+        lpResult,
+        adwChangedTiers,
+        ARRAYSIZE(adwChangedTiers),
+        qwDeadline
+    );
+
+    // Fingerprints only sample a few pages, fall back to the skipped regions
+    if (!bFound && !lpResult->bAbandoned && 0 != lpRegionMap->cbUnchanged) {
+        if (lpTarget->bShowProgress) {
+            printf("[*] Scanning unchanged memory...\n");
+        }
+
+        bFound = ScanRegionMap(
+            lpTarget,
+            lpSignaturePack,
+            lpResult,
+            adwUnchangedTiers,
+            ARRAYSIZE(adwUnchangedTiers),
+            qwDeadline
+        );
+    }
+
+    if (lpResult->bAbandoned) {
+        if (lpTarget->bShowProgress) {
+            fprintf(
+                stderr,
+                "[-] Scan %s.\n",
+                (NULL != lpTarget->lplAbort && 0 != *lpTarget->lplAbort) ? "cancelled" : "timed out"
+            );
+        }
+
+        return FALSE;
+    }
+
+    RankArtifacts(
+        lpTarget->lpSource,
+        lpSignaturePack,
+        lpResult
+    );
+
+    return bFound;
+}
+
+BOOLEAN AobScan(
+    LPCSIGNATURE_PACK lpSignaturePack,
+    LPAOBSCAN_RESULT lpResult
+) {
+    return AobScanAbortable(
+        lpSignaturePack,
+        lpResult,
+        NULL,
+        0
+    );
+}
+
+BOOLEAN AobScanAbortable(
+    LPCSIGNATURE_PACK lpSignaturePack,
+    LPAOBSCAN_RESULT lpResult,
+    CONST VOLATILE LONG *lplAbort,
+    CONST DWORD dwTimeoutMs
+) {
+    CONST AOBSCAN_TARGET aobTarget = {
+        .lpSource = &g_GameMemory,
+        .lpRegionMap = &g_RegionMap,
+        .bShowProgress = TRUE,
+        .lplAbort = lplAbort,
+        .dwTimeoutMs = dwTimeoutMs
+    };
+
+    return AobScanTarget(
+        &aobTarget,
+        lpSignaturePack,
+        lpResult
+    );
+}
+
+BOOLEAN FailoverGearAddress(
+    CONST TARGET_GEAR eTargetGear
+) {
+    CONST DWORD dwIndex = g_ShifterState.adwGearAddressIndex[eTargetGear] + 1;
+
+    if (dwIndex >= g_ShifterState.adwGearAddressCount[eTargetGear]) {
+        return FALSE;
+    }
+
+    LPVOID lpGearAddress = g_ShifterState.aalpGearAddress[eTargetGear][dwIndex];
+
+    g_ShifterState.adwGearAddressIndex[eTargetGear] = dwIndex;
+
+    if (TARGET_GEAR_CURRENT == eTargetGear) {
+        g_ShifterState.lpCurrentGearAddress = lpGearAddress;
+    } else {
+        g_ShifterState.lpLastGearAddress = lpGearAddress;
+    }
+
+    WriteLog(
+        "[*] Failing over target gear %lu to address: 0x%016llX (rank %lu)\n",
+        eTargetGear,
+        (DWORD64) lpGearAddress,
+        dwIndex
+    );
+
+    return TRUE;
+}
+
+SHIFT_GEAR ReadGear(
+    CONST TARGET_GEAR eTargetGear
+) {
+    SHIFT_GEAR eGearValue = 0;
+
+    // A stale address fails over to the next ranked one
+    do {
+        LPCVOID lpTargetAddress = (TARGET_GEAR_CURRENT == eTargetGear) 
+            ? g_ShifterState.lpCurrentGearAddress 
+            : g_ShifterState.lpLastGearAddress;
+
+        if (!ReadMemory(
+            &g_GameMemory,
+            lpTargetAddress,
+            &eGearValue,
+            sizeof(DWORD)
+        )) {
+            fprintf(
+                stderr,
+                "[-] ReadMemory(): E%lu\n",
+                GetLastError()
+            );
+            continue;
+        }
+
+        if (eGearValue <= GEAR_8) {
+            return eGearValue;
+        }
+    } while (FailoverGearAddress(eTargetGear));
+
+    return GEAR_INVALID;
 }
\ No newline at end of file
@@ -0,0 +1,187 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/// @file MemorySource.c
+/// @brief Memory source helpers and the Win32 memory source.
+///
+///  The Win32 source has no vectored primitive, batches are transferred
+///  one ReadProcessMemory()/WriteProcessMemory() call per request.
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+///
+
+#include "MemorySource.h"
+
+GLOBAL MEMORY_SOURCE g_GameMemory = { 0 };
+
+STATIC BOOLEAN Win32EnumRegions(
+    LPMEMORY_SOURCE lpSource,
+    LPCVOID lpMinimumAddress,
+    LPCVOID lpMaximumAddress,
+    LPMEMORY_REGION_CALLBACK lpCallback,
+    LPVOID lpContext
+) {
+    MEMORY_BASIC_INFORMATION memInfo = { 0 };
+    LPCBYTE lpCurrentAddress = (LPCBYTE) lpMinimumAddress;
+
+    while (lpCurrentAddress < (LPCBYTE) lpMaximumAddress) {
+        // Only fails past the end of the user address space
+        if (sizeof(memInfo) != VirtualQueryEx(
+            lpSource->hProcess,
+            lpCurrentAddress,
+            &memInfo,
+            sizeof(MEMORY_BASIC_INFORMATION)
+        )) {
+            break;
+        }
+
+        lpCurrentAddress = (LPCBYTE) memInfo.BaseAddress + memInfo.RegionSize;
+
+        if (!lpCallback(
+            lpContext,
+            &memInfo
+        )) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+STATIC DWORD Win32ReadBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    DWORD dwCompleted = 0;
+
+    for (DWORD i = 0; i < dwRequestCount; ++i) {
+        aRequests[i].cbTransferred = 0;
+
+        if (!ReadProcessMemory(
+            lpSource->hProcess,
+            aRequests[i].lpAddress,
+            aRequests[i].lpBuffer,
+            aRequests[i].cbSize,
+            &aRequests[i].cbTransferred
+        )) {
+            continue;
+        }
+
+        if (aRequests[i].cbSize == aRequests[i].cbTransferred) {
+            dwCompleted++;
+        }
+    }
+
+    return dwCompleted;
+}
+
+STATIC DWORD Win32WriteBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    DWORD dwCompleted = 0;
+
+    for (DWORD i = 0; i < dwRequestCount; ++i) {
+        aRequests[i].cbTransferred = 0;
+
+        if (!WriteProcessMemory(
+            lpSource->hProcess,
+            (LPVOID) aRequests[i].lpAddress,
+            aRequests[i].lpBuffer,
+            aRequests[i].cbSize,
+            &aRequests[i].cbTransferred
+        )) {
+            continue;
+        }
+
+        if (aRequests[i].cbSize == aRequests[i].cbTransferred) {
+            dwCompleted++;
+        }
+    }
+
+    return dwCompleted;
+}
+
+VOID InitWin32MemorySource(
+    LPMEMORY_SOURCE lpSource,
+    HANDLE hProcess
+) {
+    *lpSource = (MEMORY_SOURCE) {
+        .szName = "Win32",
+        .EnumRegions = Win32EnumRegions,
+        .ReadBatch = Win32ReadBatch,
+        .WriteBatch = Win32WriteBatch,
+        .hProcess = hProcess
+    };
+}
+
+BOOLEAN ReadMemory(
+    LPMEMORY_SOURCE lpSource,
+    LPCVOID lpAddress,
+    LPVOID lpBuffer,
+    CONST SIZE_T cbSize
+) {
+    MEMORY_IO memRequest = {
+        .lpAddress = lpAddress,
+        .lpBuffer = lpBuffer,
+        .cbSize = cbSize
+    };
+
+    return (1 == lpSource->ReadBatch(
+        lpSource,
+        &memRequest,
+        1
+    ));
+}
+
+BOOLEAN WriteMemory(
+    LPMEMORY_SOURCE lpSource,
+    LPVOID lpAddress,
+    LPCVOID lpcBuffer,
+    CONST SIZE_T cbSize
+) {
+    MEMORY_IO memRequest = {
+        .lpAddress = lpAddress,
+        .lpBuffer = (LPVOID) lpcBuffer,
+        .cbSize = cbSize
+    };
+
+    return (1 == lpSource->WriteBatch(
+        lpSource,
+        &memRequest,
+        1
+    ));
+}
+
+DWORD ReadMemoryScatter(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    DWORD dwCompleted = 0;
+
+    for (DWORD i = 0; i < dwRequestCount; i += MEMORY_SOURCE_MAX_BATCH) {
+        dwCompleted += lpSource->ReadBatch(
+            lpSource,
+            &aRequests[i],
+            min(dwRequestCount - i, MEMORY_SOURCE_MAX_BATCH)
+        );
+    }
+
+    return dwCompleted;
+}
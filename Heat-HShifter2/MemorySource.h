@@ -0,0 +1,240 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+///
+
+/// @file MemorySource.h
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#ifndef _HEAT_HSHIFTER2_MEMORYSOURCE_H
+#define _HEAT_HSHIFTER2_MEMORYSOURCE_H
+
+#include "Utils.h"
+
+#define MEMORY_SOURCE_MAX_BATCH                 1024                // Requests per ReadBatch/WriteBatch call, IOV_MAX on Linux
+
+/// One transfer of a scatter/gather batch.
+typedef struct _MEMORY_IO {
+    LPCVOID lpAddress;                  // Target address
+    LPVOID lpBuffer;                    // Local buffer
+    SIZE_T cbSize;
+    SIZE_T cbTransferred;               // Set by the source, cbSize if the transfer completed
+} MEMORY_IO, *LPMEMORY_IO;
+
+/// Receives each enumerated region, return FALSE to stop the enumeration.
+typedef BOOLEAN (*LPMEMORY_REGION_CALLBACK)(
+    LPVOID lpContext,
+    CONST MEMORY_BASIC_INFORMATION *lpMemInfo
+);
+
+typedef struct _MEMORY_SOURCE MEMORY_SOURCE, *LPMEMORY_SOURCE;
+
+/// Access to the memory of the target process.
+/// All target reads and writes go through a source, so the scan engine
+/// doesn't depend on how the target is reached.
+struct _MEMORY_SOURCE {
+    LPCSTR szName;
+
+    /// Reports the committed regions between lpMinimumAddress and lpMaximumAddress
+    /// in address order. Sources may report reserved and free regions as well,
+    /// callers skip every region that isn't MEM_COMMIT.
+    BOOLEAN (*EnumRegions)(
+        LPMEMORY_SOURCE lpSource,
+        LPCVOID lpMinimumAddress,
+        LPCVOID lpMaximumAddress,
+        LPMEMORY_REGION_CALLBACK lpCallback,
+        LPVOID lpContext
+    );
+
+    /// Transfer up to MEMORY_SOURCE_MAX_BATCH requests and return the number of completed ones
+    DWORD (*ReadBatch)(
+        LPMEMORY_SOURCE lpSource,
+        LPMEMORY_IO aRequests,
+        CONST DWORD dwRequestCount
+    );
+
+    DWORD (*WriteBatch)(
+        LPMEMORY_SOURCE lpSource,
+        LPMEMORY_IO aRequests,
+        CONST DWORD dwRequestCount
+    );
+
+    /// Optional, returns a local pointer to [lpAddress, lpAddress + cbSize)
+    /// if the source holds the range contiguously, NULL otherwise.
+    /// Lets the scan search the source directly instead of reading a copy.
+    LPCVOID (*MapRange)(
+        LPMEMORY_SOURCE lpSource,
+        LPCVOID lpAddress,
+        CONST SIZE_T cbSize
+    );
+
+    BOOLEAN bSnapshot;                  // Memory never changes, there is no live memory to sample
+    BOOLEAN bFastReplay;                // Recorded memory, live samples are taken without waiting
+
+    HANDLE hProcess;                    // Win32 source
+    DWORD dwProcessId;                  // Linux source, host process ID
+    LPVOID lpContext;                   // Dump, recording and replay sources
+};
+
+EXTERN_C GLOBAL MEMORY_SOURCE g_GameMemory;
+
+/// <summary>
+///  Sets up a source that uses VirtualQueryEx(), ReadProcessMemory() and WriteProcessMemory().
+/// </summary>
+/// <param name="lpSource"></param>
+/// <param name="hProcess">Needs PROCESS_VM_READ, PROCESS_VM_WRITE and PROCESS_QUERY_INFORMATION access.</param>
+VOID InitWin32MemorySource(
+    LPMEMORY_SOURCE lpSource,
+    HANDLE hProcess
+);
+
+#ifdef __linux__
+/// <summary>
+///  Sets up a source that uses /proc/[pid]/maps, process_vm_readv() and process_vm_writev().
+///  For Winelib builds reaching a game running under Wine or Proton.
+/// </summary>
+/// <param name="lpSource"></param>
+/// <param name="dwProcessId">Host process ID of the game.</param>
+/// <returns>
+///  TRUE if the process maps are readable, FALSE otherwise.
+/// </returns>
+BOOLEAN InitLinuxMemorySource(
+    LPMEMORY_SOURCE lpSource,
+    DWORD dwProcessId
+);
+#endif // __linux__
+
+/// <summary>
+///  Sets up a read-only snapshot source over a memory dump file, which is
+///  mapped into memory and searched in place.
+///  Accepts minidumps (memory lists of full memory dumps) and region dumps (RegionDump.h),
+///  the blocks of compressed region dumps are expanded into memory first, their zero pages aren't.
+/// </summary>
+/// <param name="lpSource"></param>
+/// <param name="szDumpPath"></param>
+/// <returns>
+///  TRUE if the dump was mapped and holds at least one region, FALSE otherwise.
+/// </returns>
+BOOLEAN InitDumpMemorySource(
+    LPMEMORY_SOURCE lpSource,
+    LPCSTR szDumpPath
+);
+
+/// <summary>
+///  Unmaps the dump of a source set up by InitDumpMemorySource().
+/// </summary>
+/// <param name="lpSource"></param>
+VOID CloseDumpMemorySource(
+    LPMEMORY_SOURCE lpSource
+);
+
+/// <summary>
+///  Wraps a source in place, every region query, read and write is forwarded
+///  to it and appended to a memory trace (MemoryTrace.h) with its answer.
+/// </summary>
+/// <param name="lpSource">Source to record, replaced by the recording source.</param>
+/// <param name="szTracePath"></param>
+/// <returns>
+///  TRUE if the trace was created, FALSE otherwise, lpSource is left as it was.
+/// </returns>
+BOOLEAN InitRecordingMemorySource(
+    LPMEMORY_SOURCE lpSource,
+    LPCSTR szTracePath
+);
+
+/// <summary>
+///  Completes the trace of a source set up by InitRecordingMemorySource()
+///  and puts the recorded source back in its place.
+/// </summary>
+/// <param name="lpSource"></param>
+VOID CloseRecordingMemorySource(
+    LPMEMORY_SOURCE lpSource
+);
+
+/// <summary>
+///  Sets up a source that answers from a memory trace, each request gets the
+///  answers recorded for the same address and size, in recording order.
+/// </summary>
+/// <param name="lpSource"></param>
+/// <param name="szTracePath"></param>
+/// <param name="bRealTime">Give answers no earlier than they were given in the recording, full speed otherwise.</param>
+/// <returns>
+///  TRUE if the trace was mapped and is intact, FALSE otherwise.
+/// </returns>
+BOOLEAN InitReplayMemorySource(
+    LPMEMORY_SOURCE lpSource,
+    LPCSTR szTracePath,
+    CONST BOOLEAN bRealTime
+);
+
+/// <summary>
+///  Unmaps the trace of a source set up by InitReplayMemorySource(),
+///  reporting requests the trace had no answer for.
+/// </summary>
+/// <param name="lpSource"></param>
+VOID CloseReplayMemorySource(
+    LPMEMORY_SOURCE lpSource
+);
+
+/// <summary>
+///  Reads a single block of target memory.
+/// </summary>
+/// <param name="lpSource"></param>
+/// <param name="lpAddress"></param>
+/// <param name="lpBuffer"></param>
+/// <param name="cbSize"></param>
+/// <returns>
+///  TRUE if all cbSize bytes were read, FALSE otherwise.
+/// </returns>
+BOOLEAN ReadMemory(
+    LPMEMORY_SOURCE lpSource,
+    LPCVOID lpAddress,
+    LPVOID lpBuffer,
+    CONST SIZE_T cbSize
+);
+
+/// <summary>
+///  Writes a single block of target memory.
+/// </summary>
+/// <param name="lpSource"></param>
+/// <param name="lpAddress"></param>
+/// <param name="lpcBuffer"></param>
+/// <param name="cbSize"></param>
+/// <returns>
+///  TRUE if all cbSize bytes were written, FALSE otherwise.
+/// </returns>
+BOOLEAN WriteMemory(
+    LPMEMORY_SOURCE lpSource,
+    LPVOID lpAddress,
+    LPCVOID lpcBuffer,
+    CONST SIZE_T cbSize
+);
+
+/// <summary>
+///  Reads any number of blocks, split into batches of MEMORY_SOURCE_MAX_BATCH.
+/// </summary>
+/// <param name="lpSource"></param>
+/// <param name="aRequests"></param>
+/// <param name="dwRequestCount"></param>
+/// <returns>
+///  Number of requests that were read completely.
+/// </returns>
+DWORD ReadMemoryScatter(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+);
+
+#endif // _HEAT_HSHIFTER2_MEMORYSOURCE_H
@@ -0,0 +1,1046 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/// @file MemorySourceDump.c
+/// @brief Memory source over a memory dump file, for offline scans.
+///
+///  The dump is mapped read-only and its memory ranges are translated into a
+///  sorted region table pointing into the view. Ranges that are contiguous in
+///  both the address space and the file are handed to the scan in place, so
+///  the pattern search runs on the page cache without copying.
+///
+///  Compressed region dumps get an address range reserved for all regions,
+///  in address order. Only the pages their blocks hold are committed and
+///  expanded, the all-zero pages in between cost neither memory nor commit
+///  charge and read as zero. Ranges without such pages are searched in place.
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+///
+
+#include "MemorySource.h"
+#include "RegionDump.h"
+
+#include <DbgHelp.h>
+#include <compressapi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#pragma comment (lib, "Cabinet.lib")
+
+/// Captured memory range, lpData points into the view or the expanded regions.
+typedef struct _DUMP_REGION {
+    LPCBYTE lpBaseAddress;
+    SIZE_T cbSize;
+    LPCBYTE lpData;
+    DWORD dwProtect;
+    DWORD dwType;
+} DUMP_REGION, *LPDUMP_REGION;
+
+typedef CONST DUMP_REGION *LPCDUMP_REGION;
+
+typedef struct _DUMP_CONTEXT {
+    HANDLE hFile;
+    HANDLE hMapping;
+    LPCBYTE lpView;
+    DWORD64 cbFile;
+
+    LPDUMP_REGION aRegions;
+    SIZE_T qwRegionCount;
+
+    LPBYTE lpExpanded;                  // Contents of compressed region dumps, committed where a block is
+    LPCREGION_DUMP_BLOCK aBlocks;       // Block table of compressed region dumps, in the view
+    DWORD64 qwBlockCount;
+} DUMP_CONTEXT, *LPDUMP_CONTEXT;
+
+/// Returns a pointer to [qwOffset, qwOffset + cbSize) of the file, or NULL if it's out of bounds.
+STATIC LPCBYTE GetDumpData(
+    LPDUMP_CONTEXT lpContext,
+    CONST DWORD64 qwOffset,
+    CONST DWORD64 cbSize
+) {
+    if (qwOffset > lpContext->cbFile || cbSize > lpContext->cbFile - qwOffset) {
+        return NULL;
+    }
+
+    return lpContext->lpView + qwOffset;
+}
+
+/// Index of the region holding lpAddress, qwRegionCount if there is none.
+STATIC SIZE_T FindDumpRegion(
+    LPDUMP_CONTEXT lpContext,
+    LPCBYTE lpAddress
+) {
+    SIZE_T qwLow = 0;
+    SIZE_T qwHigh = lpContext->qwRegionCount;
+
+    // First region starting past lpAddress
+    while (qwLow < qwHigh) {
+        CONST SIZE_T qwMiddle = qwLow + (qwHigh - qwLow) / 2;
+
+        if (lpContext->aRegions[qwMiddle].lpBaseAddress <= lpAddress) {
+            qwLow = qwMiddle + 1;
+        } else {
+            qwHigh = qwMiddle;
+        }
+    }
+
+    if (0 == qwLow) {
+        return lpContext->qwRegionCount;
+    }
+
+    LPCDUMP_REGION lpRegion = &lpContext->aRegions[qwLow - 1];
+    if (lpAddress >= lpRegion->lpBaseAddress + lpRegion->cbSize) {
+        return lpContext->qwRegionCount;
+    }
+
+    return qwLow - 1;
+}
+
+/// Length of the span at lpAddress, up to cbSize, whose pages are either all
+/// expanded from blocks (*lpbBacked TRUE) or all zero pages without a block.
+/// Every page is backed in dumps that aren't compressed.
+STATIC SIZE_T GetBackedSpan(
+    LPDUMP_CONTEXT lpContext,
+    LPCBYTE lpAddress,
+    CONST SIZE_T cbSize,
+    LPBOOLEAN lpbBacked
+) {
+    CONST DWORD64 qwAddress = (DWORD64) lpAddress;
+    CONST DWORD64 qwEnd = qwAddress + cbSize;
+    DWORD64 qwLow = 0;
+    DWORD64 qwHigh = lpContext->qwBlockCount;
+
+    *lpbBacked = TRUE;
+
+    if (NULL == lpContext->aBlocks) {
+        return cbSize;
+    }
+
+    // First block starting past lpAddress
+    while (qwLow < qwHigh) {
+        CONST DWORD64 qwMiddle = qwLow + (qwHigh - qwLow) / 2;
+
+        if (lpContext->aBlocks[qwMiddle].qwAddress <= qwAddress) {
+            qwLow = qwMiddle + 1;
+        } else {
+            qwHigh = qwMiddle;
+        }
+    }
+
+    DWORD64 qwSpanEnd = (0 != qwLow)
+        ? lpContext->aBlocks[qwLow - 1].qwAddress + lpContext->aBlocks[qwLow - 1].cbSize
+        : 0;
+
+    if (qwSpanEnd <= qwAddress) {
+        *lpbBacked = FALSE;
+
+        return (qwLow < lpContext->qwBlockCount)
+            ? (SIZE_T) (min(lpContext->aBlocks[qwLow].qwAddress, qwEnd) - qwAddress)
+            : cbSize;
+    }
+
+    // Adjacent blocks make up one span
+    for (
+        DWORD64 i = qwLow;
+        i < lpContext->qwBlockCount && qwSpanEnd < qwEnd && qwSpanEnd == lpContext->aBlocks[i].qwAddress;
+        ++i
+    ) {
+        qwSpanEnd += lpContext->aBlocks[i].cbSize;
+    }
+
+    return (SIZE_T) (min(qwSpanEnd, qwEnd) - qwAddress);
+}
+
+STATIC INT CompareDumpRegions(
+    CONST VOID *lpFirst,
+    CONST VOID *lpSecond
+) {
+    LPCBYTE lpFirstBase = ((LPCDUMP_REGION) lpFirst)->lpBaseAddress;
+    LPCBYTE lpSecondBase = ((LPCDUMP_REGION) lpSecond)->lpBaseAddress;
+
+    return (lpFirstBase > lpSecondBase) - (lpFirstBase < lpSecondBase);
+}
+
+STATIC BOOLEAN AllocateDumpRegions(
+    LPDUMP_CONTEXT lpContext,
+    CONST DWORD64 qwRegionCount
+) {
+    // Every region takes at least a descriptor in the file
+    if (0 == qwRegionCount || qwRegionCount > lpContext->cbFile / sizeof(MINIDUMP_MEMORY_DESCRIPTOR64)) {
+        return FALSE;
+    }
+
+    lpContext->aRegions = VirtualAlloc(
+        NULL,
+        (SIZE_T) qwRegionCount * sizeof(DUMP_REGION),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpContext->aRegions) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/// Looks up the protection and type of a range in the memory info list of a minidump,
+/// which is sorted by address. Dumps without one are treated as plain read/write heap memory.
+STATIC VOID GetMinidumpRangeInfo(
+    CONST MINIDUMP_MEMORY_INFO_LIST *lpInfoList,
+    DWORD64 qwAddress,
+    LPDUMP_REGION lpRegion
+) {
+    lpRegion->dwProtect = PAGE_READWRITE;
+    lpRegion->dwType = MEM_PRIVATE;
+
+    if (NULL == lpInfoList) {
+        return;
+    }
+
+    LPCBYTE lpEntries = (LPCBYTE) lpInfoList + lpInfoList->SizeOfHeader;
+    ULONG64 qwLow = 0;
+    ULONG64 qwHigh = lpInfoList->NumberOfEntries;
+
+    while (qwLow < qwHigh) {
+        CONST ULONG64 qwMiddle = qwLow + (qwHigh - qwLow) / 2;
+        CONST MINIDUMP_MEMORY_INFO *lpInfo = (CONST MINIDUMP_MEMORY_INFO *) (
+            lpEntries + qwMiddle * lpInfoList->SizeOfEntry
+        );
+
+        if (qwAddress < lpInfo->BaseAddress) {
+            qwHigh = qwMiddle;
+        } else if (qwAddress >= lpInfo->BaseAddress + lpInfo->RegionSize) {
+            qwLow = qwMiddle + 1;
+        } else {
+            lpRegion->dwProtect = lpInfo->Protect;
+            lpRegion->dwType = lpInfo->Type;
+            return;
+        }
+    }
+}
+
+STATIC BOOLEAN ParseMinidump(
+    LPDUMP_CONTEXT lpContext
+) {
+    CONST MINIDUMP_HEADER *lpHeader = (CONST MINIDUMP_HEADER *) GetDumpData(
+        lpContext,
+        0,
+        sizeof(MINIDUMP_HEADER)
+    );
+
+    CONST MINIDUMP_DIRECTORY *aDirectory = (CONST MINIDUMP_DIRECTORY *) GetDumpData(
+        lpContext,
+        lpHeader->StreamDirectoryRva,
+        (DWORD64) lpHeader->NumberOfStreams * sizeof(MINIDUMP_DIRECTORY)
+    );
+
+    if (NULL == aDirectory) {
+        return FALSE;
+    }
+
+    CONST MINIDUMP_MEMORY64_LIST *lpMemory64List = NULL;
+    CONST MINIDUMP_MEMORY_LIST *lpMemoryList = NULL;
+    CONST MINIDUMP_MEMORY_INFO_LIST *lpInfoList = NULL;
+
+    for (ULONG i = 0; i < lpHeader->NumberOfStreams; ++i) {
+        CONST LPCBYTE lpStream = GetDumpData(
+            lpContext,
+            aDirectory[i].Location.Rva,
+            aDirectory[i].Location.DataSize
+        );
+
+        if (NULL == lpStream) {
+            continue;
+        }
+
+        switch (aDirectory[i].StreamType) {
+            case Memory64ListStream:
+                if (aDirectory[i].Location.DataSize >= sizeof(MINIDUMP_MEMORY64_LIST)) {
+                    lpMemory64List = (CONST MINIDUMP_MEMORY64_LIST *) lpStream;
+                }
+                break;
+
+            case MemoryListStream:
+                if (aDirectory[i].Location.DataSize >= sizeof(MINIDUMP_MEMORY_LIST)) {
+                    lpMemoryList = (CONST MINIDUMP_MEMORY_LIST *) lpStream;
+                }
+                break;
+
+            case MemoryInfoListStream:
+                if (aDirectory[i].Location.DataSize >= sizeof(MINIDUMP_MEMORY_INFO_LIST)) {
+                    lpInfoList = (CONST MINIDUMP_MEMORY_INFO_LIST *) lpStream;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (NULL != lpInfoList && (
+        lpInfoList->SizeOfEntry < sizeof(MINIDUMP_MEMORY_INFO)
+        || lpInfoList->NumberOfEntries > lpContext->cbFile / lpInfoList->SizeOfEntry
+        || NULL == GetDumpData(
+            lpContext,
+            (DWORD64) ((LPCBYTE) lpInfoList - lpContext->lpView) + lpInfoList->SizeOfHeader,
+            lpInfoList->NumberOfEntries * lpInfoList->SizeOfEntry
+        )
+    )) {
+        lpInfoList = NULL;
+    }
+
+    // Full memory dumps store all ranges back to back from BaseRva
+    if (NULL != lpMemory64List) {
+        if (!AllocateDumpRegions(
+            lpContext,
+            lpMemory64List->NumberOfMemoryRanges
+        ) || NULL == GetDumpData(
+            lpContext,
+            (DWORD64) ((LPCBYTE) lpMemory64List - lpContext->lpView),
+            sizeof(MINIDUMP_MEMORY64_LIST)
+                + lpMemory64List->NumberOfMemoryRanges * sizeof(MINIDUMP_MEMORY_DESCRIPTOR64)
+        )) {
+            return FALSE;
+        }
+
+        DWORD64 qwDataOffset = lpMemory64List->BaseRva;
+
+        for (ULONG64 i = 0; i < lpMemory64List->NumberOfMemoryRanges; ++i) {
+            CONST MINIDUMP_MEMORY_DESCRIPTOR64 *lpRange = &lpMemory64List->MemoryRanges[i];
+            LPDUMP_REGION lpRegion = &lpContext->aRegions[lpContext->qwRegionCount];
+
+            lpRegion->lpData = GetDumpData(
+                lpContext,
+                qwDataOffset,
+                lpRange->DataSize
+            );
+
+            qwDataOffset += lpRange->DataSize;
+
+            if (NULL == lpRegion->lpData || 0 == lpRange->DataSize) {
+                continue;
+            }
+
+            lpRegion->lpBaseAddress = (LPCBYTE) lpRange->StartOfMemoryRange;
+            lpRegion->cbSize = (SIZE_T) lpRange->DataSize;
+
+            GetMinidumpRangeInfo(
+                lpInfoList,
+                lpRange->StartOfMemoryRange,
+                lpRegion
+            );
+
+            lpContext->qwRegionCount++;
+        }
+
+        return TRUE;
+    }
+
+    if (NULL != lpMemoryList) {
+        if (!AllocateDumpRegions(
+            lpContext,
+            lpMemoryList->NumberOfMemoryRanges
+        ) || NULL == GetDumpData(
+            lpContext,
+            (DWORD64) ((LPCBYTE) lpMemoryList - lpContext->lpView),
+            sizeof(MINIDUMP_MEMORY_LIST)
+                + (DWORD64) lpMemoryList->NumberOfMemoryRanges * sizeof(MINIDUMP_MEMORY_DESCRIPTOR)
+        )) {
+            return FALSE;
+        }
+
+        for (ULONG i = 0; i < lpMemoryList->NumberOfMemoryRanges; ++i) {
+            CONST MINIDUMP_MEMORY_DESCRIPTOR *lpRange = &lpMemoryList->MemoryRanges[i];
+            LPDUMP_REGION lpRegion = &lpContext->aRegions[lpContext->qwRegionCount];
+
+            lpRegion->lpData = GetDumpData(
+                lpContext,
+                lpRange->Memory.Rva,
+                lpRange->Memory.DataSize
+            );
+
+            if (NULL == lpRegion->lpData || 0 == lpRange->Memory.DataSize) {
+                continue;
+            }
+
+            lpRegion->lpBaseAddress = (LPCBYTE) lpRange->StartOfMemoryRange;
+            lpRegion->cbSize = lpRange->Memory.DataSize;
+
+            GetMinidumpRangeInfo(
+                lpInfoList,
+                lpRange->StartOfMemoryRange,
+                lpRegion
+            );
+
+            lpContext->qwRegionCount++;
+        }
+
+        return TRUE;
+    }
+
+    fprintf(
+        stderr,
+        "[-] Minidump holds no process memory, capture a full memory dump.\n"
+    );
+
+    return FALSE;
+}
+
+STATIC BOOLEAN ParseRawRegionDump(
+    LPDUMP_CONTEXT lpContext,
+    LPCREGION_DUMP_HEADER lpHeader,
+    LPCREGION_DUMP_ENTRY aEntries
+) {
+    for (DWORD i = 0; i < lpHeader->dwRegionCount; ++i) {
+        LPDUMP_REGION lpRegion = &lpContext->aRegions[lpContext->qwRegionCount];
+
+        lpRegion->lpData = GetDumpData(
+            lpContext,
+            aEntries[i].qwFileOffset,
+            aEntries[i].qwSize
+        );
+
+        if (NULL == lpRegion->lpData || 0 == aEntries[i].qwSize) {
+            continue;
+        }
+
+        lpRegion->lpBaseAddress = (LPCBYTE) aEntries[i].qwBaseAddress;
+        lpRegion->cbSize = (SIZE_T) aEntries[i].qwSize;
+        lpRegion->dwProtect = aEntries[i].dwProtect;
+        lpRegion->dwType = aEntries[i].dwType;
+
+        lpContext->qwRegionCount++;
+    }
+
+    return TRUE;
+}
+
+/// Reserves the address range of a compressed region dump and expands its
+/// blocks into it, only the pages of a block are committed.
+STATIC BOOLEAN ParseBlockRegionDump(
+    LPDUMP_CONTEXT lpContext,
+    LPCREGION_DUMP_HEADER lpHeader,
+    LPCREGION_DUMP_ENTRY aEntries
+) {
+    DECOMPRESSOR_HANDLE hDecompressor = NULL;
+    DWORD64 cbExpanded = 0;
+    BOOLEAN bRet = FALSE;
+
+    // Every block takes at least a table entry in the file
+    LPCREGION_DUMP_BLOCK aBlocks = (lpHeader->qwBlockCount > lpContext->cbFile / sizeof(REGION_DUMP_BLOCK))
+        ? NULL
+        : (LPCREGION_DUMP_BLOCK) GetDumpData(
+            lpContext,
+            lpHeader->qwBlockTableOffset,
+            lpHeader->qwBlockCount * sizeof(REGION_DUMP_BLOCK)
+        );
+
+    if (NULL == aBlocks) {
+        return FALSE;
+    }
+
+    for (DWORD i = 0; i < lpHeader->dwRegionCount; ++i) {
+        if (aEntries[i].qwSize > MAXSIZE_T - cbExpanded) {
+            return FALSE;
+        }
+
+        cbExpanded += aEntries[i].qwSize;
+    }
+
+    if (0 == cbExpanded) {
+        return TRUE;
+    }
+
+    // Committing it all would charge the zero pages against the commit limit
+    lpContext->lpExpanded = VirtualAlloc(
+        NULL,
+        (SIZE_T) cbExpanded,
+        MEM_RESERVE,
+        PAGE_NOACCESS
+    );
+
+    if (NULL == lpContext->lpExpanded) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    LPBYTE lpData = lpContext->lpExpanded;
+
+    for (DWORD i = 0; i < lpHeader->dwRegionCount; ++i) {
+        LPDUMP_REGION lpRegion = &lpContext->aRegions[lpContext->qwRegionCount];
+
+        if (0 == aEntries[i].qwSize) {
+            continue;
+        }
+
+        lpRegion->lpBaseAddress = (LPCBYTE) aEntries[i].qwBaseAddress;
+        lpRegion->cbSize = (SIZE_T) aEntries[i].qwSize;
+        lpRegion->lpData = lpData;
+        lpRegion->dwProtect = aEntries[i].dwProtect;
+        lpRegion->dwType = aEntries[i].dwType;
+
+        lpData += lpRegion->cbSize;
+        lpContext->qwRegionCount++;
+    }
+
+    // Blocks are located by address
+    qsort(
+        lpContext->aRegions,
+        lpContext->qwRegionCount,
+        sizeof(DUMP_REGION),
+        CompareDumpRegions
+    );
+
+    if (REGION_DUMP_COMPRESSION_XPRESS_HUFF == lpHeader->dwCompression && !CreateDecompressor(
+        COMPRESS_ALGORITHM_XPRESS_HUFF | COMPRESS_RAW,
+        NULL,
+        &hDecompressor
+    )) {
+        fprintf(
+            stderr,
+            "[-] CreateDecompressor(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    for (DWORD64 i = 0; i < lpHeader->qwBlockCount; ++i) {
+        LPCREGION_DUMP_BLOCK lpBlock = &aBlocks[i];
+        LPCBYTE lpAddress = (LPCBYTE) lpBlock->qwAddress;
+        SIZE_T cbExpandedBlock = 0;
+
+        // Zero pages are told apart by looking blocks up by address
+        if (0 != i && lpBlock->qwAddress < aBlocks[i - 1].qwAddress + aBlocks[i - 1].cbSize) {
+            goto _FINAL;
+        }
+
+        CONST SIZE_T qwIndex = FindDumpRegion(
+            lpContext,
+            lpAddress
+        );
+
+        if (qwIndex == lpContext->qwRegionCount) {
+            goto _FINAL;
+        }
+
+        LPCDUMP_REGION lpRegion = &lpContext->aRegions[qwIndex];
+        CONST SIZE_T cbOffset = (SIZE_T) (lpAddress - lpRegion->lpBaseAddress);
+
+        LPCBYTE lpStored = GetDumpData(
+            lpContext,
+            lpBlock->qwFileOffset,
+            lpBlock->cbStored
+        );
+
+        if (
+            NULL == lpStored
+            || 0 == lpBlock->cbSize
+            || lpBlock->cbSize > REGION_DUMP_BLOCK_SIZE
+            || lpBlock->cbStored > lpBlock->cbSize
+            || lpBlock->cbSize > lpRegion->cbSize - cbOffset
+        ) {
+            goto _FINAL;
+        }
+
+        LPBYTE lpDestination = (LPBYTE) lpRegion->lpData + cbOffset;
+
+        if (NULL == VirtualAlloc(
+            lpDestination,
+            lpBlock->cbSize,
+            MEM_COMMIT,
+            PAGE_READWRITE
+        )) {
+            fprintf(
+                stderr,
+                "[-] VirtualAlloc(): E%lu\n",
+                GetLastError()
+            );
+            goto _FINAL;
+        }
+
+        if (lpBlock->cbStored == lpBlock->cbSize) {
+            memcpy(
+                lpDestination,
+                lpStored,
+                lpBlock->cbSize
+            );
+            continue;
+        }
+
+        if (NULL == hDecompressor || !Decompress(
+            hDecompressor,
+            lpStored,
+            lpBlock->cbStored,
+            lpDestination,
+            lpBlock->cbSize,
+            &cbExpandedBlock
+        ) || cbExpandedBlock != lpBlock->cbSize) {
+            fprintf(
+                stderr,
+                "[-] Unable to expand block at 0x%llX.\n",
+                lpBlock->qwAddress
+            );
+            goto _FINAL;
+        }
+    }
+
+    lpContext->aBlocks = aBlocks;
+    lpContext->qwBlockCount = lpHeader->qwBlockCount;
+    bRet = TRUE;
+
+_FINAL:
+    if (NULL != hDecompressor) {
+        CloseDecompressor(hDecompressor);
+    }
+
+    if (!bRet) {
+        fprintf(
+            stderr,
+            "[-] Region dump block table is corrupt.\n"
+        );
+    }
+
+    return bRet;
+}
+
+STATIC BOOLEAN ParseRegionDump(
+    LPDUMP_CONTEXT lpContext
+) {
+    LPCREGION_DUMP_HEADER lpHeader = (LPCREGION_DUMP_HEADER) lpContext->lpView;
+
+    if (
+        REGION_DUMP_VERSION_RAW != lpHeader->dwVersion
+        && REGION_DUMP_VERSION_BLOCKS != lpHeader->dwVersion
+    ) {
+        fprintf(
+            stderr,
+            "[-] Unsupported region dump version: %lu\n",
+            lpHeader->dwVersion
+        );
+        return FALSE;
+    }
+
+    LPCREGION_DUMP_ENTRY aEntries = (LPCREGION_DUMP_ENTRY) GetDumpData(
+        lpContext,
+        lpHeader->qwRegionTableOffset,
+        (DWORD64) lpHeader->dwRegionCount * sizeof(REGION_DUMP_ENTRY)
+    );
+
+    if (!AllocateDumpRegions(
+        lpContext,
+        lpHeader->dwRegionCount
+    ) || NULL == aEntries) {
+        return FALSE;
+    }
+
+    return (REGION_DUMP_VERSION_RAW == lpHeader->dwVersion)
+        ? ParseRawRegionDump(lpContext, lpHeader, aEntries)
+        : ParseBlockRegionDump(lpContext, lpHeader, aEntries);
+}
+
+STATIC BOOLEAN DumpEnumRegions(
+    LPMEMORY_SOURCE lpSource,
+    LPCVOID lpMinimumAddress,
+    LPCVOID lpMaximumAddress,
+    LPMEMORY_REGION_CALLBACK lpCallback,
+    LPVOID lpCallbackContext
+) {
+    LPDUMP_CONTEXT lpContext = (LPDUMP_CONTEXT) lpSource->lpContext;
+
+    for (SIZE_T i = 0; i < lpContext->qwRegionCount; ++i) {
+        LPCDUMP_REGION lpRegion = &lpContext->aRegions[i];
+
+        // Clip to the requested range
+        LPCBYTE lpStart = max(lpRegion->lpBaseAddress, (LPCBYTE) lpMinimumAddress);
+        LPCBYTE lpEnd = min(lpRegion->lpBaseAddress + lpRegion->cbSize, (LPCBYTE) lpMaximumAddress);
+
+        if (lpStart >= lpEnd) {
+            continue;
+        }
+
+        MEMORY_BASIC_INFORMATION memInfo = {
+            .BaseAddress = (PVOID) lpStart,
+            .AllocationBase = (PVOID) lpRegion->lpBaseAddress,
+            .RegionSize = (SIZE_T) (lpEnd - lpStart),
+            .State = MEM_COMMIT,
+            .Protect = lpRegion->dwProtect,
+            .Type = lpRegion->dwType
+        };
+
+        if (!lpCallback(
+            lpCallbackContext,
+            &memInfo
+        )) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+STATIC DWORD DumpReadBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    LPDUMP_CONTEXT lpContext = (LPDUMP_CONTEXT) lpSource->lpContext;
+    DWORD dwCompleted = 0;
+
+    for (DWORD i = 0; i < dwRequestCount; ++i) {
+        LPMEMORY_IO lpRequest = &aRequests[i];
+        LPCBYTE lpAddress = (LPCBYTE) lpRequest->lpAddress;
+
+        lpRequest->cbTransferred = 0;
+
+        // Copy across regions as long as they are contiguous in the address space
+        for (
+            SIZE_T qwIndex = FindDumpRegion(lpContext, lpAddress);
+            qwIndex < lpContext->qwRegionCount && lpRequest->cbTransferred < lpRequest->cbSize;
+            ++qwIndex
+        ) {
+            LPCDUMP_REGION lpRegion = &lpContext->aRegions[qwIndex];
+
+            if (lpAddress < lpRegion->lpBaseAddress) {
+                break;
+            }
+
+            CONST SIZE_T cbOffset = (SIZE_T) (lpAddress - lpRegion->lpBaseAddress);
+            CONST SIZE_T cbCopy = min(
+                lpRegion->cbSize - cbOffset,
+                lpRequest->cbSize - lpRequest->cbTransferred
+            );
+
+            // Zero pages of compressed region dumps aren't committed
+            for (SIZE_T cbCopied = 0; cbCopied < cbCopy; ) {
+                BOOLEAN bBacked;
+                LPBYTE lpDestination = (LPBYTE) lpRequest->lpBuffer + lpRequest->cbTransferred + cbCopied;
+
+                CONST SIZE_T cbSpan = GetBackedSpan(
+                    lpContext,
+                    lpAddress + cbCopied,
+                    cbCopy - cbCopied,
+                    &bBacked
+                );
+
+                if (bBacked) {
+                    memcpy(
+                        lpDestination,
+                        lpRegion->lpData + cbOffset + cbCopied,
+                        cbSpan
+                    );
+                } else {
+                    ZeroMemory(
+                        lpDestination,
+                        cbSpan
+                    );
+                }
+
+                cbCopied += cbSpan;
+            }
+
+            lpRequest->cbTransferred += cbCopy;
+            lpAddress += cbCopy;
+        }
+
+        if (lpRequest->cbSize == lpRequest->cbTransferred) {
+            dwCompleted++;
+        } else {
+            SetLastError(ERROR_PARTIAL_COPY);
+        }
+    }
+
+    return dwCompleted;
+}
+
+STATIC DWORD DumpWriteBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    UNREFERENCED_PARAMETER(lpSource);
+
+    for (DWORD i = 0; i < dwRequestCount; ++i) {
+        aRequests[i].cbTransferred = 0;
+    }
+
+    SetLastError(ERROR_ACCESS_DENIED);
+    return 0;
+}
+
+STATIC LPCVOID DumpMapRange(
+    LPMEMORY_SOURCE lpSource,
+    LPCVOID lpAddress,
+    CONST SIZE_T cbSize
+) {
+    LPDUMP_CONTEXT lpContext = (LPDUMP_CONTEXT) lpSource->lpContext;
+
+    SIZE_T qwIndex = FindDumpRegion(
+        lpContext,
+        (LPCBYTE) lpAddress
+    );
+
+    if (qwIndex == lpContext->qwRegionCount) {
+        return NULL;
+    }
+
+    LPCDUMP_REGION lpFirst = &lpContext->aRegions[qwIndex];
+    LPCBYTE lpEnd = (LPCBYTE) lpAddress + cbSize;
+
+    // Full memory dumps store adjacent regions back to back as well
+    for (
+        LPCDUMP_REGION lpRegion = lpFirst;
+        lpRegion->lpBaseAddress + lpRegion->cbSize < lpEnd;
+        lpRegion++
+    ) {
+        if (++qwIndex == lpContext->qwRegionCount) {
+            return NULL;
+        }
+
+        LPCDUMP_REGION lpNext = &lpContext->aRegions[qwIndex];
+
+        if (
+            lpNext->lpBaseAddress != lpRegion->lpBaseAddress + lpRegion->cbSize
+            || lpNext->lpData != lpRegion->lpData + lpRegion->cbSize
+        ) {
+            return NULL;
+        }
+    }
+
+    // Zero pages of compressed region dumps are read instead
+    BOOLEAN bBacked;
+
+    if (cbSize != GetBackedSpan(
+        lpContext,
+        (LPCBYTE) lpAddress,
+        cbSize,
+        &bBacked
+    ) || !bBacked) {
+        return NULL;
+    }
+
+    return lpFirst->lpData + ((LPCBYTE) lpAddress - lpFirst->lpBaseAddress);
+}
+
+VOID CloseDumpMemorySource(
+    LPMEMORY_SOURCE lpSource
+) {
+    LPDUMP_CONTEXT lpContext = (LPDUMP_CONTEXT) lpSource->lpContext;
+
+    if (NULL == lpContext) {
+        return;
+    }
+
+    if (NULL != lpContext->aRegions) {
+        VirtualFree(
+            lpContext->aRegions,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    if (NULL != lpContext->lpExpanded) {
+        VirtualFree(
+            lpContext->lpExpanded,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    if (NULL != lpContext->lpView) {
+        UnmapViewOfFile(lpContext->lpView);
+    }
+
+    if (NULL != lpContext->hMapping) {
+        CloseHandle(lpContext->hMapping);
+    }
+
+    if (INVALID_HANDLE_VALUE != lpContext->hFile) {
+        CloseHandle(lpContext->hFile);
+    }
+
+    VirtualFree(
+        lpContext,
+        0,
+        MEM_RELEASE
+    );
+
+    lpSource->lpContext = NULL;
+}
+
+BOOLEAN InitDumpMemorySource(
+    LPMEMORY_SOURCE lpSource,
+    LPCSTR szDumpPath
+) {
+    LARGE_INTEGER liFileSize = { 0 };
+    BOOLEAN bRet = FALSE;
+
+    LPDUMP_CONTEXT lpContext = VirtualAlloc(
+        NULL,
+        sizeof(DUMP_CONTEXT),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpContext) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    *lpSource = (MEMORY_SOURCE) {
+        .szName = "Dump",
+        .EnumRegions = DumpEnumRegions,
+        .ReadBatch = DumpReadBatch,
+        .WriteBatch = DumpWriteBatch,
+        .MapRange = DumpMapRange,
+        .bSnapshot = TRUE,
+        .lpContext = lpContext
+    };
+
+    lpContext->hFile = CreateFileA(
+        szDumpPath,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL
+    );
+
+    if (INVALID_HANDLE_VALUE == lpContext->hFile) {
+        fprintf(
+            stderr,
+            "[-] CreateFileA(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    if (!GetFileSizeEx(
+        lpContext->hFile,
+        &liFileSize
+    )) {
+        fprintf(
+            stderr,
+            "[-] GetFileSizeEx(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    lpContext->cbFile = (DWORD64) liFileSize.QuadPart;
+
+    if (lpContext->cbFile < max(sizeof(MINIDUMP_HEADER), sizeof(REGION_DUMP_HEADER))) {
+        fprintf(
+            stderr,
+            "[-] '%s' is too small to be a memory dump.\n",
+            szDumpPath
+        );
+        goto _FINAL;
+    }
+
+    lpContext->hMapping = CreateFileMappingA(
+        lpContext->hFile,
+        NULL,
+        PAGE_READONLY,
+        0,
+        0,
+        NULL
+    );
+
+    if (NULL == lpContext->hMapping) {
+        fprintf(
+            stderr,
+            "[-] CreateFileMappingA(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    lpContext->lpView = MapViewOfFile(
+        lpContext->hMapping,
+        FILE_MAP_READ,
+        0,
+        0,
+        0
+    );
+
+    if (NULL == lpContext->lpView) {
+        fprintf(
+            stderr,
+            "[-] MapViewOfFile(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    CONST DWORD dwMagic = *(CONST DWORD *) lpContext->lpView;
+
+    if (MINIDUMP_SIGNATURE == dwMagic) {
+        lpSource->szName = "Minidump";
+        bRet = ParseMinidump(lpContext);
+    } else if (REGION_DUMP_MAGIC == dwMagic) {
+        lpSource->szName = "Region dump";
+        bRet = ParseRegionDump(lpContext);
+    } else {
+        fprintf(
+            stderr,
+            "[-] '%s' is neither a minidump nor a region dump.\n",
+            szDumpPath
+        );
+    }
+
+    if (!bRet) {
+        goto _FINAL;
+    }
+
+    if (0 == lpContext->qwRegionCount) {
+        fprintf(
+            stderr,
+            "[-] '%s' holds no memory regions.\n",
+            szDumpPath
+        );
+        bRet = FALSE;
+        goto _FINAL;
+    }
+
+    qsort(
+        lpContext->aRegions,
+        lpContext->qwRegionCount,
+        sizeof(DUMP_REGION),
+        CompareDumpRegions
+    );
+
+_FINAL:
+    if (!bRet) {
+        CloseDumpMemorySource(lpSource);
+    }
+
+    return bRet;
+}
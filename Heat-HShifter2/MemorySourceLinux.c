@@ -0,0 +1,290 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/// @file MemorySourceLinux.c
+/// @brief Linux memory source, for Winelib builds next to a game running
+///  under Wine or Proton.
+///
+///  Regions come from /proc/[pid]/maps, translated to the Win32 protection
+///  and type flags the scanner filters on. Batches are transferred with
+///  process_vm_readv()/process_vm_writev(), a whole batch of candidate
+///  windows costs a single system call unless one of them faults.
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+///
+
+#ifdef __linux__
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                             // process_vm_readv(), process_vm_writev()
+#endif
+
+#include "MemorySource.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#define LINUX_MAPS_LINE_LENGTH                  512
+
+STATIC DWORD LinuxGetProtect(
+    LPCSTR szPermissions
+) {
+    CONST BOOLEAN bRead = ('r' == szPermissions[0]);
+    CONST BOOLEAN bWrite = ('w' == szPermissions[1]);
+    CONST BOOLEAN bExecute = ('x' == szPermissions[2]);
+
+    if (!bRead) {
+        return bExecute ? PAGE_EXECUTE : PAGE_NOACCESS;
+    }
+
+    if (bExecute) {
+        return bWrite ? PAGE_EXECUTE_READWRITE : PAGE_EXECUTE_READ;
+    }
+
+    return bWrite ? PAGE_READWRITE : PAGE_READONLY;
+}
+
+STATIC DWORD LinuxGetType(
+    DWORD64 qwInode,
+    LPCSTR szPath
+) {
+    if (0 == qwInode) {
+        return MEM_PRIVATE;
+    }
+
+    // Wine maps PE images from their files
+    CONST SIZE_T cchPath = strlen(szPath);
+    if (
+        cchPath > 4
+        && (
+            EXIT_SUCCESS == strcasecmp(szPath + cchPath - 4, ".exe")
+            || EXIT_SUCCESS == strcasecmp(szPath + cchPath - 4, ".dll")
+        )
+    ) {
+        return MEM_IMAGE;
+    }
+
+    return MEM_MAPPED;
+}
+
+STATIC BOOLEAN LinuxEnumRegions(
+    LPMEMORY_SOURCE lpSource,
+    LPCVOID lpMinimumAddress,
+    LPCVOID lpMaximumAddress,
+    LPMEMORY_REGION_CALLBACK lpCallback,
+    LPVOID lpContext
+) {
+    CHAR szMapsPath[64] = { 0 };
+    CHAR szLine[LINUX_MAPS_LINE_LENGTH] = { 0 };
+    BOOLEAN bResult = TRUE;
+
+    snprintf(
+        szMapsPath,
+        sizeof(szMapsPath),
+        "/proc/%lu/maps",
+        (unsigned long) lpSource->dwProcessId
+    );
+
+    FILE *lpMaps = fopen(szMapsPath, "r");
+    if (NULL == lpMaps) {
+        fprintf(
+            stderr,
+            "[-] fopen('%s'): %s\n",
+            szMapsPath,
+            strerror(errno)
+        );
+        return FALSE;
+    }
+
+    while (NULL != fgets(szLine, sizeof(szLine), lpMaps)) {
+        unsigned long long qwStart = 0, qwEnd = 0, qwInode = 0;
+        CHAR szPermissions[5] = { 0 };
+        INT iPathOffset = 0;
+
+        if (3 > sscanf(
+            szLine,
+            "%llx-%llx %4s %*llx %*s %llu %n",
+            &qwStart,
+            &qwEnd,
+            szPermissions,
+            &qwInode,
+            &iPathOffset
+        )) {
+            continue;
+        }
+
+        // Clip to the requested range
+        qwStart = max(qwStart, (DWORD64) lpMinimumAddress);
+        qwEnd = min(qwEnd, (DWORD64) lpMaximumAddress);
+
+        if (qwStart >= qwEnd) {
+            continue;
+        }
+
+        szLine[strcspn(szLine, "\n")] = '\0';
+
+        CONST DWORD dwProtect = LinuxGetProtect(szPermissions);
+
+        MEMORY_BASIC_INFORMATION memInfo = {
+            .BaseAddress = (PVOID) qwStart,
+            .AllocationBase = (PVOID) qwStart,
+            .RegionSize = (SIZE_T) (qwEnd - qwStart),
+            .State = (PAGE_NOACCESS == dwProtect) ? MEM_RESERVE : MEM_COMMIT,
+            .Protect = dwProtect,
+            .Type = LinuxGetType(qwInode, szLine + iPathOffset)
+        };
+
+        if (!lpCallback(
+            lpContext,
+            &memInfo
+        )) {
+            bResult = FALSE;
+            break;
+        }
+    }
+
+    fclose(lpMaps);
+    return bResult;
+}
+
+STATIC DWORD LinuxTransferBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount,
+    CONST BOOLEAN bWrite
+) {
+    struct iovec aLocal[MEMORY_SOURCE_MAX_BATCH];
+    struct iovec aRemote[MEMORY_SOURCE_MAX_BATCH];
+
+    DWORD dwCompleted = 0;
+    DWORD dwFirst = 0;
+
+    for (DWORD i = 0; i < dwRequestCount; ++i) {
+        aRequests[i].cbTransferred = 0;
+    }
+
+    // Transfers stop at the first faulting request, resume past it
+    while (dwFirst < dwRequestCount) {
+        CONST DWORD dwCount = dwRequestCount - dwFirst;
+
+        for (DWORD i = 0; i < dwCount; ++i) {
+            aLocal[i].iov_base = aRequests[dwFirst + i].lpBuffer;
+            aLocal[i].iov_len = aRequests[dwFirst + i].cbSize;
+            aRemote[i].iov_base = (LPVOID) aRequests[dwFirst + i].lpAddress;
+            aRemote[i].iov_len = aRequests[dwFirst + i].cbSize;
+        }
+
+        ssize_t cbTransferred = bWrite
+            ? process_vm_writev(lpSource->dwProcessId, aLocal, dwCount, aRemote, dwCount, 0)
+            : process_vm_readv(lpSource->dwProcessId, aLocal, dwCount, aRemote, dwCount, 0);
+
+        if (cbTransferred < 0) {
+            CONST INT iError = errno;
+
+            SetLastError(ERROR_PARTIAL_COPY);
+
+            // Anything but a fault fails the rest of the batch as well
+            if (EFAULT != iError) {
+                break;
+            }
+
+            dwFirst++;
+            continue;
+        }
+
+        while (dwFirst < dwRequestCount && (SIZE_T) cbTransferred >= aRequests[dwFirst].cbSize) {
+            aRequests[dwFirst].cbTransferred = aRequests[dwFirst].cbSize;
+            cbTransferred -= aRequests[dwFirst].cbSize;
+            dwCompleted++;
+            dwFirst++;
+        }
+
+        if (dwFirst < dwRequestCount) {
+            SetLastError(ERROR_PARTIAL_COPY);
+            aRequests[dwFirst++].cbTransferred = (SIZE_T) cbTransferred;
+        }
+    }
+
+    return dwCompleted;
+}
+
+STATIC DWORD LinuxReadBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    return LinuxTransferBatch(
+        lpSource,
+        aRequests,
+        dwRequestCount,
+        FALSE
+    );
+}
+
+STATIC DWORD LinuxWriteBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    return LinuxTransferBatch(
+        lpSource,
+        aRequests,
+        dwRequestCount,
+        TRUE
+    );
+}
+
+BOOLEAN InitLinuxMemorySource(
+    LPMEMORY_SOURCE lpSource,
+    DWORD dwProcessId
+) {
+    CHAR szMapsPath[64] = { 0 };
+
+    snprintf(
+        szMapsPath,
+        sizeof(szMapsPath),
+        "/proc/%lu/maps",
+        (unsigned long) dwProcessId
+    );
+
+    FILE *lpMaps = fopen(szMapsPath, "r");
+    if (NULL == lpMaps) {
+        fprintf(
+            stderr,
+            "[-] fopen('%s'): %s\n",
+            szMapsPath,
+            strerror(errno)
+        );
+        return FALSE;
+    }
+
+    fclose(lpMaps);
+
+    *lpSource = (MEMORY_SOURCE) {
+        .szName = "Linux",
+        .EnumRegions = LinuxEnumRegions,
+        .ReadBatch = LinuxReadBatch,
+        .WriteBatch = LinuxWriteBatch,
+        .dwProcessId = dwProcessId
+    };
+
+    return TRUE;
+}
+
+#endif // __linux__
@@ -0,0 +1,1264 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/// @file MemorySourceTrace.c
+/// @brief Recording of a memory source into a trace, and replay of a trace.
+///
+///  The recording source forwards every call to the source it wraps and
+///  appends the answer to a trace (MemoryTrace.h). Records are serialized
+///  under one lock, recording is meant for capturing a failing scan, not for
+///  everyday use.
+///
+///  The replay source answers from the trace. Scan workers read in a
+///  different order every run, so answers aren't replayed in file order but
+///  per request: the n-th read of an address and size gets the n-th answer
+///  recorded for it. Live memory samples of a candidate window come back in
+///  the order they were taken, the verification makes the same decisions.
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+///
+
+#include "MemorySource.h"
+#include "MemoryTrace.h"
+
+#include <compressapi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#pragma comment (lib, "Cabinet.lib")
+
+#define TRACE_RECORDER_BUFFER_SIZE              0x100000            // Records written to the file at once
+#define TRACE_PADDING(cbSize)                   (((cbSize) + 7) & ~(DWORD64) 7)
+
+typedef struct _TRACE_RECORDER {
+    MEMORY_SOURCE Inner;                // Recorded source
+    HANDLE hFile;
+
+    SRWLOCK Lock;                       // Serializes records, the compressor and the buffers
+    COMPRESSOR_HANDLE hCompressor;      // NULL if payloads are stored raw
+    LPBYTE lpBuffer;                    // Records not written to the file yet
+    SIZE_T cbBuffered;
+    LPBYTE lpCompressed;
+    SIZE_T cbCompressedCapacity;
+
+    LARGE_INTEGER liStart;
+    LARGE_INTEGER liFrequency;
+    DWORD64 qwRecordCount;
+    DWORD64 cbTrace;
+    BOOLEAN bFailed;                    // Trace is incomplete, calls are still forwarded
+} TRACE_RECORDER, *LPTRACE_RECORDER;
+
+/// Regions reported during one recorded EnumRegions() call.
+typedef struct _TRACE_ENUM {
+    LPMEMORY_REGION_CALLBACK lpCallback;
+    LPVOID lpContext;
+
+    LPBYTE lpRegions;                   // MEMORY_TRACE_REGION entries
+    SIZE_T cbCapacity;
+    DWORD dwRegionCount;
+    BOOLEAN bOutOfMemory;
+} TRACE_ENUM, *LPTRACE_ENUM;
+
+/// Recorded answers for one address and size, in recording order.
+typedef struct _TRACE_KEY {
+    LPCMEMORY_TRACE_RECORD *alpAnswers;
+    DWORD64 qwAnswerCount;
+    VOLATILE LONG64 qwNextAnswer;
+} TRACE_KEY, *LPTRACE_KEY;
+
+typedef struct _TRACE_REPLAY {
+    HANDLE hFile;
+    HANDLE hMapping;
+    LPCBYTE lpView;
+    DWORD64 cbFile;
+
+    LPCMEMORY_TRACE_RECORD *alpEnums;   // Region queries in recording order
+    DWORD64 qwEnumCount;
+    VOLATILE LONG64 qwNextEnum;
+
+    LPCMEMORY_TRACE_RECORD *alpAnswers; // Reads and writes sorted by kind, address, size and file order
+    DWORD64 qwAnswerCount;
+    LPTRACE_KEY aKeys;
+    DWORD64 qwKeyCount;
+
+    SRWLOCK DecompressorLock;
+    DECOMPRESSOR_HANDLE hDecompressor;
+
+    BOOLEAN bRealTime;                  // Answer no earlier than recorded
+    LARGE_INTEGER liStart;
+    LARGE_INTEGER liFrequency;
+
+    VOLATILE LONG64 qwMissing;          // Requests the trace has no answer for
+    VOLATILE LONG64 qwRepeated;         // Requests asked more often than recorded
+} TRACE_REPLAY, *LPTRACE_REPLAY;
+
+/// Grows a buffer to at least cbRequired bytes, keeping its contents.
+STATIC BOOLEAN GrowTraceBuffer(
+    LPBYTE *lplpBuffer,
+    PSIZE_T lpcbCapacity,
+    CONST SIZE_T cbRequired
+) {
+    if (cbRequired <= *lpcbCapacity) {
+        return TRUE;
+    }
+
+    CONST SIZE_T cbCapacity = max(cbRequired, *lpcbCapacity * 2);
+
+    LPBYTE lpBuffer = VirtualAlloc(
+        NULL,
+        cbCapacity,
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpBuffer) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    if (NULL != *lplpBuffer) {
+        memcpy(
+            lpBuffer,
+            *lplpBuffer,
+            *lpcbCapacity
+        );
+
+        VirtualFree(
+            *lplpBuffer,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    *lplpBuffer = lpBuffer;
+    *lpcbCapacity = cbCapacity;
+
+    return TRUE;
+}
+
+STATIC VOID FlushTraceBuffer(
+    LPTRACE_RECORDER lpRecorder
+) {
+    DWORD dwWritten = 0;
+
+    if (0 != lpRecorder->cbBuffered && !lpRecorder->bFailed && (!WriteFile(
+        lpRecorder->hFile,
+        lpRecorder->lpBuffer,
+        (DWORD) lpRecorder->cbBuffered,
+        &dwWritten,
+        NULL
+    ) || dwWritten != lpRecorder->cbBuffered)) {
+        fprintf(
+            stderr,
+            "[-] WriteFile(): E%lu\n",
+            GetLastError()
+        );
+        lpRecorder->bFailed = TRUE;
+    }
+
+    lpRecorder->cbBuffered = 0;
+}
+
+/// Appends to the trace, payloads larger than the buffer bypass it.
+STATIC VOID AppendTraceData(
+    LPTRACE_RECORDER lpRecorder,
+    LPCVOID lpData,
+    CONST SIZE_T cbSize
+) {
+    DWORD dwWritten = 0;
+
+    if (lpRecorder->cbBuffered + cbSize > TRACE_RECORDER_BUFFER_SIZE) {
+        FlushTraceBuffer(lpRecorder);
+    }
+
+    lpRecorder->cbTrace += cbSize;
+
+    if (cbSize <= TRACE_RECORDER_BUFFER_SIZE) {
+        memcpy(
+            lpRecorder->lpBuffer + lpRecorder->cbBuffered,
+            lpData,
+            cbSize
+        );
+
+        lpRecorder->cbBuffered += cbSize;
+        return;
+    }
+
+    if (!lpRecorder->bFailed && (cbSize > MAXDWORD || !WriteFile(
+        lpRecorder->hFile,
+        lpData,
+        (DWORD) cbSize,
+        &dwWritten,
+        NULL
+    ) || dwWritten != cbSize)) {
+        fprintf(
+            stderr,
+            "[-] WriteFile(): E%lu\n",
+            GetLastError()
+        );
+        lpRecorder->bFailed = TRUE;
+    }
+}
+
+/// Microseconds since the recording started.
+STATIC DWORD64 GetTraceTimestamp(
+    LPTRACE_RECORDER lpRecorder
+) {
+    LARGE_INTEGER liNow = { 0 };
+
+    QueryPerformanceCounter(&liNow);
+
+    CONST DWORD64 qwTicks = (DWORD64) (liNow.QuadPart - lpRecorder->liStart.QuadPart);
+    CONST DWORD64 qwFrequency = (DWORD64) lpRecorder->liFrequency.QuadPart;
+
+    return (qwTicks / qwFrequency) * 1000000 + (qwTicks % qwFrequency) * 1000000 / qwFrequency;
+}
+
+/// Appends a record and its payload, compressed if that makes it smaller.
+/// The caller holds the recorder lock.
+STATIC VOID AppendTraceRecord(
+    LPTRACE_RECORDER lpRecorder,
+    LPMEMORY_TRACE_RECORD lpRecord,
+    LPCVOID lpPayload,
+    CONST SIZE_T cbPayload
+) {
+    STATIC CONST BYTE abyPadding[8] = { 0 };
+
+    SIZE_T cbCompressed = 0;
+    LPCVOID lpStored = lpPayload;
+
+    lpRecord->cbStored = cbPayload;
+
+    if (
+        MEMORY_TRACE_RECORD_ENUM != lpRecord->dwKind
+        && NULL != lpRecorder->hCompressor
+        && cbPayload >= MEMORY_TRACE_MIN_COMPRESSED
+        && GrowTraceBuffer(
+            &lpRecorder->lpCompressed,
+            &lpRecorder->cbCompressedCapacity,
+            cbPayload
+        ) && Compress(
+            lpRecorder->hCompressor,
+            lpPayload,
+            cbPayload,
+            lpRecorder->lpCompressed,
+            cbPayload,
+            &cbCompressed
+        ) && cbCompressed < cbPayload
+    ) {
+        lpStored = lpRecorder->lpCompressed;
+        lpRecord->cbStored = cbCompressed;
+    }
+
+    AppendTraceData(
+        lpRecorder,
+        lpRecord,
+        sizeof(MEMORY_TRACE_RECORD)
+    );
+
+    AppendTraceData(
+        lpRecorder,
+        lpStored,
+        (SIZE_T) lpRecord->cbStored
+    );
+
+    AppendTraceData(
+        lpRecorder,
+        abyPadding,
+        (SIZE_T) (TRACE_PADDING(lpRecord->cbStored) - lpRecord->cbStored)
+    );
+
+    lpRecorder->qwRecordCount++;
+}
+
+STATIC BOOLEAN RecordRegion(
+    LPVOID lpContext,
+    CONST MEMORY_BASIC_INFORMATION *lpMemInfo
+) {
+    LPTRACE_ENUM lpEnum = (LPTRACE_ENUM) lpContext;
+
+    if (!lpEnum->bOutOfMemory && GrowTraceBuffer(
+        &lpEnum->lpRegions,
+        &lpEnum->cbCapacity,
+        (lpEnum->dwRegionCount + 1) * sizeof(MEMORY_TRACE_REGION)
+    )) {
+        ((LPMEMORY_TRACE_REGION) lpEnum->lpRegions)[lpEnum->dwRegionCount++] = (MEMORY_TRACE_REGION) {
+            .qwBaseAddress = (DWORD64) lpMemInfo->BaseAddress,
+            .qwAllocationBase = (DWORD64) lpMemInfo->AllocationBase,
+            .qwRegionSize = (DWORD64) lpMemInfo->RegionSize,
+            .dwState = lpMemInfo->State,
+            .dwProtect = lpMemInfo->Protect,
+            .dwType = lpMemInfo->Type
+        };
+    } else {
+        lpEnum->bOutOfMemory = TRUE;
+    }
+
+    return lpEnum->lpCallback(
+        lpEnum->lpContext,
+        lpMemInfo
+    );
+}
+
+STATIC BOOLEAN RecorderEnumRegions(
+    LPMEMORY_SOURCE lpSource,
+    LPCVOID lpMinimumAddress,
+    LPCVOID lpMaximumAddress,
+    LPMEMORY_REGION_CALLBACK lpCallback,
+    LPVOID lpCallbackContext
+) {
+    LPTRACE_RECORDER lpRecorder = (LPTRACE_RECORDER) lpSource->lpContext;
+
+    TRACE_ENUM traceEnum = {
+        .lpCallback = lpCallback,
+        .lpContext = lpCallbackContext
+    };
+
+    MEMORY_TRACE_RECORD traceRecord = {
+        .dwKind = MEMORY_TRACE_RECORD_ENUM,
+        .qwTimestamp = GetTraceTimestamp(lpRecorder),
+        .qwAddress = (DWORD64) lpMinimumAddress,
+        .cbSize = (DWORD64) lpMaximumAddress - (DWORD64) lpMinimumAddress
+    };
+
+    CONST BOOLEAN bRet = lpRecorder->Inner.EnumRegions(
+        &lpRecorder->Inner,
+        lpMinimumAddress,
+        lpMaximumAddress,
+        RecordRegion,
+        &traceEnum
+    );
+
+    traceRecord.dwRegionCount = traceEnum.dwRegionCount;
+    traceRecord.cbTransferred = bRet;
+
+    AcquireSRWLockExclusive(&lpRecorder->Lock);
+
+    // A partial region list would replay as a different address space
+    if (traceEnum.bOutOfMemory) {
+        lpRecorder->bFailed = TRUE;
+    }
+
+    AppendTraceRecord(
+        lpRecorder,
+        &traceRecord,
+        traceEnum.lpRegions,
+        traceEnum.dwRegionCount * sizeof(MEMORY_TRACE_REGION)
+    );
+
+    ReleaseSRWLockExclusive(&lpRecorder->Lock);
+
+    if (NULL != traceEnum.lpRegions) {
+        VirtualFree(
+            traceEnum.lpRegions,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    return bRet;
+}
+
+/// Forwards a batch and records one answer per request, payload is the transferred data.
+STATIC DWORD RecordBatch(
+    LPTRACE_RECORDER lpRecorder,
+    CONST MEMORY_TRACE_RECORD_KIND eKind,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    CONST DWORD64 qwTimestamp = GetTraceTimestamp(lpRecorder);
+
+    CONST DWORD dwCompleted = (MEMORY_TRACE_RECORD_READ == eKind)
+        ? lpRecorder->Inner.ReadBatch(&lpRecorder->Inner, aRequests, dwRequestCount)
+        : lpRecorder->Inner.WriteBatch(&lpRecorder->Inner, aRequests, dwRequestCount);
+
+    CONST DWORD dwLastError = GetLastError();
+
+    AcquireSRWLockExclusive(&lpRecorder->Lock);
+
+    for (DWORD i = 0; i < dwRequestCount; ++i) {
+        MEMORY_TRACE_RECORD traceRecord = {
+            .dwKind = eKind,
+            .qwTimestamp = qwTimestamp,
+            .qwAddress = (DWORD64) aRequests[i].lpAddress,
+            .cbSize = aRequests[i].cbSize,
+            .cbTransferred = aRequests[i].cbTransferred
+        };
+
+        AppendTraceRecord(
+            lpRecorder,
+            &traceRecord,
+            aRequests[i].lpBuffer,
+            aRequests[i].cbTransferred
+        );
+    }
+
+    ReleaseSRWLockExclusive(&lpRecorder->Lock);
+
+    // Callers report errors of partial batches
+    SetLastError(dwLastError);
+
+    return dwCompleted;
+}
+
+STATIC DWORD RecorderReadBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    return RecordBatch(
+        (LPTRACE_RECORDER) lpSource->lpContext,
+        MEMORY_TRACE_RECORD_READ,
+        aRequests,
+        dwRequestCount
+    );
+}
+
+STATIC DWORD RecorderWriteBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    return RecordBatch(
+        (LPTRACE_RECORDER) lpSource->lpContext,
+        MEMORY_TRACE_RECORD_WRITE,
+        aRequests,
+        dwRequestCount
+    );
+}
+
+VOID CloseRecordingMemorySource(
+    LPMEMORY_SOURCE lpSource
+) {
+    LPTRACE_RECORDER lpRecorder = (LPTRACE_RECORDER) lpSource->lpContext;
+
+    if (NULL == lpRecorder) {
+        return;
+    }
+
+    if (NULL != lpRecorder->lpBuffer) {
+        FlushTraceBuffer(lpRecorder);
+
+        if (lpRecorder->bFailed) {
+            fprintf(
+                stderr,
+                "[-] Memory trace is incomplete.\n"
+            );
+        } else {
+            printf(
+                "[+] Recorded %llu memory source calls (%llu KiB).\n",
+                lpRecorder->qwRecordCount,
+                lpRecorder->cbTrace / 1024
+            );
+        }
+
+        VirtualFree(
+            lpRecorder->lpBuffer,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    if (NULL != lpRecorder->lpCompressed) {
+        VirtualFree(
+            lpRecorder->lpCompressed,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    if (NULL != lpRecorder->hCompressor) {
+        CloseCompressor(lpRecorder->hCompressor);
+    }
+
+    if (INVALID_HANDLE_VALUE != lpRecorder->hFile) {
+        CloseHandle(lpRecorder->hFile);
+    }
+
+    // Hand the recorded source back
+    *lpSource = lpRecorder->Inner;
+
+    VirtualFree(
+        lpRecorder,
+        0,
+        MEM_RELEASE
+    );
+}
+
+BOOLEAN InitRecordingMemorySource(
+    LPMEMORY_SOURCE lpSource,
+    LPCSTR szTracePath
+) {
+    BOOLEAN bRet = FALSE;
+
+    LPTRACE_RECORDER lpRecorder = VirtualAlloc(
+        NULL,
+        sizeof(TRACE_RECORDER),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpRecorder) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    lpRecorder->Inner = *lpSource;
+    InitializeSRWLock(&lpRecorder->Lock);
+    QueryPerformanceFrequency(&lpRecorder->liFrequency);
+    QueryPerformanceCounter(&lpRecorder->liStart);
+
+    // Reads from the mapped range of a dump source would go unrecorded
+    *lpSource = (MEMORY_SOURCE) {
+        .szName = "Recording",
+        .EnumRegions = RecorderEnumRegions,
+        .ReadBatch = RecorderReadBatch,
+        .WriteBatch = RecorderWriteBatch,
+        .MapRange = NULL,
+        .bSnapshot = lpRecorder->Inner.bSnapshot,
+        .hProcess = lpRecorder->Inner.hProcess,
+        .dwProcessId = lpRecorder->Inner.dwProcessId,
+        .lpContext = lpRecorder
+    };
+
+    lpRecorder->hFile = CreateFileA(
+        szTracePath,
+        GENERIC_WRITE,
+        0,
+        NULL,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+
+    if (INVALID_HANDLE_VALUE == lpRecorder->hFile) {
+        fprintf(
+            stderr,
+            "[-] CreateFileA(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    lpRecorder->lpBuffer = VirtualAlloc(
+        NULL,
+        TRACE_RECORDER_BUFFER_SIZE,
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpRecorder->lpBuffer) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    // Payloads are stored raw without a compressor
+    if (!CreateCompressor(
+        COMPRESS_ALGORITHM_XPRESS_HUFF | COMPRESS_RAW,
+        NULL,
+        &lpRecorder->hCompressor
+    )) {
+        WriteLog(
+            "[-] CreateCompressor(): E%lu\n",
+            GetLastError()
+        );
+        lpRecorder->hCompressor = NULL;
+    }
+
+    MEMORY_TRACE_HEADER traceHeader = {
+        .dwMagic = MEMORY_TRACE_MAGIC,
+        .dwVersion = MEMORY_TRACE_VERSION,
+        .dwFlags = lpRecorder->Inner.bSnapshot ? MEMORY_TRACE_FLAG_SNAPSHOT : 0,
+        .dwCompression = (NULL != lpRecorder->hCompressor)
+            ? MEMORY_TRACE_COMPRESSION_XPRESS_HUFF
+            : MEMORY_TRACE_COMPRESSION_NONE
+    };
+
+    strncpy_s(
+        traceHeader.szSourceName,
+        sizeof(traceHeader.szSourceName),
+        lpRecorder->Inner.szName,
+        _TRUNCATE
+    );
+
+    AppendTraceData(
+        lpRecorder,
+        &traceHeader,
+        sizeof(MEMORY_TRACE_HEADER)
+    );
+
+    bRet = TRUE;
+
+_FINAL:
+    if (!bRet) {
+        CloseRecordingMemorySource(lpSource);
+    }
+
+    return bRet;
+}
+
+/// Returns the record at qwOffset if it and its payload are within the file, NULL otherwise.
+STATIC LPCMEMORY_TRACE_RECORD GetTraceRecord(
+    LPTRACE_REPLAY lpReplay,
+    CONST DWORD64 qwOffset
+) {
+    if (qwOffset > lpReplay->cbFile || sizeof(MEMORY_TRACE_RECORD) > lpReplay->cbFile - qwOffset) {
+        return NULL;
+    }
+
+    LPCMEMORY_TRACE_RECORD lpRecord = (LPCMEMORY_TRACE_RECORD) (lpReplay->lpView + qwOffset);
+    CONST DWORD64 cbRemaining = lpReplay->cbFile - qwOffset - sizeof(MEMORY_TRACE_RECORD);
+
+    if (lpRecord->cbStored > cbRemaining) {
+        return NULL;
+    }
+
+    switch (lpRecord->dwKind) {
+        case MEMORY_TRACE_RECORD_ENUM:
+            return (lpRecord->cbStored == (DWORD64) lpRecord->dwRegionCount * sizeof(MEMORY_TRACE_REGION))
+                ? lpRecord
+                : NULL;
+
+        case MEMORY_TRACE_RECORD_READ:
+        case MEMORY_TRACE_RECORD_WRITE:
+            return (lpRecord->cbStored <= lpRecord->cbTransferred && lpRecord->cbTransferred <= lpRecord->cbSize)
+                ? lpRecord
+                : NULL;
+
+        default:
+            return NULL;
+    }
+}
+
+/// Orders requests by kind, address and size.
+STATIC INT CompareTraceKeys(
+    LPCMEMORY_TRACE_RECORD lpFirst,
+    LPCMEMORY_TRACE_RECORD lpSecond
+) {
+    if (lpFirst->dwKind != lpSecond->dwKind) {
+        return (lpFirst->dwKind > lpSecond->dwKind) ? 1 : -1;
+    }
+
+    if (lpFirst->qwAddress != lpSecond->qwAddress) {
+        return (lpFirst->qwAddress > lpSecond->qwAddress) ? 1 : -1;
+    }
+
+    return (lpFirst->cbSize > lpSecond->cbSize) - (lpFirst->cbSize < lpSecond->cbSize);
+}
+
+/// Orders answers by request, then by file position, which is recording order.
+STATIC INT CompareTraceAnswers(
+    CONST VOID *lpFirst,
+    CONST VOID *lpSecond
+) {
+    LPCMEMORY_TRACE_RECORD lpFirstRecord = *(CONST LPCMEMORY_TRACE_RECORD *) lpFirst;
+    LPCMEMORY_TRACE_RECORD lpSecondRecord = *(CONST LPCMEMORY_TRACE_RECORD *) lpSecond;
+
+    CONST INT iOrder = CompareTraceKeys(
+        lpFirstRecord,
+        lpSecondRecord
+    );
+
+    if (0 != iOrder) {
+        return iOrder;
+    }
+
+    return (lpFirstRecord > lpSecondRecord) - (lpFirstRecord < lpSecondRecord);
+}
+
+STATIC BOOLEAN ParseMemoryTrace(
+    LPTRACE_REPLAY lpReplay
+) {
+    DWORD64 qwAnswerCount = 0;
+    DWORD64 qwOffset = sizeof(MEMORY_TRACE_HEADER);
+
+    // Validate and count first, the arrays are sized once
+    while (qwOffset < lpReplay->cbFile) {
+        LPCMEMORY_TRACE_RECORD lpRecord = GetTraceRecord(
+            lpReplay,
+            qwOffset
+        );
+
+        if (NULL == lpRecord) {
+            fprintf(
+                stderr,
+                "[-] Memory trace is corrupt at offset 0x%llX.\n",
+                qwOffset
+            );
+            return FALSE;
+        }
+
+        if (MEMORY_TRACE_RECORD_ENUM == lpRecord->dwKind) {
+            lpReplay->qwEnumCount++;
+        } else {
+            qwAnswerCount++;
+        }
+
+        qwOffset += sizeof(MEMORY_TRACE_RECORD) + TRACE_PADDING(lpRecord->cbStored);
+    }
+
+    // One allocation for the enums, the answers and their keys
+    lpReplay->alpEnums = VirtualAlloc(
+        NULL,
+        (SIZE_T) (
+            (lpReplay->qwEnumCount + qwAnswerCount) * sizeof(LPCMEMORY_TRACE_RECORD)
+            + qwAnswerCount * sizeof(TRACE_KEY)
+            + 1
+        ),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpReplay->alpEnums) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    lpReplay->alpAnswers = lpReplay->alpEnums + lpReplay->qwEnumCount;
+    lpReplay->aKeys = (LPTRACE_KEY) (lpReplay->alpAnswers + qwAnswerCount);
+
+    DWORD64 qwEnumIndex = 0;
+    DWORD64 qwAnswerIndex = 0;
+
+    for (qwOffset = sizeof(MEMORY_TRACE_HEADER); qwOffset < lpReplay->cbFile;) {
+        LPCMEMORY_TRACE_RECORD lpRecord = (LPCMEMORY_TRACE_RECORD) (lpReplay->lpView + qwOffset);
+
+        if (MEMORY_TRACE_RECORD_ENUM == lpRecord->dwKind) {
+            lpReplay->alpEnums[qwEnumIndex++] = lpRecord;
+        } else {
+            lpReplay->alpAnswers[qwAnswerIndex++] = lpRecord;
+        }
+
+        qwOffset += sizeof(MEMORY_TRACE_RECORD) + TRACE_PADDING(lpRecord->cbStored);
+    }
+
+    qsort(
+        lpReplay->alpAnswers,
+        (SIZE_T) qwAnswerCount,
+        sizeof(LPCMEMORY_TRACE_RECORD),
+        CompareTraceAnswers
+    );
+
+    lpReplay->qwAnswerCount = qwAnswerCount;
+
+    for (DWORD64 i = 0; i < qwAnswerCount; ++i) {
+        if (0 == i || 0 != CompareTraceKeys(
+            lpReplay->alpAnswers[i - 1],
+            lpReplay->alpAnswers[i]
+        )) {
+            lpReplay->aKeys[lpReplay->qwKeyCount++].alpAnswers = &lpReplay->alpAnswers[i];
+        }
+
+        lpReplay->aKeys[lpReplay->qwKeyCount - 1].qwAnswerCount++;
+    }
+
+    return TRUE;
+}
+
+/// Next recorded answer to a request, the last one again once they run out.
+STATIC LPCMEMORY_TRACE_RECORD GetTraceAnswer(
+    LPTRACE_REPLAY lpReplay,
+    CONST MEMORY_TRACE_RECORD_KIND eKind,
+    CONST MEMORY_IO *lpRequest
+) {
+    DWORD64 qwLow = 0;
+    DWORD64 qwHigh = lpReplay->qwKeyCount;
+
+    CONST MEMORY_TRACE_RECORD keyRecord = {
+        .dwKind = eKind,
+        .qwAddress = (DWORD64) lpRequest->lpAddress,
+        .cbSize = lpRequest->cbSize
+    };
+
+    while (qwLow < qwHigh) {
+        CONST DWORD64 qwMiddle = qwLow + (qwHigh - qwLow) / 2;
+        LPTRACE_KEY lpKey = &lpReplay->aKeys[qwMiddle];
+
+        CONST INT iOrder = CompareTraceKeys(
+            lpKey->alpAnswers[0],
+            &keyRecord
+        );
+
+        if (0 == iOrder) {
+            CONST DWORD64 qwAnswer = (DWORD64) InterlockedIncrement64(&lpKey->qwNextAnswer) - 1;
+
+            if (qwAnswer < lpKey->qwAnswerCount) {
+                return lpKey->alpAnswers[qwAnswer];
+            }
+
+            InterlockedIncrement64(&lpReplay->qwRepeated);
+            return lpKey->alpAnswers[lpKey->qwAnswerCount - 1];
+        }
+
+        if (iOrder < 0) {
+            qwLow = qwMiddle + 1;
+        } else {
+            qwHigh = qwMiddle;
+        }
+    }
+
+    InterlockedIncrement64(&lpReplay->qwMissing);
+    return NULL;
+}
+
+/// Real time replay, waits until the answer was given in the recording.
+STATIC VOID WaitForTraceTimestamp(
+    LPTRACE_REPLAY lpReplay,
+    LPCMEMORY_TRACE_RECORD lpRecord
+) {
+    LARGE_INTEGER liNow = { 0 };
+
+    if (!lpReplay->bRealTime) {
+        return;
+    }
+
+    CONST DWORD64 qwFrequency = (DWORD64) lpReplay->liFrequency.QuadPart;
+    CONST LONGLONG llDue = lpReplay->liStart.QuadPart + (LONGLONG) (
+        (lpRecord->qwTimestamp / 1000000) * qwFrequency
+        + (lpRecord->qwTimestamp % 1000000) * qwFrequency / 1000000
+    );
+
+    for (;;) {
+        QueryPerformanceCounter(&liNow);
+
+        if (liNow.QuadPart >= llDue) {
+            return;
+        }
+
+        Sleep((DWORD) ((DWORD64) (llDue - liNow.QuadPart) * 1000 / qwFrequency));
+    }
+}
+
+STATIC BOOLEAN ReplayEnumRegions(
+    LPMEMORY_SOURCE lpSource,
+    LPCVOID lpMinimumAddress,
+    LPCVOID lpMaximumAddress,
+    LPMEMORY_REGION_CALLBACK lpCallback,
+    LPVOID lpCallbackContext
+) {
+    LPTRACE_REPLAY lpReplay = (LPTRACE_REPLAY) lpSource->lpContext;
+
+    if (0 == lpReplay->qwEnumCount) {
+        InterlockedIncrement64(&lpReplay->qwMissing);
+        SetLastError(ERROR_NOT_FOUND);
+        return FALSE;
+    }
+
+    DWORD64 qwEnum = (DWORD64) InterlockedIncrement64(&lpReplay->qwNextEnum) - 1;
+
+    // The address space stays as last seen
+    if (qwEnum >= lpReplay->qwEnumCount) {
+        InterlockedIncrement64(&lpReplay->qwRepeated);
+        qwEnum = lpReplay->qwEnumCount - 1;
+    }
+
+    LPCMEMORY_TRACE_RECORD lpRecord = lpReplay->alpEnums[qwEnum];
+    LPCMEMORY_TRACE_REGION aRegions = (LPCMEMORY_TRACE_REGION) (lpRecord + 1);
+
+    WaitForTraceTimestamp(
+        lpReplay,
+        lpRecord
+    );
+
+    for (DWORD i = 0; i < lpRecord->dwRegionCount; ++i) {
+        // Clip to the requested range
+        CONST DWORD64 qwStart = max(aRegions[i].qwBaseAddress, (DWORD64) lpMinimumAddress);
+        CONST DWORD64 qwEnd = min(
+            aRegions[i].qwBaseAddress + aRegions[i].qwRegionSize,
+            (DWORD64) lpMaximumAddress
+        );
+
+        if (qwStart >= qwEnd) {
+            continue;
+        }
+
+        MEMORY_BASIC_INFORMATION memInfo = {
+            .BaseAddress = (PVOID) qwStart,
+            .AllocationBase = (PVOID) aRegions[i].qwAllocationBase,
+            .RegionSize = (SIZE_T) (qwEnd - qwStart),
+            .State = aRegions[i].dwState,
+            .Protect = aRegions[i].dwProtect,
+            .Type = aRegions[i].dwType
+        };
+
+        if (!lpCallback(
+            lpCallbackContext,
+            &memInfo
+        )) {
+            return FALSE;
+        }
+    }
+
+    return (BOOLEAN) lpRecord->cbTransferred;
+}
+
+STATIC BOOLEAN ExpandTracePayload(
+    LPTRACE_REPLAY lpReplay,
+    LPCMEMORY_TRACE_RECORD lpRecord,
+    LPVOID lpBuffer
+) {
+    SIZE_T cbExpanded = 0;
+    BOOLEAN bRet = FALSE;
+
+    if (lpRecord->cbStored == lpRecord->cbTransferred) {
+        memcpy(
+            lpBuffer,
+            lpRecord + 1,
+            (SIZE_T) lpRecord->cbTransferred
+        );
+        return TRUE;
+    }
+
+    AcquireSRWLockExclusive(&lpReplay->DecompressorLock);
+
+    bRet = NULL != lpReplay->hDecompressor && Decompress(
+        lpReplay->hDecompressor,
+        lpRecord + 1,
+        (SIZE_T) lpRecord->cbStored,
+        lpBuffer,
+        (SIZE_T) lpRecord->cbTransferred,
+        &cbExpanded
+    ) && cbExpanded == lpRecord->cbTransferred;
+
+    ReleaseSRWLockExclusive(&lpReplay->DecompressorLock);
+
+    if (!bRet) {
+        fprintf(
+            stderr,
+            "[-] Unable to expand trace record at 0x%llX.\n",
+            (DWORD64) ((LPCBYTE) lpRecord - lpReplay->lpView)
+        );
+    }
+
+    return bRet;
+}
+
+STATIC DWORD ReplayBatch(
+    LPTRACE_REPLAY lpReplay,
+    CONST MEMORY_TRACE_RECORD_KIND eKind,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    DWORD dwCompleted = 0;
+
+    for (DWORD i = 0; i < dwRequestCount; ++i) {
+        LPMEMORY_IO lpRequest = &aRequests[i];
+
+        lpRequest->cbTransferred = 0;
+
+        LPCMEMORY_TRACE_RECORD lpRecord = GetTraceAnswer(
+            lpReplay,
+            eKind,
+            lpRequest
+        );
+
+        if (NULL == lpRecord) {
+            SetLastError(ERROR_PARTIAL_COPY);
+            continue;
+        }
+
+        WaitForTraceTimestamp(
+            lpReplay,
+            lpRecord
+        );
+
+        if (MEMORY_TRACE_RECORD_READ == eKind && !ExpandTracePayload(
+            lpReplay,
+            lpRecord,
+            lpRequest->lpBuffer
+        )) {
+            SetLastError(ERROR_PARTIAL_COPY);
+            continue;
+        }
+
+        lpRequest->cbTransferred = (SIZE_T) lpRecord->cbTransferred;
+
+        if (lpRequest->cbSize == lpRequest->cbTransferred) {
+            dwCompleted++;
+        } else {
+            SetLastError(ERROR_PARTIAL_COPY);
+        }
+    }
+
+    return dwCompleted;
+}
+
+STATIC DWORD ReplayReadBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    return ReplayBatch(
+        (LPTRACE_REPLAY) lpSource->lpContext,
+        MEMORY_TRACE_RECORD_READ,
+        aRequests,
+        dwRequestCount
+    );
+}
+
+/// Writes only report the recorded outcome, the trace holds no memory to change.
+STATIC DWORD ReplayWriteBatch(
+    LPMEMORY_SOURCE lpSource,
+    LPMEMORY_IO aRequests,
+    CONST DWORD dwRequestCount
+) {
+    return ReplayBatch(
+        (LPTRACE_REPLAY) lpSource->lpContext,
+        MEMORY_TRACE_RECORD_WRITE,
+        aRequests,
+        dwRequestCount
+    );
+}
+
+VOID CloseReplayMemorySource(
+    LPMEMORY_SOURCE lpSource
+) {
+    LPTRACE_REPLAY lpReplay = (LPTRACE_REPLAY) lpSource->lpContext;
+
+    if (NULL == lpReplay) {
+        return;
+    }
+
+    if (0 != lpReplay->qwMissing || 0 != lpReplay->qwRepeated) {
+        fprintf(
+            stderr,
+            "[-] Replay diverged from the trace: %lld requests without an answer, %lld answers repeated.\n",
+            lpReplay->qwMissing,
+            lpReplay->qwRepeated
+        );
+    }
+
+    if (NULL != lpReplay->hDecompressor) {
+        CloseDecompressor(lpReplay->hDecompressor);
+    }
+
+    if (NULL != lpReplay->alpEnums) {
+        VirtualFree(
+            lpReplay->alpEnums,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    if (NULL != lpReplay->lpView) {
+        UnmapViewOfFile(lpReplay->lpView);
+    }
+
+    if (NULL != lpReplay->hMapping) {
+        CloseHandle(lpReplay->hMapping);
+    }
+
+    if (INVALID_HANDLE_VALUE != lpReplay->hFile) {
+        CloseHandle(lpReplay->hFile);
+    }
+
+    VirtualFree(
+        lpReplay,
+        0,
+        MEM_RELEASE
+    );
+
+    lpSource->lpContext = NULL;
+}
+
+BOOLEAN InitReplayMemorySource(
+    LPMEMORY_SOURCE lpSource,
+    LPCSTR szTracePath,
+    CONST BOOLEAN bRealTime
+) {
+    LARGE_INTEGER liFileSize = { 0 };
+    BOOLEAN bRet = FALSE;
+
+    LPTRACE_REPLAY lpReplay = VirtualAlloc(
+        NULL,
+        sizeof(TRACE_REPLAY),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpReplay) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    InitializeSRWLock(&lpReplay->DecompressorLock);
+    lpReplay->bRealTime = bRealTime;
+
+    *lpSource = (MEMORY_SOURCE) {
+        .szName = "Trace replay",
+        .EnumRegions = ReplayEnumRegions,
+        .ReadBatch = ReplayReadBatch,
+        .WriteBatch = ReplayWriteBatch,
+        .bFastReplay = !bRealTime,
+        .lpContext = lpReplay
+    };
+
+    lpReplay->hFile = CreateFileA(
+        szTracePath,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL
+    );
+
+    if (INVALID_HANDLE_VALUE == lpReplay->hFile) {
+        fprintf(
+            stderr,
+            "[-] CreateFileA(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    if (!GetFileSizeEx(
+        lpReplay->hFile,
+        &liFileSize
+    )) {
+        fprintf(
+            stderr,
+            "[-] GetFileSizeEx(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    lpReplay->cbFile = (DWORD64) liFileSize.QuadPart;
+
+    if (lpReplay->cbFile < sizeof(MEMORY_TRACE_HEADER)) {
+        fprintf(
+            stderr,
+            "[-] '%s' is too small to be a memory trace.\n",
+            szTracePath
+        );
+        goto _FINAL;
+    }
+
+    lpReplay->hMapping = CreateFileMappingA(
+        lpReplay->hFile,
+        NULL,
+        PAGE_READONLY,
+        0,
+        0,
+        NULL
+    );
+
+    if (NULL == lpReplay->hMapping) {
+        fprintf(
+            stderr,
+            "[-] CreateFileMappingA(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    lpReplay->lpView = MapViewOfFile(
+        lpReplay->hMapping,
+        FILE_MAP_READ,
+        0,
+        0,
+        0
+    );
+
+    if (NULL == lpReplay->lpView) {
+        fprintf(
+            stderr,
+            "[-] MapViewOfFile(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    LPCMEMORY_TRACE_HEADER lpHeader = (LPCMEMORY_TRACE_HEADER) lpReplay->lpView;
+
+    if (MEMORY_TRACE_MAGIC != lpHeader->dwMagic) {
+        fprintf(
+            stderr,
+            "[-] '%s' is not a memory trace.\n",
+            szTracePath
+        );
+        goto _FINAL;
+    }
+
+    if (MEMORY_TRACE_VERSION != lpHeader->dwVersion) {
+        fprintf(
+            stderr,
+            "[-] Unsupported memory trace version: %lu\n",
+            lpHeader->dwVersion
+        );
+        goto _FINAL;
+    }
+
+    lpSource->bSnapshot = (0 != (lpHeader->dwFlags & MEMORY_TRACE_FLAG_SNAPSHOT));
+
+    if (MEMORY_TRACE_COMPRESSION_XPRESS_HUFF == lpHeader->dwCompression && !CreateDecompressor(
+        COMPRESS_ALGORITHM_XPRESS_HUFF | COMPRESS_RAW,
+        NULL,
+        &lpReplay->hDecompressor
+    )) {
+        fprintf(
+            stderr,
+            "[-] CreateDecompressor(): E%lu\n",
+            GetLastError()
+        );
+        goto _FINAL;
+    }
+
+    if (!ParseMemoryTrace(lpReplay)) {
+        goto _FINAL;
+    }
+
+    printf(
+        "[*] Memory trace of %.*s source: %llu region queries, %llu reads and writes\n",
+        (INT) sizeof(lpHeader->szSourceName),
+        lpHeader->szSourceName,
+        lpReplay->qwEnumCount,
+        lpReplay->qwAnswerCount
+    );
+
+    QueryPerformanceFrequency(&lpReplay->liFrequency);
+    QueryPerformanceCounter(&lpReplay->liStart);
+
+    bRet = TRUE;
+
+_FINAL:
+    if (!bRet) {
+        CloseReplayMemorySource(lpSource);
+    }
+
+    return bRet;
+}
@@ -0,0 +1,87 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+///
+
+/// @file MemoryTrace.h
+///  Memory trace file format, every answer a memory source gave, in call order.
+///
+///  [MEMORY_TRACE_HEADER][MEMORY_TRACE_RECORD][payload][padding] ...
+///
+///  Payloads are padded to 8 bytes. Region queries store the reported
+///  regions as MEMORY_TRACE_REGION entries, reads the bytes that were read
+///  and writes the bytes that were written, compressed one by one if that
+///  makes them smaller.
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#ifndef _HEAT_HSHIFTER2_MEMORYTRACE_H
+#define _HEAT_HSHIFTER2_MEMORYTRACE_H
+
+#include "Utils.h"
+
+#define MEMORY_TRACE_MAGIC                      0x52545348          // 'HSTR'
+#define MEMORY_TRACE_VERSION                    1
+#define MEMORY_TRACE_MIN_COMPRESSED             0x100               // Smaller payloads are stored raw
+
+typedef enum _MEMORY_TRACE_COMPRESSION {
+    MEMORY_TRACE_COMPRESSION_NONE = 0,
+    MEMORY_TRACE_COMPRESSION_XPRESS_HUFF = 1 // Compression API, raw mode
+} MEMORY_TRACE_COMPRESSION, *LPMEMORY_TRACE_COMPRESSION;
+
+typedef enum _MEMORY_TRACE_RECORD_KIND {
+    MEMORY_TRACE_RECORD_ENUM = 1,       // EnumRegions()
+    MEMORY_TRACE_RECORD_READ,           // One request of ReadBatch()
+    MEMORY_TRACE_RECORD_WRITE           // One request of WriteBatch()
+} MEMORY_TRACE_RECORD_KIND, *LPMEMORY_TRACE_RECORD_KIND;
+
+#define MEMORY_TRACE_FLAG_SNAPSHOT              0x00000001          // Recorded source was a snapshot
+
+#pragma pack(push, 8)
+typedef struct _MEMORY_TRACE_HEADER {
+    DWORD dwMagic;
+    DWORD dwVersion;
+    DWORD dwFlags;                      // MEMORY_TRACE_FLAG_*
+    DWORD dwCompression;                // MEMORY_TRACE_COMPRESSION
+    CHAR szSourceName[32];              // Name of the recorded source
+} MEMORY_TRACE_HEADER, *LPMEMORY_TRACE_HEADER;
+
+typedef struct _MEMORY_TRACE_RECORD {
+    DWORD dwKind;                       // MEMORY_TRACE_RECORD_KIND
+    DWORD dwRegionCount;                // ENUM, MEMORY_TRACE_REGION entries in the payload
+    DWORD64 qwTimestamp;                // Microseconds since the recording started
+    DWORD64 qwAddress;                  // Request address, ENUM: lowest address of the query
+    DWORD64 cbSize;                     // Request size, ENUM: size of the queried range
+    DWORD64 cbTransferred;              // READ, WRITE: bytes transferred, ENUM: return value
+    DWORD64 cbStored;                   // Payload bytes, compressed if less than cbTransferred
+} MEMORY_TRACE_RECORD, *LPMEMORY_TRACE_RECORD;
+
+/// Region reported to the EnumRegions() callback.
+typedef struct _MEMORY_TRACE_REGION {
+    DWORD64 qwBaseAddress;
+    DWORD64 qwAllocationBase;
+    DWORD64 qwRegionSize;
+    DWORD dwState;
+    DWORD dwProtect;
+    DWORD dwType;
+    DWORD dwReserved;
+} MEMORY_TRACE_REGION, *LPMEMORY_TRACE_REGION;
+#pragma pack(pop)
+
+typedef CONST MEMORY_TRACE_HEADER *LPCMEMORY_TRACE_HEADER;
+typedef CONST MEMORY_TRACE_RECORD *LPCMEMORY_TRACE_RECORD;
+typedef CONST MEMORY_TRACE_REGION *LPCMEMORY_TRACE_REGION;
+
+#endif // _HEAT_HSHIFTER2_MEMORYTRACE_H
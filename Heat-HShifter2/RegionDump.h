@@ -0,0 +1,83 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+///
+
+/// @file RegionDump.h
+///  Region dump file format, region contents with a region table.
+///
+///  Version 1, raw region contents:
+///  [REGION_DUMP_HEADER][region data ...][REGION_DUMP_ENTRY x dwRegionCount]
+///
+///  Version 2, written by --dump. Regions are stored as blocks of up to
+///  REGION_DUMP_BLOCK_SIZE bytes of non-zero pages, compressed one by one,
+///  pages without a block are all zero:
+///  [REGION_DUMP_HEADER][block data ...][REGION_DUMP_ENTRY x dwRegionCount][REGION_DUMP_BLOCK x qwBlockCount]
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#ifndef _HEAT_HSHIFTER2_REGIONDUMP_H
+#define _HEAT_HSHIFTER2_REGIONDUMP_H
+
+#include "Utils.h"
+
+#define REGION_DUMP_MAGIC                       0x44525348          // 'HSRD'
+#define REGION_DUMP_VERSION_RAW                 1
+#define REGION_DUMP_VERSION_BLOCKS              2
+#define REGION_DUMP_BLOCK_SIZE                  0x10000             // Largest block, multiple of PAGE_SIZE
+
+typedef enum _REGION_DUMP_COMPRESSION {
+    REGION_DUMP_COMPRESSION_NONE = 0,
+    REGION_DUMP_COMPRESSION_XPRESS_HUFF = 1 // Compression API, raw mode
+} REGION_DUMP_COMPRESSION, *LPREGION_DUMP_COMPRESSION;
+
+#pragma pack(push, 8)
+typedef struct _REGION_DUMP_HEADER {
+    DWORD dwMagic;
+    DWORD dwVersion;
+    DWORD dwRegionCount;
+    DWORD dwReserved;
+    DWORD64 qwRegionTableOffset;        // File offset of the region table
+
+    // Version 2
+    DWORD64 qwBlockTableOffset;         // File offset of the block table
+    DWORD64 qwBlockCount;
+    DWORD dwCompression;                // REGION_DUMP_COMPRESSION
+    DWORD dwReserved2;
+} REGION_DUMP_HEADER, *LPREGION_DUMP_HEADER;
+
+/// Region table entry, sorted by base address.
+typedef struct _REGION_DUMP_ENTRY {
+    DWORD64 qwBaseAddress;
+    DWORD64 qwSize;
+    DWORD64 qwFileOffset;               // Version 1, file offset of the region contents, qwSize bytes
+    DWORD dwProtect;
+    DWORD dwType;
+} REGION_DUMP_ENTRY, *LPREGION_DUMP_ENTRY;
+
+/// Block table entry, sorted by address. A block never crosses a region.
+typedef struct _REGION_DUMP_BLOCK {
+    DWORD64 qwAddress;
+    DWORD64 qwFileOffset;
+    DWORD cbSize;                       // Multiple of PAGE_SIZE
+    DWORD cbStored;                     // Stored raw if equal to cbSize
+} REGION_DUMP_BLOCK, *LPREGION_DUMP_BLOCK;
+#pragma pack(pop)
+
+typedef CONST REGION_DUMP_HEADER *LPCREGION_DUMP_HEADER;
+typedef CONST REGION_DUMP_ENTRY *LPCREGION_DUMP_ENTRY;
+typedef CONST REGION_DUMP_BLOCK *LPCREGION_DUMP_BLOCK;
+
+#endif // _HEAT_HSHIFTER2_REGIONDUMP_H
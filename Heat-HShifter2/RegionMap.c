@@ -0,0 +1,573 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/// @file RegionMap.c
+/// @brief Cached map of the committed regions of the game process.
+///
+///  The address space is enumerated by the memory source over the real
+///  application address range and kept as a sorted array, which scans
+///  iterate instead of querying the source for every region again.
+///
+///  Regions also carry the history of the last scan: a fingerprint of a few
+///  sampled pages and the number of pattern hits. A refresh carries that
+///  history over to regions with the same base and size, so that rescans
+///  can visit new and modified regions first and skip unchanged regions
+///  that held no match. Only regions whose metadata changed are sampled
+///  again, in batches shared by all of them.
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+///
+
+#include "RegionMap.h"
+
+#include <stdio.h>
+
+/// LPMEMORY_REGION_CALLBACK, adds committed regions to the map.
+STATIC BOOLEAN AddMemoryRegion(
+    LPVOID lpContext,
+    CONST MEMORY_BASIC_INFORMATION *lpMemInfo
+) {
+    LPREGION_MAP lpRegionMap = (LPREGION_MAP) lpContext;
+
+    lpRegionMap->dwEnumeratedCount++;
+
+    if (MEM_COMMIT != lpMemInfo->State) {
+        return TRUE;
+    }
+
+    if (lpRegionMap->qwRegionCount == lpRegionMap->qwCapacity) {
+        CONST SIZE_T qwNewCapacity = (0 == lpRegionMap->qwCapacity)
+            ? REGION_MAP_INITIAL_CAPACITY
+            : lpRegionMap->qwCapacity * 2;
+
+        LPMEMORY_REGION aNewRegions = VirtualAlloc(
+            NULL,
+            qwNewCapacity * sizeof(MEMORY_REGION),
+            MEM_COMMIT | MEM_RESERVE,
+            PAGE_READWRITE
+        );
+
+        if (NULL == aNewRegions) {
+            fprintf(
+                stderr,
+                "[-] VirtualAlloc(): E%lu\n",
+                GetLastError()
+            );
+            return FALSE;
+        }
+
+        if (NULL != lpRegionMap->aRegions) {
+            memcpy(
+                aNewRegions,
+                lpRegionMap->aRegions,
+                lpRegionMap->qwRegionCount * sizeof(MEMORY_REGION)
+            );
+
+            VirtualFree(
+                lpRegionMap->aRegions,
+                0,
+                MEM_RELEASE
+            );
+        }
+
+        lpRegionMap->aRegions = aNewRegions;
+        lpRegionMap->qwCapacity = qwNewCapacity;
+    }
+
+    lpRegionMap->aRegions[lpRegionMap->qwRegionCount++] = (MEMORY_REGION) {
+        .lpBaseAddress = (LPCBYTE) lpMemInfo->BaseAddress,
+        .lpAllocationBase = (LPCBYTE) lpMemInfo->AllocationBase,
+        .cbSize = lpMemInfo->RegionSize,
+        .dwProtect = lpMemInfo->Protect,
+        .dwType = lpMemInfo->Type
+    };
+
+    lpRegionMap->cbCommitted += lpMemInfo->RegionSize;
+    return TRUE;
+}
+
+BOOLEAN IsMemoryRegionScannable(
+    LPCMEMORY_REGION lpRegion
+) {
+    CONST DWORD dwProtect = lpRegion->dwProtect;
+
+    if (PAGE_GUARD & dwProtect) {
+        return FALSE;
+    }
+
+    if (PAGE_NOACCESS & dwProtect) {
+        return FALSE;
+    }
+
+    if (PAGE_EXECUTE_READ & dwProtect) {
+        return FALSE;
+    }
+
+    if (!(PAGE_READWRITE & dwProtect)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/// Offsets of up to REGION_FINGERPRINT_SAMPLES pages spread evenly over the
+/// region, first and last page included. Returns the number of pages.
+STATIC DWORD GetFingerprintPages(
+    LPCMEMORY_REGION lpRegion,
+    SIZE_T aqwPage[REGION_FINGERPRINT_SAMPLES]
+) {
+    CONST SIZE_T qwLastPage = (lpRegion->cbSize / PAGE_SIZE) - 1;
+    DWORD dwPageCount = 0;
+
+    for (DWORD i = 0; i < REGION_FINGERPRINT_SAMPLES; ++i) {
+        CONST SIZE_T qwPage = (qwLastPage * i) / (REGION_FINGERPRINT_SAMPLES - 1);
+
+        // Small regions have fewer pages than samples
+        if (0 != dwPageCount && qwPage == aqwPage[dwPageCount - 1]) {
+            continue;
+        }
+
+        aqwPage[dwPageCount++] = qwPage;
+    }
+
+    return dwPageCount;
+}
+
+/// Returns whether a region of the new map must be sampled again, or can
+/// keep the fingerprint of the same region in the previous map.
+STATIC BOOLEAN IsFingerprintStale(
+    LPCMEMORY_REGION lpRegion,
+    LPCMEMORY_REGION lpPrevious
+) {
+    return (
+        NULL == lpPrevious
+        || REGION_STATE_NONE == lpPrevious->eState
+        || REGION_FINGERPRINT_INVALID == lpPrevious->qwFingerprint
+        || lpPrevious->lpAllocationBase != lpRegion->lpAllocationBase
+        || lpPrevious->dwProtect != lpRegion->dwProtect
+    );
+}
+
+/// Hashes the sampled pages of the regions between qwFirstRegion and
+/// qwEndRegion that are waiting for a fingerprint, in request order.
+STATIC VOID FoldRegionFingerprints(
+    LPREGION_MAP lpRegionMap,
+    CONST SIZE_T qwFirstRegion,
+    CONST SIZE_T qwEndRegion,
+    CONST MEMORY_IO *aRequests
+) {
+    SIZE_T aqwPage[REGION_FINGERPRINT_SAMPLES];
+    DWORD dwRequest = 0;
+
+    for (SIZE_T i = qwFirstRegion; i < qwEndRegion; ++i) {
+        LPMEMORY_REGION lpRegion = &lpRegionMap->aRegions[i];
+
+        if (
+            REGION_STATE_NONE == lpRegion->eState
+            || REGION_FINGERPRINT_INVALID != lpRegion->qwFingerprint
+        ) {
+            continue;
+        }
+
+        CONST DWORD dwPageCount = GetFingerprintPages(
+            lpRegion,
+            aqwPage
+        );
+
+        // FNV-1a, folded a QWORD at a time
+        DWORD64 qwHash = 0xCBF29CE484222325ULL ^ lpRegion->cbSize;
+        BOOLEAN bComplete = TRUE;
+
+        for (DWORD j = 0; j < dwPageCount; ++j, ++dwRequest) {
+            CONST DWORD64 *lpPage = (CONST DWORD64 *) aRequests[dwRequest].lpBuffer;
+
+            if (aRequests[dwRequest].cbTransferred != aRequests[dwRequest].cbSize) {
+                bComplete = FALSE;
+                continue;
+            }
+
+            for (DWORD k = 0; k < PAGE_SIZE / sizeof(DWORD64); ++k) {
+                qwHash = (qwHash ^ lpPage[k]) * 0x100000001B3ULL;
+            }
+        }
+
+        if (bComplete) {
+            lpRegion->qwFingerprint = (REGION_FINGERPRINT_INVALID == qwHash) ? 1 : qwHash;
+        }
+    }
+}
+
+/// Fingerprints the scannable regions still holding REGION_FINGERPRINT_INVALID.
+/// The sampled pages of all of them are read in batches of
+/// MEMORY_SOURCE_MAX_BATCH instead of one batch per region.
+STATIC VOID SampleRegionFingerprints(
+    LPREGION_MAP lpRegionMap,
+    LPMEMORY_SOURCE lpSource
+) {
+    MEMORY_IO aRequests[MEMORY_SOURCE_MAX_BATCH];
+    SIZE_T aqwPage[REGION_FINGERPRINT_SAMPLES];
+    DWORD dwRequestCount = 0;
+    SIZE_T qwFirstRegion = 0;
+
+    LPBYTE lpSamples = VirtualAlloc(
+        NULL,
+        MEMORY_SOURCE_MAX_BATCH * PAGE_SIZE,
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpSamples) {
+        // Regions without a fingerprint are classified as modified
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return;
+    }
+
+    for (SIZE_T i = 0; i <= lpRegionMap->qwRegionCount; ++i) {
+        LPCMEMORY_REGION lpRegion = (i < lpRegionMap->qwRegionCount)
+            ? &lpRegionMap->aRegions[i]
+            : NULL;
+
+        DWORD dwPageCount = 0;
+
+        if (NULL != lpRegion) {
+            if (
+                REGION_STATE_NONE == lpRegion->eState
+                || REGION_FINGERPRINT_INVALID != lpRegion->qwFingerprint
+            ) {
+                continue;
+            }
+
+            dwPageCount = GetFingerprintPages(
+                lpRegion,
+                aqwPage
+            );
+        }
+
+        // Flush once the next region no longer fits, and after the last one
+        if (
+            0 != dwRequestCount
+            && (NULL == lpRegion || dwRequestCount + dwPageCount > MEMORY_SOURCE_MAX_BATCH)
+        ) {
+            ReadMemoryScatter(
+                lpSource,
+                aRequests,
+                dwRequestCount
+            );
+
+            FoldRegionFingerprints(
+                lpRegionMap,
+                qwFirstRegion,
+                i,
+                aRequests
+            );
+
+            dwRequestCount = 0;
+        }
+
+        if (NULL == lpRegion) {
+            break;
+        }
+
+        if (0 == dwRequestCount) {
+            qwFirstRegion = i;
+        }
+
+        for (DWORD j = 0; j < dwPageCount; ++j) {
+            aRequests[dwRequestCount] = (MEMORY_IO) {
+                .lpAddress = lpRegion->lpBaseAddress + aqwPage[j] * PAGE_SIZE,
+                .lpBuffer = lpSamples + (SIZE_T) dwRequestCount * PAGE_SIZE,
+                .cbSize = PAGE_SIZE
+            };
+
+            dwRequestCount++;
+        }
+    }
+
+    VirtualFree(
+        lpSamples,
+        0,
+        MEM_RELEASE
+    );
+}
+
+/// Classifies the scannable regions of a freshly enumerated map against the
+/// regions of the previous map. Regions whose base, size, protection and
+/// allocation base are unchanged keep their previous fingerprint, content
+/// changes inside them are left to the unchanged tier of the scan.
+STATIC VOID InheritRegionHistory(
+    LPREGION_MAP lpRegionMap,
+    LPCREGION_MAP lpPreviousMap,
+    LPMEMORY_SOURCE lpSource
+) {
+    lpRegionMap->cbChanged = 0;
+    lpRegionMap->cbHit = 0;
+    lpRegionMap->cbUnscanned = 0;
+    lpRegionMap->cbUnchanged = 0;
+
+    for (SIZE_T i = 0; i < lpRegionMap->qwRegionCount; ++i) {
+        LPMEMORY_REGION lpRegion = &lpRegionMap->aRegions[i];
+
+        if (!IsMemoryRegionScannable(lpRegion)) {
+            lpRegion->eState = REGION_STATE_NONE;
+            continue;
+        }
+
+        LPCMEMORY_REGION lpPrevious = FindMemoryRegion(
+            lpPreviousMap,
+            lpRegion->lpBaseAddress
+        );
+
+        if (
+            NULL != lpPrevious
+            && (
+                lpPrevious->lpBaseAddress != lpRegion->lpBaseAddress
+                || lpPrevious->cbSize != lpRegion->cbSize
+            )
+        ) {
+            lpPrevious = NULL;
+        }
+
+        // Any state but NONE, until the fingerprints were sampled
+        lpRegion->eState = REGION_STATE_NEW;
+        lpRegion->qwFingerprint = IsFingerprintStale(lpRegion, lpPrevious)
+            ? REGION_FINGERPRINT_INVALID
+            : lpPrevious->qwFingerprint;
+    }
+
+    SampleRegionFingerprints(
+        lpRegionMap,
+        lpSource
+    );
+
+    for (SIZE_T i = 0; i < lpRegionMap->qwRegionCount; ++i) {
+        LPMEMORY_REGION lpRegion = &lpRegionMap->aRegions[i];
+
+        if (REGION_STATE_NONE == lpRegion->eState) {
+            continue;
+        }
+
+        LPCMEMORY_REGION lpPrevious = FindMemoryRegion(
+            lpPreviousMap,
+            lpRegion->lpBaseAddress
+        );
+
+        if (
+            NULL == lpPrevious
+            || lpPrevious->lpBaseAddress != lpRegion->lpBaseAddress
+            || lpPrevious->cbSize != lpRegion->cbSize
+            || REGION_STATE_NONE == lpPrevious->eState
+        ) {
+            lpRegion->eState = REGION_STATE_NEW;
+        } else if (
+            REGION_FINGERPRINT_INVALID == lpRegion->qwFingerprint
+            || lpPrevious->qwFingerprint != lpRegion->qwFingerprint
+        ) {
+            lpRegion->eState = REGION_STATE_MODIFIED;
+        } else if (
+            // A skipped unchanged region still has a complete history
+            REGION_STATE_UNCHANGED != lpPrevious->eState
+            && lpPrevious->qwBytesScanned != (LONG64) lpPrevious->cbSize
+        ) {
+            lpRegion->eState = REGION_STATE_UNSCANNED;
+        } else if (0 != lpPrevious->lHitCount) {
+            lpRegion->eState = REGION_STATE_HIT;
+        } else {
+            lpRegion->eState = REGION_STATE_UNCHANGED;
+        }
+
+        switch (lpRegion->eState) {
+            case REGION_STATE_HIT:
+                lpRegionMap->cbHit += lpRegion->cbSize;
+                break;
+
+            case REGION_STATE_UNSCANNED:
+                lpRegionMap->cbUnscanned += lpRegion->cbSize;
+                break;
+
+            case REGION_STATE_UNCHANGED:
+                lpRegionMap->cbUnchanged += lpRegion->cbSize;
+                break;
+
+            default:
+                lpRegionMap->cbChanged += lpRegion->cbSize;
+                break;
+        }
+    }
+}
+
+BOOLEAN RefreshRegionMap(
+    LPREGION_MAP lpRegionMap,
+    LPMEMORY_SOURCE lpSource
+) {
+    SYSTEM_INFO sysInfo = { 0 };
+
+    // History source, the new map is enumerated into a fresh array
+    CONST REGION_MAP previousMap = *lpRegionMap;
+
+    GetSystemInfo(&sysInfo);
+
+    ZeroMemory(
+        lpRegionMap,
+        sizeof(REGION_MAP)
+    );
+
+    lpRegionMap->lpMinimumAddress = (LPCBYTE) sysInfo.lpMinimumApplicationAddress;
+    lpRegionMap->lpMaximumAddress = (LPCBYTE) sysInfo.lpMaximumApplicationAddress;
+
+    if (!lpSource->EnumRegions(
+        lpSource,
+        lpRegionMap->lpMinimumAddress,
+        lpRegionMap->lpMaximumAddress,
+        AddMemoryRegion,
+        lpRegionMap
+    )) {
+        // Keep the previous map and its history
+        FreeRegionMap(lpRegionMap);
+        *lpRegionMap = previousMap;
+        return FALSE;
+    }
+
+    InheritRegionHistory(
+        lpRegionMap,
+        &previousMap,
+        lpSource
+    );
+
+    if (NULL != previousMap.aRegions) {
+        VirtualFree(
+            previousMap.aRegions,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    WriteLog(
+        "[*] Region map: %llu committed regions, %llu MiB, %lu regions enumerated by the %s source\n"
+        "[*] Region map: %llu MiB new or modified, %llu MiB with hits, %llu MiB unscanned, %llu MiB unchanged\n",
+        (DWORD64) lpRegionMap->qwRegionCount,
+        (DWORD64) lpRegionMap->cbCommitted >> 20,
+        lpRegionMap->dwEnumeratedCount,
+        lpSource->szName,
+        (DWORD64) lpRegionMap->cbChanged >> 20,
+        (DWORD64) lpRegionMap->cbHit >> 20,
+        (DWORD64) lpRegionMap->cbUnscanned >> 20,
+        (DWORD64) lpRegionMap->cbUnchanged >> 20
+    );
+
+    return (0 != lpRegionMap->qwRegionCount);
+}
+
+/// Index of the first region ending past lpAddress.
+STATIC SIZE_T FindRegionIndex(
+    LPCREGION_MAP lpRegionMap,
+    LPCVOID lpAddress
+) {
+    SIZE_T qwLow = 0;
+    SIZE_T qwHigh = lpRegionMap->qwRegionCount;
+
+    while (qwLow < qwHigh) {
+        CONST SIZE_T qwMiddle = qwLow + (qwHigh - qwLow) / 2;
+        LPCMEMORY_REGION lpRegion = &lpRegionMap->aRegions[qwMiddle];
+
+        if (lpRegion->lpBaseAddress + lpRegion->cbSize <= (LPCBYTE) lpAddress) {
+            qwLow = qwMiddle + 1;
+        } else {
+            qwHigh = qwMiddle;
+        }
+    }
+
+    return qwLow;
+}
+
+LPCMEMORY_REGION FindMemoryRegion(
+    LPCREGION_MAP lpRegionMap,
+    LPCVOID lpAddress
+) {
+    CONST SIZE_T qwIndex = FindRegionIndex(
+        lpRegionMap,
+        lpAddress
+    );
+
+    if (qwIndex == lpRegionMap->qwRegionCount) {
+        return NULL;
+    }
+
+    LPCMEMORY_REGION lpRegion = &lpRegionMap->aRegions[qwIndex];
+    return (lpRegion->lpBaseAddress <= (LPCBYTE) lpAddress) ? lpRegion : NULL;
+}
+
+VOID RecordRegionHit(
+    LPREGION_MAP lpRegionMap,
+    LPCVOID lpAddress
+) {
+    CONST SIZE_T qwIndex = FindRegionIndex(
+        lpRegionMap,
+        lpAddress
+    );
+
+    if (
+        qwIndex < lpRegionMap->qwRegionCount
+        && lpRegionMap->aRegions[qwIndex].lpBaseAddress <= (LPCBYTE) lpAddress
+    ) {
+        InterlockedIncrement(&lpRegionMap->aRegions[qwIndex].lHitCount);
+    }
+}
+
+VOID MarkRegionsScanned(
+    LPREGION_MAP lpRegionMap,
+    LPCVOID lpAddress,
+    CONST SIZE_T cbSize
+) {
+    LPCBYTE lpStart = (LPCBYTE) lpAddress;
+    LPCBYTE lpEnd = lpStart + cbSize;
+
+    for (
+        SIZE_T i = FindRegionIndex(lpRegionMap, lpAddress);
+        i < lpRegionMap->qwRegionCount && lpRegionMap->aRegions[i].lpBaseAddress < lpEnd;
+        ++i
+    ) {
+        LPMEMORY_REGION lpRegion = &lpRegionMap->aRegions[i];
+
+        CONST LPCBYTE lpOverlapStart = max(lpStart, lpRegion->lpBaseAddress);
+        CONST LPCBYTE lpOverlapEnd = min(lpEnd, lpRegion->lpBaseAddress + lpRegion->cbSize);
+
+        InterlockedExchangeAdd64(
+            &lpRegion->qwBytesScanned,
+            (LONG64) (lpOverlapEnd - lpOverlapStart)
+        );
+    }
+}
+
+VOID FreeRegionMap(
+    LPREGION_MAP lpRegionMap
+) {
+    if (NULL != lpRegionMap->aRegions) {
+        VirtualFree(
+            lpRegionMap->aRegions,
+            0,
+            MEM_RELEASE
+        );
+    }
+
+    ZeroMemory(
+        lpRegionMap,
+        sizeof(REGION_MAP)
+    );
+}
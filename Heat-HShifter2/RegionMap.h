@@ -0,0 +1,144 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+///
+
+/// @file RegionMap.h
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#ifndef _HEAT_HSHIFTER2_REGIONMAP_H
+#define _HEAT_HSHIFTER2_REGIONMAP_H
+
+#include "Utils.h"
+#include "MemorySource.h"
+
+#define REGION_MAP_INITIAL_CAPACITY             4096
+#define REGION_FINGERPRINT_SAMPLES              4                   // Pages hashed per region, spread evenly
+#define REGION_FINGERPRINT_INVALID              0ULL
+
+typedef enum _REGION_STATE {
+    REGION_STATE_NONE = 0,              // Not scannable
+    REGION_STATE_NEW = 1 << 0,          // Not in the previous map, freshly allocated
+    REGION_STATE_MODIFIED = 1 << 1,     // Fingerprint changed since the previous scan
+    REGION_STATE_HIT = 1 << 2,          // Unchanged, had pattern hits in the previous scan
+    REGION_STATE_UNSCANNED = 1 << 3,    // Unchanged, but the previous scan stopped before covering it
+    REGION_STATE_UNCHANGED = 1 << 4     // Unchanged, no pattern hits in the previous scan
+} REGION_STATE, *LPREGION_STATE;
+
+typedef struct _MEMORY_REGION {
+    LPCBYTE lpBaseAddress;
+    LPCBYTE lpAllocationBase;
+    SIZE_T cbSize;
+    DWORD dwProtect;
+    DWORD dwType;                       // MEM_PRIVATE, MEM_MAPPED or MEM_IMAGE
+
+    // Scan history, inherited by RefreshRegionMap() while base and size stay the same,
+    // the fingerprint is only sampled again once protection or allocation base change
+    REGION_STATE eState;
+    DWORD64 qwFingerprint;
+    VOLATILE LONG lHitCount;            // Pattern hits of the current scan
+    VOLATILE LONG64 qwBytesScanned;     // History is only trusted once the whole region was scanned
+} MEMORY_REGION, *LPMEMORY_REGION;
+
+typedef CONST MEMORY_REGION *LPCMEMORY_REGION;
+
+typedef struct _REGION_MAP {
+    LPMEMORY_REGION aRegions;           // Committed regions, sorted by base address
+    SIZE_T qwRegionCount;
+    SIZE_T qwCapacity;
+
+    // Application address range of the target, taken from GetSystemInfo()
+    LPCBYTE lpMinimumAddress;
+    LPCBYTE lpMaximumAddress;
+
+    SIZE_T cbCommitted;
+    SIZE_T cbChanged;                   // REGION_STATE_NEW or REGION_STATE_MODIFIED
+    SIZE_T cbHit;
+    SIZE_T cbUnscanned;
+    SIZE_T cbUnchanged;
+
+    DWORD dwEnumeratedCount;            // Regions reported by the memory source on the last refresh
+} REGION_MAP, *LPREGION_MAP;
+
+typedef CONST REGION_MAP *LPCREGION_MAP;
+
+/// <summary>
+///  Returns whether a region may hold gear artifacts and is worth scanning.
+/// </summary>
+/// <param name="lpRegion"></param>
+BOOLEAN IsMemoryRegionScannable(
+    LPCMEMORY_REGION lpRegion
+);
+
+/// <summary>
+///  Enumerates all committed regions of the target process into the map,
+///  replacing its previous contents. Scannable regions are classified
+///  against the scan history of the previous map, new regions and regions
+///  with changed metadata are fingerprinted in batches.
+/// </summary>
+/// <param name="lpRegionMap"></param>
+/// <param name="lpSource"></param>
+/// <returns>
+///  TRUE if the map was enumerated, FALSE on failure.
+/// </returns>
+BOOLEAN RefreshRegionMap(
+    LPREGION_MAP lpRegionMap,
+    LPMEMORY_SOURCE lpSource
+);
+
+/// <summary>
+///  Finds the committed region containing an address.
+/// </summary>
+/// <param name="lpRegionMap"></param>
+/// <param name="lpAddress"></param>
+/// <returns>
+///  Region containing lpAddress, NULL if the address is not committed.
+/// </returns>
+LPCMEMORY_REGION FindMemoryRegion(
+    LPCREGION_MAP lpRegionMap,
+    LPCVOID lpAddress
+);
+
+/// <summary>
+///  Counts a pattern hit against the region containing the address.
+/// </summary>
+/// <param name="lpRegionMap"></param>
+/// <param name="lpAddress"></param>
+VOID RecordRegionHit(
+    LPREGION_MAP lpRegionMap,
+    LPCVOID lpAddress
+);
+
+/// <summary>
+///  Records that part of the address space was scanned in full.
+/// </summary>
+/// <param name="lpRegionMap"></param>
+/// <param name="lpAddress"></param>
+/// <param name="cbSize"></param>
+VOID MarkRegionsScanned(
+    LPREGION_MAP lpRegionMap,
+    LPCVOID lpAddress,
+    CONST SIZE_T cbSize
+);
+
+/// <summary>
+///  Releases the region array of the map.
+/// </summary>
+/// <param name="lpRegionMap"></param>
+VOID FreeRegionMap(
+    LPREGION_MAP lpRegionMap
+);
+
+#endif // _HEAT_HSHIFTER2_REGIONMAP_H
@@ -0,0 +1,1114 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/// @file Search.c
+/// @brief Pattern compiler, search kernels and signature packs used by the memory scanner.
+///
+///  Patterns are compiled into a search plan. The two fixed pattern bytes
+///  that are rarest in game heap memory become anchors, which the SSE2 and
+///  AVX2 kernels test for 32 or 64 positions at once. Address alignment
+///  constraints mask out vector lanes, or for coarse alignments are stepped
+///  over directly. Without a vector kernel, a Horspool skip table is used
+///  when its expected shift on heap memory is worth it.
+///  Only positions passing both anchors are compared in full.
+///
+///  Signatures come either built-in or from a versioned signature pack (INI),
+///  for example:
+///
+///    [PACK]
+///    VERSION=1
+///    COUNT=1
+///
+///    [SIGNATURE0]
+///    NAME=current_gear
+///    TARGET=CURRENT
+///    PATTERN=00 00 00 00 ?? ?? ?? ?? 00 00 00 00 AA 61 1C 3F AA 61 1C 3F
+///    NIBBLE=0x4
+///
+///  PATTERN bytes are hex, "??" matches any byte.
+///  NIBBLE=n is shorthand for ALIGNMENT=0x10 with ALIGNMENT_OFFSET=n.
+///  Layout keys (NIBBLE, ALIGNMENT, ALIGNMENT_OFFSET, GEAR_OFFSET,
+///  LIVE_OFFSET, LIVE_SIZE, STATIC_OFFSET) default to the built-in layout
+///  of the TARGET gear.
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+///
+
+#include "Search.h"
+
+#include <Shlwapi.h>
+
+#include <stdio.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SEARCH_X86_KERNELS
+#include <intrin.h>
+#endif
+
+// GCC (Winelib builds) only emits AVX2 and XGETBV in functions built for them
+#ifdef __GNUC__
+#define SEARCH_TARGET(szTarget)                 __attribute__((target(szTarget)))
+#else
+#define SEARCH_TARGET(szTarget)
+#endif
+
+STATIC VOLATILE SEARCH_KERNEL g_eSearchKernel = SEARCH_KERNEL_INVALID;
+
+STATIC CONST BYTE g_abyCurrentGearPattern[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xAA, 0x61, 0x1C, 0x3F,
+    0xAA, 0x61, 0x1C, 0x3F
+};
+
+STATIC CONST BYTE g_abyLastGearPattern[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x3F,
+    0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x3F,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+static_assert(
+    sizeof(g_abyCurrentGearPattern) == HEAT_CURRENT_GEAR_ARTIFACT_SIZE,
+    "Current gear artifact size mismatch."
+);
+
+static_assert(
+    sizeof(g_abyLastGearPattern) == HEAT_LAST_GEAR_ARTIFACT_SIZE,
+    "Last gear artifact size mismatch."
+);
+
+/// Approximate share of a byte value in game heap memory, in 1/4096ths.
+/// Zero fill dominates, followed by -1 fill, float exponent bytes
+/// (0x3F800000 == 1.0f) and small integers.
+STATIC DWORD GetHeapByteWeight(
+    BYTE byValue
+) {
+    switch (byValue) {
+        case 0x00:
+            return 1536;
+
+        case 0xFF:
+            return 192;
+
+        case 0x3F:
+        case 0x40:
+        case 0x80:
+        case 0xBF:
+            return 48;
+
+        default:
+            break;
+    }
+
+    if (byValue < 0x10) {
+        return 24;
+    }
+
+    // Printable ASCII
+    if (byValue >= 0x20 && byValue < 0x7F) {
+        return 12;
+    }
+
+    return 8;
+}
+
+STATIC INLINE BOOLEAN IsFixedPatternByte(
+    LPCSEARCH_PATTERN lpSearchPattern,
+    SIZE_T qwOffset
+) {
+    return (NULL == lpSearchPattern->abyMask || 0 != lpSearchPattern->abyMask[qwOffset]);
+}
+
+/// Picks the rarest fixed byte as the first anchor, and the rarest other
+/// fixed byte as the second one, preferring the one furthest from the first
+/// so that the two anchors rarely hit on the same fill run.
+STATIC VOID SelectAnchors(
+    LPSEARCH_PATTERN lpSearchPattern
+) {
+    LPCBYTE abyPattern = lpSearchPattern->abyPattern;
+
+    SIZE_T qwFirstAnchor = SEARCH_NOT_FOUND;
+    for (SIZE_T i = 0; i < lpSearchPattern->cbPatternSize; ++i) {
+        if (!IsFixedPatternByte(lpSearchPattern, i)) {
+            continue;
+        }
+
+        if (
+            SEARCH_NOT_FOUND == qwFirstAnchor
+            || GetHeapByteWeight(abyPattern[i]) < GetHeapByteWeight(abyPattern[qwFirstAnchor])
+        ) {
+            qwFirstAnchor = i;
+        }
+    }
+
+    // Single fixed byte, both anchors test the same position
+    SIZE_T qwSecondAnchor = qwFirstAnchor;
+    SIZE_T qwSecondDistance = 0;
+    for (SIZE_T i = 0; i < lpSearchPattern->cbPatternSize; ++i) {
+        if (i == qwFirstAnchor || !IsFixedPatternByte(lpSearchPattern, i)) {
+            continue;
+        }
+
+        CONST SIZE_T qwDistance = (i > qwFirstAnchor)
+            ? i - qwFirstAnchor
+            : qwFirstAnchor - i;
+
+        if (qwSecondAnchor != qwFirstAnchor) {
+            CONST DWORD dwWeight = GetHeapByteWeight(abyPattern[i]);
+            CONST DWORD dwSecondWeight = GetHeapByteWeight(abyPattern[qwSecondAnchor]);
+
+            if (dwWeight > dwSecondWeight) {
+                continue;
+            }
+
+            if (dwWeight == dwSecondWeight && qwDistance <= qwSecondDistance) {
+                continue;
+            }
+        }
+
+        qwSecondAnchor = i;
+        qwSecondDistance = qwDistance;
+    }
+
+    lpSearchPattern->aqwAnchorOffset[0] = qwFirstAnchor;
+    lpSearchPattern->aqwAnchorOffset[1] = qwSecondAnchor;
+    lpSearchPattern->abyAnchor[0] = abyPattern[qwFirstAnchor];
+    lpSearchPattern->abyAnchor[1] = abyPattern[qwSecondAnchor];
+}
+
+/// Builds the Horspool table and returns the expected shift on heap memory.
+STATIC DWORD BuildSkipTable(
+    LPSEARCH_PATTERN lpSearchPattern
+) {
+    CONST SIZE_T cbPatternSize = lpSearchPattern->cbPatternSize;
+
+    memset(
+        lpSearchPattern->abySkip,
+        (BYTE) min(cbPatternSize, MAXBYTE),
+        sizeof(lpSearchPattern->abySkip)
+    );
+
+    // The last byte itself never produces a shift
+    for (SIZE_T i = 0; i + 1 < cbPatternSize; ++i) {
+        CONST BYTE byShift = (BYTE) min(cbPatternSize - 1 - i, MAXBYTE);
+
+        if (IsFixedPatternByte(lpSearchPattern, i)) {
+            lpSearchPattern->abySkip[lpSearchPattern->abyPattern[i]] = min(
+                lpSearchPattern->abySkip[lpSearchPattern->abyPattern[i]],
+                byShift
+            );
+            continue;
+        }
+
+        // Wildcards line up with any byte
+        for (DWORD j = 0; j < ARRAYSIZE(lpSearchPattern->abySkip); ++j) {
+            lpSearchPattern->abySkip[j] = min(lpSearchPattern->abySkip[j], byShift);
+        }
+    }
+
+    DWORD64 qwWeightedShift = 0;
+    DWORD64 qwTotalWeight = 0;
+    for (DWORD i = 0; i < ARRAYSIZE(lpSearchPattern->abySkip); ++i) {
+        CONST DWORD dwWeight = GetHeapByteWeight((BYTE) i);
+
+        qwWeightedShift += (DWORD64) dwWeight * lpSearchPattern->abySkip[i];
+        qwTotalWeight += dwWeight;
+    }
+
+    return (DWORD) (qwWeightedShift / qwTotalWeight);
+}
+
+BOOLEAN CompileSearchPattern(
+    LPSEARCH_PATTERN lpSearchPattern,
+    LPCBYTE abyPattern,
+    LPCBYTE abyMask,
+    CONST SIZE_T cbPatternSize,
+    CONST DWORD dwAlignment,
+    CONST DWORD dwAlignmentOffset
+) {
+    if (0 == cbPatternSize) {
+        return FALSE;
+    }
+
+    // Power of two
+    if (0 == dwAlignment || 0 != (dwAlignment & (dwAlignment - 1))) {
+        return FALSE;
+    }
+
+    if (dwAlignmentOffset >= dwAlignment) {
+        return FALSE;
+    }
+
+    ZeroMemory(
+        lpSearchPattern,
+        sizeof(SEARCH_PATTERN)
+    );
+
+    lpSearchPattern->abyPattern = abyPattern;
+    lpSearchPattern->abyMask = abyMask;
+    lpSearchPattern->cbPatternSize = cbPatternSize;
+    lpSearchPattern->dwAlignment = dwAlignment;
+    lpSearchPattern->dwAlignmentOffset = dwAlignmentOffset;
+
+    SIZE_T cbFixed = 0;
+    for (SIZE_T i = 0; i < cbPatternSize; ++i) {
+        if (IsFixedPatternByte(lpSearchPattern, i)) {
+            cbFixed++;
+        }
+    }
+
+    if (0 == cbFixed) {
+        return FALSE;
+    }
+
+    lpSearchPattern->bHasWildcards = (cbFixed != cbPatternSize);
+
+    if (dwAlignment <= SEARCH_LANE_MASK_MAX_ALIGNMENT) {
+        for (DWORD i = 0; i < SEARCH_LANE_MASK_MAX_ALIGNMENT; i += dwAlignment) {
+            lpSearchPattern->dwLaneMask |= 1UL << i;
+        }
+    }
+
+    SelectAnchors(lpSearchPattern);
+
+    CONST DWORD dwExpectedShift = BuildSkipTable(lpSearchPattern);
+
+    if (dwAlignment > SEARCH_LANE_MASK_MAX_ALIGNMENT) {
+        lpSearchPattern->eStrategy = SEARCH_STRATEGY_ALIGNED;
+    } else if (SEARCH_KERNEL_SCALAR != GetSearchKernel()) {
+        lpSearchPattern->eStrategy = SEARCH_STRATEGY_ANCHOR;
+    } else if (1 == dwAlignment && dwExpectedShift >= SEARCH_HORSPOOL_MIN_EXPECTED_SHIFT) {
+        lpSearchPattern->eStrategy = SEARCH_STRATEGY_HORSPOOL;
+    } else {
+        lpSearchPattern->eStrategy = SEARCH_STRATEGY_ALIGNED;
+    }
+
+    return TRUE;
+}
+
+STATIC INLINE BOOLEAN IsPatternMatch(
+    LPCSEARCH_PATTERN lpSearchPattern,
+    LPCBYTE lpCandidate
+) {
+    if (!lpSearchPattern->bHasWildcards) {
+        return (EXIT_SUCCESS == memcmp(
+            lpCandidate,
+            lpSearchPattern->abyPattern,
+            lpSearchPattern->cbPatternSize
+        ));
+    }
+
+    for (SIZE_T i = 0; i < lpSearchPattern->cbPatternSize; ++i) {
+        if (0 != ((lpCandidate[i] ^ lpSearchPattern->abyPattern[i]) & lpSearchPattern->abyMask[i])) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/// Anchor test on every aligned position, stepping by the alignment.
+STATIC SIZE_T FindPatternScalar(
+    LPCSEARCH_PATTERN lpSearchPattern,
+    LPCBYTE lpBuffer,
+    SIZE_T qwStartIndex,
+    CONST SIZE_T qwLastIndex,
+    CONST DWORD64 qwBaseAddress
+) {
+    LPCBYTE lpFirstAnchor = lpBuffer + lpSearchPattern->aqwAnchorOffset[0];
+    LPCBYTE lpSecondAnchor = lpBuffer + lpSearchPattern->aqwAnchorOffset[1];
+
+    CONST DWORD dwAlignment = lpSearchPattern->dwAlignment;
+
+    // Round up to the first position with the required alignment
+    qwStartIndex += (SIZE_T) (
+        (lpSearchPattern->dwAlignmentOffset - (qwBaseAddress + qwStartIndex)) & (dwAlignment - 1)
+    );
+
+    for (SIZE_T i = qwStartIndex; i <= qwLastIndex; i += dwAlignment) {
+        if (lpFirstAnchor[i] != lpSearchPattern->abyAnchor[0]) {
+            continue;
+        }
+
+        if (lpSecondAnchor[i] != lpSearchPattern->abyAnchor[1]) {
+            continue;
+        }
+
+        if (IsPatternMatch(lpSearchPattern, lpBuffer + i)) {
+            return i;
+        }
+    }
+
+    return SEARCH_NOT_FOUND;
+}
+
+STATIC SIZE_T FindPatternHorspool(
+    LPCSEARCH_PATTERN lpSearchPattern,
+    LPCBYTE lpBuffer,
+    SIZE_T qwStartIndex,
+    CONST SIZE_T qwLastIndex
+) {
+    LPCBYTE lpLastByte = lpBuffer + lpSearchPattern->cbPatternSize - 1;
+    LPCBYTE lpFirstAnchor = lpBuffer + lpSearchPattern->aqwAnchorOffset[0];
+    LPCBYTE lpSecondAnchor = lpBuffer + lpSearchPattern->aqwAnchorOffset[1];
+
+    for (SIZE_T i = qwStartIndex; i <= qwLastIndex; i += lpSearchPattern->abySkip[lpLastByte[i]]) {
+        if (lpFirstAnchor[i] != lpSearchPattern->abyAnchor[0]) {
+            continue;
+        }
+
+        if (lpSecondAnchor[i] != lpSearchPattern->abyAnchor[1]) {
+            continue;
+        }
+
+        if (IsPatternMatch(lpSearchPattern, lpBuffer + i)) {
+            return i;
+        }
+    }
+
+    return SEARCH_NOT_FOUND;
+}
+
+#ifdef SEARCH_X86_KERNELS
+/// Lanes of every 32-position block holding an aligned position.
+/// Blocks advance by 32 and the alignment divides 32, so the mask
+/// only depends on the alignment phase of the first block.
+STATIC INLINE DWORD GetLaneMask(
+    LPCSEARCH_PATTERN lpSearchPattern,
+    CONST DWORD64 qwBlockAddress
+) {
+    CONST DWORD dwAlignmentMask = lpSearchPattern->dwAlignment - 1;
+
+    return lpSearchPattern->dwLaneMask << (
+        (lpSearchPattern->dwAlignmentOffset - (DWORD) qwBlockAddress) & dwAlignmentMask
+    );
+}
+
+/// Runs the full compare on every anchor hit in a 32-position block.
+STATIC INLINE SIZE_T ResolveCandidates(
+    LPCSEARCH_PATTERN lpSearchPattern,
+    LPCBYTE lpBuffer,
+    CONST SIZE_T qwBlockIndex,
+    DWORD dwCandidateMask
+) {
+    while (0 != dwCandidateMask) {
+        unsigned long ulBit = 0;
+        _BitScanForward(&ulBit, dwCandidateMask);
+
+        if (IsPatternMatch(lpSearchPattern, lpBuffer + qwBlockIndex + ulBit)) {
+            return qwBlockIndex + ulBit;
+        }
+
+        // Clear lowest set bit
+        dwCandidateMask &= dwCandidateMask - 1;
+    }
+
+    return SEARCH_NOT_FOUND;
+}
+
+STATIC SIZE_T FindPatternSse2(
+    LPCSEARCH_PATTERN lpSearchPattern,
+    LPCBYTE lpBuffer,
+    SIZE_T qwStartIndex,
+    CONST SIZE_T qwLastIndex,
+    CONST DWORD64 qwBaseAddress
+) {
+    LPCBYTE lpFirstAnchor = lpBuffer + lpSearchPattern->aqwAnchorOffset[0];
+    LPCBYTE lpSecondAnchor = lpBuffer + lpSearchPattern->aqwAnchorOffset[1];
+
+    CONST __m128i xmmFirstAnchor = _mm_set1_epi8((CHAR) lpSearchPattern->abyAnchor[0]);
+    CONST __m128i xmmSecondAnchor = _mm_set1_epi8((CHAR) lpSearchPattern->abyAnchor[1]);
+
+    CONST DWORD dwLaneMask = GetLaneMask(
+        lpSearchPattern,
+        qwBaseAddress + qwStartIndex
+    );
+
+    SIZE_T i = qwStartIndex;
+    for (; i + 32 <= qwLastIndex + 1; i += 32) {
+        __m128i xmmLow = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_loadu_si128((CONST __m128i *) (lpFirstAnchor + i)), xmmFirstAnchor),
+            _mm_cmpeq_epi8(_mm_loadu_si128((CONST __m128i *) (lpSecondAnchor + i)), xmmSecondAnchor)
+        );
+
+        __m128i xmmHigh = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_loadu_si128((CONST __m128i *) (lpFirstAnchor + i + 16)), xmmFirstAnchor),
+            _mm_cmpeq_epi8(_mm_loadu_si128((CONST __m128i *) (lpSecondAnchor + i + 16)), xmmSecondAnchor)
+        );
+
+        DWORD dwCandidateMask = ((DWORD) _mm_movemask_epi8(xmmLow)
+            | ((DWORD) _mm_movemask_epi8(xmmHigh) << 16)) & dwLaneMask;
+
+        if (0 == dwCandidateMask) {
+            continue;
+        }
+
+        SIZE_T qwMatch = ResolveCandidates(
+            lpSearchPattern,
+            lpBuffer,
+            i,
+            dwCandidateMask
+        );
+
+        if (SEARCH_NOT_FOUND != qwMatch) {
+            return qwMatch;
+        }
+    }
+
+    return FindPatternScalar(
+        lpSearchPattern,
+        lpBuffer,
+        i,
+        qwLastIndex,
+        qwBaseAddress
+    );
+}
+
+SEARCH_TARGET("avx2")
+STATIC SIZE_T FindPatternAvx2(
+    LPCSEARCH_PATTERN lpSearchPattern,
+    LPCBYTE lpBuffer,
+    SIZE_T qwStartIndex,
+    CONST SIZE_T qwLastIndex,
+    CONST DWORD64 qwBaseAddress
+) {
+    LPCBYTE lpFirstAnchor = lpBuffer + lpSearchPattern->aqwAnchorOffset[0];
+    LPCBYTE lpSecondAnchor = lpBuffer + lpSearchPattern->aqwAnchorOffset[1];
+
+    CONST __m256i ymmFirstAnchor = _mm256_set1_epi8((CHAR) lpSearchPattern->abyAnchor[0]);
+    CONST __m256i ymmSecondAnchor = _mm256_set1_epi8((CHAR) lpSearchPattern->abyAnchor[1]);
+
+    CONST DWORD dwLaneMask = GetLaneMask(
+        lpSearchPattern,
+        qwBaseAddress + qwStartIndex
+    );
+
+    SIZE_T i = qwStartIndex;
+    for (; i + 64 <= qwLastIndex + 1; i += 64) {
+        __m256i ymmLow = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((CONST __m256i *) (lpFirstAnchor + i)), ymmFirstAnchor),
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((CONST __m256i *) (lpSecondAnchor + i)), ymmSecondAnchor)
+        );
+
+        __m256i ymmHigh = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((CONST __m256i *) (lpFirstAnchor + i + 32)), ymmFirstAnchor),
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((CONST __m256i *) (lpSecondAnchor + i + 32)), ymmSecondAnchor)
+        );
+
+        // Test both halves at once, hits are rare
+        if (_mm256_testz_si256(
+            _mm256_or_si256(ymmLow, ymmHigh),
+            _mm256_or_si256(ymmLow, ymmHigh)
+        )) {
+            continue;
+        }
+
+        SIZE_T qwMatch = ResolveCandidates(
+            lpSearchPattern,
+            lpBuffer,
+            i,
+            (DWORD) _mm256_movemask_epi8(ymmLow) & dwLaneMask
+        );
+
+        if (SEARCH_NOT_FOUND != qwMatch) {
+            return qwMatch;
+        }
+
+        qwMatch = ResolveCandidates(
+            lpSearchPattern,
+            lpBuffer,
+            i + 32,
+            (DWORD) _mm256_movemask_epi8(ymmHigh) & dwLaneMask
+        );
+
+        if (SEARCH_NOT_FOUND != qwMatch) {
+            return qwMatch;
+        }
+    }
+
+    // Leave the remaining positions to the narrower kernel
+    return FindPatternSse2(
+        lpSearchPattern,
+        lpBuffer,
+        i,
+        qwLastIndex,
+        qwBaseAddress
+    );
+}
+
+SEARCH_TARGET("xsave")
+STATIC BOOLEAN IsAvx2Supported(
+    VOID
+) {
+    INT aiCpuInfo[4] = { 0 };
+
+    __cpuid(aiCpuInfo, 0);
+    if (aiCpuInfo[0] < 7) {
+        return FALSE;
+    }
+
+    // OSXSAVE and AVX
+    __cpuid(aiCpuInfo, 1);
+    if ((aiCpuInfo[2] & (1 << 27 | 1 << 28)) != (1 << 27 | 1 << 28)) {
+        return FALSE;
+    }
+
+    // OS must preserve both XMM and YMM state
+    if ((_xgetbv(0) & 0x6) != 0x6) {
+        return FALSE;
+    }
+
+    __cpuidex(aiCpuInfo, 7, 0);
+    return (0 != (aiCpuInfo[1] & (1 << 5)));
+}
+#endif // SEARCH_X86_KERNELS
+
+STATIC SEARCH_KERNEL DetectSearchKernel(
+    VOID
+) {
+    SEARCH_KERNEL eKernel = SEARCH_KERNEL_SCALAR;
+
+#ifdef SEARCH_X86_KERNELS
+    if (IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE)) {
+        eKernel = SEARCH_KERNEL_SSE2;
+    }
+
+    if (SEARCH_KERNEL_SSE2 == eKernel && IsAvx2Supported()) {
+        eKernel = SEARCH_KERNEL_AVX2;
+    }
+#endif
+
+    return eKernel;
+}
+
+SEARCH_KERNEL GetSearchKernel(
+    VOID
+) {
+    if (SEARCH_KERNEL_INVALID == g_eSearchKernel) {
+        g_eSearchKernel = DetectSearchKernel();
+    }
+
+    return g_eSearchKernel;
+}
+
+BOOLEAN SetSearchKernel(
+    CONST SEARCH_KERNEL eKernel
+) {
+    // Kernels are ordered by the instruction sets they need
+    if (eKernel > DetectSearchKernel()) {
+        return FALSE;
+    }
+
+    g_eSearchKernel = eKernel;
+    return TRUE;
+}
+
+LPCSTR GetSearchKernelName(
+    SEARCH_KERNEL eKernel
+) {
+    switch (eKernel) {
+        case SEARCH_KERNEL_SCALAR:
+            return "scalar";
+
+        case SEARCH_KERNEL_SSE2:
+            return "SSE2";
+
+        case SEARCH_KERNEL_AVX2:
+            return "AVX2";
+
+        default:
+            return "invalid";
+    }
+}
+
+SIZE_T FindPattern(
+    LPCSEARCH_PATTERN lpSearchPattern,
+    LPCBYTE lpBuffer,
+    CONST SIZE_T cbBuffer,
+    SIZE_T qwStartIndex,
+    CONST DWORD64 qwBaseAddress
+) {
+    if (cbBuffer < lpSearchPattern->cbPatternSize) {
+        return SEARCH_NOT_FOUND;
+    }
+
+    CONST SIZE_T qwLastIndex = cbBuffer - lpSearchPattern->cbPatternSize;
+    if (qwStartIndex > qwLastIndex) {
+        return SEARCH_NOT_FOUND;
+    }
+
+    switch (lpSearchPattern->eStrategy) {
+        case SEARCH_STRATEGY_HORSPOOL:
+            return FindPatternHorspool(
+                lpSearchPattern,
+                lpBuffer,
+                qwStartIndex,
+                qwLastIndex
+            );
+
+        case SEARCH_STRATEGY_ALIGNED:
+            return FindPatternScalar(
+                lpSearchPattern,
+                lpBuffer,
+                qwStartIndex,
+                qwLastIndex,
+                qwBaseAddress
+            );
+
+        default:
+            break;
+    }
+
+    switch (GetSearchKernel()) {
+#ifdef SEARCH_X86_KERNELS
+        case SEARCH_KERNEL_AVX2:
+            return FindPatternAvx2(
+                lpSearchPattern,
+                lpBuffer,
+                qwStartIndex,
+                qwLastIndex,
+                qwBaseAddress
+            );
+
+        case SEARCH_KERNEL_SSE2:
+            return FindPatternSse2(
+                lpSearchPattern,
+                lpBuffer,
+                qwStartIndex,
+                qwLastIndex,
+                qwBaseAddress
+            );
+#endif
+
+        default:
+            return FindPatternScalar(
+                lpSearchPattern,
+                lpBuffer,
+                qwStartIndex,
+                qwLastIndex,
+                qwBaseAddress
+            );
+    }
+}
+
+STATIC VOID InitSignatureLayout(
+    LPSIGNATURE lpSignature,
+    TARGET_GEAR eTargetGear
+) {
+    lpSignature->eTargetGear = eTargetGear;
+
+    if (TARGET_GEAR_CURRENT == eTargetGear) {
+        lpSignature->dwAlignment = SIGNATURE_NIBBLE_ALIGNMENT;
+        lpSignature->dwAlignmentOffset = HEAT_CURRENT_GEAR_ARTIFACT_NIBBLE;
+        lpSignature->lGearOffset = HEAT_CURRENT_GEAR_ARTIFACT_OFFSET;
+        lpSignature->lLiveOffset = AOBSCAN_CURRENT_GEAR_LIVE_MEMORY_OFFSET;
+        lpSignature->cbLiveSize = HEAT_CURRENT_GEAR_ARTIFACT_SIZE;
+        lpSignature->lStaticOffset = lpSignature->lLiveOffset - (LONG) sizeof(DWORD64);
+    } else {
+        lpSignature->dwAlignment = 1;
+        lpSignature->dwAlignmentOffset = 0;
+        lpSignature->lGearOffset = HEAT_LAST_GEAR_ARTIFACT_OFFSET;
+        lpSignature->lLiveOffset = -AOBSCAN_LAST_GEAR_LIVE_MEMORY_OFFSET;
+        lpSignature->cbLiveSize = HEAT_LAST_GEAR_ARTIFACT_SIZE;
+        lpSignature->lStaticOffset = lpSignature->lLiveOffset + (LONG) sizeof(DWORD64);
+    }
+}
+
+STATIC VOID InitSignature(
+    LPSIGNATURE lpSignature,
+    LPCSTR szName,
+    TARGET_GEAR eTargetGear,
+    LPCBYTE abyPattern,
+    CONST SIZE_T cbPatternSize
+) {
+    ZeroMemory(
+        lpSignature,
+        sizeof(SIGNATURE)
+    );
+
+    strncpy_s(
+        lpSignature->szName,
+        sizeof(lpSignature->szName),
+        szName,
+        _TRUNCATE
+    );
+
+    InitSignatureLayout(
+        lpSignature,
+        eTargetGear
+    );
+
+    memcpy(
+        lpSignature->abyPattern,
+        abyPattern,
+        cbPatternSize
+    );
+
+    memset(
+        lpSignature->abyMask,
+        0xFF,
+        cbPatternSize
+    );
+
+    CompileSearchPattern(
+        &lpSignature->SearchPattern,
+        lpSignature->abyPattern,
+        lpSignature->abyMask,
+        cbPatternSize,
+        lpSignature->dwAlignment,
+        lpSignature->dwAlignmentOffset
+    );
+}
+
+VOID InitDefaultSignaturePack(
+    LPSIGNATURE_PACK lpSignaturePack
+) {
+    lpSignaturePack->dwVersion = SIGNATURE_PACK_VERSION;
+    lpSignaturePack->dwSignatureCount = 2;
+
+    InitSignature(
+        &lpSignaturePack->aSignatures[0],
+        "current_gear",
+        TARGET_GEAR_CURRENT,
+        g_abyCurrentGearPattern,
+        sizeof(g_abyCurrentGearPattern)
+    );
+
+    InitSignature(
+        &lpSignaturePack->aSignatures[1],
+        "last_gear",
+        TARGET_GEAR_LAST,
+        g_abyLastGearPattern,
+        sizeof(g_abyLastGearPattern)
+    );
+}
+
+/// Parses space separated hex bytes, e.g. "00 AA ?? 1C", "??" or "?" is a wildcard.
+STATIC BOOLEAN ParsePatternString(
+    LPCWSTR wszPattern,
+    LPBYTE abyPattern,
+    LPBYTE abyMask,
+    PSIZE_T lpcbPatternSize
+) {
+    SIZE_T cbPatternSize = 0;
+    LPCWSTR wszCursor = wszPattern;
+
+    while (L'\0' != *wszCursor) {
+        if (L' ' == *wszCursor || L'\t' == *wszCursor) {
+            ++wszCursor;
+            continue;
+        }
+
+        if (SIGNATURE_MAX_SIZE == cbPatternSize) {
+            return FALSE;
+        }
+
+        if (L'?' == *wszCursor) {
+            wszCursor += (L'?' == wszCursor[1]) ? 2 : 1;
+
+            if (L'\0' != *wszCursor && L' ' != *wszCursor && L'\t' != *wszCursor) {
+                return FALSE;
+            }
+
+            abyPattern[cbPatternSize] = 0x00;
+            abyMask[cbPatternSize++] = 0x00;
+            continue;
+        }
+
+        LPWSTR wszEnd = NULL;
+        ULONG ulValue = wcstoul(
+            wszCursor,
+            &wszEnd,
+            16
+        );
+
+        if (wszEnd == wszCursor || ulValue > 0xFF) {
+            return FALSE;
+        }
+
+        abyPattern[cbPatternSize] = (BYTE) ulValue;
+        abyMask[cbPatternSize++] = 0xFF;
+        wszCursor = wszEnd;
+    }
+
+    *lpcbPatternSize = cbPatternSize;
+    return (0 != cbPatternSize);
+}
+
+/// GetPrivateProfileIntW() clamps negative values to 0, offsets can be negative.
+STATIC LONG GetPrivateProfileLongW(
+    LPCWSTR wszSection,
+    LPCWSTR wszKey,
+    LONG lDefault,
+    LPCWSTR wszFilePath
+) {
+    WCHAR wszValue[32] = { 0 };
+
+    if (0 == GetPrivateProfileStringW(
+        wszSection,
+        wszKey,
+        L"",
+        wszValue,
+        ARRAYSIZE(wszValue),
+        wszFilePath
+    )) {
+        return lDefault;
+    }
+
+    LPWSTR wszEnd = NULL;
+    LONG lValue = wcstol(
+        wszValue,
+        &wszEnd,
+        0
+    );
+
+    return (wszEnd == wszValue) ? lDefault : lValue;
+}
+
+STATIC BOOLEAN LoadSignature(
+    LPSIGNATURE lpSignature,
+    LPCWSTR wszSection,
+    LPCWSTR wszPackFilePath
+) {
+    WCHAR wszValue[SIGNATURE_MAX_SIZE * 3 + 1] = { 0 };
+    SIZE_T cbPatternSize = 0;
+
+    ZeroMemory(
+        lpSignature,
+        sizeof(SIGNATURE)
+    );
+
+    GetPrivateProfileStringW(
+        wszSection,
+        L"TARGET",
+        L"",
+        wszValue,
+        ARRAYSIZE(wszValue),
+        wszPackFilePath
+    );
+
+    if (EXIT_SUCCESS == _wcsicmp(wszValue, L"CURRENT")) {
+        InitSignatureLayout(lpSignature, TARGET_GEAR_CURRENT);
+    } else if (EXIT_SUCCESS == _wcsicmp(wszValue, L"LAST")) {
+        InitSignatureLayout(lpSignature, TARGET_GEAR_LAST);
+    } else {
+        fwprintf(
+            stderr,
+            L"[-] [%s] Invalid TARGET: '%s'\n",
+            wszSection,
+            wszValue
+        );
+        return FALSE;
+    }
+
+    GetPrivateProfileStringW(
+        wszSection,
+        L"PATTERN",
+        L"",
+        wszValue,
+        ARRAYSIZE(wszValue),
+        wszPackFilePath
+    );
+
+    if (!ParsePatternString(
+        wszValue,
+        lpSignature->abyPattern,
+        lpSignature->abyMask,
+        &cbPatternSize
+    )) {
+        fwprintf(
+            stderr,
+            L"[-] [%s] Invalid PATTERN\n",
+            wszSection
+        );
+        return FALSE;
+    }
+
+    GetPrivateProfileStringW(
+        wszSection,
+        L"NAME",
+        wszSection,
+        wszValue,
+        ARRAYSIZE(wszValue),
+        wszPackFilePath
+    );
+
+    WideCharToMultiByte(
+        CP_UTF8,
+        0,
+        wszValue,
+        -1,
+        lpSignature->szName,
+        sizeof(lpSignature->szName) - 1,
+        NULL,
+        NULL
+    );
+
+    // Layout defaults to the built-in one of the target gear
+    CONST LONG lNibble = GetPrivateProfileLongW(
+        wszSection,
+        L"NIBBLE",
+        -1,
+        wszPackFilePath
+    );
+
+    if (-1 != lNibble) {
+        lpSignature->dwAlignment = SIGNATURE_NIBBLE_ALIGNMENT;
+        lpSignature->dwAlignmentOffset = (DWORD) lNibble;
+    }
+
+    lpSignature->dwAlignment = (DWORD) GetPrivateProfileLongW(
+        wszSection,
+        L"ALIGNMENT",
+        (LONG) lpSignature->dwAlignment,
+        wszPackFilePath
+    );
+
+    lpSignature->dwAlignmentOffset = (DWORD) GetPrivateProfileLongW(
+        wszSection,
+        L"ALIGNMENT_OFFSET",
+        (LONG) lpSignature->dwAlignmentOffset,
+        wszPackFilePath
+    );
+
+    lpSignature->lGearOffset = GetPrivateProfileLongW(
+        wszSection,
+        L"GEAR_OFFSET",
+        lpSignature->lGearOffset,
+        wszPackFilePath
+    );
+
+    lpSignature->lLiveOffset = GetPrivateProfileLongW(
+        wszSection,
+        L"LIVE_OFFSET",
+        lpSignature->lLiveOffset,
+        wszPackFilePath
+    );
+
+    lpSignature->cbLiveSize = (DWORD) GetPrivateProfileLongW(
+        wszSection,
+        L"LIVE_SIZE",
+        (LONG) lpSignature->cbLiveSize,
+        wszPackFilePath
+    );
+
+    lpSignature->lStaticOffset = GetPrivateProfileLongW(
+        wszSection,
+        L"STATIC_OFFSET",
+        lpSignature->lStaticOffset,
+        wszPackFilePath
+    );
+
+    if (0 == lpSignature->cbLiveSize || lpSignature->cbLiveSize > SIGNATURE_MAX_SIZE) {
+        fwprintf(
+            stderr,
+            L"[-] [%s] Invalid LIVE_SIZE: %lu\n",
+            wszSection,
+            lpSignature->cbLiveSize
+        );
+        return FALSE;
+    }
+
+    if (!CompileSearchPattern(
+        &lpSignature->SearchPattern,
+        lpSignature->abyPattern,
+        lpSignature->abyMask,
+        cbPatternSize,
+        lpSignature->dwAlignment,
+        lpSignature->dwAlignmentOffset
+    )) {
+        fwprintf(
+            stderr,
+            L"[-] [%s] PATTERN has no fixed byte or invalid ALIGNMENT: 0x%lX:0x%lX\n",
+            wszSection,
+            lpSignature->dwAlignment,
+            lpSignature->dwAlignmentOffset
+        );
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOLEAN LoadSignaturePack(
+    LPSIGNATURE_PACK lpSignaturePack,
+    LPCWSTR wszPackFilePath
+) {
+    if (!PathFileExistsW(wszPackFilePath)) {
+        return FALSE;
+    }
+
+    DWORD dwVersion = GetPrivateProfileIntW(
+        L"PACK",
+        L"VERSION",
+        0,
+        wszPackFilePath
+    );
+
+    if (SIGNATURE_PACK_VERSION != dwVersion) {
+        fprintf(
+            stderr,
+            "[-] Unsupported signature pack version: %lu (expected %u)\n",
+            dwVersion,
+            SIGNATURE_PACK_VERSION
+        );
+        return FALSE;
+    }
+
+    DWORD dwCount = GetPrivateProfileIntW(
+        L"PACK",
+        L"COUNT",
+        0,
+        wszPackFilePath
+    );
+
+    if (dwCount > SIGNATURE_PACK_MAX_SIGNATURES) {
+        fprintf(
+            stderr,
+            "[-] Too many signatures in pack: %lu (max %u)\n",
+            dwCount,
+            SIGNATURE_PACK_MAX_SIGNATURES
+        );
+        return FALSE;
+    }
+
+    lpSignaturePack->dwVersion = dwVersion;
+    lpSignaturePack->dwSignatureCount = 0;
+
+    for (DWORD i = 0; i < dwCount; ++i) {
+        WCHAR wszSection[32] = { 0 };
+        swprintf_s(
+            wszSection,
+            ARRAYSIZE(wszSection),
+            L"SIGNATURE%lu",
+            i
+        );
+
+        if (!LoadSignature(
+            &lpSignaturePack->aSignatures[lpSignaturePack->dwSignatureCount],
+            wszSection,
+            wszPackFilePath
+        )) {
+            // Skip broken entries, keep the rest of the pack usable
+            continue;
+        }
+
+        lpSignaturePack->dwSignatureCount++;
+    }
+
+    return (0 != lpSignaturePack->dwSignatureCount);
+}
@@ -0,0 +1,289 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+///
+
+/// @file Search.h
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#ifndef _HEAT_HSHIFTER2_SEARCH_H
+#define _HEAT_HSHIFTER2_SEARCH_H
+
+#include "Utils.h"
+#include "RegionMap.h"
+
+#define SEARCH_NOT_FOUND                        ((SIZE_T) -1)
+
+#define SIGNATURE_PACK_FILE_NAME                L"signatures.ini"
+#define SIGNATURE_PACK_VERSION                  1
+#define SIGNATURE_PACK_MAX_SIGNATURES           16
+#define SIGNATURE_MAX_SIZE                      0x40
+#define SIGNATURE_NAME_LENGTH                   32
+#define SIGNATURE_NIBBLE_ALIGNMENT              0x10
+
+// Alignments up to the vector width are applied as a lane mask,
+// coarser ones are cheaper to visit one aligned position at a time
+#define SEARCH_LANE_MASK_MAX_ALIGNMENT          32
+// Minimum expected Horspool shift on heap memory for the skip table to pay off
+#define SEARCH_HORSPOOL_MIN_EXPECTED_SHIFT      4
+
+typedef enum _SEARCH_KERNEL {
+    SEARCH_KERNEL_SCALAR = 0,
+    SEARCH_KERNEL_SSE2,
+    SEARCH_KERNEL_AVX2,
+    SEARCH_KERNEL_INVALID = 0xFFFFFFFF
+} SEARCH_KERNEL, *LPSEARCH_KERNEL;
+
+typedef enum _SEARCH_STRATEGY {
+    SEARCH_STRATEGY_ANCHOR = 0,         // Vector anchor filter, alignment applied as a lane mask
+    SEARCH_STRATEGY_ALIGNED,            // Anchor test on aligned positions only
+    SEARCH_STRATEGY_HORSPOOL            // Bad character skip table, unaligned patterns only
+} SEARCH_STRATEGY, *LPSEARCH_STRATEGY;
+
+/// Search plan emitted by CompileSearchPattern().
+typedef struct _SEARCH_PATTERN {
+    LPCBYTE abyPattern;
+    LPCBYTE abyMask;                    // 0xFF = byte must match, 0x00 = wildcard
+    SIZE_T cbPatternSize;
+    BOOLEAN bHasWildcards;
+
+    // Match address % dwAlignment must equal dwAlignmentOffset
+    DWORD dwAlignment;
+    DWORD dwAlignmentOffset;
+    DWORD dwLaneMask;                   // Lanes of a 32-position block at alignment phase 0
+
+    SEARCH_STRATEGY eStrategy;
+
+    // The two rarest pattern bytes, tested before any full compare
+    SIZE_T aqwAnchorOffset[2];
+    BYTE abyAnchor[2];
+
+    // Horspool shift by the buffer byte under the last pattern byte
+    BYTE abySkip[256];
+} SEARCH_PATTERN, *LPSEARCH_PATTERN;
+
+typedef CONST SEARCH_PATTERN *LPCSEARCH_PATTERN;
+
+typedef struct _SIGNATURE {
+    CHAR szName[SIGNATURE_NAME_LENGTH];
+    TARGET_GEAR eTargetGear;
+
+    BYTE abyPattern[SIGNATURE_MAX_SIZE];
+    BYTE abyMask[SIGNATURE_MAX_SIZE];
+    SEARCH_PATTERN SearchPattern;       // Refers to abyPattern and abyMask, don't copy signatures around
+
+    // Artifact address % dwAlignment must equal dwAlignmentOffset
+    DWORD dwAlignment;
+    DWORD dwAlignmentOffset;
+
+    // Artifact layout, all offsets relative to the artifact address
+    LONG lGearOffset;
+    LONG lLiveOffset;
+    DWORD cbLiveSize;
+    LONG lStaticOffset;                 // DWORD that must not change while live memory does
+} SIGNATURE, *LPSIGNATURE;
+
+typedef CONST SIGNATURE *LPCSIGNATURE;
+
+typedef struct _SIGNATURE_PACK {
+    DWORD dwVersion;
+    DWORD dwSignatureCount;
+    SIGNATURE aSignatures[SIGNATURE_PACK_MAX_SIGNATURES];
+} SIGNATURE_PACK, *LPSIGNATURE_PACK;
+
+typedef CONST SIGNATURE_PACK *LPCSIGNATURE_PACK;
+
+typedef struct _AOBSCAN_ARTIFACT {
+    LPCVOID lpArtifact;
+    DWORD dwSignatureId;
+    DWORD dwScore;
+} AOBSCAN_ARTIFACT, *LPAOBSCAN_ARTIFACT;
+
+typedef CONST AOBSCAN_ARTIFACT *LPCAOBSCAN_ARTIFACT;
+
+typedef struct _AOBSCAN_RESULT {
+    // Best ranked artifact per target gear
+    LPCVOID alpArtifact[TARGET_GEAR_LAST + 1];
+    DWORD adwSignatureId[TARGET_GEAR_LAST + 1];
+
+    // All kept verified artifacts per target gear, best first
+    AOBSCAN_ARTIFACT aaRankedArtifacts[TARGET_GEAR_LAST + 1][AOBSCAN_MAX_RANKED_ARTIFACTS];
+    DWORD adwRankedCount[TARGET_GEAR_LAST + 1];
+
+    DWORD adwHitCount[SIGNATURE_PACK_MAX_SIGNATURES];
+    DWORD dwCandidateCount;             // Hits admitted to verification, all passes
+    BOOLEAN bAbandoned;                 // Aborted or timed out, the artifacts are incomplete
+
+    // All passes
+    DWORD64 qwBytesScanned;
+    DOUBLE fScanSeconds;
+} AOBSCAN_RESULT, *LPAOBSCAN_RESULT;
+
+typedef CONST AOBSCAN_RESULT *LPCAOBSCAN_RESULT;
+
+/// Memory scanned by AobScanTarget(), AobScan() scans the game with its own region map.
+typedef struct _AOBSCAN_TARGET {
+    LPMEMORY_SOURCE lpSource;
+    LPREGION_MAP lpRegionMap;           // Carries the history of the previous scan of the source
+    DWORD dwWorkerCount;                // 0 for one per processor
+    BOOLEAN bShowProgress;              // Console progress and scan summary
+    CONST VOLATILE LONG *lplAbort;      // Optional, the scan is abandoned once it is nonzero
+    DWORD dwTimeoutMs;                  // 0 for no limit
+} AOBSCAN_TARGET, *LPAOBSCAN_TARGET;
+
+typedef CONST AOBSCAN_TARGET *LPCAOBSCAN_TARGET;
+
+/// <summary>
+///  Compiles a pattern into a search plan.
+///  Picks the rarest pattern bytes as anchors, builds the skip table
+///  and selects the search strategy for the detected kernel.
+/// </summary>
+/// <param name="lpSearchPattern"></param>
+/// <param name="abyPattern"></param>
+/// <param name="abyMask">Per-byte mask, 0x00 marks a wildcard. NULL if the pattern has no wildcards.</param>
+/// <param name="cbPatternSize"></param>
+/// <param name="dwAlignment">Required match address alignment, power of two.</param>
+/// <param name="dwAlignmentOffset">Required match address remainder modulo dwAlignment.</param>
+/// <returns>
+///  TRUE if the pattern was compiled, FALSE if it has no fixed byte or the alignment is invalid.
+/// </returns>
+BOOLEAN CompileSearchPattern(
+    LPSEARCH_PATTERN lpSearchPattern,
+    LPCBYTE abyPattern,
+    LPCBYTE abyMask,
+    CONST SIZE_T cbPatternSize,
+    CONST DWORD dwAlignment,
+    CONST DWORD dwAlignmentOffset
+);
+
+/// <summary>
+///  Returns the fastest search kernel supported by the CPU and OS.
+/// </summary>
+/// <returns>
+///  Selected search kernel, detected once and cached.
+/// </returns>
+SEARCH_KERNEL GetSearchKernel(
+    VOID
+);
+
+/// <summary>
+///  Overrides the detected search kernel, for benchmarks of the slower ones.
+///  Patterns compiled before keep the strategy they were compiled with.
+/// </summary>
+/// <param name="eKernel"></param>
+/// <returns>
+///  TRUE if the CPU and OS support the kernel, FALSE otherwise.
+/// </returns>
+BOOLEAN SetSearchKernel(
+    CONST SEARCH_KERNEL eKernel
+);
+
+/// <summary>
+///  Returns a printable name of the search kernel.
+/// </summary>
+/// <param name="eKernel"></param>
+LPCSTR GetSearchKernelName(
+    SEARCH_KERNEL eKernel
+);
+
+/// <summary>
+///  Finds the next full pattern match in a local buffer.
+/// </summary>
+/// <param name="lpSearchPattern"></param>
+/// <param name="lpBuffer"></param>
+/// <param name="cbBuffer"></param>
+/// <param name="qwStartIndex">First buffer index at which a match may start.</param>
+/// <param name="qwBaseAddress">Address lpBuffer[0] is mapped at, alignment constraints apply to it.</param>
+/// <returns>
+///  Buffer index of the match, SEARCH_NOT_FOUND if there is none.
+/// </returns>
+SIZE_T FindPattern(
+    LPCSEARCH_PATTERN lpSearchPattern,
+    LPCBYTE lpBuffer,
+    CONST SIZE_T cbBuffer,
+    SIZE_T qwStartIndex,
+    CONST DWORD64 qwBaseAddress
+);
+
+/// <summary>
+///  Fills a signature pack with the built-in gear artifact signatures.
+/// </summary>
+/// <param name="lpSignaturePack"></param>
+VOID InitDefaultSignaturePack(
+    LPSIGNATURE_PACK lpSignaturePack
+);
+
+/// <summary>
+///  Loads a versioned signature pack file.
+/// </summary>
+/// <param name="lpSignaturePack"></param>
+/// <param name="wszPackFilePath"></param>
+/// <returns>
+///  TRUE if the pack was loaded, FALSE if it is missing, malformed or of an unsupported version.
+/// </returns>
+BOOLEAN LoadSignaturePack(
+    LPSIGNATURE_PACK lpSignaturePack,
+    LPCWSTR wszPackFilePath
+);
+
+/// <summary>
+///  Scans target memory for all signatures of a pack in a single pass.
+/// </summary>
+/// <param name="lpSignaturePack"></param>
+/// <param name="lpResult">Receives the verified artifacts per target gear, ranked by score.</param>
+/// <returns>
+///  TRUE if a verified artifact was found for every target gear in the pack, FALSE otherwise.
+/// </returns>
+BOOLEAN AobScan(
+    LPCSIGNATURE_PACK lpSignaturePack,
+    LPAOBSCAN_RESULT lpResult
+);
+
+/// <summary>
+///  AobScan() that can be given up on from another thread, for rescans
+///  that run while the shifter keeps shifting on the old addresses.
+/// </summary>
+/// <param name="lpSignaturePack"></param>
+/// <param name="lpResult">Receives the verified artifacts per target gear, bAbandoned if the scan was given up on.</param>
+/// <param name="lplAbort">Set to nonzero to abandon the scan.</param>
+/// <param name="dwTimeoutMs">Abandons the scan after this long, 0 for no limit.</param>
+/// <returns>
+///  TRUE if a verified artifact was found for every target gear in the pack before the scan
+///  was abandoned, FALSE otherwise.
+/// </returns>
+BOOLEAN AobScanAbortable(
+    LPCSIGNATURE_PACK lpSignaturePack,
+    LPAOBSCAN_RESULT lpResult,
+    CONST VOLATILE LONG *lplAbort,
+    CONST DWORD dwTimeoutMs
+);
+
+/// <summary>
+///  Scans any memory source for all signatures of a pack in a single pass.
+///  Scans of different sources with different region maps may run concurrently.
+/// </summary>
+/// <param name="lpTarget"></param>
+/// <param name="lpSignaturePack"></param>
+/// <param name="lpResult">Receives the verified artifacts per target gear, ranked by score.</param>
+/// <returns>
+///  TRUE if a verified artifact was found for every target gear in the pack, FALSE otherwise.
+/// </returns>
+BOOLEAN AobScanTarget(
+    LPCAOBSCAN_TARGET lpTarget,
+    LPCSIGNATURE_PACK lpSignaturePack,
+    LPAOBSCAN_RESULT lpResult
+);
+
+#endif // _HEAT_HSHIFTER2_SEARCH_H
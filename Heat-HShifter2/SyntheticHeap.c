@@ -0,0 +1,141 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/// @file SyntheticHeap.c
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#include "SyntheticHeap.h"
+
+#include <string.h>
+
+DWORD64 NextRandom(
+    PDWORD64 lpqwRandomState
+) {
+    DWORD64 qwState = *lpqwRandomState;
+
+    qwState ^= qwState >> 12;
+    qwState ^= qwState << 25;
+    qwState ^= qwState >> 27;
+    *lpqwRandomState = qwState;
+
+    return qwState * 0x2545F4914F6CDD1DULL;
+}
+
+DWORD64 NextRandomBelow(
+    PDWORD64 lpqwRandomState,
+    CONST DWORD64 qwBound
+) {
+    return (0 == qwBound) ? 0 : NextRandom(lpqwRandomState) % qwBound;
+}
+
+VOID FillHeapPage(
+    PDWORD64 lpqwRandomState,
+    LPDWORD lpPage
+) {
+    CONST DWORD64 qwKind = NextRandomBelow(lpqwRandomState, 100);
+
+    // Zero pages, VirtualAlloc() already cleared them
+    if (qwKind < 40) {
+        return;
+    }
+
+    for (DWORD i = 0; i < PAGE_SIZE / sizeof(DWORD); ++i) {
+        if (qwKind < 60) {
+            // Floats around 1.0f
+            lpPage[i] = 0x3F800000 | (DWORD) NextRandomBelow(lpqwRandomState, 0x800000);
+        } else if (qwKind < 80) {
+            lpPage[i] = (DWORD) NextRandomBelow(lpqwRandomState, 0x100);
+        } else if (qwKind < 90) {
+            lpPage[i] = 0xFFFFFFFF;
+        } else {
+            lpPage[i] = (DWORD) NextRandom(lpqwRandomState);
+        }
+    }
+}
+
+LPBYTE AlignArtifactAddress(
+    LPCSIGNATURE lpSignature,
+    LPBYTE lpAddress
+) {
+    CONST DWORD dwAlignment = lpSignature->dwAlignment;
+    CONST DWORD dwGearNibble = (TARGET_GEAR_CURRENT == lpSignature->eTargetGear)
+        ? HEAT_GEAR_ADDRESS_NIBBLE
+        : HEAT_LAST_GEAR_ADDRESS_NIBBLE;
+
+    // Signatures aligned to less than a nibble leave the gear address nibble to the game
+    if (dwAlignment < 0x10) {
+        lpAddress += (dwGearNibble - GET_NIBBLE(lpAddress + lpSignature->lGearOffset)) & 0xF;
+    }
+
+    return lpAddress + (dwAlignment + lpSignature->dwAlignmentOffset - (DWORD64) lpAddress % dwAlignment) % dwAlignment;
+}
+
+VOID PlantArtifact(
+    PDWORD64 lpqwRandomState,
+    LPCSIGNATURE lpSignature,
+    LPBYTE lpArtifact,
+    CONST DWORD dwGear
+) {
+    CONST DWORD dwStatic = (DWORD) NextRandom(lpqwRandomState) | 1;
+
+    for (SIZE_T i = 0; i < lpSignature->SearchPattern.cbPatternSize; ++i) {
+        lpArtifact[i] = (0x00 != lpSignature->abyMask[i])
+            ? lpSignature->abyPattern[i]
+            : (BYTE) NextRandom(lpqwRandomState);
+    }
+
+    memcpy(
+        lpArtifact + lpSignature->lStaticOffset,
+        &dwStatic,
+        sizeof(DWORD)
+    );
+
+    memcpy(
+        lpArtifact + lpSignature->lGearOffset,
+        &dwGear,
+        sizeof(DWORD)
+    );
+}
+
+STATIC BOOLEAN AreFieldsOverlapping(
+    CONST LONG lFirstOffset,
+    CONST LONG lFirstSize,
+    CONST LONG lSecondOffset,
+    CONST LONG lSecondSize
+) {
+    return (lFirstOffset < lSecondOffset + lSecondSize && lSecondOffset < lFirstOffset + lFirstSize);
+}
+
+LONG GetLiveFieldOffset(
+    LPCSIGNATURE lpSignature
+) {
+    CONST LONG lLiveEnd = lpSignature->lLiveOffset + (LONG) lpSignature->cbLiveSize;
+
+    for (LONG lOffset = lpSignature->lLiveOffset; lOffset + (LONG) sizeof(DWORD) <= lLiveEnd; lOffset += sizeof(DWORD)) {
+        if (
+            AreFieldsOverlapping(lOffset, sizeof(DWORD), 0, (LONG) lpSignature->SearchPattern.cbPatternSize)
+            || AreFieldsOverlapping(lOffset, sizeof(DWORD), lpSignature->lGearOffset, sizeof(DWORD))
+            || AreFieldsOverlapping(lOffset, sizeof(DWORD), lpSignature->lStaticOffset, sizeof(DWORD))
+        ) {
+            continue;
+        }
+
+        return lOffset;
+    }
+
+    return lpSignature->lLiveOffset;
+}
@@ -0,0 +1,97 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/// @file SyntheticHeap.h
+///  Synthetic game memory of the simulator and the benchmarks: seeded noise
+///  that looks like game heap memory, and signature artifacts planted into it
+///  the way the game lays its structs out.
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#ifndef _HEAT_HSHIFTER2_SYNTHETICHEAP_H
+#define _HEAT_HSHIFTER2_SYNTHETICHEAP_H
+
+#include "Search.h"
+
+/// <summary>
+///  xorshift64*, the same seed gives the same memory contents.
+/// </summary>
+/// <param name="lpqwRandomState">Seed, nonzero.</param>
+DWORD64 NextRandom(
+    PDWORD64 lpqwRandomState
+);
+
+/// <summary>
+///  Random number in [0, qwBound), 0 if qwBound is 0.
+/// </summary>
+/// <param name="lpqwRandomState"></param>
+/// <param name="qwBound"></param>
+DWORD64 NextRandomBelow(
+    PDWORD64 lpqwRandomState,
+    CONST DWORD64 qwBound
+);
+
+/// <summary>
+///  Fills a zeroed page with one of the value kinds that dominate game heap memory.
+/// </summary>
+/// <param name="lpqwRandomState"></param>
+/// <param name="lpPage">PAGE_SIZE bytes, as VirtualAlloc() returns them.</param>
+VOID FillHeapPage(
+    PDWORD64 lpqwRandomState,
+    LPDWORD lpPage
+);
+
+/// <summary>
+///  Moves an artifact address up to the alignment of the signature and,
+///  for signatures aligned to less than a nibble, to the gear address nibble of the game.
+/// </summary>
+/// <param name="lpSignature"></param>
+/// <param name="lpAddress"></param>
+/// <returns>
+///  The artifact address, less than 0x10 + dwAlignment bytes past lpAddress.
+/// </returns>
+LPBYTE AlignArtifactAddress(
+    LPCSIGNATURE lpSignature,
+    LPBYTE lpAddress
+);
+
+/// <summary>
+///  Writes the pattern, a random static field and the gear of a signature at lpArtifact.
+///  Wildcard bytes of the pattern are random.
+/// </summary>
+/// <param name="lpqwRandomState"></param>
+/// <param name="lpSignature"></param>
+/// <param name="lpArtifact"></param>
+/// <param name="dwGear"></param>
+VOID PlantArtifact(
+    PDWORD64 lpqwRandomState,
+    LPCSIGNATURE lpSignature,
+    LPBYTE lpArtifact,
+    CONST DWORD dwGear
+);
+
+/// <summary>
+///  Finds the first DWORD of live memory that isn't part of the pattern, gear or static field.
+/// </summary>
+/// <param name="lpSignature"></param>
+/// <returns>
+///  Offset from the artifact, lLiveOffset if every DWORD overlaps one of them.
+/// </returns>
+LONG GetLiveFieldOffset(
+    LPCSIGNATURE lpSignature
+);
+
+#endif // _HEAT_HSHIFTER2_SYNTHETICHEAP_H
@@ -29,9 +29,13 @@
 #include <stdarg.h>
 
 #include "Utils.h"
+#include "GearCommit.h"
 
 #pragma comment (lib, "Shlwapi.lib")
 
+// Serializes access to the shared log buffer (scan workers log concurrently)
+STATIC SRWLOCK g_LogLock = SRWLOCK_INIT;
+
 DWORD GetGameProcessId(
     LPCWSTR wszProcessName
 ) {
@@ -180,6 +184,10 @@ BOOLEAN WriteLog(
         return FALSE;
     }
 
+    BOOLEAN bRet = TRUE;
+
+    AcquireSRWLockExclusive(&g_LogLock);
+
     va_list args;
     va_start(args, szFormat);
     vsnprintf(
@@ -203,10 +211,12 @@ BOOLEAN WriteLog(
             "[-] WriteFile(): E%lu\n",
             GetLastError()
         );
-        return FALSE;
+        bRet = FALSE;
     }
 
-    return TRUE;
+    ReleaseSRWLockExclusive(&g_LogLock);
+
+    return bRet;
 }
 
 BOOLEAN CreateConfig(
@@ -327,6 +337,10 @@ BOOLEAN CreateConfig(
         "GEAR_6=0x37\n"
         "GEAR_7=0x38\n"
         "GEAR_8=0x39\n"
+        "EXIT=0x23\n"
+        "RESCAN=0x2E\n"
+        "TOGGLE_WINDOW=0x2D\n"
+        "LATENCY=0x24\n"
     };
 
     DWORD dwBytesWritten = 0;
@@ -356,37 +370,300 @@ BOOLEAN CreateConfig(
     return TRUE;
 }
 
+// Config key names, indexed by SHIFT_GEAR and KEY_ACTION
+STATIC CONST LPCWSTR g_awszKeyTargetNames[KEY_TARGET_COUNT] = {
+    L"GEAR_REVERSE",
+    L"GEAR_NEUTRAL",
+    L"GEAR_1",
+    L"GEAR_2",
+    L"GEAR_3",
+    L"GEAR_4",
+    L"GEAR_5",
+    L"GEAR_6",
+    L"GEAR_7",
+    L"GEAR_8",
+    L"EXIT",
+    L"RESCAN",
+    L"TOGGLE_WINDOW",
+    L"LATENCY"
+};
+
+LPCWSTR GetKeyTargetName(
+    CONST WORD wTarget
+) {
+    if (wTarget >= KEY_TARGET_COUNT) {
+        return NULL;
+    }
+
+    return g_awszKeyTargetNames[wTarget];
+}
+
+STATIC DWORD CountKeyModifiers(
+    CONST BYTE byModifiers
+) {
+    return (0 != (byModifiers & KEY_MODIFIER_CTRL))
+        + (0 != (byModifiers & KEY_MODIFIER_SHIFT))
+        + (0 != (byModifiers & KEY_MODIFIER_ALT));
+}
+
+/// Adds a binding to the chain of its key, after the ones with at least as many modifiers.
+STATIC BOOLEAN AddKeyBinding(
+    LPKEYBOARD_MAP lpKeyboardMap,
+    CONST BYTE byVirtualKey,
+    CONST BYTE byModifiers,
+    CONST WORD wTarget
+) {
+    CONST DWORD dwModifierCount = CountKeyModifiers(byModifiers);
+    LPBYTE lpbyLink = &lpKeyboardMap->abyFirstBinding[byVirtualKey];
+
+    while (0 != *lpbyLink) {
+        LPKEY_BINDING lpBinding = &lpKeyboardMap->aBindings[*lpbyLink];
+
+        if (lpBinding->byModifiers == byModifiers) {
+            fprintf(
+                stderr,
+                "[-] Key 0x%02X (modifiers 0x%X) is bound twice, keeping the first binding.\n",
+                byVirtualKey,
+                byModifiers
+            );
+            return FALSE;
+        }
+
+        if (CountKeyModifiers(lpBinding->byModifiers) < dwModifierCount) {
+            break;
+        }
+
+        lpbyLink = &lpBinding->byNext;
+    }
+
+    if (lpKeyboardMap->dwBindingCount >= KEY_BINDING_MAX) {
+        fprintf(
+            stderr,
+            "[-] Too many key bindings, at most %u are used.\n",
+            KEY_BINDING_MAX
+        );
+        return FALSE;
+    }
+
+    CONST BYTE byIndex = (BYTE) ++lpKeyboardMap->dwBindingCount;
+
+    lpKeyboardMap->aBindings[byIndex].byModifiers = byModifiers;
+    lpKeyboardMap->aBindings[byIndex].byNext = *lpbyLink;
+    lpKeyboardMap->aBindings[byIndex].wTarget = wTarget;
+
+    *lpbyLink = byIndex;
+
+    return TRUE;
+}
+
+/// Parses the comma separated keys of a config key, e.g. "0x32, CTRL+SHIFT+0x62".
+STATIC VOID LoadKeyBindings(
+    LPKEYBOARD_MAP lpKeyboardMap,
+    LPCWSTR wszName,
+    LPCWSTR wszDefault,
+    CONST WORD wTarget
+) {
+    CONST struct {
+        LPCWSTR wszPrefix;
+        BYTE byModifier;
+    } aModifierPrefixes[] = {
+        { L"CTRL+", KEY_MODIFIER_CTRL },
+        { L"SHIFT+", KEY_MODIFIER_SHIFT },
+        { L"ALT+", KEY_MODIFIER_ALT }
+    };
+
+    WCHAR wszBindings[KEY_BINDING_TEXT_SIZE] = { 0 };
+
+    GetPrivateProfileStringW(
+        L"CONFIG",
+        wszName,
+        wszDefault,
+        wszBindings,
+        ARRAYSIZE(wszBindings),
+        g_ShifterConfig.wszConfigFilePath
+    );
+
+    LPWSTR wszCursor = wszBindings;
+
+    while (L'\0' != *wszCursor) {
+        BYTE byModifiers = 0;
+
+        while (L' ' == *wszCursor || L'\t' == *wszCursor || L',' == *wszCursor) {
+            wszCursor++;
+        }
+
+        if (L'\0' == *wszCursor) {
+            break;
+        }
+
+        LPCWSTR wszKey = wszCursor;
+
+        // Modifiers come in any order
+        for (BOOLEAN bPrefixFound = TRUE; bPrefixFound; ) {
+            bPrefixFound = FALSE;
+
+            for (DWORD i = 0; i < ARRAYSIZE(aModifierPrefixes); i++) {
+                CONST SIZE_T cchPrefix = wcslen(aModifierPrefixes[i].wszPrefix);
+
+                if (EXIT_SUCCESS == _wcsnicmp(
+                    wszCursor,
+                    aModifierPrefixes[i].wszPrefix,
+                    cchPrefix
+                )) {
+                    byModifiers |= aModifierPrefixes[i].byModifier;
+                    wszCursor += cchPrefix;
+                    bPrefixFound = TRUE;
+                }
+            }
+        }
+
+        LPWSTR wszEnd = NULL;
+        CONST ULONG ulVirtualKey = wcstoul(
+            wszCursor,
+            &wszEnd,
+            0
+        );
+
+        wszCursor = wszEnd;
+        while (L' ' == *wszCursor || L'\t' == *wszCursor) {
+            wszCursor++;
+        }
+
+        // Virtual key codes are 1 - 254
+        if (
+            wszEnd == wszKey
+            || 0 == ulVirtualKey
+            || ulVirtualKey > 0xFE
+            || (L'\0' != *wszCursor && L',' != *wszCursor)
+        ) {
+            // Skip to the next binding
+            while (L'\0' != *wszCursor && L',' != *wszCursor) {
+                wszCursor++;
+            }
+
+            fwprintf(
+                stderr,
+                L"[-] Invalid key binding of %s: '%.*s'\n",
+                wszName,
+                (INT) (wszCursor - wszKey),
+                wszKey
+            );
+            continue;
+        }
+
+        AddKeyBinding(
+            lpKeyboardMap,
+            (BYTE) ulVirtualKey,
+            byModifiers,
+            wTarget
+        );
+    }
+}
+
 VOID LoadConfig(
     VOID
 ) {
-    CONST WCHAR awszGearNames[GEAR_8 + 1][64] = { 
-        L"GEAR_REVERSE",
-        L"GEAR_NEUTRAL",
-        L"GEAR_1",
-        L"GEAR_2",
-        L"GEAR_3",
-        L"GEAR_4",
-        L"GEAR_5",
-        L"GEAR_6",
-        L"GEAR_7",
-        L"GEAR_8"
+    CONST struct {
+        LPCWSTR wszDefault;
+        KEY_ACTION eAction;
+    } aActionBindings[] = {
+        { L"0x23", KEY_ACTION_EXIT },                               // VK_END
+        { L"0x2E", KEY_ACTION_RESCAN },                             // VK_DELETE
+        { L"0x2D", KEY_ACTION_TOGGLE_WINDOW },                      // VK_INSERT
+        { L"0x24", KEY_ACTION_SHOW_LATENCY }                        // VK_HOME
     };
 
+    ZeroMemory(
+        &g_ShifterConfig.KeyboardMap,
+        sizeof(KEYBOARD_MAP)
+    );
+
     for (INT i = 0; i <= GEAR_8; i++) {
-        g_ShifterConfig.KeyboardMap.adwKeyCode[i] = GetPrivateProfileIntW(
-            L"CONFIG",
-            awszGearNames[i],
-            0x30 + i,
-            g_ShifterConfig.wszConfigFilePath
+        WCHAR wszDefault[8] = { 0 };
+
+        swprintf_s(
+            wszDefault,
+            ARRAYSIZE(wszDefault),
+            L"0x%02X",
+            0x30 + i
+        );
+
+        LoadKeyBindings(
+            &g_ShifterConfig.KeyboardMap,
+            g_awszKeyTargetNames[i],
+            wszDefault,
+            (WORD) i
         );
     }
 
+    // After the gears, a gear bound to the same key keeps it
+    for (DWORD i = 0; i < ARRAYSIZE(aActionBindings); i++) {
+        LoadKeyBindings(
+            &g_ShifterConfig.KeyboardMap,
+            g_awszKeyTargetNames[aActionBindings[i].eAction],
+            aActionBindings[i].wszDefault,
+            (WORD) aActionBindings[i].eAction
+        );
+    }
+
+    WriteLog(
+        "[*] Compiled %lu key bindings\n",
+        g_ShifterConfig.KeyboardMap.dwBindingCount
+    );
+
+    g_ShifterConfig.dwCommitWindowMs = GetPrivateProfileIntW(
+        L"CONFIG",
+        L"COMMIT_WINDOW_MS",
+        SHIFT_COMMIT_WINDOW_MS,
+        g_ShifterConfig.wszConfigFilePath
+    );
+
+    g_ShifterConfig.dwCommitRetries = GetPrivateProfileIntW(
+        L"CONFIG",
+        L"COMMIT_RETRIES",
+        SHIFT_COMMIT_MAX_RETRIES,
+        g_ShifterConfig.wszConfigFilePath
+    );
+
     wprintf(
         L"[+] Loaded config file: '%s'\n",
         g_ShifterConfig.wszConfigFilePath
     );
 }
 
+WORD ResolveKeyBinding(
+    CONST BYTE byVirtualKey
+) {
+    CONST LPKEYBOARD_MAP lpKeyboardMap = &g_ShifterConfig.KeyboardMap;
+    BYTE byIndex = lpKeyboardMap->abyFirstBinding[byVirtualKey];
+    BYTE byHeldModifiers = 0;
+
+    // Chords come first in the chain, plain keys never ask for the modifiers
+    if (0 != lpKeyboardMap->aBindings[byIndex].byModifiers) {
+        if (GetAsyncKeyState(VK_CONTROL) & 0x8000) {
+            byHeldModifiers |= KEY_MODIFIER_CTRL;
+        }
+
+        if (GetAsyncKeyState(VK_SHIFT) & 0x8000) {
+            byHeldModifiers |= KEY_MODIFIER_SHIFT;
+        }
+
+        if (GetAsyncKeyState(VK_MENU) & 0x8000) {
+            byHeldModifiers |= KEY_MODIFIER_ALT;
+        }
+    }
+
+    for (; 0 != byIndex; byIndex = lpKeyboardMap->aBindings[byIndex].byNext) {
+        CONST BYTE byModifiers = lpKeyboardMap->aBindings[byIndex].byModifiers;
+
+        if ((byHeldModifiers & byModifiers) == byModifiers) {
+            return lpKeyboardMap->aBindings[byIndex].wTarget;
+        }
+    }
+
+    return KEY_ACTION_INVALID;
+}
+
 BOOL CALLBACK EnumWindowProc(
     HWND hwnd,
     LPARAM lParam
@@ -440,42 +717,6 @@ BOOLEAN FindGameWindow(
     return bFound;
 }
 
-BOOLEAN IsWindowForeground(
-    FOREGROUND_WINDOW eTargetWindow
-) {
-    HWND hWnd = GetForegroundWindow();
-    if (NULL == hWnd) {
-        return FALSE;
-    }
-
-    DWORD dwWindowPid = 0;
-    if (0 == GetWindowThreadProcessId(
-        hWnd,
-        &dwWindowPid
-    )) {
-        fprintf(
-            stderr,
-            "[-] GetWindowThreadProcessId(): E%lu\n",
-            GetLastError()
-        );
-        return FALSE;
-    }
-
-    if (FGWIN_GAME == eTargetWindow) {
-        return (dwWindowPid == g_ShifterConfig.dwGameProcessId);
-    } else if (FGWIN_SHIFTER == eTargetWindow) {
-        return (dwWindowPid == g_ShifterConfig.dwShifterProcessId);
-    } else {
-        fprintf(
-            stderr,
-            "[-] Invalid target window: %d\n",
-            eTargetWindow
-        );
-    }
-
-    return FALSE;
-}
-
 BOOLEAN MaximizeWindow(
     HWND hTargetWindow
 ) {
@@ -665,8 +906,9 @@ BOOLEAN MAYBE_UNUSED ForceForegroundWindow(
 VOID SwitchWindows(
     VOID
 ) {
-
-    g_ShifterConfig.dwCurrentGear = ReadCurrentGear();
+    AcquireSRWLockExclusive(&g_ShifterState.Lock);
+    g_ShifterState.dwCurrentGear = ReadCurrentGear();
+    ReleaseSRWLockExclusive(&g_ShifterState.Lock);
 
     HANDLE hTargetConsole = NULL;
 
@@ -784,6 +1026,90 @@ BOOLEAN IsWindowInWindowedMode(
     return FALSE;
 }
 
+/// Formats the first key bound to a gear or action, e.g. "Insert" or "CTRL+0x62".
+/// "-" if nothing is bound to it.
+STATIC VOID FormatKeyBindingLabel(
+    CONST WORD wTarget,
+    LPSTR szLabel,
+    CONST SIZE_T cchLabel
+) {
+    CONST LPKEYBOARD_MAP lpKeyboardMap = &g_ShifterConfig.KeyboardMap;
+
+    for (DWORD dwVirtualKey = 0; dwVirtualKey < ARRAYSIZE(lpKeyboardMap->abyFirstBinding); dwVirtualKey++) {
+        for (
+            BYTE byIndex = lpKeyboardMap->abyFirstBinding[dwVirtualKey];
+            0 != byIndex;
+            byIndex = lpKeyboardMap->aBindings[byIndex].byNext
+        ) {
+            CONST LPKEY_BINDING lpBinding = &lpKeyboardMap->aBindings[byIndex];
+
+            if (wTarget != lpBinding->wTarget) {
+                continue;
+            }
+
+            CONST INT iPrefixLength = snprintf(
+                szLabel,
+                cchLabel,
+                "%s%s%s",
+                (lpBinding->byModifiers & KEY_MODIFIER_CTRL) ? "CTRL+" : "",
+                (lpBinding->byModifiers & KEY_MODIFIER_SHIFT) ? "SHIFT+" : "",
+                (lpBinding->byModifiers & KEY_MODIFIER_ALT) ? "ALT+" : ""
+            );
+
+            // Extended scan codes (0xE0xx) tell INSERT apart from NUMPAD 0
+            CONST UINT uScanCode = MapVirtualKeyA(
+                dwVirtualKey,
+                MAPVK_VK_TO_VSC_EX
+            );
+
+            LONG lKeyParam = (LONG) (LOBYTE(uScanCode) << 16);
+
+            if (0xE0 == HIBYTE(uScanCode)) {
+                lKeyParam |= 1 << 24;
+            }
+
+            if (0 == uScanCode || 0 == GetKeyNameTextA(
+                lKeyParam,
+                szLabel + iPrefixLength,
+                (INT) (cchLabel - iPrefixLength)
+            )) {
+                snprintf(
+                    szLabel + iPrefixLength,
+                    cchLabel - iPrefixLength,
+                    "0x%02lX",
+                    dwVirtualKey
+                );
+            }
+
+            return;
+        }
+    }
+
+    snprintf(
+        szLabel,
+        cchLabel,
+        "-"
+    );
+}
+
+/// Appends a line to the help of the gear display, cut off at the border.
+STATIC VOID AppendGearDisplayHelpLine(
+    LPSTR szOutputBuffer,
+    CONST SIZE_T cbOutputBuffer,
+    LPCSTR szText
+) {
+    CONST SIZE_T cchOutput = strlen(szOutputBuffer);
+
+    snprintf(
+        szOutputBuffer + cchOutput,
+        cbOutputBuffer - cchOutput,
+        "[ %-*.*s ]\n",
+        GEAR_DISPLAY_HELP_WIDTH,
+        GEAR_DISPLAY_HELP_WIDTH,
+        szText
+    );
+}
+
 VOID DrawAsciiGearDisplay(
     VOID
 ) {
@@ -793,11 +1119,12 @@ VOID DrawAsciiGearDisplay(
 
     DWORD dwCharsToWrite;
     DWORD dwCharsWritten = 0;
-    CHAR szOutputBuffer[1024] = { 0 };
+    CHAR szOutputBuffer[2048] = { 0 };
+    CHAR szLine[GEAR_DISPLAY_HELP_WIDTH + 1] = { 0 };
 
     CHAR cTargetGear = '1';
 
-    switch (g_ShifterConfig.dwCurrentGear) {
+    switch (g_ShifterState.dwCurrentGear) {
         case GEAR_REVERSE:
             cTargetGear = 'R';
             break;
@@ -807,19 +1134,101 @@ VOID DrawAsciiGearDisplay(
             break;
 
         default:
-            cTargetGear = (CHAR) ('0' + g_ShifterConfig.dwCurrentGear - 1);
+            cTargetGear = (CHAR) ('0' + g_ShifterState.dwCurrentGear - 1);
             break;
     }
 
+    CONST struct {
+        KEY_ACTION eAction;
+        LPCSTR szDescription;
+    } aActionHelp[] = {
+        { KEY_ACTION_TOGGLE_WINDOW, "Toggle Gear/Main Window" },
+        { KEY_ACTION_RESCAN, "Rescan Gear Addresses" },
+        { KEY_ACTION_SHOW_LATENCY, "Shift Latency" },
+        { KEY_ACTION_EXIT, "Exit H-Shifter" }
+    };
+
     snprintf(
         szOutputBuffer, 
         sizeof(szOutputBuffer),
         "[ ******> HEAT H-Shifter v%u.%u <****** ]\n"
-        "[ ----------------------------------- ]\n"
-        "[ 0 - 9  - Gear Control               ]\n"
-        "[ INSERT - Toggle Gear/Main Window    ]\n"
-        "[ DELETE - Rescan Gear Addresses      ]\n"
-        "[ END    - Exit H-Shifter             ]\n"
+        "[ ----------------------------------- ]\n",
+        HSHIFTER_VERSION_MAJOR,
+        HSHIFTER_VERSION_MINOR
+    );
+
+    AppendGearDisplayHelpLine(
+        szOutputBuffer,
+        sizeof(szOutputBuffer),
+        "Gears R N 1-8:"
+    );
+
+    // Key names come from the config and can be anything, wrap them at the border
+    SIZE_T cchLine = 0;
+
+    for (WORD wGear = GEAR_REVERSE; wGear <= GEAR_8; wGear++) {
+        CHAR szGearKey[32] = { 0 };
+
+        FormatKeyBindingLabel(
+            wGear,
+            szGearKey,
+            sizeof(szGearKey)
+        );
+
+        if (0 != cchLine && cchLine + 1 + strlen(szGearKey) > GEAR_DISPLAY_HELP_WIDTH) {
+            AppendGearDisplayHelpLine(
+                szOutputBuffer,
+                sizeof(szOutputBuffer),
+                szLine
+            );
+            cchLine = 0;
+        }
+
+        cchLine += snprintf(
+            szLine + cchLine,
+            sizeof(szLine) - cchLine,
+            (0 == cchLine) ? "  %s" : " %s",
+            szGearKey
+        );
+
+        cchLine = min(cchLine, sizeof(szLine) - 1);
+    }
+
+    AppendGearDisplayHelpLine(
+        szOutputBuffer,
+        sizeof(szOutputBuffer),
+        szLine
+    );
+
+    for (DWORD i = 0; i < ARRAYSIZE(aActionHelp); i++) {
+        CHAR szActionKey[32] = { 0 };
+
+        FormatKeyBindingLabel(
+            (WORD) aActionHelp[i].eAction,
+            szActionKey,
+            sizeof(szActionKey)
+        );
+
+        snprintf(
+            szLine,
+            sizeof(szLine),
+            "%-6s - %s",
+            szActionKey,
+            aActionHelp[i].szDescription
+        );
+
+        AppendGearDisplayHelpLine(
+            szOutputBuffer,
+            sizeof(szOutputBuffer),
+            szLine
+        );
+    }
+
+    CONST SIZE_T cchHelp = strlen(szOutputBuffer);
+
+    snprintf(
+        szOutputBuffer + cchHelp,
+        sizeof(szOutputBuffer) - cchHelp,
         "[*************************************]\n"
         "\n"
         "\n"
@@ -834,11 +1243,28 @@ VOID DrawAsciiGearDisplay(
         "     \\               /\n"
         "      \\             /\n"
         "       \\___________/\n",
-        HSHIFTER_VERSION_MAJOR,
-        HSHIFTER_VERSION_MINOR,
         cTargetGear
     );
 
+    LATENCY_SUMMARY WriteLatency;
+    GetShiftLatency(
+        SHIFT_LATENCY_WRITE,
+        &WriteLatency
+    );
+
+    if (0 != WriteLatency.qwCount) {
+        CONST SIZE_T cbOutputLength = strlen(szOutputBuffer);
+
+        snprintf(
+            szOutputBuffer + cbOutputLength,
+            sizeof(szOutputBuffer) - cbOutputLength,
+            "\n"
+            "  Shift p50 %lu us, p99 %lu us\n",
+            WriteLatency.dwP50Us,
+            WriteLatency.dwP99Us
+        );
+    }
+
     dwCharsToWrite = (DWORD) strlen(szOutputBuffer);
 
     if (!WriteConsoleA(
@@ -50,15 +50,27 @@
 #define HEAT_CURRENT_GEAR_ARTIFACT_SIZE         0x14
 #define HEAT_LAST_GEAR_ARTIFACT_SIZE            0x28
 
-#define AOBSCAN_LOW_ADDRESS_LIMIT               0x10000ULL
-#define AOBSCAN_HIGH_ADDRESS_LIMIT              0x2FFFFFFFFULL
-
 #define AOBSCAN_CURRENT_GEAR_LIVE_MEMORY_OFFSET 0x30                // To be added
 #define AOBSCAN_LAST_GEAR_LIVE_MEMORY_OFFSET    0xC                 // To be subtracted
 #define AOBSCAN_LIVE_MEMORY_ITERATIONS          4                   // Number of different live memory values to check
 #define AOBSCAN_LIVE_MEMORY_DELAY_MS            450                 // Delay between each live memory check
-#define AOBSCAN_UPDATE_CHECKPOINT               0x6000000           // Visual updates are displayed per this threshold.
-                                                                    //  - Setting this too low will cause performance issues
+#define AOBSCAN_PROGRESS_INTERVAL_MS            250                 // Delay between scan progress updates
+#define AOBSCAN_RESCAN_TIMEOUT_MS               90000               // DELETE rescans give up after this long
+#define AOBSCAN_READ_CHUNK_SIZE                 0x400000            // Bytes fetched per ReadProcessMemory call.
+                                                                    //  - Must be a multiple of PAGE_SIZE
+#define AOBSCAN_MAX_WORKERS                     16                  // Upper bound of scan worker threads
+#define AOBSCAN_BLOCK_SIZE                      0x10000             // Bytes searched for all signatures at once
+#define AOBSCAN_MAX_CANDIDATES                  1024                // Pattern hits verified at once
+#define AOBSCAN_HIT_QUEUE_SIZE                  256                 // Pattern hits waiting for verification
+#define AOBSCAN_CANDIDATE_WINDOW_SIZE           0x100               // Bytes sampled per candidate and round
+#define AOBSCAN_MAX_RANKED_ARTIFACTS            8                   // Verified artifacts kept per target gear for failover
+#define AOBSCAN_SCORE_LIVE_CHANGE               2                   // Per sample in which live memory changed
+#define AOBSCAN_SCORE_PLAUSIBLE_GEAR            1                   // Per sample with a plausible gear value
+#define AOBSCAN_SCORE_GEAR_AGREEMENT            4                   // Gear value matches an artifact of the other target gear
+
+#define KEY_BINDING_MAX                         128                 // Key bindings of all gears and actions
+#define KEY_BINDING_TEXT_SIZE                   256                 // Characters per config key, e.g. "0x32, CTRL+0x62"
+#define GEAR_DISPLAY_HELP_WIDTH                 35                  // Characters between the borders of the gear display help
 
 #define GET_NIBBLE(value) ((DWORD64)(value) & 0xF)
 
@@ -82,25 +94,43 @@ typedef enum _TARGET_GEAR {
     TARGET_GEAR_INVALID = 0xFFFFFFFF
 } TARGET_GEAR, *LPTARGET_GEAR;
 
-typedef enum _FOREGROUND_WINDOW {
-    FGWIN_GAME = 0,
-    FGWIN_SHIFTER,
-    FGWIN_INVALID = 0xFFFFFFFF
-} FOREGROUND_WINDOW, *LPFOREGROUND_WINDOW;
-
+/// Control actions a key can be bound to, next to the gears.
+typedef enum _KEY_ACTION {
+    KEY_ACTION_EXIT = GEAR_8 + 1,
+    KEY_ACTION_RESCAN,
+    KEY_ACTION_TOGGLE_WINDOW,
+    KEY_ACTION_SHOW_LATENCY,
+    KEY_ACTION_INVALID = 0xFFFF
+} KEY_ACTION, *LPKEY_ACTION;
+
+#define KEY_TARGET_COUNT                        (KEY_ACTION_SHOW_LATENCY + 1)
+#define WM_SHIFTER_ACTION                       (WM_APP + 1)        // Posted to the main thread by input threads, wParam: KEY_ACTION
+
+#define KEY_MODIFIER_CTRL                       0x01
+#define KEY_MODIFIER_SHIFT                      0x02
+#define KEY_MODIFIER_ALT                        0x04
+
+typedef struct _KEY_BINDING {
+    BYTE byModifiers;                   // KEY_MODIFIER_*, all of them must be held
+    BYTE byNext;                        // Next binding of the same key, 0 if none
+    WORD wTarget;                       // SHIFT_GEAR or KEY_ACTION
+} KEY_BINDING, *LPKEY_BINDING;
+
+/// Key bindings compiled by LoadConfig().
+/// Bindings of the same key are chained, the ones with more modifiers first.
 typedef struct _KEYBOARD_MAP {
-    DWORD adwKeyCode[GEAR_8 + 1];
+    BYTE abyFirstBinding[256];          // Per virtual key, index into aBindings, 0 if unbound
+    KEY_BINDING aBindings[KEY_BINDING_MAX + 1]; // Entry 0 is unused
+    DWORD dwBindingCount;
 } KEYBOARD_MAP, *LPKEYBOARD_MAP;
 
 typedef struct _SHIFTER_CONFIG {
     HANDLE hGameProcess;
     DWORD dwGameProcessId;
+    DWORD dwHostProcessId;      // Linux builds, game process ID on the host (--host-pid)
     DWORD dwShifterProcessId;
     DWORD dwShifterThreadId;
 
-    DWORD dwCurrentGear;
-    DWORD dwLastGear;
-    
     HWND hGameWindow;
     BOOLEAN bGameWasMinimized;
     
@@ -119,13 +149,31 @@ typedef struct _SHIFTER_CONFIG {
     BOOLEAN bEnableDebugLogging;
 
     KEYBOARD_MAP KeyboardMap;
+    DWORD dwCommitWindowMs;     // Shifts the game keeps this long are accepted (COMMIT_WINDOW_MS)
+    DWORD dwCommitRetries;      // Re-commits of a reverted shift (COMMIT_RETRIES)
     WCHAR wszConfigFilePath[MAX_PATH];
+} SHIFTER_CONFIG, *LPSHIFTER_CONFIG;
+
+/// Gear state written on every shift, by the gear writer thread.
+/// Kept on its own cache lines, apart from the config the keyboard hook reads.
+typedef struct DECLSPEC_CACHEALIGN _SHIFTER_STATE {
+    SRWLOCK Lock;                       // Held while gear addresses are used or replaced
+
+    DWORD dwCurrentGear;
+    DWORD dwLastGear;
 
     LPVOID lpCurrentGearAddress;
     LPVOID lpLastGearAddress;
-} SHIFTER_CONFIG, *LPSHIFTER_CONFIG;
+
+    // Ranked gear addresses per target gear, best first.
+    // The active address is the one at adwGearAddressIndex.
+    LPVOID aalpGearAddress[TARGET_GEAR_LAST + 1][AOBSCAN_MAX_RANKED_ARTIFACTS];
+    DWORD adwGearAddressCount[TARGET_GEAR_LAST + 1];
+    DWORD adwGearAddressIndex[TARGET_GEAR_LAST + 1];
+} SHIFTER_STATE, *LPSHIFTER_STATE;
 
 EXTERN_C GLOBAL SHIFTER_CONFIG g_ShifterConfig;
+EXTERN_C GLOBAL SHIFTER_STATE g_ShifterState;
 
 /// <summary>
 ///  Retrieves process ID of the target game process.
@@ -139,27 +187,24 @@ DWORD GetGameProcessId(
 );
 
 /// <summary>
-///  Scans target memory for a known signature/artifact.
+///  Reads the current or last gear value from the target memory.
+///  Fails over to the next ranked gear address if the active one doesn't hold a sane gear.
 /// </summary>
-/// <param name="abyPattern"></param>
-/// <param name="cbPatternSize"></param>
 /// <param name="eTargetGear"></param>
 /// <returns>
-///   Address of the signature/artifact if found, NULL on failure.
-/// </returns>
-LPCVOID AobScan(
-    LPCBYTE abyPattern,
-    CONST SIZE_T cbPatternSize,
-    TARGET_GEAR eTargetGear
+///  Current or last gear value if found, GEAR_INVALID on failure.
+SHIFT_GEAR ReadGear(
+    CONST TARGET_GEAR eTargetGear
 );
 
 /// <summary>
-///  Reads the current or last gear value from the target memory.
+///  Makes the next ranked gear address of the target gear the active one.
 /// </summary>
 /// <param name="eTargetGear"></param>
 /// <returns>
-///  Current or last gear value if found, GEAR_INVALID on failure.
-SHIFT_GEAR ReadGear(
+///  TRUE if there was another gear address to fail over to, FALSE otherwise.
+/// </returns>
+BOOLEAN FailoverGearAddress(
     CONST TARGET_GEAR eTargetGear
 );
 
@@ -257,16 +302,6 @@ BOOLEAN FindGameWindow(
     VOID
 );
 
-/// <summary>
-///  Checks if the target window is in the foreground.
-/// </summary>
-/// /// <returns>
-///  TRUE if the target window is in the foreground, FALSE otherwise.
-/// </returns>
-BOOLEAN IsWindowForeground(
-    FOREGROUND_WINDOW eTargetWindow
-);
-
 /// <summary>
 ///  Opens the log file for writing.
 /// </summary>
@@ -308,10 +343,35 @@ BOOLEAN CreateConfig(
 );
 
 /// <summary>
-///  Loads the config file and retrieves the keyboard mapping.
+///  Loads the config file and compiles the key bindings of the gears and actions.
+///  A config key holds one or more comma separated virtual key codes,
+///  each optionally prefixed with CTRL+, SHIFT+ and ALT+ (e.g. "0x32, CTRL+0x62").
 /// </summary>
 VOID LoadConfig(
     VOID
 );
 
+/// <summary>
+///  Resolves a bound virtual key to its gear or action, for the modifiers held right now.
+///  Most keys aren't bound, callers reject those with KeyboardMap.abyFirstBinding first.
+/// </summary>
+/// <param name="byVirtualKey"></param>
+/// <returns>
+///  SHIFT_GEAR or KEY_ACTION of the first matching binding, KEY_ACTION_INVALID if none matches.
+/// </returns>
+WORD ResolveKeyBinding(
+    CONST BYTE byVirtualKey
+);
+
+/// <summary>
+///  Retrieves the config key name of a gear or action, e.g. "GEAR_1" or "RESCAN".
+/// </summary>
+/// <param name="wTarget">SHIFT_GEAR or KEY_ACTION.</param>
+/// <returns>
+///  Config key name, NULL if wTarget is neither a gear nor an action.
+/// </returns>
+LPCWSTR GetKeyTargetName(
+    CONST WORD wTarget
+);
+
 #endif // _HEAT_HSHIFTER2_GAMEHELPER_H
\ No newline at end of file
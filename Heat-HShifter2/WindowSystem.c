@@ -0,0 +1,314 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+///
+
+/// @file WindowSystem.c
+/// @brief Window systems and the focus tracker.
+///
+///  The keyboard hook only handles keys while the game or the shifter is in
+///  the foreground. Instead of asking for the foreground window on every key,
+///  the focus tracker keeps a flag that the window system updates when the
+///  foreground window changes.
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+///
+
+#include "WindowSystem.h"
+
+#include <stdio.h>
+
+GLOBAL WINDOW_SYSTEM g_WindowSystem = { 0 };
+
+// WinEvent callbacks have no context, there is one hook per process
+STATIC LPWINDOW_SYSTEM g_lpHookedWindowSystem = NULL;
+
+STATIC DWORD GetWindowProcessId(
+    HWND hWnd
+) {
+    DWORD dwProcessId = 0;
+
+    if (NULL == hWnd) {
+        return 0;
+    }
+
+    if (0 == GetWindowThreadProcessId(
+        hWnd,
+        &dwProcessId
+    )) {
+        WriteLog(
+            "[-] GetWindowThreadProcessId(): E%lu\n",
+            GetLastError()
+        );
+        return 0;
+    }
+
+    return dwProcessId;
+}
+
+STATIC DWORD Win32GetForegroundProcessId(
+    LPWINDOW_SYSTEM lpWindowSystem
+) {
+    UNREFERENCED_PARAMETER(lpWindowSystem);
+
+    return GetWindowProcessId(
+        GetForegroundWindow()
+    );
+}
+
+STATIC VOID CALLBACK Win32ForegroundEventProc(
+    HWINEVENTHOOK hWinEventHook,
+    DWORD dwEvent,
+    HWND hWnd,
+    LONG idObject,
+    LONG idChild,
+    DWORD dwEventThread,
+    DWORD dwmsEventTime
+) {
+    UNREFERENCED_PARAMETER(dwEvent);
+    UNREFERENCED_PARAMETER(idObject);
+    UNREFERENCED_PARAMETER(idChild);
+    UNREFERENCED_PARAMETER(dwEventThread);
+    UNREFERENCED_PARAMETER(dwmsEventTime);
+
+    LPWINDOW_SYSTEM lpWindowSystem = g_lpHookedWindowSystem;
+
+    if (NULL == lpWindowSystem || hWinEventHook != lpWindowSystem->hEventHook) {
+        return;
+    }
+
+    lpWindowSystem->lpCallback(
+        lpWindowSystem->lpCallbackContext,
+        GetWindowProcessId(hWnd)
+    );
+}
+
+STATIC BOOLEAN Win32SubscribeForeground(
+    LPWINDOW_SYSTEM lpWindowSystem,
+    LPFOREGROUND_CALLBACK lpCallback,
+    LPVOID lpContext
+) {
+    if (NULL != g_lpHookedWindowSystem) {
+        return FALSE;
+    }
+
+    lpWindowSystem->lpCallback = lpCallback;
+    lpWindowSystem->lpCallbackContext = lpContext;
+    g_lpHookedWindowSystem = lpWindowSystem;
+
+    lpWindowSystem->hEventHook = SetWinEventHook(
+        EVENT_SYSTEM_FOREGROUND,
+        EVENT_SYSTEM_FOREGROUND,
+        NULL,
+        Win32ForegroundEventProc,
+        0,
+        0,
+        WINEVENT_OUTOFCONTEXT
+    );
+
+    if (NULL == lpWindowSystem->hEventHook) {
+        fprintf(
+            stderr,
+            "[-] SetWinEventHook(): E%lu\n",
+            GetLastError()
+        );
+        g_lpHookedWindowSystem = NULL;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+STATIC VOID Win32UnsubscribeForeground(
+    LPWINDOW_SYSTEM lpWindowSystem
+) {
+    if (NULL == lpWindowSystem->hEventHook) {
+        return;
+    }
+
+    if (!UnhookWinEvent(
+        lpWindowSystem->hEventHook
+    )) {
+        fprintf(
+            stderr,
+            "[-] UnhookWinEvent(): E%lu\n",
+            GetLastError()
+        );
+    }
+
+    lpWindowSystem->hEventHook = NULL;
+    g_lpHookedWindowSystem = NULL;
+}
+
+VOID InitWin32WindowSystem(
+    LPWINDOW_SYSTEM lpWindowSystem
+) {
+    ZeroMemory(
+        lpWindowSystem,
+        sizeof(WINDOW_SYSTEM)
+    );
+
+    lpWindowSystem->szName = "win32";
+    lpWindowSystem->GetForegroundProcessId = Win32GetForegroundProcessId;
+    lpWindowSystem->SubscribeForeground = Win32SubscribeForeground;
+    lpWindowSystem->UnsubscribeForeground = Win32UnsubscribeForeground;
+}
+
+STATIC DWORD FakeGetForegroundProcessId(
+    LPWINDOW_SYSTEM lpWindowSystem
+) {
+    return (DWORD) InterlockedCompareExchange(
+        &lpWindowSystem->lForegroundProcessId,
+        0,
+        0
+    );
+}
+
+STATIC BOOLEAN FakeSubscribeForeground(
+    LPWINDOW_SYSTEM lpWindowSystem,
+    LPFOREGROUND_CALLBACK lpCallback,
+    LPVOID lpContext
+) {
+    if (NULL != lpWindowSystem->lpCallback) {
+        return FALSE;
+    }
+
+    lpWindowSystem->lpCallbackContext = lpContext;
+    lpWindowSystem->lpCallback = lpCallback;
+    return TRUE;
+}
+
+STATIC VOID FakeUnsubscribeForeground(
+    LPWINDOW_SYSTEM lpWindowSystem
+) {
+    lpWindowSystem->lpCallback = NULL;
+    lpWindowSystem->lpCallbackContext = NULL;
+}
+
+VOID InitFakeWindowSystem(
+    LPWINDOW_SYSTEM lpWindowSystem,
+    CONST DWORD dwProcessId
+) {
+    ZeroMemory(
+        lpWindowSystem,
+        sizeof(WINDOW_SYSTEM)
+    );
+
+    lpWindowSystem->szName = "fake";
+    lpWindowSystem->GetForegroundProcessId = FakeGetForegroundProcessId;
+    lpWindowSystem->SubscribeForeground = FakeSubscribeForeground;
+    lpWindowSystem->UnsubscribeForeground = FakeUnsubscribeForeground;
+    lpWindowSystem->lForegroundProcessId = (LONG) dwProcessId;
+}
+
+VOID SetFakeForegroundProcess(
+    LPWINDOW_SYSTEM lpWindowSystem,
+    CONST DWORD dwProcessId
+) {
+    InterlockedExchange(
+        &lpWindowSystem->lForegroundProcessId,
+        (LONG) dwProcessId
+    );
+
+    if (NULL != lpWindowSystem->lpCallback) {
+        lpWindowSystem->lpCallback(
+            lpWindowSystem->lpCallbackContext,
+            dwProcessId
+        );
+    }
+}
+
+STATIC BOOLEAN IsTargetProcess(
+    LPFOCUS_TRACKER lpTracker,
+    CONST DWORD dwProcessId
+) {
+    return 0 != dwProcessId && (
+        dwProcessId == lpTracker->dwGameProcessId
+        || dwProcessId == lpTracker->dwShifterProcessId
+    );
+}
+
+STATIC VOID OnForegroundChanged(
+    LPVOID lpContext,
+    CONST DWORD dwProcessId
+) {
+    LPFOCUS_TRACKER lpTracker = (LPFOCUS_TRACKER) lpContext;
+
+    InterlockedExchange(
+        &lpTracker->lFocused,
+        IsTargetProcess(lpTracker, dwProcessId)
+    );
+}
+
+BOOLEAN StartFocusTracker(
+    LPFOCUS_TRACKER lpTracker,
+    LPWINDOW_SYSTEM lpWindowSystem,
+    CONST DWORD dwGameProcessId,
+    CONST DWORD dwShifterProcessId
+) {
+    lpTracker->lpWindowSystem = lpWindowSystem;
+    lpTracker->dwGameProcessId = dwGameProcessId;
+    lpTracker->dwShifterProcessId = dwShifterProcessId;
+
+    lpTracker->bSubscribed = lpWindowSystem->SubscribeForeground(
+        lpWindowSystem,
+        OnForegroundChanged,
+        lpTracker
+    );
+
+    // After subscribing, a change in between isn't missed
+    OnForegroundChanged(
+        lpTracker,
+        lpWindowSystem->GetForegroundProcessId(lpWindowSystem)
+    );
+
+    if (!lpTracker->bSubscribed) {
+        printf(
+            "[-] Foreground changes aren't reported by the %s window system, "
+            "keys check the foreground window instead.\n",
+            lpWindowSystem->szName
+        );
+    }
+
+    return lpTracker->bSubscribed;
+}
+
+VOID StopFocusTracker(
+    LPFOCUS_TRACKER lpTracker
+) {
+    if (!lpTracker->bSubscribed) {
+        return;
+    }
+
+    lpTracker->lpWindowSystem->UnsubscribeForeground(
+        lpTracker->lpWindowSystem
+    );
+
+    lpTracker->bSubscribed = FALSE;
+}
+
+BOOLEAN IsTargetFocused(
+    LPFOCUS_TRACKER lpTracker
+) {
+    if (lpTracker->bSubscribed) {
+        return 0 != lpTracker->lFocused;
+    }
+
+    return IsTargetProcess(
+        lpTracker,
+        lpTracker->lpWindowSystem->GetForegroundProcessId(lpTracker->lpWindowSystem)
+    );
+}
@@ -0,0 +1,145 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+///
+
+/// @file WindowSystem.h
+///   - github.con/x0reaxeax/nfsheat-hshifter
+
+#ifndef _HEAT_HSHIFTER2_WINDOWSYSTEM_H
+#define _HEAT_HSHIFTER2_WINDOWSYSTEM_H
+
+#include "Utils.h"
+
+/// Receives the process owning the new foreground window, 0 if there is none.
+typedef VOID (*LPFOREGROUND_CALLBACK)(
+    LPVOID lpContext,
+    CONST DWORD dwProcessId
+);
+
+typedef struct _WINDOW_SYSTEM WINDOW_SYSTEM, *LPWINDOW_SYSTEM;
+
+/// Foreground window queries and notifications.
+/// The focus tracker only reaches the desktop through a window system,
+/// so it can be driven by a fake one where there is no desktop.
+struct _WINDOW_SYSTEM {
+    LPCSTR szName;
+
+    /// Returns the process owning the foreground window, 0 if there is none
+    DWORD (*GetForegroundProcessId)(
+        LPWINDOW_SYSTEM lpWindowSystem
+    );
+
+    /// Calls lpCallback every time the foreground window changes, until UnsubscribeForeground().
+    /// One subscription per window system.
+    BOOLEAN (*SubscribeForeground)(
+        LPWINDOW_SYSTEM lpWindowSystem,
+        LPFOREGROUND_CALLBACK lpCallback,
+        LPVOID lpContext
+    );
+
+    VOID (*UnsubscribeForeground)(
+        LPWINDOW_SYSTEM lpWindowSystem
+    );
+
+    LPFOREGROUND_CALLBACK lpCallback;
+    LPVOID lpCallbackContext;
+
+    HWINEVENTHOOK hEventHook;           // Win32 window system
+    VOLATILE LONG lForegroundProcessId; // Fake window system
+};
+
+/// Tracks whether the game or the shifter owns the foreground window.
+typedef struct DECLSPEC_CACHEALIGN _FOCUS_TRACKER {
+    VOLATILE LONG lFocused;             // Game or shifter window in the foreground
+    BOOLEAN bSubscribed;                // Otherwise IsTargetFocused() asks the window system
+    DWORD dwGameProcessId;
+    DWORD dwShifterProcessId;
+    LPWINDOW_SYSTEM lpWindowSystem;
+} FOCUS_TRACKER, *LPFOCUS_TRACKER;
+
+EXTERN_C GLOBAL WINDOW_SYSTEM g_WindowSystem;
+
+/// <summary>
+///  Sets up a window system that uses GetForegroundWindow() and an
+///  EVENT_SYSTEM_FOREGROUND hook. Notifications arrive on the thread that
+///  subscribed, which has to pump messages.
+/// </summary>
+/// <param name="lpWindowSystem"></param>
+VOID InitWin32WindowSystem(
+    LPWINDOW_SYSTEM lpWindowSystem
+);
+
+/// <summary>
+///  Sets up a window system without a desktop, whose foreground window is
+///  moved between processes with SetFakeForegroundProcess().
+/// </summary>
+/// <param name="lpWindowSystem"></param>
+/// <param name="dwProcessId">Process owning the foreground window at first.</param>
+VOID InitFakeWindowSystem(
+    LPWINDOW_SYSTEM lpWindowSystem,
+    CONST DWORD dwProcessId
+);
+
+/// <summary>
+///  Brings a window of another process to the foreground of a fake window system
+///  and notifies the subscriber on the calling thread.
+/// </summary>
+/// <param name="lpWindowSystem"></param>
+/// <param name="dwProcessId">0 for no foreground window.</param>
+VOID SetFakeForegroundProcess(
+    LPWINDOW_SYSTEM lpWindowSystem,
+    CONST DWORD dwProcessId
+);
+
+/// <summary>
+///  Starts tracking the focus of the game and shifter processes.
+///  If the window system can't notify foreground changes, IsTargetFocused()
+///  falls back to asking it on every call.
+/// </summary>
+/// <param name="lpTracker"></param>
+/// <param name="lpWindowSystem"></param>
+/// <param name="dwGameProcessId"></param>
+/// <param name="dwShifterProcessId"></param>
+/// <returns>
+///  TRUE if the tracker is notified of foreground changes, FALSE if it falls back to polling.
+/// </returns>
+BOOLEAN StartFocusTracker(
+    LPFOCUS_TRACKER lpTracker,
+    LPWINDOW_SYSTEM lpWindowSystem,
+    CONST DWORD dwGameProcessId,
+    CONST DWORD dwShifterProcessId
+);
+
+/// <summary>
+///  Stops the foreground notifications of a tracker started by StartFocusTracker().
+/// </summary>
+/// <param name="lpTracker"></param>
+VOID StopFocusTracker(
+    LPFOCUS_TRACKER lpTracker
+);
+
+/// <summary>
+///  Checks if the game or the shifter owns the foreground window.
+/// </summary>
+/// <param name="lpTracker"></param>
+/// <returns>
+///  TRUE if one of them is focused, FALSE otherwise.
+/// </returns>
+BOOLEAN IsTargetFocused(
+    LPFOCUS_TRACKER lpTracker
+);
+
+#endif // _HEAT_HSHIFTER2_WINDOWSYSTEM_H
@@ -21,57 +21,100 @@
 ///  The program uses a low-level keyboard hook to intercept key presses
 ///  and change gears in the game.
 /// 
-///  The hooked keys are:
+///  The hooked keys are (defaults, bound in config.ini):
 ///    *  - 0-9: Change gear (NOT NUMPAD!!)
 ///    *  - INSERT: Toggle between the gear display and the main console window
-///    *  - DELETE: Re-scan for gear addresses (do this every time you enter and exit garage)
+///    *  - DELETE: Re-scan for gear addresses (do this every time you enter and exit garage), again to cancel
 ///    *  - END: Exit the program
 ///  
 /// 
-///  The program uses ReadProcessMemory and WriteProcessMemory as read/write primitives.
+///  The program reads and writes game memory through a memory source, ReadProcessMemory and
+///  WriteProcessMemory on Windows, process_vm_readv and process_vm_writev in Linux (Winelib) builds.
 ///   - github.con/x0reaxeax/nfsheat-hshifter
 ///  
 
 #include <Windows.h>
+#include <Shlwapi.h>
 #include <stdio.h>
 
 #include "Utils.h"
-
-// Verifies written gear value, but causes a 75ms delay
-//#define ENABLE_GEAR_VALIDATION
+#include "Search.h"
+#include "MemorySource.h"
+#include "Corpus.h"
+#include "DumpWriter.h"
+#include "GearCommit.h"
+#include "WindowSystem.h"
+#include "EvdevInput.h"
 
 // Checks if the game window is in the foreground before processing key events
 #define ENABLE_FOREGROUND_CHECK
 
 GLOBAL SHIFTER_CONFIG g_ShifterConfig = { 0 };
+GLOBAL SHIFTER_STATE g_ShifterState = { 0 };
 
-STATIC BOOLEAN ScanForGearAddresses(
+STATIC SIGNATURE_PACK g_SignaturePack = { 0 };
+
+// Whether the game or the shifter is focused, read by the keyboard hook
+STATIC FOCUS_TRACKER g_FocusTracker = { 0 };
+
+// Memory trace of the session (--record)
+STATIC LPCSTR g_szRecordTracePath = NULL;
+
+/// DELETE rescan, runs in the background while gears are shifted on the old addresses.
+typedef struct _RESCAN_WORKER {
+    HANDLE hThread;
+    VOLATILE LONG lRunning;
+    VOLATILE LONG lAbort;               // Set by DELETE or on exit
+} RESCAN_WORKER, *LPRESCAN_WORKER;
+
+STATIC RESCAN_WORKER g_Rescan = { 0 };
+
+STATIC VOID InitSignaturePack(
     VOID
 ) {
-    CONST BYTE abCurrentGearPattern[] = {
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0xAA, 0x61, 0x1C, 0x3F,
-        0xAA, 0x61, 0x1C, 0x3F
-    };
-
-    CONST BYTE abLastGearPattern[] = {
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x3F,
-        0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x3F,
-        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
-    };
+    WCHAR wszConfigDirectory[MAX_PATH] = { 0 };
+    WCHAR wszPackFilePath[MAX_PATH] = { 0 };
 
-    static_assert(
-        sizeof(abCurrentGearPattern) == HEAT_CURRENT_GEAR_ARTIFACT_SIZE,
-        "Current gear artifact size mismatch."
+    memcpy(
+        wszConfigDirectory,
+        g_ShifterConfig.wszConfigFilePath,
+        sizeof(wszConfigDirectory)
     );
 
-    static_assert(
-        sizeof(abLastGearPattern) == HEAT_LAST_GEAR_ARTIFACT_SIZE,
-        "Last gear artifact size mismatch."
+    if (
+        PathRemoveFileSpecW(wszConfigDirectory)
+        && NULL != PathCombineW(
+            wszPackFilePath,
+            wszConfigDirectory,
+            SIGNATURE_PACK_FILE_NAME
+        )
+        && LoadSignaturePack(
+            &g_SignaturePack,
+            wszPackFilePath
+        )
+    ) {
+        wprintf(
+            L"[+] Loaded signature pack: '%s' (%lu signatures)\n",
+            wszPackFilePath,
+            g_SignaturePack.dwSignatureCount
+        );
+        return;
+    }
+
+    InitDefaultSignaturePack(&g_SignaturePack);
+
+    printf(
+        "[*] Using built-in signatures (%lu signatures).\n",
+        g_SignaturePack.dwSignatureCount
     );
+}
 
+/// Scans for the gear addresses and swaps them in once they are verified.
+/// An abandoned scan leaves the current addresses in use.
+STATIC BOOLEAN ScanForGearAddresses(
+    CONST VOLATILE LONG *lplAbort,
+    CONST DWORD dwTimeoutMs
+) {
     // Set higher priority class, since Win11 seems to bully the program
 
     printf("[*] Adjusting process priority class..\n");
@@ -103,46 +146,45 @@ STATIC BOOLEAN ScanForGearAddresses(
 
     g_ShifterConfig.bGameWasMinimized = FALSE;
 
-    LPCVOID lpCurrentGearArtifact = AobScan(
-        abCurrentGearPattern,
-        sizeof(abCurrentGearPattern),
-        TARGET_GEAR_CURRENT
+    AOBSCAN_RESULT aobResult = { 0 };
+    BOOLEAN bFound = AobScanAbortable(
+        &g_SignaturePack,
+        &aobResult,
+        lplAbort,
+        dwTimeoutMs
     );
 
+    LPCVOID lpCurrentGearArtifact = aobResult.alpArtifact[TARGET_GEAR_CURRENT];
+    LPCVOID lpLastGearArtifact = aobResult.alpArtifact[TARGET_GEAR_LAST];
+
     if (NULL == lpCurrentGearArtifact) {
         fprintf(
             stderr,
-            "[-] Unable to find memory artifact.\n"
+            "[-] Unable to find memory artifact (current gear).\n"
+        );
+    } else {
+        printf(
+            "[+] Memory artifact address (current gear): 0x%llX [%s] (%lu fallbacks)\n",
+            (DWORD64) lpCurrentGearArtifact,
+            g_SignaturePack.aSignatures[aobResult.adwSignatureId[TARGET_GEAR_CURRENT]].szName,
+            aobResult.adwRankedCount[TARGET_GEAR_CURRENT] - 1
         );
-
-        return FALSE;
     }
 
-    printf(
-        "[+] Memory artifact address (current gear): 0x%llX\n",
-        (DWORD64) lpCurrentGearArtifact
-    );
-
-    LPCVOID lpLastGearArtifact = AobScan(
-        abLastGearPattern,
-        sizeof(abLastGearPattern),
-        TARGET_GEAR_LAST
-    );
-
     if (NULL == lpLastGearArtifact) {
         fprintf(
             stderr,
-            "[-] Unable to find memory artifact.\n"
+            "[-] Unable to find memory artifact (previous gear).\n"
+        );
+    } else {
+        printf(
+            "[+] Memory artifact address (previous gear): 0x%llX [%s] (%lu fallbacks)\n",
+            (DWORD64) lpLastGearArtifact,
+            g_SignaturePack.aSignatures[aobResult.adwSignatureId[TARGET_GEAR_LAST]].szName,
+            aobResult.adwRankedCount[TARGET_GEAR_LAST] - 1
         );
-
-        return FALSE;
     }
 
-    printf(
-        "[+] Memory artifact address (previous gear): 0x%llX\n",
-        (DWORD64) lpLastGearArtifact
-    );
-
     if (g_ShifterConfig.bGameWasMinimized) {
         if (!ShowWindow(
             g_ShifterConfig.hGameWindow,
@@ -172,58 +214,241 @@ STATIC BOOLEAN ScanForGearAddresses(
         return FALSE;
     }
 
-    g_ShifterConfig.lpCurrentGearAddress = (LPVOID) (
-        (DWORD64) lpCurrentGearArtifact +
-        HEAT_CURRENT_GEAR_ARTIFACT_OFFSET
-    );
+    if (!bFound || NULL == lpCurrentGearArtifact || NULL == lpLastGearArtifact) {
+        return FALSE;
+    }
 
-    g_ShifterConfig.lpLastGearAddress = (LPVOID) (
-        (DWORD64) lpLastGearArtifact +
-        HEAT_LAST_GEAR_ARTIFACT_OFFSET
-    );
+    AcquireSRWLockExclusive(&g_ShifterState.Lock);
+
+    // Keep the ranked artifacts around, ReadGear() fails over to them
+    for (DWORD i = 0; i <= TARGET_GEAR_LAST; ++i) {
+        for (DWORD j = 0; j < aobResult.adwRankedCount[i]; ++j) {
+            LPCAOBSCAN_ARTIFACT lpcArtifact = &aobResult.aaRankedArtifacts[i][j];
+
+            g_ShifterState.aalpGearAddress[i][j] = (LPVOID) (
+                (DWORD64) lpcArtifact->lpArtifact +
+                g_SignaturePack.aSignatures[lpcArtifact->dwSignatureId].lGearOffset
+            );
+        }
+
+        g_ShifterState.adwGearAddressCount[i] = aobResult.adwRankedCount[i];
+        g_ShifterState.adwGearAddressIndex[i] = 0;
+    }
+
+    g_ShifterState.lpCurrentGearAddress = g_ShifterState.aalpGearAddress[TARGET_GEAR_CURRENT][0];
+    g_ShifterState.lpLastGearAddress = g_ShifterState.aalpGearAddress[TARGET_GEAR_LAST][0];
+
+    ReleaseSRWLockExclusive(&g_ShifterState.Lock);
 
     return TRUE;
 }
 
-STATIC BOOLEAN InitShifter(
+/// Config, signatures and log for the modes that don't shift gears.
+STATIC BOOLEAN InitOfflineMode(
     VOID
 ) {
-    // Default gear state
-    g_ShifterConfig.dwCurrentGear = GEAR_1;
+    g_ShifterConfig.hShifterConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 
-    // Enable ASCII gear display mode
-    g_ShifterConfig.bGearWindowEnabled = TRUE;
+    if (!CreateConfig()) {
+        fprintf(
+            stderr,
+            "[-] Config initialization failure.\n"
+        );
+        return FALSE;
+    }
 
-    g_ShifterConfig.dwGameProcessId = GetGameProcessId(
-        L"NeedForSpeedHeat.exe"
+    InitSignaturePack();
+
+    // Don't truncate the log of the last session unless asked to
+    if (g_ShifterConfig.bEnableDebugLogging) {
+        g_ShifterConfig.hLogFile = OpenLogFile();
+    }
+
+    printf(
+        "[*] Pattern search kernel: %s\n",
+        GetSearchKernelName(GetSearchKernel())
     );
 
-    ZeroMemory(
-        &g_ShifterConfig.KeyboardMap,
-        sizeof(KEYBOARD_MAP)
+    return TRUE;
+}
+
+/// Wraps the game memory source in a recording source if the session is recorded.
+STATIC BOOLEAN StartMemoryRecording(
+    VOID
+) {
+    if (NULL == g_szRecordTracePath) {
+        return TRUE;
+    }
+
+    if (!InitRecordingMemorySource(
+        &g_GameMemory,
+        g_szRecordTracePath
+    )) {
+        fprintf(
+            stderr,
+            "[-] Unable to create memory trace '%s'.\n",
+            g_szRecordTracePath
+        );
+        g_szRecordTracePath = NULL;
+        return FALSE;
+    }
+
+    printf(
+        "[*] Recording memory trace '%s'\n",
+        g_szRecordTracePath
     );
 
-    ZeroMemory(
-        &g_ShifterConfig.wszConfigFilePath,
-        sizeof(g_ShifterConfig.wszConfigFilePath)
+    return TRUE;
+}
+
+/// Completes the memory trace of a recorded session.
+STATIC VOID StopMemoryRecording(
+    VOID
+) {
+    if (NULL == g_szRecordTracePath) {
+        return;
+    }
+
+    CloseRecordingMemorySource(&g_GameMemory);
+    g_szRecordTracePath = NULL;
+}
+
+/// Scans an offline memory source instead of the running game and reports
+/// every verified artifact with its gear address and value.
+STATIC BOOLEAN ScanOfflineMemory(
+    VOID
+) {
+    STATIC CONST LPCSTR aszTargetGearNames[] = {
+        [TARGET_GEAR_CURRENT] = "current gear",
+        [TARGET_GEAR_LAST] = "previous gear"
+    };
+
+    AOBSCAN_RESULT aobResult = { 0 };
+    CONST BOOLEAN bFound = AobScan(
+        &g_SignaturePack,
+        &aobResult
     );
-    
-    if (g_ShifterConfig.bEnableDebugLogging) {
-        printf("[*] Debug logging enabled.\n");
+
+    for (DWORD i = 0; i < g_SignaturePack.dwSignatureCount; ++i) {
+        printf(
+            "[*] Signature %lu '%s': %lu hits\n",
+            i,
+            g_SignaturePack.aSignatures[i].szName,
+            aobResult.adwHitCount[i]
+        );
     }
 
-    if (g_ShifterConfig.bSecondGearScan) {
-        printf("[*] Second gear scan target enabled.\n");
+    for (DWORD i = 0; i <= TARGET_GEAR_LAST; ++i) {
+        if (0 == aobResult.adwRankedCount[i]) {
+            fprintf(
+                stderr,
+                "[-] Unable to find memory artifact (%s).\n",
+                aszTargetGearNames[i]
+            );
+            continue;
+        }
+
+        for (DWORD j = 0; j < aobResult.adwRankedCount[i]; ++j) {
+            LPCAOBSCAN_ARTIFACT lpcArtifact = &aobResult.aaRankedArtifacts[i][j];
+            LPCSIGNATURE lpSignature = &g_SignaturePack.aSignatures[lpcArtifact->dwSignatureId];
+            DWORD dwGearValue = GEAR_INVALID;
+
+            LPCVOID lpGearAddress = (LPCVOID) (
+                (DWORD64) lpcArtifact->lpArtifact + lpSignature->lGearOffset
+            );
+
+            ReadMemory(
+                &g_GameMemory,
+                lpGearAddress,
+                &dwGearValue,
+                sizeof(DWORD)
+            );
+
+            printf(
+                "[+] Memory artifact (%s) #%lu: 0x%llX [%s], gear address: 0x%llX, gear: %lu (score %lu)\n",
+                aszTargetGearNames[i],
+                j,
+                (DWORD64) lpcArtifact->lpArtifact,
+                lpSignature->szName,
+                (DWORD64) lpGearAddress,
+                dwGearValue,
+                lpcArtifact->dwScore
+            );
+        }
     }
 
-    g_ShifterConfig.hShifterWindow = GetForegroundWindow();
-    g_ShifterConfig.dwShifterProcessId = GetCurrentProcessId();
-    g_ShifterConfig.dwShifterThreadId = GetCurrentThreadId();
+    return bFound;
+}
+
+STATIC BOOLEAN ScanMemoryDump(
+    LPCSTR szDumpPath
+) {
+    if (!InitDumpMemorySource(
+        &g_GameMemory,
+        szDumpPath
+    )) {
+        fprintf(
+            stderr,
+            "[-] Unable to open memory dump '%s'.\n",
+            szDumpPath
+        );
+        return FALSE;
+    }
+
+    printf(
+        "[*] Memory source: %s '%s'\n",
+        g_GameMemory.szName,
+        szDumpPath
+    );
+
+    CONST BOOLEAN bFound = StartMemoryRecording() && ScanOfflineMemory();
+
+    StopMemoryRecording();
+    CloseDumpMemorySource(&g_GameMemory);
+
+    return bFound;
+}
+
+/// Reruns a recorded scan on the answers of its memory trace.
+STATIC BOOLEAN ReplayMemoryTrace(
+    LPCSTR szTracePath,
+    CONST BOOLEAN bRealTime
+) {
+    if (!InitReplayMemorySource(
+        &g_GameMemory,
+        szTracePath,
+        bRealTime
+    )) {
+        fprintf(
+            stderr,
+            "[-] Unable to open memory trace '%s'.\n",
+            szTracePath
+        );
+        return FALSE;
+    }
+
+    printf(
+        "[*] Memory source: %s '%s' (%s)\n",
+        g_GameMemory.szName,
+        szTracePath,
+        bRealTime ? "real time" : "full speed"
+    );
+
+    CONST BOOLEAN bFound = ScanOfflineMemory();
+
+    CloseReplayMemorySource(&g_GameMemory);
+
+    return bFound;
+}
 
+/// Opens the game process and sets up the memory source it is reached through.
+STATIC BOOLEAN OpenGameMemory(
+    VOID
+) {
     if (0 == g_ShifterConfig.dwGameProcessId) {
         fprintf(
             stderr,
-            "[-] Unable to initialize shifter - Heat process not found.\n"
+            "[-] Heat process not found.\n"
         );
         return FALSE;
     }
@@ -247,6 +472,100 @@ STATIC BOOLEAN InitShifter(
         return FALSE;
     }
 
+    InitWin32MemorySource(
+        &g_GameMemory,
+        g_ShifterConfig.hGameProcess
+    );
+
+#ifdef __linux__
+    // Reach the game through its host process, one syscall per batch
+    if (0 != g_ShifterConfig.dwHostProcessId && !InitLinuxMemorySource(
+        &g_GameMemory,
+        g_ShifterConfig.dwHostProcessId
+    )) {
+        fprintf(
+            stderr,
+            "[-] Unable to access host process %lu.\n",
+            (unsigned long) g_ShifterConfig.dwHostProcessId
+        );
+        return FALSE;
+    }
+#endif
+
+    printf(
+        "[*] Memory source: %s\n",
+        g_GameMemory.szName
+    );
+
+    return StartMemoryRecording();
+}
+
+/// Captures a compressed region dump of the running game, to be attached to bug reports.
+STATIC BOOLEAN WriteGameDump(
+    LPCSTR szDumpPath,
+    CONST SIZE_T cbHitRadius
+) {
+    g_ShifterConfig.dwGameProcessId = GetGameProcessId(
+        L"NeedForSpeedHeat.exe"
+    );
+
+    if (!OpenGameMemory()) {
+        return FALSE;
+    }
+
+    CONST BOOLEAN bWritten = WriteRegionDump(
+        &g_GameMemory,
+        &g_SignaturePack,
+        szDumpPath,
+        cbHitRadius
+    );
+
+    StopMemoryRecording();
+    CloseHandle(g_ShifterConfig.hGameProcess);
+    g_ShifterConfig.hGameProcess = NULL;
+
+    return bWritten;
+}
+
+STATIC BOOLEAN InitShifter(
+    VOID
+) {
+    // Default gear state
+    g_ShifterState.dwCurrentGear = GEAR_1;
+
+    // Enable ASCII gear display mode
+    g_ShifterConfig.bGearWindowEnabled = TRUE;
+
+    g_ShifterConfig.dwGameProcessId = GetGameProcessId(
+        L"NeedForSpeedHeat.exe"
+    );
+
+    ZeroMemory(
+        &g_ShifterConfig.KeyboardMap,
+        sizeof(KEYBOARD_MAP)
+    );
+
+    ZeroMemory(
+        &g_ShifterConfig.wszConfigFilePath,
+        sizeof(g_ShifterConfig.wszConfigFilePath)
+    );
+    
+    if (g_ShifterConfig.bEnableDebugLogging) {
+        printf("[*] Debug logging enabled.\n");
+    }
+
+    if (g_ShifterConfig.bSecondGearScan) {
+        printf("[*] Second gear scan target enabled.\n");
+    }
+
+    g_ShifterConfig.hShifterWindow = GetForegroundWindow();
+    g_ShifterConfig.dwShifterProcessId = GetCurrentProcessId();
+    g_ShifterConfig.dwShifterThreadId = GetCurrentThreadId();
+
+    if (!OpenGameMemory()) {
+        return FALSE;
+    }
+
     // Get game window handle
     if (!FindGameWindow()) {
         fprintf(
@@ -302,6 +621,9 @@ STATIC BOOLEAN InitShifter(
 
     LoadConfig();
 
+    // Must run before OpenLogFile() strips the config file name
+    InitSignaturePack();
+
     g_ShifterConfig.hLogFile = OpenLogFile();
     if (NULL == g_ShifterConfig.hLogFile) {
         fprintf(
@@ -322,11 +644,19 @@ STATIC BOOLEAN InitShifter(
         "[+] Loaded keyboard map from config file.\n"
     );
 
+    printf(
+        "[*] Pattern search kernel: %s\n",
+        GetSearchKernelName(GetSearchKernel())
+    );
+
     printf(
         "[*] Scanning for memory artifacts...\n"
     );
 
-    if (!ScanForGearAddresses()) {
+    if (!ScanForGearAddresses(
+        NULL,
+        0
+    )) {
         fprintf(
             stderr,
             "[-] Unable to find gear addresses.\n"
@@ -351,178 +681,217 @@ STATIC BOOLEAN InitShifter(
     printf(
         "[+] Current gear address: 0x%llX\n"
         "[+] Last gear address: 0x%llX\n",
-        (DWORD64) g_ShifterConfig.lpCurrentGearAddress,
-        (DWORD64) g_ShifterConfig.lpLastGearAddress
+        (DWORD64) g_ShifterState.lpCurrentGearAddress,
+        (DWORD64) g_ShifterState.lpLastGearAddress
     );
     
     return TRUE;
 }
 
-STATIC BOOLEAN ShiftGear(
-    SHIFT_GEAR eTargetGear
+STATIC DWORD WINAPI RescanThread(
+    LPVOID lpParameter
 ) {
-    SIZE_T cbBytesWritten = 0;
+    UNREFERENCED_PARAMETER(lpParameter);
 
-    if (eTargetGear == g_ShifterConfig.dwLastGear) {
-        return TRUE;
-    }
+    SetMainWindowVisible();
 
-    // Writes go ASAP
-    if (!WriteProcessMemory(
-        g_ShifterConfig.hGameProcess,
-        g_ShifterConfig.lpCurrentGearAddress,
-        &eTargetGear,
-        sizeof(DWORD),
-        &cbBytesWritten
-    )) {
-        fprintf(
-            stderr,
-            "[-] WriteProcessMemory(): E%lu\n",
-            GetLastError()
-        );
-        return FALSE;
-    }
+    printf(
+        "[*] Rescanning gear addresses, press DELETE to cancel...\n"
+    );
 
-    if (!WriteProcessMemory(
-        g_ShifterConfig.hGameProcess,
-        g_ShifterConfig.lpLastGearAddress,
-        &eTargetGear,
-        sizeof(DWORD),
-        &cbBytesWritten
+    if (ScanForGearAddresses(
+        &g_Rescan.lAbort,
+        AOBSCAN_RESCAN_TIMEOUT_MS
     )) {
+        printf(
+            "[+] Current gear address: 0x%llX\n"
+            "[+] Last gear address: 0x%llX\n",
+            (DWORD64) g_ShifterState.lpCurrentGearAddress,
+            (DWORD64) g_ShifterState.lpLastGearAddress
+        );
+    } else {
         fprintf(
             stderr,
-            "[-] WriteProcessMemory(): E%lu\n",
-            GetLastError()
+            "[-] Rescan failed, keeping the previous gear addresses.\n"
         );
-        return FALSE;
     }
 
-#ifdef ENABLE_GEAR_VALIDATION
-    // Give the game some time to (in/)validate gear change
-    Sleep(75);
-
-
-    // Read gear value from game memory
-    g_ShifterConfig.dwCurrentGear = ReadCurrentGear();
-
-    // Sanitize last gear value
-    DWORD dwLastGear = ReadLastGear();
-    if (dwLastGear != g_ShifterConfig.dwCurrentGear) {
-        if (!WriteProcessMemory(
-            g_ShifterConfig.hGameProcess,
-            g_ShifterConfig.lpLastGearAddress,
-            &g_ShifterConfig.dwCurrentGear,
-            sizeof(DWORD),
-            &cbBytesWritten
-        )) {
-            fprintf(
-                stderr,
-                "[-] WriteProcessMemory(): E%lu\n",
-                GetLastError()
-            );
-            return FALSE;
-        }
-    }
-#else
-    g_ShifterConfig.dwCurrentGear = eTargetGear;
-#endif
-    // Log the gear change
-    g_ShifterConfig.dwLastGear = eTargetGear;
-
     if (g_ShifterConfig.bGearWindowEnabled) {
-        DrawAsciiGearDisplay();
+        SwitchWindows();
     }
 
-    return TRUE;
+    InterlockedExchange(&g_Rescan.lRunning, FALSE);
+    return EXIT_SUCCESS;
 }
 
-STATIC SHIFT_GEAR ConvertKeyMapToGear(
-    DWORD dwKeyCode
+/// Starts a rescan, or cancels the one that is running.
+STATIC VOID ToggleRescan(
+    VOID
 ) {
-    for (INT i = 0; i < ARRAYSIZE(g_ShifterConfig.KeyboardMap.adwKeyCode); ++i) {
-        if (g_ShifterConfig.KeyboardMap.adwKeyCode[i] == dwKeyCode) {
-            return (SHIFT_GEAR) i;
-        }
+    if (g_Rescan.lRunning) {
+        InterlockedExchange(&g_Rescan.lAbort, TRUE);
+        return;
     }
 
-    return GEAR_INVALID;
-}
+    // The last rescan has returned
+    if (NULL != g_Rescan.hThread) {
+        CloseHandle(g_Rescan.hThread);
+    }
 
-INT64 CALLBACK KeyboardHookProc(
-    int nCode,
-    WPARAM wParam,
-    LPARAM lParam
-) {
-    LPKBDLLHOOKSTRUCT lpKbdHookStruct = (LPKBDLLHOOKSTRUCT) lParam;
-    SHIFT_GEAR eTargetGear;
+    g_Rescan.lAbort = FALSE;
+    g_Rescan.lRunning = TRUE;
 
-    if (HC_ACTION != nCode) {
-        goto _NEXT_HOOK;
-    }
+    g_Rescan.hThread = CreateThread(
+        NULL,
+        0,
+        RescanThread,
+        NULL,
+        0,
+        NULL
+    );
 
-    if (WM_SYSKEYDOWN != wParam && WM_KEYDOWN != wParam) {
-        goto _NEXT_HOOK;
+    if (NULL == g_Rescan.hThread) {
+        fprintf(
+            stderr,
+            "[-] CreateThread(): E%lu\n",
+            GetLastError()
+        );
+        g_Rescan.lRunning = FALSE;
     }
+}
 
-    if (!IsWindowForeground(FGWIN_GAME) && !IsWindowForeground(FGWIN_SHIFTER)) {
-        goto _NEXT_HOOK;
+STATIC VOID StopRescan(
+    VOID
+) {
+    if (NULL == g_Rescan.hThread) {
+        return;
     }
 
-    eTargetGear = ConvertKeyMapToGear(
-        lpKbdHookStruct->vkCode
+    InterlockedExchange(&g_Rescan.lAbort, TRUE);
+
+    WaitForSingleObject(
+        g_Rescan.hThread,
+        INFINITE
     );
 
-    if (GEAR_INVALID != eTargetGear) {
-        ShiftGear(
-            eTargetGear
+    CloseHandle(g_Rescan.hThread);
+    g_Rescan.hThread = NULL;
+}
+
+/// Prints the latency percentiles of every shift stage, and logs them.
+STATIC VOID PrintShiftLatency(
+    VOID
+) {
+    CONST LPCSTR aszStageNames[SHIFT_LATENCY_STAGE_COUNT] = {
+        "key -> hook",
+        "hook -> dispatch",
+        "hook -> written",
+        "hook -> confirmed"
+    };
+
+    printf(
+        "[*] Shift latency (us)       count      p50      p99    p99.9      max\n"
+    );
+
+    for (DWORD i = 0; i < SHIFT_LATENCY_STAGE_COUNT; i++) {
+        LATENCY_SUMMARY Summary;
+        GetShiftLatency(
+            (SHIFT_LATENCY_STAGE) i,
+            &Summary
         );
 
-        goto _NEXT_HOOK;
+        printf(
+            "    %-18s %10llu %8lu %8lu %8lu %8lu\n",
+            aszStageNames[i],
+            Summary.qwCount,
+            Summary.dwP50Us,
+            Summary.dwP99Us,
+            Summary.dwP999Us,
+            Summary.dwMaxUs
+        );
+
+        WriteLog(
+            "[*] Shift latency %s: %llu shifts, p50 %lu us, p99 %lu us, p99.9 %lu us, max %lu us\n",
+            aszStageNames[i],
+            Summary.qwCount,
+            Summary.dwP50Us,
+            Summary.dwP99Us,
+            Summary.dwP999Us,
+            Summary.dwMaxUs
+        );
     }
+}
 
-    switch (lpKbdHookStruct->vkCode) {
-        case VK_END: {
+/// Runs a bound action, on the main thread.
+STATIC VOID DispatchKeyAction(
+    CONST WORD wAction
+) {
+    switch (wAction) {
+        case KEY_ACTION_EXIT: {
             // Exit the program
             PostQuitMessage(EXIT_SUCCESS);
             break;
         }
 
-        case VK_DELETE: {
-            // Re-scan for gear addresses
-            SetMainWindowVisible();
-
-            if (!ScanForGearAddresses()) {
-                fprintf(
-                    stderr,
-                    "[-] Unable to find gear addresses.\n"
-                );
-                PostQuitMessage(EXIT_FAILURE);
-            }
-
-            printf(
-                "[+] Current gear address: 0x%llX\n"
-                "[+] Last gear address: 0x%llX\n",
-                (DWORD64) g_ShifterConfig.lpCurrentGearAddress,
-                (DWORD64) g_ShifterConfig.lpLastGearAddress
-            );
-
-            if (g_ShifterConfig.bGearWindowEnabled) {
-                SwitchWindows();
-            }
+        case KEY_ACTION_RESCAN: {
+            // Re-scan for gear addresses in the background, gear keys keep working
+            ToggleRescan();
             break;
         }
 
-        case VK_INSERT: {
+        case KEY_ACTION_TOGGLE_WINDOW: {
             // Switch between the main console window and the gear display window
             SwitchWindows();
             break;
         }
 
+        case KEY_ACTION_SHOW_LATENCY: {
+            // Print the shift latencies measured so far to the main console window
+            PrintShiftLatency();
+            break;
+        }
+
         default: {
             break;
         }
     }
+}
+
+INT64 CALLBACK KeyboardHookProc(
+    int nCode,
+    WPARAM wParam,
+    LPARAM lParam
+) {
+    LPKBDLLHOOKSTRUCT lpKbdHookStruct = (LPKBDLLHOOKSTRUCT) lParam;
+#ifdef ENABLE_FOREGROUND_CHECK
+    LPFOCUS_TRACKER lpFocusTracker = &g_FocusTracker;
+#else
+    LPFOCUS_TRACKER lpFocusTracker = NULL;
+#endif
+    WORD wTarget;
+
+    if (HC_ACTION != nCode) {
+        goto _NEXT_HOOK;
+    }
+
+    if (WM_SYSKEYDOWN != wParam && WM_KEYDOWN != wParam) {
+        goto _NEXT_HOOK;
+    }
+
+    // Gears are posted to the writer thread and actions to the main thread,
+    // the hook returns right away
+    wTarget = HandleShifterKey(
+        (BYTE) lpKbdHookStruct->vkCode,
+        lpFocusTracker
+    );
+
+    if (wTarget <= GEAR_8) {
+        // Event times are GetTickCount() based
+        RecordShiftLatency(
+            SHIFT_LATENCY_INPUT,
+            (ULONGLONG) (GetTickCount() - lpKbdHookStruct->time) * 1000
+        );
+    }
 
 _NEXT_HOOK:
     return CallNextHookEx(
@@ -534,6 +903,16 @@ _NEXT_HOOK:
 }
 
 int main(int argc, const char *argv[]) {
+    LPCSTR szDumpPath = NULL;
+    LPCSTR szCorpusDirectory = NULL;
+    LPCSTR szWriteDumpPath = NULL;
+    LPCSTR szReplayTracePath = NULL;
+    BOOLEAN bReplayRealTime = FALSE;
+#ifdef __linux__
+    LPCSTR szEvdevPath = NULL;
+#endif
+    SIZE_T cbDumpHitRadius = DUMP_WRITER_DEFAULT_HIT_RADIUS;
+
     if (argc >= 2) {
         for (INT i = 1; i < argc; i++) {
             if (EXIT_SUCCESS == strncmp(
@@ -551,6 +930,88 @@ int main(int argc, const char *argv[]) {
             )) {
                 g_ShifterConfig.bSecondGearScan = TRUE;
             }
+
+            if (EXIT_SUCCESS == strncmp(
+                argv[i],
+                "--offline",
+                strlen("--offline")
+            ) && i + 1 < argc) {
+                szDumpPath = argv[++i];
+            }
+
+            // Before --dump, which is a prefix of it
+            if (EXIT_SUCCESS == strncmp(
+                argv[i],
+                "--dump-radius",
+                strlen("--dump-radius")
+            ) && i + 1 < argc) {
+                cbDumpHitRadius = (SIZE_T) strtoull(
+                    argv[++i],
+                    NULL,
+                    0
+                );
+            }
+
+            if (EXIT_SUCCESS == strncmp(
+                argv[i],
+                "--dump",
+                strlen("--dump")
+            ) && i + 1 < argc) {
+                szWriteDumpPath = argv[++i];
+            }
+
+            if (EXIT_SUCCESS == strncmp(
+                argv[i],
+                "--corpus",
+                strlen("--corpus")
+            ) && i + 1 < argc) {
+                szCorpusDirectory = argv[++i];
+            }
+
+            if (EXIT_SUCCESS == strncmp(
+                argv[i],
+                "--record",
+                strlen("--record")
+            ) && i + 1 < argc) {
+                g_szRecordTracePath = argv[++i];
+            }
+
+            // Before --replay, which is a prefix of it
+            if (EXIT_SUCCESS == strncmp(
+                argv[i],
+                "--replay-realtime",
+                strlen("--replay-realtime")
+            )) {
+                bReplayRealTime = TRUE;
+            } else if (EXIT_SUCCESS == strncmp(
+                argv[i],
+                "--replay",
+                strlen("--replay")
+            ) && i + 1 < argc) {
+                szReplayTracePath = argv[++i];
+            }
+
+#ifdef __linux__
+            if (EXIT_SUCCESS == strncmp(
+                argv[i],
+                "--host-pid",
+                strlen("--host-pid")
+            ) && i + 1 < argc) {
+                g_ShifterConfig.dwHostProcessId = strtoul(
+                    argv[++i],
+                    NULL,
+                    10
+                );
+            }
+
+            if (EXIT_SUCCESS == strncmp(
+                argv[i],
+                "--evdev",
+                strlen("--evdev")
+            ) && i + 1 < argc) {
+                szEvdevPath = argv[++i];
+            }
+#endif
         }
     }
     
@@ -570,6 +1031,28 @@ int main(int argc, const char *argv[]) {
         HSHIFTER_VERSION_PATCH
     );
 
+    if (
+        NULL != szDumpPath
+        || NULL != szCorpusDirectory
+        || NULL != szWriteDumpPath
+        || NULL != szReplayTracePath
+    ) {
+        if (!InitOfflineMode()) {
+            return EXIT_FAILURE;
+        }
+
+        CONST BOOLEAN bOfflineResult = (NULL != szWriteDumpPath)
+            ? WriteGameDump(szWriteDumpPath, cbDumpHitRadius)
+            : (NULL != szReplayTracePath)
+                ? ReplayMemoryTrace(szReplayTracePath, bReplayRealTime)
+                : (NULL != szDumpPath)
+                    ? ScanMemoryDump(szDumpPath)
+                    : ScanDumpCorpus(&g_SignaturePack, szCorpusDirectory);
+
+        CloseLogFile();
+        return bOfflineResult ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     printf(
         "[*] Initializing Shifter...\n"
     );
@@ -579,12 +1062,44 @@ int main(int argc, const char *argv[]) {
             stderr,
             "[-] Unable to initialize shifter.\n"
         );
+        // Keep the trace of the failed scan
+        StopMemoryRecording();
         system("pause");
         return EXIT_FAILURE;
     }
 
     printf("[+] Shifter initialized.\n");
 
+    if (!StartGearWriter()) {
+        system("pause");
+        goto _FINAL;
+    }
+
+#ifdef ENABLE_FOREGROUND_CHECK
+    // Notified on this thread, by the message loop below
+    InitWin32WindowSystem(&g_WindowSystem);
+
+    StartFocusTracker(
+        &g_FocusTracker,
+        &g_WindowSystem,
+        g_ShifterConfig.dwGameProcessId,
+        g_ShifterConfig.dwShifterProcessId
+    );
+#endif
+
+#ifdef __linux__
+#ifdef ENABLE_FOREGROUND_CHECK
+    LPFOCUS_TRACKER lpEvdevFocusTracker = &g_FocusTracker;
+#else
+    LPFOCUS_TRACKER lpEvdevFocusTracker = NULL;
+#endif
+
+    if (NULL != szEvdevPath && !StartEvdevInput(szEvdevPath, lpEvdevFocusTracker)) {
+        system("pause");
+        goto _FINAL;
+    }
+#endif
+
     hKeyboardHook = SetWindowsHookExA(
         WH_KEYBOARD_LL,
         KeyboardHookProc,
@@ -623,7 +1138,9 @@ int main(int argc, const char *argv[]) {
     }
 
     // Read for initial gear display
-    g_ShifterConfig.dwCurrentGear = ReadCurrentGear();
+    AcquireSRWLockExclusive(&g_ShifterState.Lock);
+    g_ShifterState.dwCurrentGear = ReadCurrentGear();
+    ReleaseSRWLockExclusive(&g_ShifterState.Lock);
 
     if (g_ShifterConfig.bGearWindowEnabled) {
         DrawAsciiGearDisplay();
@@ -635,10 +1152,21 @@ int main(int argc, const char *argv[]) {
         0,
         0
     ))) {
+        // Actions posted by the keyboard hook and the evdev input thread
+        if (WM_SHIFTER_ACTION == msg.message && NULL == msg.hwnd) {
+            DispatchKeyAction(
+                (WORD) msg.wParam
+            );
+            continue;
+        }
+
         TranslateMessage(&msg);
         DispatchMessageA(&msg);
     }
 
+    // Before the consoles are put back, a rescan switches them when it returns
+    StopRescan();
+
     if (!SetConsoleActiveScreenBuffer(
         g_ShifterConfig.hShifterConsole
     )) {
@@ -667,11 +1195,33 @@ int main(int argc, const char *argv[]) {
         );
     }
     
+    SHIFT_COMMIT_COUNTERS CommitCounters;
+    GetShiftCommitCounters(&CommitCounters);
+
+    printf(
+        "[*] Shifts: %ld accepted, %ld re-committed, %ld rejected, %ld superseded (%ld re-commits)\n",
+        CommitCounters.lAccepted,
+        CommitCounters.lRecommitted,
+        CommitCounters.lRejected,
+        CommitCounters.lSuperseded,
+        CommitCounters.lRecommits
+    );
+
+    PrintShiftLatency();
+
     printf("[+] Exiting..\n");
 
     iRet = EXIT_SUCCESS;
 
 _FINAL:
+#ifdef __linux__
+    StopEvdevInput();
+#endif
+    StopFocusTracker(&g_FocusTracker);
+    StopRescan();
+    StopGearWriter();
+    StopMemoryRecording();
+
     CloseHandle(
         g_ShifterConfig.hGearDisplayConsole
     );
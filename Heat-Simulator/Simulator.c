@@ -0,0 +1,675 @@
+/// H-shifter support for Need for Speed Heat.
+/// Copyright (C) 2025  x0reaxeax
+///
+/// This program is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/// @file Simulator.c
+/// @brief Stand-in for the game process, for end-to-end tests and benchmarks
+///  of the shifter without NFS Heat.
+///
+///  Built as NeedForSpeedHeat.exe with a "Need for Speed" window, so the shifter
+///  attaches to it like to the game, on Windows or under Wine. The simulator
+///  allocates heap-like noise, plants decoys of every signature of the default
+///  pack and one real struct per target gear, laid out like the signatures
+///  expect. A tick thread mutates the live fields and applies the gear writes
+///  of the shifter the way the game does.
+///
+///  Usage: NeedForSpeedHeat.exe [--seed <n>] [--heap-mib <n>] [--decoys <n>] [--tick-hz <n>] [--gears <n>]
+///
+///   - github.con/x0reaxeax/nfsheat-hshifter
+///
+
+#include <Windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Search.h"
+#include "SyntheticHeap.h"
+
+// Signature pack files of Search.c
+#pragma comment (lib, "Shlwapi.lib")
+
+#define SIM_WINDOW_CLASS                        "HeatSimulator"
+#define SIM_WINDOW_TITLE                        "Need for Speed Heat (Simulator)"
+
+#define SIM_DEFAULT_SEED                        0x1337
+#define SIM_DEFAULT_HEAP_MIB                    1024
+#define SIM_DEFAULT_DECOYS                      256                 // Per signature
+#define SIM_DEFAULT_TICK_HZ                     60
+#define SIM_DEFAULT_GEAR_COUNT                  7                   // Forward gears of the simulated car
+
+#define SIM_MIN_ALLOCATION_SIZE                 0x10000
+#define SIM_MAX_ALLOCATION_SIZE                 0x1000000
+#define SIM_STRUCT_MARGIN                       0x100               // Bytes of a planted struct on either side of its artifact
+#define SIM_PLANT_CELL_SIZE                     (2 * SIM_STRUCT_MARGIN)
+#define SIM_MAX_PLANT_ATTEMPTS                  64
+#define SIM_MAX_LIVE_DECOYS                     4096                // Decoys mutated every tick
+
+typedef enum _SIM_DECOY_KIND {
+    SIM_DECOY_STATIC = 0,               // Plausible gear, never changes
+    SIM_DECOY_BAD_GEAR,                 // Live, but the gear is out of range
+    SIM_DECOY_UNSTABLE,                 // Static field changes every tick
+    SIM_DECOY_VOLATILE_ARTIFACT,        // Pattern itself changes every tick
+    SIM_DECOY_KIND_COUNT,
+    SIM_DECOY_NONE = 0xFFFFFFFF         // Real struct
+} SIM_DECOY_KIND, *LPSIM_DECOY_KIND;
+
+typedef struct _SIM_ARTIFACT {
+    LPBYTE lpArtifact;
+    LPCSIGNATURE lpSignature;
+    SIM_DECOY_KIND eKind;
+    LONG lLiveFieldOffset;              // DWORD in live memory, clear of the pattern, gear and static fields
+} SIM_ARTIFACT, *LPSIM_ARTIFACT;
+
+typedef struct _SIM_CONFIG {
+    DWORD64 qwSeed;
+    SIZE_T cbHeap;
+    DWORD dwDecoys;
+    DWORD dwTickHz;
+    DWORD dwGearCount;
+} SIM_CONFIG, *LPSIM_CONFIG;
+
+typedef struct _SIMULATOR {
+    SIM_CONFIG Config;
+    SIGNATURE_PACK SignaturePack;
+    DWORD64 qwRandomState;
+
+    LPBYTE *alpAllocations;
+    PSIZE_T acbAllocations;
+    DWORD dwAllocationCount;
+
+    // Address cells holding a planted struct, open addressing
+    PDWORD64 aqwPlantCells;
+    DWORD64 qwPlantCellMask;
+
+    SIM_ARTIFACT aRealArtifacts[TARGET_GEAR_LAST + 1];
+    SIM_ARTIFACT aLiveDecoys[SIM_MAX_LIVE_DECOYS];
+    DWORD dwLiveDecoyCount;
+    DWORD adwDecoyCount[SIM_DECOY_KIND_COUNT];
+
+    DWORD dwGear;                       // Gear the car is in
+    DWORD64 qwTick;
+    VOLATILE LONG lStop;
+} SIMULATOR, *LPSIMULATOR;
+
+STATIC SIMULATOR g_Simulator = { 0 };
+
+STATIC BOOLEAN AllocateHeapNoise(
+    LPSIMULATOR lpSimulator
+) {
+    CONST DWORD dwMaxAllocations = (DWORD) (lpSimulator->Config.cbHeap / SIM_MIN_ALLOCATION_SIZE) + 1;
+    SIZE_T cbAllocated = 0;
+
+    lpSimulator->alpAllocations = VirtualAlloc(
+        NULL,
+        dwMaxAllocations * (sizeof(LPBYTE) + sizeof(SIZE_T)),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpSimulator->alpAllocations) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    lpSimulator->acbAllocations = (PSIZE_T) (lpSimulator->alpAllocations + dwMaxAllocations);
+
+    // Allocations of mixed sizes, so the address space is as fragmented as the game's
+    while (cbAllocated < lpSimulator->Config.cbHeap && lpSimulator->dwAllocationCount < dwMaxAllocations) {
+        SIZE_T cbAllocation = SIM_MIN_ALLOCATION_SIZE + (SIZE_T) NextRandomBelow(
+            &lpSimulator->qwRandomState,
+            SIM_MAX_ALLOCATION_SIZE - SIM_MIN_ALLOCATION_SIZE
+        );
+
+        cbAllocation &= ~((SIZE_T) PAGE_SIZE - 1);
+        cbAllocation = min(cbAllocation, max(lpSimulator->Config.cbHeap - cbAllocated, SIM_MIN_ALLOCATION_SIZE));
+
+        LPBYTE lpAllocation = VirtualAlloc(
+            NULL,
+            cbAllocation,
+            MEM_COMMIT | MEM_RESERVE,
+            PAGE_READWRITE
+        );
+
+        if (NULL == lpAllocation) {
+            fprintf(
+                stderr,
+                "[-] VirtualAlloc(): E%lu\n",
+                GetLastError()
+            );
+            return FALSE;
+        }
+
+        for (SIZE_T cbOffset = 0; cbOffset < cbAllocation; cbOffset += PAGE_SIZE) {
+            FillHeapPage(
+                &lpSimulator->qwRandomState,
+                (LPDWORD) (lpAllocation + cbOffset)
+            );
+        }
+
+        lpSimulator->alpAllocations[lpSimulator->dwAllocationCount] = lpAllocation;
+        lpSimulator->acbAllocations[lpSimulator->dwAllocationCount++] = cbAllocation;
+        cbAllocated += cbAllocation;
+    }
+
+    return TRUE;
+}
+
+STATIC PDWORD64 FindPlantCell(
+    LPSIMULATOR lpSimulator,
+    CONST DWORD64 qwCell
+) {
+    DWORD64 qwSlot = (qwCell * 0x9E3779B97F4A7C15ULL) & lpSimulator->qwPlantCellMask;
+
+    while (0 != lpSimulator->aqwPlantCells[qwSlot] && qwCell != lpSimulator->aqwPlantCells[qwSlot]) {
+        qwSlot = (qwSlot + 1) & lpSimulator->qwPlantCellMask;
+    }
+
+    return &lpSimulator->aqwPlantCells[qwSlot];
+}
+
+/// Claims the cell of an artifact address if neither it nor its neighbours
+/// hold a planted struct, so the fields of two structs never overlap.
+STATIC BOOLEAN ClaimPlantCell(
+    LPSIMULATOR lpSimulator,
+    LPCBYTE lpAddress
+) {
+    CONST DWORD64 qwCell = (DWORD64) lpAddress / SIM_PLANT_CELL_SIZE;
+
+    for (DWORD64 qwNeighbour = qwCell - 1; qwNeighbour <= qwCell + 1; ++qwNeighbour) {
+        if (0 != *FindPlantCell(lpSimulator, qwNeighbour)) {
+            return FALSE;
+        }
+    }
+
+    *FindPlantCell(lpSimulator, qwCell) = qwCell;
+    return TRUE;
+}
+
+/// Picks a free artifact address with the alignment of the signature and
+/// the gear address nibble of the game. NULL if the heap is too crowded.
+STATIC LPBYTE FindPlantAddress(
+    LPSIMULATOR lpSimulator,
+    LPCSIGNATURE lpSignature
+) {
+    for (DWORD i = 0; i < SIM_MAX_PLANT_ATTEMPTS; ++i) {
+        CONST DWORD dwIndex = (DWORD) NextRandomBelow(
+            &lpSimulator->qwRandomState,
+            lpSimulator->dwAllocationCount
+        );
+
+        LPBYTE lpAllocationEnd = lpSimulator->alpAllocations[dwIndex] + lpSimulator->acbAllocations[dwIndex];
+        LPBYTE lpAddress = AlignArtifactAddress(
+            lpSignature,
+            lpSimulator->alpAllocations[dwIndex] + SIM_STRUCT_MARGIN + NextRandomBelow(
+                &lpSimulator->qwRandomState,
+                lpSimulator->acbAllocations[dwIndex] - 3 * SIM_STRUCT_MARGIN
+            )
+        );
+
+        if (lpAddress + SIM_STRUCT_MARGIN <= lpAllocationEnd && ClaimPlantCell(
+            lpSimulator,
+            lpAddress
+        )) {
+            return lpAddress;
+        }
+    }
+
+    return NULL;
+}
+
+STATIC VOID PlantSimArtifact(
+    LPSIMULATOR lpSimulator,
+    LPSIM_ARTIFACT lpArtifact,
+    CONST DWORD dwGear
+) {
+    PlantArtifact(
+        &lpSimulator->qwRandomState,
+        lpArtifact->lpSignature,
+        lpArtifact->lpArtifact,
+        dwGear
+    );
+
+    lpArtifact->lLiveFieldOffset = GetLiveFieldOffset(lpArtifact->lpSignature);
+}
+
+STATIC BOOLEAN PlantArtifacts(
+    LPSIMULATOR lpSimulator
+) {
+    LPCSIGNATURE_PACK lpSignaturePack = &lpSimulator->SignaturePack;
+    CONST DWORD64 qwPlantCount = (DWORD64) lpSignaturePack->dwSignatureCount * (lpSimulator->Config.dwDecoys + 1);
+    DWORD64 qwCellCount = 1;
+
+    // At most a quarter full
+    while (qwCellCount < 4 * qwPlantCount) {
+        qwCellCount <<= 1;
+    }
+
+    lpSimulator->qwPlantCellMask = qwCellCount - 1;
+    lpSimulator->aqwPlantCells = VirtualAlloc(
+        NULL,
+        (SIZE_T) qwCellCount * sizeof(DWORD64),
+        MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE
+    );
+
+    if (NULL == lpSimulator->aqwPlantCells) {
+        fprintf(
+            stderr,
+            "[-] VirtualAlloc(): E%lu\n",
+            GetLastError()
+        );
+        return FALSE;
+    }
+
+    // Real structs first, so a crowded heap only runs out of decoys
+    for (DWORD i = 0; i < lpSignaturePack->dwSignatureCount; ++i) {
+        LPCSIGNATURE lpSignature = &lpSignaturePack->aSignatures[i];
+        LPSIM_ARTIFACT lpReal = &lpSimulator->aRealArtifacts[lpSignature->eTargetGear];
+
+        if (NULL != lpReal->lpArtifact) {
+            continue;
+        }
+
+        lpReal->lpSignature = lpSignature;
+        lpReal->eKind = SIM_DECOY_NONE;
+        lpReal->lpArtifact = FindPlantAddress(
+            lpSimulator,
+            lpSignature
+        );
+
+        if (NULL == lpReal->lpArtifact) {
+            fprintf(
+                stderr,
+                "[-] No room for the real '%s' struct.\n",
+                lpSignature->szName
+            );
+            return FALSE;
+        }
+
+        PlantSimArtifact(
+            lpSimulator,
+            lpReal,
+            lpSimulator->dwGear
+        );
+
+        printf(
+            "[+] Real '%s' artifact: 0x%llX, gear address: 0x%llX\n",
+            lpSignature->szName,
+            (DWORD64) lpReal->lpArtifact,
+            (DWORD64) (lpReal->lpArtifact + lpSignature->lGearOffset)
+        );
+    }
+
+    for (DWORD i = 0; i < lpSignaturePack->dwSignatureCount; ++i) {
+        for (DWORD j = 0; j < lpSimulator->Config.dwDecoys; ++j) {
+            SIM_ARTIFACT simDecoy = {
+                .lpSignature = &lpSignaturePack->aSignatures[i],
+                .eKind = (SIM_DECOY_KIND) (j % SIM_DECOY_KIND_COUNT)
+            };
+
+            // Only static decoys are left once the live ones run out
+            if (SIM_DECOY_STATIC != simDecoy.eKind && SIM_MAX_LIVE_DECOYS == lpSimulator->dwLiveDecoyCount) {
+                simDecoy.eKind = SIM_DECOY_STATIC;
+            }
+
+            simDecoy.lpArtifact = FindPlantAddress(
+                lpSimulator,
+                simDecoy.lpSignature
+            );
+
+            if (NULL == simDecoy.lpArtifact) {
+                printf(
+                    "[*] Heap is full after %lu '%s' decoys.\n",
+                    j,
+                    simDecoy.lpSignature->szName
+                );
+                break;
+            }
+
+            PlantSimArtifact(
+                lpSimulator,
+                &simDecoy,
+                (SIM_DECOY_BAD_GEAR == simDecoy.eKind)
+                    ? GEAR_8 + 1 + (DWORD) NextRandomBelow(&lpSimulator->qwRandomState, 0x100)
+                    : GEAR_NEUTRAL + (DWORD) NextRandomBelow(&lpSimulator->qwRandomState, GEAR_8)
+            );
+
+            lpSimulator->adwDecoyCount[simDecoy.eKind]++;
+
+            if (SIM_DECOY_STATIC != simDecoy.eKind) {
+                lpSimulator->aLiveDecoys[lpSimulator->dwLiveDecoyCount++] = simDecoy;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/// Applies gear writes like the game does. A gear the car has is engaged,
+/// anything else is overwritten with the engaged gear, and the previous gear
+/// field always follows the current one.
+STATIC VOID ApplyGearWrites(
+    LPSIMULATOR lpSimulator
+) {
+    LPSIM_ARTIFACT lpCurrent = &lpSimulator->aRealArtifacts[TARGET_GEAR_CURRENT];
+    LPSIM_ARTIFACT lpLast = &lpSimulator->aRealArtifacts[TARGET_GEAR_LAST];
+
+    if (NULL == lpCurrent->lpArtifact) {
+        return;
+    }
+
+    VOLATILE DWORD *lpCurrentGear = (VOLATILE DWORD *) (lpCurrent->lpArtifact + lpCurrent->lpSignature->lGearOffset);
+    CONST DWORD dwRequested = *lpCurrentGear;
+
+    if (dwRequested != lpSimulator->dwGear) {
+        if (dwRequested <= GEAR_1 + lpSimulator->Config.dwGearCount - 1) {
+            printf(
+                "[*] Tick %llu: shifted %lu -> %lu\n",
+                lpSimulator->qwTick,
+                lpSimulator->dwGear,
+                dwRequested
+            );
+            lpSimulator->dwGear = dwRequested;
+        } else {
+            printf(
+                "[*] Tick %llu: rejected gear %lu\n",
+                lpSimulator->qwTick,
+                dwRequested
+            );
+        }
+    }
+
+    *lpCurrentGear = lpSimulator->dwGear;
+
+    if (NULL != lpLast->lpArtifact) {
+        *(VOLATILE DWORD *) (lpLast->lpArtifact + lpLast->lpSignature->lGearOffset) = lpSimulator->dwGear;
+    }
+}
+
+STATIC VOID SimulateTick(
+    LPSIMULATOR lpSimulator
+) {
+    // Engine and wheel state of the car
+    for (DWORD i = 0; i <= TARGET_GEAR_LAST; ++i) {
+        LPSIM_ARTIFACT lpReal = &lpSimulator->aRealArtifacts[i];
+
+        if (NULL != lpReal->lpArtifact) {
+            *(VOLATILE DWORD *) (lpReal->lpArtifact + lpReal->lLiveFieldOffset) = (DWORD) NextRandom(&lpSimulator->qwRandomState);
+        }
+    }
+
+    for (DWORD i = 0; i < lpSimulator->dwLiveDecoyCount; ++i) {
+        LPSIM_ARTIFACT lpDecoy = &lpSimulator->aLiveDecoys[i];
+        LPCSIGNATURE lpSignature = lpDecoy->lpSignature;
+
+        switch (lpDecoy->eKind) {
+            case SIM_DECOY_BAD_GEAR:
+                *(VOLATILE DWORD *) (lpDecoy->lpArtifact + lpDecoy->lLiveFieldOffset) = (DWORD) NextRandom(&lpSimulator->qwRandomState);
+                break;
+
+            case SIM_DECOY_UNSTABLE:
+                *(VOLATILE DWORD *) (lpDecoy->lpArtifact + lpSignature->lStaticOffset) = (DWORD) NextRandom(&lpSimulator->qwRandomState);
+                *(VOLATILE DWORD *) (lpDecoy->lpArtifact + lpDecoy->lLiveFieldOffset) = (DWORD) NextRandom(&lpSimulator->qwRandomState);
+                break;
+
+            case SIM_DECOY_VOLATILE_ARTIFACT:
+                // Matches every other tick
+                lpDecoy->lpArtifact[lpSignature->SearchPattern.cbPatternSize - 1] ^= 0x01;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    ApplyGearWrites(lpSimulator);
+    lpSimulator->qwTick++;
+}
+
+STATIC DWORD WINAPI SimulatorThread(
+    LPVOID lpParameter
+) {
+    LPSIMULATOR lpSimulator = (LPSIMULATOR) lpParameter;
+    LARGE_INTEGER liFrequency, liNow;
+
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liNow);
+
+    CONST LONGLONG llTickLength = liFrequency.QuadPart / lpSimulator->Config.dwTickHz;
+    LONGLONG llNextTick = liNow.QuadPart;
+
+    while (!lpSimulator->lStop) {
+        SimulateTick(lpSimulator);
+
+        // Fixed rate, late ticks don't shift the ones after them
+        llNextTick += llTickLength;
+        QueryPerformanceCounter(&liNow);
+
+        if (llNextTick > liNow.QuadPart) {
+            Sleep((DWORD) ((llNextTick - liNow.QuadPart) * 1000 / liFrequency.QuadPart));
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+STATIC LRESULT CALLBACK SimulatorWindowProc(
+    HWND hWnd,
+    UINT uMsg,
+    WPARAM wParam,
+    LPARAM lParam
+) {
+    if (WM_DESTROY == uMsg) {
+        PostQuitMessage(EXIT_SUCCESS);
+        return 0;
+    }
+
+    return DefWindowProcA(
+        hWnd,
+        uMsg,
+        wParam,
+        lParam
+    );
+}
+
+STATIC HWND CreateSimulatorWindow(
+    VOID
+) {
+    CONST WNDCLASSEXA wndClass = {
+        .cbSize = sizeof(WNDCLASSEXA),
+        .lpfnWndProc = SimulatorWindowProc,
+        .hInstance = GetModuleHandleA(NULL),
+        .hCursor = LoadCursor(NULL, IDC_ARROW),
+        .hbrBackground = (HBRUSH) (COLOR_WINDOW + 1),
+        .lpszClassName = SIM_WINDOW_CLASS
+    };
+
+    if (0 == RegisterClassExA(&wndClass)) {
+        fprintf(
+            stderr,
+            "[-] RegisterClassExA(): E%lu\n",
+            GetLastError()
+        );
+        return NULL;
+    }
+
+    HWND hWnd = CreateWindowExA(
+        0,
+        SIM_WINDOW_CLASS,
+        SIM_WINDOW_TITLE,
+        WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+        CW_USEDEFAULT,
+        CW_USEDEFAULT,
+        640,
+        360,
+        NULL,
+        NULL,
+        wndClass.hInstance,
+        NULL
+    );
+
+    if (NULL == hWnd) {
+        fprintf(
+            stderr,
+            "[-] CreateWindowExA(): E%lu\n",
+            GetLastError()
+        );
+    }
+
+    return hWnd;
+}
+
+STATIC VOID ParseSimulatorArguments(
+    LPSIM_CONFIG lpConfig,
+    int argc,
+    const char *argv[]
+) {
+    for (INT i = 1; i + 1 < argc; i++) {
+        if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--seed",
+            strlen("--seed")
+        )) {
+            lpConfig->qwSeed = strtoull(argv[++i], NULL, 0);
+        } else if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--heap-mib",
+            strlen("--heap-mib")
+        )) {
+            lpConfig->cbHeap = (SIZE_T) strtoull(argv[++i], NULL, 0) << 20;
+        } else if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--decoys",
+            strlen("--decoys")
+        )) {
+            lpConfig->dwDecoys = strtoul(argv[++i], NULL, 0);
+        } else if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--tick-hz",
+            strlen("--tick-hz")
+        )) {
+            lpConfig->dwTickHz = strtoul(argv[++i], NULL, 0);
+        } else if (EXIT_SUCCESS == strncmp(
+            argv[i],
+            "--gears",
+            strlen("--gears")
+        )) {
+            lpConfig->dwGearCount = strtoul(argv[++i], NULL, 0);
+        }
+    }
+
+    lpConfig->cbHeap = max(lpConfig->cbHeap, 4 * SIM_MIN_ALLOCATION_SIZE);
+    lpConfig->dwTickHz = max(lpConfig->dwTickHz, 1);
+    lpConfig->dwGearCount = min(max(lpConfig->dwGearCount, 1), GEAR_8 - GEAR_1 + 1);
+}
+
+int main(int argc, const char *argv[]) {
+    LPSIMULATOR lpSimulator = &g_Simulator;
+    HANDLE hThread = NULL;
+    MSG msg = { 0 };
+
+    lpSimulator->Config = (SIM_CONFIG) {
+        .qwSeed = SIM_DEFAULT_SEED,
+        .cbHeap = (SIZE_T) SIM_DEFAULT_HEAP_MIB << 20,
+        .dwDecoys = SIM_DEFAULT_DECOYS,
+        .dwTickHz = SIM_DEFAULT_TICK_HZ,
+        .dwGearCount = SIM_DEFAULT_GEAR_COUNT
+    };
+
+    ParseSimulatorArguments(
+        &lpSimulator->Config,
+        argc,
+        argv
+    );
+
+    lpSimulator->qwRandomState = lpSimulator->Config.qwSeed | 1;
+    lpSimulator->dwGear = GEAR_1;
+
+    InitDefaultSignaturePack(&lpSimulator->SignaturePack);
+
+    printf(
+        "[*] Heat simulator: seed 0x%llX, %llu MiB heap, %lu decoys per signature, %lu Hz, %lu gears\n",
+        lpSimulator->Config.qwSeed,
+        (DWORD64) lpSimulator->Config.cbHeap >> 20,
+        lpSimulator->Config.dwDecoys,
+        lpSimulator->Config.dwTickHz,
+        lpSimulator->Config.dwGearCount
+    );
+
+    if (!AllocateHeapNoise(lpSimulator)) {
+        return EXIT_FAILURE;
+    }
+
+    if (!PlantArtifacts(lpSimulator)) {
+        return EXIT_FAILURE;
+    }
+
+    printf(
+        "[*] %lu allocations, decoys: %lu static, %lu bad gear, %lu unstable, %lu volatile\n",
+        lpSimulator->dwAllocationCount,
+        lpSimulator->adwDecoyCount[SIM_DECOY_STATIC],
+        lpSimulator->adwDecoyCount[SIM_DECOY_BAD_GEAR],
+        lpSimulator->adwDecoyCount[SIM_DECOY_UNSTABLE],
+        lpSimulator->adwDecoyCount[SIM_DECOY_VOLATILE_ARTIFACT]
+    );
+
+    if (NULL == CreateSimulatorWindow()) {
+        return EXIT_FAILURE;
+    }
+
+    hThread = CreateThread(
+        NULL,
+        0,
+        SimulatorThread,
+        lpSimulator,
+        0,
+        NULL
+    );
+
+    if (NULL == hThread) {
+        fprintf(
+            stderr,
+            "[-] CreateThread(): E%lu\n",
+            GetLastError()
+        );
+        return EXIT_FAILURE;
+    }
+
+    printf("[+] Running, close the window to exit.\n");
+
+    while (GetMessageA(
+        &msg,
+        NULL,
+        0,
+        0
+    ) > 0) {
+        TranslateMessage(&msg);
+        DispatchMessageA(&msg);
+    }
+
+    InterlockedExchange(&lpSimulator->lStop, TRUE);
+    WaitForSingleObject(
+        hThread,
+        INFINITE
+    );
+
+    CloseHandle(hThread);
+
+    return EXIT_SUCCESS;
+}